@@ -3,7 +3,16 @@ setlocal
 
 if not exist build mkdir build
 
-set CF=/Zi /nologo
+set CF=/Zi /nologo /arch:AVX2
 set LF=/link vulkan-1.lib user32.lib gdi32.lib shell32.lib shlwapi.lib
 
+call build_shaders.bat || exit /b 1
+
+if not exist code\generated mkdir code\generated
+clang-cl /O2 /nologo /Fe:build\text_lexer_generator.exe code\text_lexer_generator.c
+build\text_lexer_generator.exe code\generated\text_lexers.h code\lexers\text.lexer code\lexers\c.lexer code\lexers\python.lexer code\lexers\json.lexer || exit /b 1
+
 clang-cl %CF% /Fe:build\text.exe code\text.c %LF%
+
+rem the host exports what plugins call, into build\text.lib
+clang-cl %CF% /LD /Icode /Fe:build\text_terminal.dll text_terminal.c /link build\text.lib
@@ -2,7 +2,17 @@
 
 mkdir -p build
 
-CF='-O0 -g'
-LF=-lm
+CF='-O0 -g -mavx2'
+LF='-lm -ldl -lvulkan'
 
-clang $CF -o build/editor code/editor.c $LF
+glslc code/shader.vert -o data/vert.spv || exit 1
+glslc code/shader.frag -o data/frag.spv || exit 1
+glslc code/shader_ui.vert -o data/ui_vert.spv || exit 1
+glslc code/shader_ui.frag -o data/ui_frag.spv || exit 1
+
+mkdir -p code/generated
+clang -O2 -o build/text_lexer_generator code/text_lexer_generator.c
+build/text_lexer_generator code/generated/text_lexers.h code/lexers/text.lexer code/lexers/c.lexer code/lexers/python.lexer code/lexers/json.lexer || exit 1
+
+clang $CF -rdynamic -o build/text code/text.c $LF
+clang $CF -shared -fPIC -fvisibility=hidden -Icode -o build/text_terminal.so text_terminal.c
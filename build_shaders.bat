@@ -1,4 +1,6 @@
 @echo off
 
-glslc code\shader.vert -o data\vert.spv
-glslc code\shader.frag -o data\frag.spv
+glslc code\shader.vert -o data\vert.spv || exit /b 1
+glslc code\shader.frag -o data\frag.spv || exit /b 1
+glslc code\shader_ui.vert -o data\ui_vert.spv || exit /b 1
+glslc code\shader_ui.frag -o data\ui_frag.spv || exit /b 1
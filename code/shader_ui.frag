@@ -0,0 +1,16 @@
+#version 450
+
+/* the set of the quad's texture, bound by `ui_record_batches` */
+layout(set = 0, binding = 0) uniform sampler2D glyphs;
+
+layout(location = 0) in vec3 fragment_color;
+layout(location = 1) in vec2 fragment_coordinates;
+layout(location = 2) flat in uint fragment_texture;
+
+layout(location = 0) out vec4 color;
+
+void main()
+{
+    float coverage = fragment_texture == 0 ? 1.0 : texture(glyphs, fragment_coordinates).r;
+    color = vec4(fragment_color, coverage);
+}
@@ -0,0 +1,32 @@
+#version 450
+
+/* one instance per `ui_quad` */
+layout(location = 0) in vec4 range;
+layout(location = 1) in uint texture;
+layout(location = 2) in uint layer;
+layout(location = 3) in uint glyph;
+
+layout(push_constant) uniform constants
+{
+	vec2 frame_size;
+};
+
+layout(location = 0) out vec3 fragment_color;
+layout(location = 1) out vec2 fragment_coordinates;
+layout(location = 2) flat out uint fragment_texture;
+
+/* the glyphs are one under the other, as many as `FONT_GLYPHS_CAPACITY` */
+const float glyphs_count = 128.0;
+
+void main()
+{
+	/* two triangles: 0 1 2, 2 1 3 */
+	const uint corners[6] = uint[](0, 1, 2, 2, 1, 3);
+	uint corner = corners[gl_VertexIndex];
+	vec2 position = vec2((corner & 1) == 0 ? range.x : range.z, (corner & 2) == 0 ? range.y : range.w);
+
+	gl_Position = vec4(position / frame_size * 2.0 - 1.0, 0.0, 1.0);
+	fragment_color = texture == 0 ? vec3(0.12 + 0.04 * float(layer)) : vec3(0.9);
+	fragment_coordinates = vec2(float(corner & 1), (float(glyph) + float((corner & 2) >> 1)) / glyphs_count);
+	fragment_texture = texture;
+}
@@ -13,58 +13,76 @@ thread_local struct context context =
 {
 };
 
-void _report(const char *file, uint line, severity severity, const char *message, ...)
+/* the printable runes of ASCII are rasterized when a font is loaded */
+#define FONT_INITIAL_FIRST_RUNE ' '
+#define FONT_INITIAL_LAST_RUNE  '~'
+
+font default_font;
+
+typedef struct
 {
-	const char *severity_representations[] =
-	{
-		[SEVERITY_VERBOSE] = "VERBOSE",
-		[SEVERITY_COMMENT] = "COMMENT",
-		[SEVERITY_CAUTION] = "CAUTION",
-		[SEVERITY_FAILURE] = "FAILURE",
-	};
-	printf("[%s] %s:%u: ", severity_representations[severity], file, line);
+	font *font;
+	uint  rune;
+	sint  baseline;  /* in the glyph's cell */
+} glyph_rasterization;
 
-	va_list vargs;
-	va_start(vargs, message);
-	vprintf(message, vargs);
-	va_end(vargs);
+/* places the glyph on the cell's baseline, clipped to the cell */
+static void rasterize_glyph(void *parameter)
+{
+	const glyph_rasterization *rasterization = parameter;
+	font *font = rasterization->font;
+	int left, top, right, base;
+	stbtt_GetCodepointBitmapBox(&font->info, rasterization->rune, font->scale, font->scale, &left, &top, &right, &base);
+	sint x = clamp(left, 0, (sint)font->glyph_width);
+	sint y = clamp(rasterization->baseline + top, 0, (sint)font->glyph_height);
+	stbtt_MakeCodepointBitmap(
+		&font->info,
+		font->glyphs + rasterization->rune * font->glyph_size + y * font->glyph_width + x,
+		font->glyph_width - x,
+		font->glyph_height - y,
+		font->glyph_width,
+		font->scale,
+		font->scale,
+		rasterization->rune);
 }
 
-static const utf32 initial_runes_of_font[] = { 'A', 'B' };
-
 void load_font(const char *font_file_path, uintb font_index, font *font)
 {
 	font->file = open_file(font_file_path);
 	font->data_size = get_size_of_file(font->file);
-	font->data = allocate(font->data_size);
+	font->data = allocate(font->data_size, ALLOCATION_TAG_FONT);
 	read_from_file(font->data, font->data_size, font->file);
 
 	stbtt_InitFont(&font->info, font->data, stbtt_GetFontOffsetForIndex(font->data, font_index));
 	font->scale = stbtt_ScaleForPixelHeight(&font->info, FONT_DEFAULT_HEIGHT);
 	int right, left, top, base;
 	stbtt_GetCodepointBitmapBox(&font->info, 'W', font->scale, font->scale, &left, &top, &right, &base);
-	font->glyph_width = right - left;
-	font->glyph_size = (base - top) * font->glyph_width;
-	font->glyphs = allocate(FONT_GLYPHS_CAPACITY * font->glyph_size);
-	for (uint i = 0; i < countof(initial_runes_of_font); ++i)
-	{
-		byte *glyph = font->glyphs + (i * font->glyph_size);
-		stbtt_MakeCodepointBitmap(
-			&font->info,
-			glyph,
-			font->glyph_width,
-			font->glyph_size / font->glyph_width,
-			font->glyph_width,
-			font->scale,
-			font->scale,
-			initial_runes_of_font[i]);
-	}
+	font->glyph_width  = right - left;
+	font->glyph_height = FONT_DEFAULT_HEIGHT;
+	font->glyph_size   = font->glyph_height * font->glyph_width;
+	font->glyphs = allocate(FONT_GLYPHS_CAPACITY * font->glyph_size, ALLOCATION_TAG_FONT);
+	zero(font->glyphs, FONT_GLYPHS_CAPACITY * font->glyph_size);
+	int ascent, descent, line_gap;
+	stbtt_GetFontVMetrics(&font->info, &ascent, &descent, &line_gap);
+
+	/* the glyphs do not depend on each other, so they are rasterized at once */
+	glyph_rasterization rasterizations[FONT_INITIAL_LAST_RUNE - FONT_INITIAL_FIRST_RUNE + 1];
+	job_counter         counter = {0};
 	zero(font->glyphs_flags, sizeof(font->glyphs_flags));
+	for (uint rune = FONT_INITIAL_FIRST_RUNE; rune <= FONT_INITIAL_LAST_RUNE; ++rune)
+	{
+		glyph_rasterization *rasterization = &rasterizations[rune - FONT_INITIAL_FIRST_RUNE];
+		*rasterization = (glyph_rasterization){ font, rune, (sint)(ascent * font->scale) };
+		push_job(rasterize_glyph, rasterization, &counter);
+		font->glyphs_flags[rune / 64] |= (bit64)1 << (rune % 64);
+	}
+	wait_for_jobs(&counter);
 }
 
 void unload_font(font *font)
 {
-	deallocate(font->glyphs, font->glyph_size * FONT_GLYPHS_CAPACITY);
+	deallocate(font->glyphs, font->glyph_size * FONT_GLYPHS_CAPACITY, ALLOCATION_TAG_FONT);
+	deallocate(font->data, font->data_size, ALLOCATION_TAG_FONT);
 	close_file(font->file);
 }
 
@@ -88,11 +106,245 @@ inline void zero(void *memory, uint size)
 	fill(memory, size, 0);
 }
 
+inline int compare(const void *left, const void *right, uint size)
+{
+	return memcmp(left, right, size);
+}
+
 inline int compare_string(const char *left, const char *right)
 {
 	return strcmp(left, right);
 }
 
+const char *allocation_tag_representations[ALLOCATION_TAGS_COUNT] =
+{
+	[ALLOCATION_TAG_FONT]       = "font",
+	[ALLOCATION_TAG_UI]         = "ui",
+	[ALLOCATION_TAG_BUFFER]     = "buffer",
+	[ALLOCATION_TAG_SEARCH]     = "search",
+	[ALLOCATION_TAG_HIGHLIGHT]  = "highlight",
+	[ALLOCATION_TAG_VULKAN]     = "vulkan",
+	[ALLOCATION_TAG_TERMINAL]   = "terminal",
+	[ALLOCATION_TAG_SCROLLBACK] = "scrollback",
+	[ALLOCATION_TAG_MAPPINGS]   = "mappings",
+	[ALLOCATION_TAG_JOBS]       = "jobs",
+	[ALLOCATION_TAG_REPORTS]    = "reports",
+	[ALLOCATION_TAG_PLUGIN]     = "plugin",
+	[ALLOCATION_TAG_FRAME]      = "frame",
+};
+
+inline static uint get_allocation_size(uint size)
+{
+	return (size + ALLOCATION_PAGE_SIZE - 1) & ~(uint)(ALLOCATION_PAGE_SIZE - 1);
+}
+
+void *allocate(uint size, allocation_tag tag)
+{
+	assert(tag < ALLOCATION_TAGS_COUNT);
+	allocation_statistics *statistics = &global.allocations[tag];
+	uint                   pages_size = get_allocation_size(size);
+
+	uintl live_size = atomic_fetch_add_explicit(&statistics->live_size, pages_size, memory_order_relaxed) + pages_size;
+	uintl peak_size = atomic_load_explicit(&statistics->peak_size, memory_order_relaxed);
+	while (live_size > peak_size && !atomic_compare_exchange_weak_explicit(&statistics->peak_size, &peak_size, live_size, memory_order_relaxed, memory_order_relaxed));
+	atomic_fetch_add_explicit(&statistics->live_count, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&statistics->allocated_size, pages_size, memory_order_relaxed);
+	atomic_fetch_add_explicit(&statistics->allocations_count, 1, memory_order_relaxed);
+	return allocate_pages(size);
+}
+
+void deallocate(void *memory, uint size, allocation_tag tag)
+{
+	assert(tag < ALLOCATION_TAGS_COUNT);
+	allocation_statistics *statistics = &global.allocations[tag];
+	uint                   pages_size = get_allocation_size(size);
+
+	/* a size that differs from the allocation's would show here, sooner or later */
+	assert(atomic_load_explicit(&statistics->live_size, memory_order_relaxed) >= pages_size);
+	atomic_fetch_sub_explicit(&statistics->live_size, pages_size, memory_order_relaxed);
+	atomic_fetch_sub_explicit(&statistics->live_count, 1, memory_order_relaxed);
+	deallocate_pages(memory, size);
+}
+
+void update_allocation_rates(float32 elapsed_time)
+{
+	for (uint i = 0; i < ALLOCATION_TAGS_COUNT; ++i)
+	{
+		allocation_statistics *statistics     = &global.allocations[i];
+		uintl                  allocated_size = atomic_load_explicit(&statistics->allocated_size, memory_order_relaxed);
+		statistics->allocation_rate     = (float32)(allocated_size - statistics->last_allocated_size) / elapsed_time;
+		statistics->last_allocated_size = allocated_size;
+	}
+}
+
+void report_allocations(void)
+{
+	for (uint i = 0; i < ALLOCATION_TAGS_COUNT; ++i)
+	{
+		allocation_statistics *statistics = &global.allocations[i];
+		uintl live_size  = atomic_load(&statistics->live_size);
+		uintl live_count = atomic_load(&statistics->live_count);
+		uintl peak_size  = atomic_load(&statistics->peak_size);
+		if (live_count) report_caution("%s: %llu allocations of %llu bytes are live; %llu bytes at peak\n", allocation_tag_representations[i], live_count, live_size, peak_size);
+		else            report_verbose("%s: %llu bytes at peak, %llu bytes in %llu allocations\n", allocation_tag_representations[i], peak_size, atomic_load(&statistics->allocated_size), atomic_load(&statistics->allocations_count));
+	}
+}
+
+void initialize_arena(uint capacity, allocation_tag tag, arena *arena)
+{
+	arena->memory   = allocate(capacity, tag);
+	arena->capacity = capacity;
+	arena->mass     = 0;
+	arena->tag      = tag;
+}
+
+void terminate_arena(arena *arena)
+{
+	deallocate(arena->memory, arena->capacity, arena->tag);
+	zero(arena, sizeof(*arena));
+}
+
+void *push_into_arena(uint size, uint alignment, arena *arena)
+{
+	uint offset = (arena->mass + (alignment - 1)) & ~(alignment - 1);
+	assert(offset + size <= arena->capacity);
+	arena->mass = offset + size;
+	return arena->memory + offset;
+}
+
+inline void reset_arena(arena *arena)
+{
+	arena->mass = 0;
+}
+
+void initialize_ring(uint capacity, allocation_tag tag, ring *ring)
+{
+	assert(capacity && !(capacity & (capacity - 1)));
+	ring->memory   = allocate(capacity, tag);
+	ring->capacity = capacity;
+	ring->tag      = tag;
+	atomic_init(&ring->head, 0);
+	atomic_init(&ring->tail, 0);
+}
+
+void terminate_ring(ring *ring)
+{
+	deallocate(ring->memory, ring->capacity, ring->tag);
+	ring->memory = 0;
+}
+
+byte *begin_ring_write(uint *size, ring *ring)
+{
+	uintl head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	uintl tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+	uint  offset = head & (ring->capacity - 1);
+	uint  free_size = ring->capacity - (uint)(head - tail);
+	uint  contiguous_size = ring->capacity - offset;
+	*size = free_size < contiguous_size ? free_size : contiguous_size;
+	return ring->memory + offset;
+}
+
+void end_ring_write(uint size, ring *ring)
+{
+	atomic_fetch_add_explicit(&ring->head, size, memory_order_release);
+}
+
+const byte *begin_ring_read(uint *size, ring *ring)
+{
+	uintl tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	uintl head = atomic_load_explicit(&ring->head, memory_order_acquire);
+	uint  offset = tail & (ring->capacity - 1);
+	uint  used_size = (uint)(head - tail);
+	uint  contiguous_size = ring->capacity - offset;
+	*size = used_size < contiguous_size ? used_size : contiguous_size;
+	return ring->memory + offset;
+}
+
+void end_ring_read(uint size, ring *ring)
+{
+	atomic_fetch_add_explicit(&ring->tail, size, memory_order_release);
+}
+
+uint write_to_ring(const void *data, uint size, ring *ring)
+{
+	uint written_size = 0;
+	while (written_size < size)
+	{
+		uint available_size;
+		byte *region = begin_ring_write(&available_size, ring);
+		if (!available_size) break;
+		if (available_size > size - written_size) available_size = size - written_size;
+		copy(region, (const byte *)data + written_size, available_size);
+		end_ring_write(available_size, ring);
+		written_size += available_size;
+	}
+	return written_size;
+}
+
+uint read_from_ring(void *buffer, uint size, ring *ring)
+{
+	uint read_size = 0;
+	while (read_size < size)
+	{
+		uint available_size;
+		const byte *region = begin_ring_read(&available_size, ring);
+		if (!available_size) break;
+		if (available_size > size - read_size) available_size = size - read_size;
+		copy((byte *)buffer + read_size, region, available_size);
+		end_ring_read(available_size, ring);
+		read_size += available_size;
+	}
+	return read_size;
+}
+
+bit push_input_event(const input_event *event, input_queue *queue)
+{
+	uint32 head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+	uint32 tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+	if (head - tail == INPUT_QUEUE_CAPACITY) return 0;
+	queue->events[head & (INPUT_QUEUE_CAPACITY - 1)] = *event;
+	atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+	return 1;
+}
+
+bit pop_input_event(input_event *event, input_queue *queue)
+{
+	uint32 tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+	uint32 head = atomic_load_explicit(&queue->head, memory_order_acquire);
+	if (head == tail) return 0;
+	*event = queue->events[tail & (INPUT_QUEUE_CAPACITY - 1)];
+	atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+	return 1;
+}
+
+/* handles what the platform's thread has received since the last frame */
+void process_input_events(void)
+{
+	input_statistics *statistics = &global.input_statistics;
+	input_event       event;
+	while (pop_input_event(&event, &global.input_queue))
+	{
+		uintl latency = get_time() - event.time;
+		statistics->events_count += 1;
+		statistics->latency_sum  += latency;
+		if (latency > statistics->latency_maximum) statistics->latency_maximum = latency;
+
+		switch (event.tag)
+		{
+		case INPUT_EVENT_TAG_KEY:
+			if (dispatch_key(event.key) || !(event.key.modifiers & KEY_MODIFIER_PRESSED)) break;
+			/* fallthrough */
+		case INPUT_EVENT_TAG_TEXT:
+			if (global.interface.inputs_count < INTERFACE_EVENTS_CAPACITY) global.interface.inputs[global.interface.inputs_count++] = event;
+			break;
+		case INPUT_EVENT_TAG_CLOSE:
+			global.terminability = 1;
+			break;
+		default: unreachable();
+		}
+	}
+}
+
 inline uintl begin_clock(void)
 {
 	return context.clock_time = get_time();
@@ -113,7 +365,6 @@ void _assert_vulkan_result(VkResult result, const char *file, uint line)
 }
 
 static void initialize(void);
-static void get_window_messages(void);
 
 static VKAPI_ATTR VkBool32 VKAPI_CALL process_vulkan_message(
 	VkDebugUtilsMessageSeverityFlagBitsEXT      message_severity,
@@ -127,11 +378,28 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL process_vulkan_message(
 	#include "text_linux.c"
 #endif
 
+#include "text_job.c"
+#include "text_format.c"
+#include "text_report.c"
+#include "text_mapping.c"
+#include "text_compress.c"
+#include "text_scrollback.c"
+#include "text_vt.c"
+#include "text_buffer.c"
+#include "text_search.c"
+#include "text_regex.c"
+#include "text_cursor.c"
+#include "text_brackets.c"
+#include "generated/text_lexers.h"
+#include "text_highlight.c"
+#include "text_ui.c"
+
 static void initialize_vulkan(void);
 static void terminate_vulkan(void);
-static void create_vulkan_swapchain(void);
-static void destroy_vulkan_swapchain(void);
-static void recreate_vulkan_swapchain(void);
+static void create_swapchain(void);
+static void destroy_swapchain(void);
+static bit recreate_swapchain(void);
+static void render_frame(void);
 
 static VKAPI_ATTR VkBool32 VKAPI_CALL process_vulkan_message(
 	VkDebugUtilsMessageSeverityFlagBitsEXT      message_severity,
@@ -141,20 +409,89 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL process_vulkan_message(
 {
 	if (message_severity < VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) return VK_FALSE;
 
-	const char *severity;
+	severity severity;
 	switch (message_severity)
 	{
-	case VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT: severity = "VERBOSE"; break;
-	case VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT:    severity = "COMMENT"; break;
-	case VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT: severity = "CAUTION"; break;
-	case VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT:   severity = "FAILURE"; break;
+	case VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT: severity = SEVERITY_VERBOSE; break;
+	case VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT:    severity = SEVERITY_COMMENT; break;
+	case VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT: severity = SEVERITY_CAUTION; break;
+	case VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT:   severity = SEVERITY_FAILURE; break;
 	default: unreachable();
 	}
 
-	fprintf(stderr, "[%s] %s\n", severity, callback_data->pMessage);
+	/* the validation layer can be chatty, so this must not block */
+	report(severity, "%s\n", callback_data->pMessage);
 	return VK_FALSE;
 }
 
+static uint find_vulkan_memory_type(uint type_bits, VkMemoryPropertyFlags properties)
+{
+	VkPhysicalDeviceMemoryProperties memory_properties;
+	vkGetPhysicalDeviceMemoryProperties(vulkan.physical_device, &memory_properties);
+	for (uint i = 0; i < memory_properties.memoryTypeCount; ++i)
+	{
+		if ((type_bits & (1u << i)) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties) return i;
+	}
+	assert(!"no memory type has the properties");
+	return 0;
+}
+
+static void allocate_vulkan_memory(VkDeviceMemory *memory, const VkMemoryRequirements *requirements, VkMemoryPropertyFlags properties)
+{
+	VkMemoryAllocateInfo memory_allocation_info =
+	{
+		.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.pNext           = 0,
+		.allocationSize  = requirements->size,
+		.memoryTypeIndex = find_vulkan_memory_type(requirements->memoryTypeBits, properties),
+	};
+	assert_vulkan_result(vkAllocateMemory(vulkan.device, &memory_allocation_info, 0, memory));
+}
+
+static void create_vulkan_buffer(VkBuffer *buffer, VkDeviceMemory *memory, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+{
+	VkBufferCreateInfo buffer_creation_info =
+	{
+		.sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.pNext                 = 0,
+		.flags                 = 0,
+		.size                  = size,
+		.usage                 = usage,
+		.sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = 0,
+		.pQueueFamilyIndices   = 0,
+	};
+	assert_vulkan_result(vkCreateBuffer(vulkan.device, &buffer_creation_info, 0, buffer));
+
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(vulkan.device, *buffer, &requirements);
+	allocate_vulkan_memory(memory, &requirements, properties);
+	assert_vulkan_result(vkBindBufferMemory(vulkan.device, *buffer, *memory, 0));
+}
+
+/* reads SPIR-V that was compiled ahead of time */
+static VkShaderModule load_vulkan_shader(const char *path)
+{
+	handle  file = open_file(path);
+	uint    size = get_size_of_file(file);
+	uint32 *code = allocate(size, ALLOCATION_TAG_VULKAN);
+	read_from_file(code, size, file);
+	close_file(file);
+
+	VkShaderModuleCreateInfo shader_module_creation_info =
+	{
+		.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+		.pNext    = 0,
+		.flags    = 0,
+		.codeSize = size,
+		.pCode    = code,
+	};
+	VkShaderModule module;
+	assert_vulkan_result(vkCreateShaderModule(vulkan.device, &shader_module_creation_info, 0, &module));
+	deallocate(code, size, ALLOCATION_TAG_VULKAN);
+	return module;
+}
+
 void initialize_vulkan(void)
 {
 	static const char *physical_device_extension_names[] =
@@ -367,99 +704,906 @@ void initialize_vulkan(void)
 			vkGetDeviceQueue(vulkan.device, vulkan.queue_families[i], 0, &vulkan.queues[i]);
 		}
 	}
+
+	/* create the render pass */
+	{
+		VkAttachmentDescription color_attachment =
+		{
+			.flags          = 0,
+			.format         = vulkan.swapchain_image_format.format,
+			.samples        = VK_SAMPLE_COUNT_1_BIT,
+			.loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR,
+			.storeOp        = VK_ATTACHMENT_STORE_OP_STORE,
+			.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+			.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+			.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED,
+			.finalLayout    = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+		};
+		VkAttachmentReference color_attachment_reference =
+		{
+			.attachment = 0,
+			.layout     = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		};
+		VkSubpassDescription subpass =
+		{
+			.flags                   = 0,
+			.pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS,
+			.inputAttachmentCount    = 0,
+			.pInputAttachments       = 0,
+			.colorAttachmentCount    = 1,
+			.pColorAttachments       = &color_attachment_reference,
+			.pResolveAttachments     = 0,
+			.pDepthStencilAttachment = 0,
+			.preserveAttachmentCount = 0,
+			.pPreserveAttachments    = 0,
+		};
+
+		/* the image is written only once it is acquired, which is waited for at
+		   this stage */
+		VkSubpassDependency dependency =
+		{
+			.srcSubpass      = VK_SUBPASS_EXTERNAL,
+			.dstSubpass      = 0,
+			.srcStageMask    = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			.dstStageMask    = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			.srcAccessMask   = 0,
+			.dstAccessMask   = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			.dependencyFlags = 0,
+		};
+		VkRenderPassCreateInfo render_pass_creation_info =
+		{
+			.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+			.pNext           = 0,
+			.flags           = 0,
+			.attachmentCount = 1,
+			.pAttachments    = &color_attachment,
+			.subpassCount    = 1,
+			.pSubpasses      = &subpass,
+			.dependencyCount = 1,
+			.pDependencies   = &dependency,
+		};
+		assert_vulkan_result(vkCreateRenderPass(vulkan.device, &render_pass_creation_info, 0, &vulkan.render_pass));
+	}
+
+	create_swapchain();
+
+	/* create the command pool */
+	{
+		VkCommandPoolCreateInfo command_pool_creation_info =
+		{
+			.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			.pNext            = 0,
+			.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+			.queueFamilyIndex = vulkan.graphics_queue_family,
+		};
+		assert_vulkan_result(vkCreateCommandPool(vulkan.device, &command_pool_creation_info, 0, &vulkan.command_pool));
+	}
+
+	/* create the UI's pipeline */
+	{
+		VkDescriptorSetLayoutBinding binding =
+		{
+			.binding            = 0,
+			.descriptorType     = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.descriptorCount    = 1,
+			.stageFlags         = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.pImmutableSamplers = 0,
+		};
+		VkDescriptorSetLayoutCreateInfo descriptor_set_layout_creation_info =
+		{
+			.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.pNext        = 0,
+			.flags        = 0,
+			.bindingCount = 1,
+			.pBindings    = &binding,
+		};
+		assert_vulkan_result(vkCreateDescriptorSetLayout(vulkan.device, &descriptor_set_layout_creation_info, 0, &vulkan.ui_descriptor_set_layout));
+
+		/* the frame's size, to place the quads */
+		VkPushConstantRange push_constant_range =
+		{
+			.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+			.offset     = 0,
+			.size       = sizeof(float32[2]),
+		};
+		VkPipelineLayoutCreateInfo pipeline_layout_creation_info =
+		{
+			.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.pNext                  = 0,
+			.flags                  = 0,
+			.setLayoutCount         = 1,
+			.pSetLayouts            = &vulkan.ui_descriptor_set_layout,
+			.pushConstantRangeCount = 1,
+			.pPushConstantRanges    = &push_constant_range,
+		};
+		assert_vulkan_result(vkCreatePipelineLayout(vulkan.device, &pipeline_layout_creation_info, 0, &vulkan.ui_pipeline_layout));
+
+		VkShaderModule vertex_shader   = load_vulkan_shader(UI_VERTEX_SHADER_PATH);
+		VkShaderModule fragment_shader = load_vulkan_shader(UI_FRAGMENT_SHADER_PATH);
+		VkPipelineShaderStageCreateInfo stage_creation_infos[] =
+		{
+			{
+				.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+				.pNext               = 0,
+				.flags               = 0,
+				.stage               = VK_SHADER_STAGE_VERTEX_BIT,
+				.module              = vertex_shader,
+				.pName               = "main",
+				.pSpecializationInfo = 0,
+			},
+			{
+				.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+				.pNext               = 0,
+				.flags               = 0,
+				.stage               = VK_SHADER_STAGE_FRAGMENT_BIT,
+				.module              = fragment_shader,
+				.pName               = "main",
+				.pSpecializationInfo = 0,
+			},
+		};
+
+		/* a `ui_quad` per instance; the vertices are made in the shader */
+		VkVertexInputBindingDescription binding_description =
+		{
+			.binding   = 0,
+			.stride    = sizeof(ui_quad),
+			.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE,
+		};
+		VkVertexInputAttributeDescription attribute_descriptions[] =
+		{
+			{ .location = 0, .binding = 0, .format = VK_FORMAT_R32G32B32A32_SFLOAT, .offset = offsetof(ui_quad, range) },
+			{ .location = 1, .binding = 0, .format = VK_FORMAT_R32_UINT,            .offset = offsetof(ui_quad, texture) },
+			{ .location = 2, .binding = 0, .format = VK_FORMAT_R32_UINT,            .offset = offsetof(ui_quad, layer) },
+			{ .location = 3, .binding = 0, .format = VK_FORMAT_R32_UINT,            .offset = offsetof(ui_quad, glyph) },
+		};
+		VkPipelineVertexInputStateCreateInfo vertex_input_state_creation_info =
+		{
+			.sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+			.pNext                           = 0,
+			.flags                           = 0,
+			.vertexBindingDescriptionCount   = 1,
+			.pVertexBindingDescriptions      = &binding_description,
+			.vertexAttributeDescriptionCount = countof(attribute_descriptions),
+			.pVertexAttributeDescriptions    = attribute_descriptions,
+		};
+		VkPipelineInputAssemblyStateCreateInfo input_assembly_state_creation_info =
+		{
+			.sType                  = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+			.pNext                  = 0,
+			.flags                  = 0,
+			.topology               = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+			.primitiveRestartEnable = VK_FALSE,
+		};
+
+		/* the viewport and the scissor follow the swapchain, so they are set
+		   when recording */
+		VkPipelineViewportStateCreateInfo viewport_state_creation_info =
+		{
+			.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+			.pNext         = 0,
+			.flags         = 0,
+			.viewportCount = 1,
+			.pViewports    = 0,
+			.scissorCount  = 1,
+			.pScissors     = 0,
+		};
+		VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+		VkPipelineDynamicStateCreateInfo dynamic_state_creation_info =
+		{
+			.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+			.pNext             = 0,
+			.flags             = 0,
+			.dynamicStateCount = countof(dynamic_states),
+			.pDynamicStates    = dynamic_states,
+		};
+		VkPipelineRasterizationStateCreateInfo rasterization_state_creation_info =
+		{
+			.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+			.pNext                   = 0,
+			.flags                   = 0,
+			.depthClampEnable        = VK_FALSE,
+			.rasterizerDiscardEnable = VK_FALSE,
+			.polygonMode             = VK_POLYGON_MODE_FILL,
+			.cullMode                = VK_CULL_MODE_NONE,
+			.frontFace               = VK_FRONT_FACE_CLOCKWISE,
+			.depthBiasEnable         = VK_FALSE,
+			.lineWidth               = 1.f,
+		};
+		VkPipelineMultisampleStateCreateInfo multisample_state_creation_info =
+		{
+			.sType                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+			.pNext                = 0,
+			.flags                = 0,
+			.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+			.sampleShadingEnable  = VK_FALSE,
+		};
+
+		/* glyphs are blended by their coverage */
+		VkPipelineColorBlendAttachmentState color_blend_attachment_state =
+		{
+			.blendEnable         = VK_TRUE,
+			.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+			.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+			.colorBlendOp        = VK_BLEND_OP_ADD,
+			.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+			.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+			.alphaBlendOp        = VK_BLEND_OP_ADD,
+			.colorWriteMask      = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+		};
+		VkPipelineColorBlendStateCreateInfo color_blend_state_creation_info =
+		{
+			.sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+			.pNext           = 0,
+			.flags           = 0,
+			.logicOpEnable   = VK_FALSE,
+			.attachmentCount = 1,
+			.pAttachments    = &color_blend_attachment_state,
+		};
+		VkGraphicsPipelineCreateInfo pipeline_creation_info =
+		{
+			.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+			.pNext               = 0,
+			.flags               = 0,
+			.stageCount          = countof(stage_creation_infos),
+			.pStages             = stage_creation_infos,
+			.pVertexInputState   = &vertex_input_state_creation_info,
+			.pInputAssemblyState = &input_assembly_state_creation_info,
+			.pTessellationState  = 0,
+			.pViewportState      = &viewport_state_creation_info,
+			.pRasterizationState = &rasterization_state_creation_info,
+			.pMultisampleState   = &multisample_state_creation_info,
+			.pDepthStencilState  = 0,
+			.pColorBlendState    = &color_blend_state_creation_info,
+			.pDynamicState       = &dynamic_state_creation_info,
+			.layout              = vulkan.ui_pipeline_layout,
+			.renderPass          = vulkan.render_pass,
+			.subpass             = 0,
+			.basePipelineHandle  = VK_NULL_HANDLE,
+			.basePipelineIndex   = -1,
+		};
+		assert_vulkan_result(vkCreateGraphicsPipelines(vulkan.device, VK_NULL_HANDLE, 1, &pipeline_creation_info, 0, &vulkan.ui_pipeline));
+
+		vkDestroyShaderModule(vulkan.device, fragment_shader, 0);
+		vkDestroyShaderModule(vulkan.device, vertex_shader, 0);
+	}
+
+	/* upload the glyphs of the default font */
+	{
+		const font *font   = &default_font;
+		VkExtent3D  extent = { font->glyph_width, font->glyph_height * FONT_GLYPHS_CAPACITY, 1 };
+		VkImageSubresourceRange subresource_range =
+		{
+			.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel   = 0,
+			.levelCount     = 1,
+			.baseArrayLayer = 0,
+			.layerCount     = 1,
+		};
+
+		VkImageCreateInfo image_creation_info =
+		{
+			.sType                 = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+			.pNext                 = 0,
+			.flags                 = 0,
+			.imageType             = VK_IMAGE_TYPE_2D,
+			.format                = VK_FORMAT_R8_UNORM,
+			.extent                = extent,
+			.mipLevels             = 1,
+			.arrayLayers           = 1,
+			.samples               = VK_SAMPLE_COUNT_1_BIT,
+			.tiling                = VK_IMAGE_TILING_OPTIMAL,
+			.usage                 = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			.sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+			.queueFamilyIndexCount = 0,
+			.pQueueFamilyIndices   = 0,
+			.initialLayout         = VK_IMAGE_LAYOUT_UNDEFINED,
+		};
+		assert_vulkan_result(vkCreateImage(vulkan.device, &image_creation_info, 0, &vulkan.glyphs_image));
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(vulkan.device, vulkan.glyphs_image, &requirements);
+		allocate_vulkan_memory(&vulkan.glyphs_memory, &requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		assert_vulkan_result(vkBindImageMemory(vulkan.device, vulkan.glyphs_image, vulkan.glyphs_memory, 0));
+
+		VkImageViewCreateInfo image_view_creation_info =
+		{
+			.sType            = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+			.pNext            = 0,
+			.flags            = 0,
+			.image            = vulkan.glyphs_image,
+			.viewType         = VK_IMAGE_VIEW_TYPE_2D,
+			.format           = VK_FORMAT_R8_UNORM,
+			.components       = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY },
+			.subresourceRange = subresource_range,
+		};
+		assert_vulkan_result(vkCreateImageView(vulkan.device, &image_view_creation_info, 0, &vulkan.glyphs_image_view));
+
+		/* glyphs are drawn at their size, texel for pixel */
+		VkSamplerCreateInfo sampler_creation_info =
+		{
+			.sType                   = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+			.pNext                   = 0,
+			.flags                   = 0,
+			.magFilter               = VK_FILTER_NEAREST,
+			.minFilter               = VK_FILTER_NEAREST,
+			.mipmapMode              = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+			.addressModeU            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+			.addressModeV            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+			.addressModeW            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+			.mipLodBias              = 0.f,
+			.anisotropyEnable        = VK_FALSE,
+			.maxAnisotropy           = 1.f,
+			.compareEnable           = VK_FALSE,
+			.compareOp               = VK_COMPARE_OP_ALWAYS,
+			.minLod                  = 0.f,
+			.maxLod                  = 0.f,
+			.borderColor             = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,
+			.unnormalizedCoordinates = VK_FALSE,
+		};
+		assert_vulkan_result(vkCreateSampler(vulkan.device, &sampler_creation_info, 0, &vulkan.glyphs_sampler));
+
+		/* the glyphs go through a buffer that the host can write */
+		VkDeviceSize   size = (VkDeviceSize)font->glyph_size * FONT_GLYPHS_CAPACITY;
+		VkBuffer       staging_buffer;
+		VkDeviceMemory staging_memory;
+		create_vulkan_buffer(&staging_buffer, &staging_memory, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		void *staging;
+		assert_vulkan_result(vkMapMemory(vulkan.device, staging_memory, 0, size, 0, &staging));
+		copy(staging, font->glyphs, size);
+		vkUnmapMemory(vulkan.device, staging_memory);
+
+		VkCommandBufferAllocateInfo command_buffer_allocation_info =
+		{
+			.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.pNext              = 0,
+			.commandPool        = vulkan.command_pool,
+			.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1,
+		};
+		VkCommandBuffer command_buffer;
+		assert_vulkan_result(vkAllocateCommandBuffers(vulkan.device, &command_buffer_allocation_info, &command_buffer));
+		VkCommandBufferBeginInfo command_buffer_beginning_info =
+		{
+			.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+			.pNext            = 0,
+			.flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+			.pInheritanceInfo = 0,
+		};
+		assert_vulkan_result(vkBeginCommandBuffer(command_buffer, &command_buffer_beginning_info));
+
+		VkImageMemoryBarrier barrier =
+		{
+			.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.pNext               = 0,
+			.srcAccessMask       = 0,
+			.dstAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED,
+			.newLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image               = vulkan.glyphs_image,
+			.subresourceRange    = subresource_range,
+		};
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, 0, 0, 0, 1, &barrier);
+
+		VkBufferImageCopy region =
+		{
+			.bufferOffset      = 0,
+			.bufferRowLength   = 0,
+			.bufferImageHeight = 0,
+			.imageSubresource  = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
+			.imageOffset       = { 0, 0, 0 },
+			.imageExtent       = extent,
+		};
+		vkCmdCopyBufferToImage(command_buffer, staging_buffer, vulkan.glyphs_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, 0, 0, 0, 1, &barrier);
+		assert_vulkan_result(vkEndCommandBuffer(command_buffer));
+
+		VkSubmitInfo submission_info =
+		{
+			.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+			.pNext                = 0,
+			.waitSemaphoreCount   = 0,
+			.pWaitSemaphores      = 0,
+			.pWaitDstStageMask    = 0,
+			.commandBufferCount   = 1,
+			.pCommandBuffers      = &command_buffer,
+			.signalSemaphoreCount = 0,
+			.pSignalSemaphores    = 0,
+		};
+		assert_vulkan_result(vkQueueSubmit(vulkan.graphics_queue, 1, &submission_info, VK_NULL_HANDLE));
+		assert_vulkan_result(vkQueueWaitIdle(vulkan.graphics_queue));
+
+		vkFreeCommandBuffers(vulkan.device, vulkan.command_pool, 1, &command_buffer);
+		vkDestroyBuffer(vulkan.device, staging_buffer, 0);
+		vkFreeMemory(vulkan.device, staging_memory, 0);
+	}
+
+	/* a descriptor set for every texture of the UI, which `ui_record_batches`
+	   binds */
+	{
+		VkDescriptorPoolSize pool_size =
+		{
+			.type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.descriptorCount = UI_TEXTURES_COUNT,
+		};
+		VkDescriptorPoolCreateInfo descriptor_pool_creation_info =
+		{
+			.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+			.pNext         = 0,
+			.flags         = 0,
+			.maxSets       = UI_TEXTURES_COUNT,
+			.poolSizeCount = 1,
+			.pPoolSizes    = &pool_size,
+		};
+		assert_vulkan_result(vkCreateDescriptorPool(vulkan.device, &descriptor_pool_creation_info, 0, &vulkan.descriptor_pool));
+
+		VkDescriptorSetLayout layouts[UI_TEXTURES_COUNT];
+		for (uint i = 0; i < UI_TEXTURES_COUNT; ++i) layouts[i] = vulkan.ui_descriptor_set_layout;
+		VkDescriptorSetAllocateInfo descriptor_set_allocation_info =
+		{
+			.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+			.pNext              = 0,
+			.descriptorPool     = vulkan.descriptor_pool,
+			.descriptorSetCount = UI_TEXTURES_COUNT,
+			.pSetLayouts        = layouts,
+		};
+		assert_vulkan_result(vkAllocateDescriptorSets(vulkan.device, &descriptor_set_allocation_info, vulkan.ui_descriptor_sets));
+
+		/* quads without a texture are not sampled, but their set must be valid
+		   all the same */
+		VkImageView image_views[UI_TEXTURES_COUNT] =
+		{
+			[UI_TEXTURE_NONE]   = vulkan.glyphs_image_view,
+			[UI_TEXTURE_GLYPHS] = vulkan.glyphs_image_view,
+		};
+		VkDescriptorImageInfo image_infos[UI_TEXTURES_COUNT];
+		VkWriteDescriptorSet  writes[UI_TEXTURES_COUNT];
+		for (uint i = 0; i < UI_TEXTURES_COUNT; ++i)
+		{
+			image_infos[i] = (VkDescriptorImageInfo)
+			{
+				.sampler     = vulkan.glyphs_sampler,
+				.imageView   = image_views[i],
+				.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			};
+			writes[i] = (VkWriteDescriptorSet)
+			{
+				.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.pNext            = 0,
+				.dstSet           = vulkan.ui_descriptor_sets[i],
+				.dstBinding       = 0,
+				.dstArrayElement  = 0,
+				.descriptorCount  = 1,
+				.descriptorType   = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.pImageInfo       = &image_infos[i],
+				.pBufferInfo      = 0,
+				.pTexelBufferView = 0,
+			};
+		}
+		vkUpdateDescriptorSets(vulkan.device, UI_TEXTURES_COUNT, writes, 0, 0);
+	}
+
+	/* create what each frame in flight records into and waits on */
+	{
+		VkCommandBufferAllocateInfo command_buffer_allocation_info =
+		{
+			.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.pNext              = 0,
+			.commandPool        = vulkan.command_pool,
+			.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1,
+		};
+		VkSemaphoreCreateInfo semaphore_creation_info =
+		{
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+			.pNext = 0,
+			.flags = 0,
+		};
+
+		/* as if the frames before the first had been drawn */
+		VkFenceCreateInfo fence_creation_info =
+		{
+			.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+			.pNext = 0,
+			.flags = VK_FENCE_CREATE_SIGNALED_BIT,
+		};
+		for (uint i = 0; i < VULKAN_FRAMES_COUNT; ++i)
+		{
+			vulkan_frame *frame = &vulkan.frames[i];
+			assert_vulkan_result(vkAllocateCommandBuffers(vulkan.device, &command_buffer_allocation_info, &frame->command_buffer));
+			assert_vulkan_result(vkCreateSemaphore(vulkan.device, &semaphore_creation_info, 0, &frame->image_acquired));
+			assert_vulkan_result(vkCreateFence(vulkan.device, &fence_creation_info, 0, &frame->rendered));
+			create_vulkan_buffer(&frame->quads_buffer, &frame->quads_memory, UI_QUADS_CAPACITY * sizeof(ui_quad), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			assert_vulkan_result(vkMapMemory(vulkan.device, frame->quads_memory, 0, VK_WHOLE_SIZE, 0, (void **)&frame->quads));
+		}
+	}
 }
 
 void terminate_vulkan(void)
 {
+	vkDeviceWaitIdle(vulkan.device);
+
+	for (uint i = 0; i < VULKAN_FRAMES_COUNT; ++i)
+	{
+		vulkan_frame *frame = &vulkan.frames[i];
+		vkDestroyBuffer(vulkan.device, frame->quads_buffer, 0);
+		vkFreeMemory(vulkan.device, frame->quads_memory, 0);
+		vkDestroyFence(vulkan.device, frame->rendered, 0);
+		vkDestroySemaphore(vulkan.device, frame->image_acquired, 0);
+	}
+	vkDestroyDescriptorPool(vulkan.device, vulkan.descriptor_pool, 0);
+	vkDestroySampler(vulkan.device, vulkan.glyphs_sampler, 0);
+	vkDestroyImageView(vulkan.device, vulkan.glyphs_image_view, 0);
+	vkDestroyImage(vulkan.device, vulkan.glyphs_image, 0);
+	vkFreeMemory(vulkan.device, vulkan.glyphs_memory, 0);
+	vkDestroyPipeline(vulkan.device, vulkan.ui_pipeline, 0);
+	vkDestroyPipelineLayout(vulkan.device, vulkan.ui_pipeline_layout, 0);
+	vkDestroyDescriptorSetLayout(vulkan.device, vulkan.ui_descriptor_set_layout, 0);
+	vkDestroyCommandPool(vulkan.device, vulkan.command_pool, 0);
+	destroy_swapchain();
+	vkDestroyRenderPass(vulkan.device, vulkan.render_pass, 0);
+	vkDestroyDevice(vulkan.device, 0);
 
+	vkDestroySurfaceKHR(vulkan.instance, vulkan.surface, 0);
+#if defined(DEBUGGING)
+	PFN_vkDestroyDebugUtilsMessengerEXT vkDestroyDebugUtilsMessengerEXT = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(vulkan.instance, "vkDestroyDebugUtilsMessengerEXT");
+	if (vkDestroyDebugUtilsMessengerEXT) vkDestroyDebugUtilsMessengerEXT(vulkan.instance, vulkan.debug_messenger, 0);
+#endif
+	vkDestroyInstance(vulkan.instance, 0);
 }
 
 void create_swapchain(void)
 {
+	/* the surface follows the window, which may have been resized */
+	VkSurfaceCapabilitiesKHR capabilities;
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(vulkan.physical_device, vulkan.surface, &capabilities);
+	if (capabilities.currentExtent.width == UINT_MAXIMUM)
+	{
+		rect rect;
+		get_window_frame_rect(&rect);
+		vulkan.swapchain_image_extent.width  = clamp(rect.right - rect.left, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
+		vulkan.swapchain_image_extent.height = clamp(rect.base - rect.top, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
+	}
+	else vulkan.swapchain_image_extent = capabilities.currentExtent;
+
+	uint images_count = vulkan.swapchain_images_capacity;
+	if (capabilities.maxImageCount && images_count > capabilities.maxImageCount) images_count = capabilities.maxImageCount;
+	if (images_count > VULKAN_SWAPCHAIN_IMAGES_CAPACITY)                         images_count = VULKAN_SWAPCHAIN_IMAGES_CAPACITY;
+
+	bit shared = vulkan.graphics_queue_family != vulkan.presentation_queue_family;
+	VkSwapchainCreateInfoKHR swapchain_creation_info =
+	{
+		.sType                 = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+		.pNext                 = 0,
+		.flags                 = 0,
+		.surface               = vulkan.surface,
+		.minImageCount         = images_count,
+		.imageFormat           = vulkan.swapchain_image_format.format,
+		.imageColorSpace       = vulkan.swapchain_image_format.colorSpace,
+		.imageExtent           = vulkan.swapchain_image_extent,
+		.imageArrayLayers      = 1,
+		.imageUsage            = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+		.imageSharingMode      = shared ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = shared ? VULKAN_QUEUES_COUNT : 0,
+		.pQueueFamilyIndices   = vulkan.queue_families,
+		.preTransform          = capabilities.currentTransform,
+		.compositeAlpha        = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
+		.presentMode           = vulkan.swapchain_presentation_mode,
+		.clipped               = VK_TRUE,
+		.oldSwapchain          = VK_NULL_HANDLE,
+	};
+	assert_vulkan_result(vkCreateSwapchainKHR(vulkan.device, &swapchain_creation_info, 0, &vulkan.swapchain));
+
+	vkGetSwapchainImagesKHR(vulkan.device, vulkan.swapchain, &vulkan.swapchain_images_count, 0);
+	assert(vulkan.swapchain_images_count <= VULKAN_SWAPCHAIN_IMAGES_CAPACITY);
+	vkGetSwapchainImagesKHR(vulkan.device, vulkan.swapchain, &vulkan.swapchain_images_count, vulkan.swapchain_images);
 
+	VkSemaphoreCreateInfo semaphore_creation_info =
+	{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		.pNext = 0,
+		.flags = 0,
+	};
+	for (uint i = 0; i < vulkan.swapchain_images_count; ++i)
+	{
+		VkImageViewCreateInfo image_view_creation_info =
+		{
+			.sType            = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+			.pNext            = 0,
+			.flags            = 0,
+			.image            = vulkan.swapchain_images[i],
+			.viewType         = VK_IMAGE_VIEW_TYPE_2D,
+			.format           = vulkan.swapchain_image_format.format,
+			.components       = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY },
+			.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 },
+		};
+		assert_vulkan_result(vkCreateImageView(vulkan.device, &image_view_creation_info, 0, &vulkan.swapchain_image_views[i]));
+
+		VkFramebufferCreateInfo framebuffer_creation_info =
+		{
+			.sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+			.pNext           = 0,
+			.flags           = 0,
+			.renderPass      = vulkan.render_pass,
+			.attachmentCount = 1,
+			.pAttachments    = &vulkan.swapchain_image_views[i],
+			.width           = vulkan.swapchain_image_extent.width,
+			.height          = vulkan.swapchain_image_extent.height,
+			.layers          = 1,
+		};
+		assert_vulkan_result(vkCreateFramebuffer(vulkan.device, &framebuffer_creation_info, 0, &vulkan.framebuffers[i]));
+
+		assert_vulkan_result(vkCreateSemaphore(vulkan.device, &semaphore_creation_info, 0, &vulkan.rendering_finished[i]));
+	}
 }
 
 void destroy_swapchain(void)
 {
-	/* destroy framebuffers */
-
-	/* destroy image views */
+	for (uint i = 0; i < vulkan.swapchain_images_count; ++i)
+	{
+		vkDestroySemaphore(vulkan.device, vulkan.rendering_finished[i], 0);
+		vkDestroyFramebuffer(vulkan.device, vulkan.framebuffers[i], 0);
+		vkDestroyImageView(vulkan.device, vulkan.swapchain_image_views[i], 0);
+	}
+	vulkan.swapchain_images_count = 0;
 
 	vkDestroySwapchainKHR(vulkan.device, vulkan.swapchain, 0);
 }
 
-void recreate_swapchain(void)
+/* returns whether there is a swapchain to draw into again */
+bit recreate_swapchain(void)
 {
 	/* the window might be minimized, resulting in a frame size of 0, so wait
-	   until the window is unminimized */
+	   until the window is unminimized, or closed */
 	for (;;)
 	{
 		rect frame_rect;
-		get_window_frame_rect(&frame_rect);
+		if (!get_window_frame_rect(&frame_rect))
+		{
+			report_failure("the swapchain is out of date, and there is no window to recreate it for\n");
+			global.terminability = 1;
+			return 0;
+		}
 		if (frame_rect.right || frame_rect.base) break;
-		get_window_messages();
+		wait_for_events(WAIT_FOREVER);
+		process_input_events();
+		if (global.terminability) return 0;
 	}
 	vkDeviceWaitIdle(vulkan.device);
 
 	destroy_swapchain();
 	create_swapchain();
+
+	/* plugins lay their UI out for the new size on the next frame */
+	global.interface.wait = 0;
+	return 1;
 }
 
-int main(void)
+/* finalizes the UI that was made during the frame and draws it */
+void render_frame(void)
 {
-	initialize();
-	initialize_vulkan();
+	vulkan_frame *frame = &vulkan.frames[vulkan.frame];
+	assert_vulkan_result(vkWaitForFences(vulkan.device, 1, &frame->rendered, VK_TRUE, UINTL_MAXIMUM));
 
-	/* compile shaders */
-#if 0
+	uint image_index;
+	for (;;)
 	{
-		printf("loading shaders...\n");
+		VkResult result = vkAcquireNextImageKHR(vulkan.device, vulkan.swapchain, UINTL_MAXIMUM, frame->image_acquired, VK_NULL_HANDLE, &image_index);
+		if (result == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			if (!recreate_swapchain()) return;
+			continue;
+		}
+		if (result != VK_SUBOPTIMAL_KHR) assert_vulkan_result(result);
+		break;
+	}
+	assert_vulkan_result(vkResetFences(vulkan.device, 1, &frame->rendered));
 
-		shader shaders[] =
+	VkExtent2D extent      = vulkan.swapchain_image_extent;
+	range2_f32 frame_range = { .left = 0, .top = 0, .right = (float32)extent.width, .base = (float32)extent.height };
+	ui_finalize(&frame_range);
+	copy(frame->quads, ui->batches.quads, ui->batches.quads_count * sizeof(ui_quad));
+
+	VkCommandBuffer command_buffer = frame->command_buffer;
+	assert_vulkan_result(vkResetCommandBuffer(command_buffer, 0));
+	VkCommandBufferBeginInfo command_buffer_beginning_info =
+	{
+		.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.pNext            = 0,
+		.flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		.pInheritanceInfo = 0,
+	};
+	assert_vulkan_result(vkBeginCommandBuffer(command_buffer, &command_buffer_beginning_info));
+	{
+		VkClearValue clear_value = { .color = { .float32 = { 0.f, 0.f, 0.f, 1.f } } };
+		VkRenderPassBeginInfo render_pass_beginning_info =
 		{
-			{ 0, "code/shader.vert" },
-			{ 1, "code/shader.frag" },
+			.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+			.pNext           = 0,
+			.renderPass      = vulkan.render_pass,
+			.framebuffer     = vulkan.framebuffers[image_index],
+			.renderArea      = { { 0, 0 }, extent },
+			.clearValueCount = 1,
+			.pClearValues    = &clear_value,
 		};
+		vkCmdBeginRenderPass(command_buffer, &render_pass_beginning_info, VK_SUBPASS_CONTENTS_INLINE);
+
+		VkViewport viewport = { 0.f, 0.f, (float32)extent.width, (float32)extent.height, 0.f, 1.f };
+		VkRect2D   scissor  = { { 0, 0 }, extent };
+		float32    frame_size[2] = { (float32)extent.width, (float32)extent.height };
+		VkDeviceSize quads_offset = 0;
+		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan.ui_pipeline);
+		vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+		vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+		vkCmdPushConstants(command_buffer, vulkan.ui_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(frame_size), frame_size);
+		vkCmdBindVertexBuffers(command_buffer, 0, 1, &frame->quads_buffer, &quads_offset);
+		ui_record_batches(command_buffer);
+
+		vkCmdEndRenderPass(command_buffer);
+	}
+	assert_vulkan_result(vkEndCommandBuffer(command_buffer));
 
-		const uint shaders_count = countof(shaders);
+	VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	VkSubmitInfo submission_info =
+	{
+		.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.pNext                = 0,
+		.waitSemaphoreCount   = 1,
+		.pWaitSemaphores      = &frame->image_acquired,
+		.pWaitDstStageMask    = &wait_stage,
+		.commandBufferCount   = 1,
+		.pCommandBuffers      = &command_buffer,
+		.signalSemaphoreCount = 1,
+		.pSignalSemaphores    = &vulkan.rendering_finished[image_index],
+	};
+	assert_vulkan_result(vkQueueSubmit(vulkan.graphics_queue, 1, &submission_info, frame->rendered));
+
+	VkPresentInfoKHR presentation_info =
+	{
+		.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+		.pNext              = 0,
+		.waitSemaphoreCount = 1,
+		.pWaitSemaphores    = &vulkan.rendering_finished[image_index],
+		.swapchainCount     = 1,
+		.pSwapchains        = &vulkan.swapchain,
+		.pImageIndices      = &image_index,
+		.pResults           = 0,
+	};
+	VkResult result = vkQueuePresentKHR(vulkan.presentation_queue, &presentation_info);
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) recreate_swapchain();
+	else                                                                    assert_vulkan_result(result);
+
+	vulkan.frame = (vulkan.frame + 1) % VULKAN_FRAMES_COUNT;
+}
+
+/* `--benchmark-<name> <arguments>` runs a benchmark instead of the editor */
+typedef struct
+{
+	const char *name;
+	const char *usage;
+	uint        arguments_count;
+	void      (*run)(char **arguments);
+} benchmark;
+
+static void run_jobs_benchmark           (char **arguments) { benchmark_jobs(); }
+static void run_format_benchmark         (char **arguments) { benchmark_format(); }
+static void run_buffer_benchmark         (char **arguments) { benchmark_text_buffer(arguments[0]); }
+static void run_search_benchmark         (char **arguments) { benchmark_text_search(arguments[0], arguments[1]); }
+static void run_find_all_benchmark       (char **arguments) { benchmark_text_find_all(arguments[0], arguments[1]); }
+static void run_search_typing_benchmark  (char **arguments) { benchmark_text_search_typing(arguments[0], arguments[1]); }
+static void run_cursors_benchmark        (char **arguments) { benchmark_text_cursors(arguments[0], arguments[1]); }
+static void run_highlighting_benchmark   (char **arguments) { benchmark_text_highlighting(arguments[0]); }
+static void run_lexers_benchmark         (char **arguments) { benchmark_text_lexers(arguments[0]); }
+static void run_replace_all_benchmark    (char **arguments) { benchmark_text_replace_all(arguments[0], arguments[1], arguments[2]); }
+static void run_regex_benchmark          (char **arguments) { benchmark_text_regex(arguments[0], arguments[1]); }
+static void run_vt_benchmark             (char **arguments) { benchmark_vt(arguments[0]); }
+static void run_pseudoterminal_benchmark (char **arguments) { benchmark_pseudoterminal(arguments[0]); }
+
+static const benchmark benchmarks[] =
+{
+	{ "--benchmark-jobs",           "no arguments",                   0, run_jobs_benchmark },
+	{ "--benchmark-format",         "no arguments",                   0, run_format_benchmark },
+	{ "--benchmark-buffer",         "<path>",                         1, run_buffer_benchmark },
+	{ "--benchmark-search",         "<path> <literal>",               2, run_search_benchmark },
+	{ "--benchmark-find-all",       "<path> <literal>",               2, run_find_all_benchmark },
+	{ "--benchmark-search-typing",  "<path> <query>",                 2, run_search_typing_benchmark },
+	{ "--benchmark-cursors",        "<path> <literal>",               2, run_cursors_benchmark },
+	{ "--benchmark-highlighting",   "<path>",                         1, run_highlighting_benchmark },
+	{ "--benchmark-lexers",         "<path>",                         1, run_lexers_benchmark },
+	{ "--benchmark-replace-all",    "<path> <literal> <replacement>", 3, run_replace_all_benchmark },
+	{ "--benchmark-regex",          "<path> <pattern>",               2, run_regex_benchmark },
+	{ "--benchmark-vt",             "<path>",                         1, run_vt_benchmark },
+	{ "--benchmark-pseudoterminal", "<path>",                         1, run_pseudoterminal_benchmark },
+};
 
-		uint shaders_data_size = 0;
-		for (uint i = 0; i < shaders_count; ++i)
+int main(int arguments_count, char **arguments)
+{
+	initialize_reports(REPORTS_DEFAULT_PATH);
+	initialize();
+	initialize_jobs();
+	for (uint i = 0; i < countof(benchmarks); ++i)
+	{
+		const benchmark *benchmark = &benchmarks[i];
+		if (arguments_count > 1 && !compare_string(arguments[1], benchmark->name))
 		{
-			shader *shader = shaders + i;
-			shader->handle = open_file(shader->path);
-			shader->size = 1 + get_size_of_file(shader->handle);
-			shaders_data_size += shader->size;
+			if ((uint)arguments_count < 2 + benchmark->arguments_count) report_failure("%s takes %s\n", benchmark->name, benchmark->usage);
+			else                                                         benchmark->run(arguments + 2);
+			goto terminated;
 		}
+	}
 
-		char *shaders_data = allocate(shaders_data_size);
-		char *shader_data = shaders_data;
-		for (uint i = 0; i < shaders_count; ++i)
+	/* `--plugin <path>` loads another plugin than the default */
+	const char *plugin_path = PLUGIN_DEFAULT_PATH;
+	if (arguments_count > 1)
+	{
+		if (compare_string(arguments[1], "--plugin"))
 		{
-			shader *shader = shaders + i;
-			shader->data = shader_data;
-			shader_data += shader->size;
-			read_from_file(shader->data, shader->size, shader->handle);
-			shader->data[shader->size - 1] = 0;
-			close_file(shader->handle);
+			report_failure("unknown option %s\n", arguments[1]);
+			goto terminated;
 		}
+		if (arguments_count < 3)
+		{
+			report_failure("--plugin takes <path>\n");
+			goto terminated;
+		}
+		plugin_path = arguments[2];
 	}
-#endif
+
+	load_font(FONT_DEFAULT_PATH, 0, &default_font);
+	initialize_vulkan();
+
+	initialize_arena(FRAME_ARENA_CAPACITY, ALLOCATION_TAG_FRAME, &global.frame_arena);
+	initialize_mappings(&global.mappings);
+
+	plugin plugin;
+	load_plugin(plugin_path, &plugin);
 
 	uintl   frame_beginning_time = get_time();
 	uintl   frame_ending_time;
-	float32 frame_elapsed_time;
+	float32 frame_elapsed_time  = 0;
 	uint    second_frames_count = 0;
 	float32 second_elapsed_time = 0;
 	while (!global.terminability)
 	{
-		get_window_messages();
+		reset_arena(&global.frame_arena);
+		ui_reset();
+		global.interface.events_count = 0;
+		global.interface.inputs_count = 0;
+		global.interface.wait         = WAIT_FOREVER;
+
+		process_input_events();
+		run_main_jobs();
+
+		VkExtent2D frame_extent = vulkan.swapchain_image_extent;
+		global.interface.frame_width  = frame_extent.width;
+		global.interface.frame_height = frame_extent.height;
+
+		update_plugin(&plugin);
+		if (plugin.library) plugin.tick(frame_elapsed_time);
+		render_frame();
 
 		{
 			if (second_elapsed_time >= 1.f)
 			{
 				report_verbose("FPS: %u\n", second_frames_count);
 				second_frames_count = 0;
+
+				input_statistics *statistics = &global.input_statistics;
+				if (statistics->events_count)
+				{
+					report_verbose(
+						"input latency: %.3fms average, %.3fms maximum\n",
+						(float64)statistics->latency_sum / statistics->events_count / (TIME_SECONDS_FACTOR / 1000),
+						(float64)statistics->latency_maximum / (TIME_SECONDS_FACTOR / 1000));
+				}
+				zero(statistics, sizeof(*statistics));
+				report_job_statistics(second_elapsed_time);
+				update_allocation_rates(second_elapsed_time);
 				second_elapsed_time = 0;
 			}
 			frame_ending_time = get_time();
@@ -468,7 +1612,21 @@ int main(void)
 			second_frames_count += 1;
 			frame_beginning_time = frame_ending_time;
 		}
+
+		/* sleep until there is something to do; the time asleep counts to the
+		   next frame's elapse */
+		wait_for_events(global.interface.wait);
 	}
 
+	unload_plugin(&plugin);
+	terminate_vulkan();
+	unload_font(&default_font);
+	terminate_mappings(&global.mappings);
+	terminate_arena(&global.frame_arena);
+terminated:
+	terminate_jobs();
+	stop_reports();
+	report_allocations();
+	terminate_reports();
 	return 0;
 }
@@ -16,6 +16,19 @@
 	#include "text_linux.h"
 #endif
 
+/* marks what the host has for plugins to call, which is all that is declared
+   here. a Win32 library only reaches what the executable exports, and its
+   data only through imports; on Linux the host exports all (`-rdynamic`) */
+#if defined(ON_WIN32)
+	#if defined(PLUGIN)
+		#define HOST __declspec(dllimport)
+	#else
+		#define HOST __declspec(dllexport)
+	#endif
+#else
+	#define HOST
+#endif
+
 #include <vulkan/vulkan.h>
 #include <vulkan/vk_enum_string_helper.h>
 
@@ -26,12 +39,19 @@
 #include "stb/stb_truetype.h"
 
 #include <assert.h>
+#include <stdalign.h>
+#include <stdarg.h>
 #include <stdint.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <threads.h>
 #include <wchar.h>
 #include <limits.h>
 
+#if defined(__x86_64__) || defined(_M_X64)
+	#include <immintrin.h>
+#endif
+
 #define __FUNCTION__ __func__
 
 #define unreachable() __builtin_unreachable()
@@ -57,7 +77,8 @@ typedef uint16 uints;
 typedef uint32 uint;
 typedef uint64 uintl;
 
-#define UINT_MAXIMUM UINT_MAX
+#define UINT_MAXIMUM  UINT_MAX
+#define UINTL_MAXIMUM UINT64_MAX
 
 typedef sint8  sintb;
 typedef sint16 sints;
@@ -87,9 +108,13 @@ typedef enum
 	SEVERITY_COMMENT,
 	SEVERITY_CAUTION,
 	SEVERITY_FAILURE,
+	SEVERITIES_COUNT,
 } severity;
 
-void _report(const char *file, uint line, severity severity, const char *message, ...);
+/* reports are packed by the thread that makes them, without formatting, and
+   written out by a logger thread. failures are written before `report`
+   returns, since what follows them may be an abort. */
+HOST void _report(const char *file, uint line, severity severity, const char *message, ...);
 
 #define report(...) _report(__FILE__, __LINE__, __VA_ARGS__)
 #define report_verbose(...) report(SEVERITY_VERBOSE, __VA_ARGS__)
@@ -101,6 +126,7 @@ void _report(const char *file, uint line, severity severity, const char *message
 
 #define FONT_GLYPHS_CAPACITY 128
 #define FONT_DEFAULT_HEIGHT  16
+#define FONT_DEFAULT_PATH    "data/consola.ttf"
 
 typedef struct
 {
@@ -113,16 +139,17 @@ typedef struct
 	float32 scale;
 
 	uint glyph_width;
+	uint glyph_height;
 	uint glyph_size;
-	byte *glyphs;
+	byte *glyphs;  /* one under the other, by code point */
 	bit64 glyphs_flags[2];
 } font;
 
-font default_font;
+HOST extern font default_font;
 
-void load_font(const char *file_path, uintb font_index, font *font);
+HOST void load_font(const char *file_path, uintb font_index, font *font);
 
-void unload_font(font *font);
+HOST void unload_font(font *font);
 
 typedef struct
 {
@@ -136,27 +163,1205 @@ typedef struct
 
 typedef vec3 vertex;
 
-void copy(void *destination, const void *memory, uint size);
-void move(void *destination, const void *memory, uint size);
-void fill(void *memory, uint size, uintb value);
-void zero(void *memory, uint size);
+HOST void copy(void *destination, const void *memory, uint size);
+HOST void move(void *destination, const void *memory, uint size);
+HOST void fill(void *memory, uint size, uintb value);
+HOST void zero(void *memory, uint size);
 
-int compare_string(const char *left, const char *right);
+HOST int compare(const void *left, const void *right, uint size);
+HOST int compare_string(const char *left, const char *right);
 
 #define TIME_SECONDS_FACTOR 1e9
 
-uintl get_time(void);
+HOST uintl get_time(void);
+
+/* the main thread sleeps until something needs it: input, output from a
+   program, a finished job, a change to the plugin, or the end of `timeout` */
+#define WAIT_FOREVER UINTL_MAXIMUM
+
+HOST void wait_for_events(uintl timeout);
+HOST void wake_main_thread(void);
+
+HOST uintl begin_clock(void);
+HOST uintl end_clock(void);
+
+/* every allocation is accounted to the subsystem that makes it */
+typedef enum
+{
+	ALLOCATION_TAG_FONT,
+	ALLOCATION_TAG_UI,
+	ALLOCATION_TAG_BUFFER,
+	ALLOCATION_TAG_SEARCH,
+	ALLOCATION_TAG_HIGHLIGHT,
+	ALLOCATION_TAG_VULKAN,
+	ALLOCATION_TAG_TERMINAL,
+	ALLOCATION_TAG_SCROLLBACK,
+	ALLOCATION_TAG_MAPPINGS,
+	ALLOCATION_TAG_JOBS,
+	ALLOCATION_TAG_REPORTS,
+	ALLOCATION_TAG_PLUGIN,
+	ALLOCATION_TAG_FRAME,
+	ALLOCATION_TAGS_COUNT,
+} allocation_tag;
+
+HOST extern const char *allocation_tag_representations[ALLOCATION_TAGS_COUNT];
+
+#define ALLOCATION_PAGE_SIZE 4096
 
-uintl begin_clock(void);
-uintl end_clock(void);
+/* sizes are of the pages taken, not of what was asked for */
+typedef struct
+{
+	_Atomic uintl live_size;
+	_Atomic uintl peak_size;
+	_Atomic uintl live_count;
+	_Atomic uintl allocated_size;  /* since the beginning */
+	_Atomic uintl allocations_count;
+
+	/* of the last second; updated by the main thread */
+	uintl   last_allocated_size;
+	float32 allocation_rate;  /* bytes per second */
+} allocation_statistics;
+
+HOST void *allocate(uint size, allocation_tag tag);
+HOST void deallocate(void *memory, uint size, allocation_tag tag);
 
-void *allocate(uint size);
-void deallocate(void *memory, uint size);
+/* what the platform gives; `allocate` and `deallocate` account for them */
+HOST void *allocate_pages(uint size);
+HOST void deallocate_pages(void *memory, uint size);
 
-handle open_file(const char *path);
-uintl get_size_of_file(handle handle);
-uint read_from_file(void *buffer, uint size, handle handle);
-void close_file(handle handle);
+HOST void update_allocation_rates(float32 elapsed_time);
+
+/* reports what every tag still holds; at exit, after `stop_reports`, that is
+   what leaked */
+HOST void report_allocations(void);
+
+HOST uint get_processors_count(void);
+
+/* a linear allocator whose pushes are released all at once */
+typedef struct
+{
+	byte *memory;
+	uint  capacity;
+	uint  mass;
+
+	allocation_tag tag;
+} arena;
+
+#define FRAME_ARENA_CAPACITY (64 << 20)
+
+HOST void  initialize_arena(uint capacity, allocation_tag tag, arena *arena);
+HOST void  terminate_arena(arena *arena);
+HOST void *push_into_arena(uint size, uint alignment, arena *arena);
+HOST void  reset_arena(arena *arena);
+
+#define push_array(type, count, arena) ((type *)push_into_arena(sizeof(type) * (count), _Alignof(type), arena))
+
+typedef void job_function(void *parameter);
+
+/* the jobs of a group that have not finished */
+typedef struct
+{
+	_Atomic uint count;
+} job_counter;
+
+typedef struct
+{
+	job_function *function;
+	void         *parameter;
+	job_counter  *counter;
+} job;
+
+#define JOB_DEQUE_CAPACITY      4096
+#define JOB_WORKERS_CAPACITY    64
+#define JOB_SCRATCH_CAPACITY    (4 << 20)
+#define JOB_MAIN_QUEUE_CAPACITY 256
+
+/* a Chase-Lev deque: its worker pushes and pops at the bottom, and the others
+   steal from the top */
+typedef struct
+{
+	alignas(64) _Atomic sintl top;
+	alignas(64) _Atomic sintl bottom;
+	job jobs[JOB_DEQUE_CAPACITY];
+} job_deque;
+
+typedef struct
+{
+	job_deque deque;
+	arena     scratch;  /* for the jobs that it runs; what a job pushes is popped when it returns */
+	thrd_t    thread;
+	uint      index;
+	uint32    random;  /* for picking whom to steal from */
+	uint      depth;   /* of jobs run while waiting for others */
+
+	/* reset whenever they are reported */
+	_Atomic uintl busy_time;
+	_Atomic uint  jobs_count;
+	_Atomic uint  stolen_jobs_count;
+} job_worker;
+
+/* a worker thread for every processor, after the main thread. jobs
+   that must run on the main thread, such as submissions to vulkan, are queued
+   apart and run once a frame. */
+typedef struct
+{
+	job_worker  *workers;
+	uint         workers_count;
+	atomic_bool  terminating;
+
+	/* workers with nothing to steal sleep here */
+	mtx_t        mutex;
+	cnd_t        condition;
+	_Atomic uint sleepers_count;
+
+	mtx_t main_mutex;
+	job   main_jobs[JOB_MAIN_QUEUE_CAPACITY];
+	uint  main_jobs_count;
+} job_system;
+
+HOST void initialize_jobs(void);
+HOST void terminate_jobs(void);
+HOST void push_job(job_function *function, void *parameter, job_counter *counter);
+HOST void push_main_job(job_function *function, void *parameter, job_counter *counter);
+HOST void run_main_jobs(void);
+HOST void wait_for_jobs(job_counter *counter);
+HOST void report_job_statistics(float32 elapsed_time);
+HOST void benchmark_jobs(void);
+
+/* printf-style formatting without the heap; the result is always terminated
+   and truncated to `capacity` */
+HOST uint format_string_v(char *buffer, uint capacity, const char *format, va_list vargs);
+HOST uint format_string  (char *buffer, uint capacity, const char *format, ...);
+
+/* formats into `arena`, reusing the string formatted by an earlier call with
+   the same format and arguments */
+HOST const char *push_formatted_string_v(uint *size, arena *arena, const char *format, va_list vargs);
+HOST const char *push_formatted_string  (uint *size, arena *arena, const char *format, ...);
+
+HOST uint pack_format_arguments(byte *buffer, uint capacity, const char *format, va_list vargs);
+HOST uint format_packed_string (char *buffer, uint capacity, const char *format, const byte *packed);
+
+HOST void benchmark_format(void);
+
+#define REPORT_QUEUE_CAPACITY     256
+#define REPORT_ARGUMENTS_CAPACITY 1024
+#define REPORT_TEXT_CAPACITY      2048
+#define REPORTS_DEFAULT_PATH      "build/text.log"
+
+typedef struct
+{
+	uintl       time;
+	const char *file;
+	const char *format;  /* none if the report was formatted into `arguments` */
+	uint        line;
+	severity    severity;
+	alignas(uintl) byte arguments[REPORT_ARGUMENTS_CAPACITY];
+} report_entry;
+
+typedef enum
+{
+	REPORT_QUEUE_STATE_LEFT,       /* by its thread, for another to take */
+	REPORT_QUEUE_STATE_OWNED,
+	REPORT_QUEUE_STATE_ABANDONED,  /* by the reporter when it stopped, for its thread to free */
+} report_queue_state;
+
+/* the reports of a thread to the logger, without locks. a queue is owned by
+   one thread at a time, and is left for another once that thread exits. */
+typedef struct report_queue
+{
+	report_entry         entries[REPORT_QUEUE_CAPACITY];
+	_Atomic uint32       head;
+	_Atomic uint32       tail;
+	_Atomic uint32       state;
+	struct report_queue *next;
+} report_queue;
+
+typedef struct
+{
+	_Atomic(report_queue *) queues;  /* only ever pushed to, until terminated */
+	tss_t                   queue_key;
+	atomic_bool             running;
+	_Atomic uint            reporters_count;  /* of threads in `_report`, which `stop_reports` waits out */
+	thrd_t                  logger;
+	FILE                   *file;
+
+	/* the logger sleeps here when every queue is empty */
+	mtx_t       mutex;
+	cnd_t       condition;
+	atomic_bool sleeping;
+
+	_Atomic uintl dropped_counts[SEVERITIES_COUNT];  /* of reports that found their queue full */
+} reporter;
+
+HOST void initialize_reports(const char *path);
+HOST void terminate_reports(void);
+/* stops the logger and frees the queues, but those of threads that are still
+   running, which free theirs as they exit; reports are then written at once,
+   so what is left of the reporter's own memory can be reported */
+HOST void stop_reports(void);
+HOST void flush_reports(void);
+
+/* a single-producer single-consumer ring of bytes. the producer and the
+   consumer may be on different threads without locking; the `begin_*`
+   functions give the largest contiguous region that can be used at once. */
+typedef struct
+{
+	byte *memory;
+	uint  capacity;  /* a power of two */
+	_Atomic uintl head;  /* advanced by the producer */
+	_Atomic uintl tail;  /* advanced by the consumer */
+
+	allocation_tag tag;
+} ring;
+
+HOST void initialize_ring(uint capacity, allocation_tag tag, ring *ring);
+HOST void terminate_ring(ring *ring);
+HOST byte       *begin_ring_write(uint *size, ring *ring);
+HOST void        end_ring_write  (uint size, ring *ring);
+HOST const byte *begin_ring_read (uint *size, ring *ring);
+HOST void        end_ring_read   (uint size, ring *ring);
+HOST uint write_to_ring (const void *data, uint size, ring *ring);
+HOST uint read_from_ring(void *buffer, uint size, ring *ring);
+
+HOST handle open_file(const char *path);
+HOST uintl get_size_of_file(handle handle);
+HOST uint read_from_file(void *buffer, uint size, handle handle);
+HOST void close_file(handle handle);
+
+/* maps `size` bytes of a file to read; nothing for an empty file */
+HOST const byte *map_file(uintl size, handle handle);
+HOST void unmap_file(const byte *memory, uintl size);
+
+#define PSEUDOTERMINAL_OUTPUT_CAPACITY (4 << 20)
+
+/* how long a program has to exit once it is hung up on, before it is killed */
+#define PSEUDOTERMINAL_HANGUP_TIMEOUT (TIME_SECONDS_FACTOR / 2)
+
+/* a program attached to a pseudoterminal. its output is read on a dedicated
+   thread into `output`, so a program that writes faster than the editor can
+   draw only ever blocks itself. */
+typedef struct
+{
+	handle input;
+	handle output;
+	handle process;
+	handle closer;  /* wakes the reader when the pseudoterminal is closed; the pseudoconsole on Win32 */
+	thrd_t reader;
+#if defined(ON_WIN32)
+	handle exit_wait;    /* closes the pseudoconsole when the program exits */
+	mtx_t  closer_lock;  /* as the program's exit and closing both close it */
+#endif
+	ring   output_ring;
+
+	atomic_bool closing;
+	atomic_bool exited;
+	_Atomic uintl bytes_read_count;
+	uintl opening_time;
+} pseudoterminal;
+
+HOST void open_pseudoterminal(const char *program, uint columns, uint rows, pseudoterminal *pseudoterminal);
+HOST void close_pseudoterminal(pseudoterminal *pseudoterminal);
+HOST uint write_to_pseudoterminal(const void *data, uint size, pseudoterminal *pseudoterminal);
+HOST void resize_pseudoterminal(uint columns, uint rows, pseudoterminal *pseudoterminal);
+
+typedef enum
+{
+	TERMINAL_ATTRIBUTE_BOLD      = 1 << 0,
+	TERMINAL_ATTRIBUTE_UNDERLINE = 1 << 1,
+	TERMINAL_ATTRIBUTE_INVERSE   = 1 << 2,
+} terminal_attribute;
+
+#define TERMINAL_DEFAULT_FOREGROUND 7
+#define TERMINAL_DEFAULT_BACKGROUND 0
+
+typedef struct
+{
+	utf32 rune;
+	uint8 foreground;  /* an index into the 256-color palette */
+	uint8 background;
+	uint8 attributes;
+	uint8 reserved;
+} terminal_cell;
+
+HOST uint get_lz_bound(uint size);
+HOST uint compress_lz(const byte *source, uint size, byte *destination);
+HOST uint decompress_lz(const byte *source, uint size, byte *destination, uint capacity);
+
+#define SCROLLBACK_PAGE_CELLS_CAPACITY     (1 << 16)
+#define SCROLLBACK_PAGE_LINES_CAPACITY     (1 << 13)
+#define SCROLLBACK_LINE_CAPACITY           SCROLLBACK_PAGE_CELLS_CAPACITY  /* longer lines are broken */
+#define SCROLLBACK_HOT_PAGES_COUNT         2
+#define SCROLLBACK_QUEUE_CAPACITY          64  /* the bits of a slot mask */
+#define SCROLLBACK_DEFAULT_MEMORY_CAPACITY (64 << 20)
+#define SCROLLBACK_REFLOW_PAGES_CAPACITY   64
+
+typedef enum
+{
+	SCROLLBACK_PAGE_STATE_OPEN,
+	SCROLLBACK_PAGE_STATE_SEALED,
+	SCROLLBACK_PAGE_STATE_QUEUED,      /* the compressor reads its cells */
+	SCROLLBACK_PAGE_STATE_COMPRESSED,
+} scrollback_page_state;
+
+typedef struct
+{
+	uintl first_line;
+	uint  lines_count;
+	uint  cells_count;
+
+	/* the sizes of the lines in varints, which are kept uncompressed */
+	byte *lengths;
+	uint  lengths_size;
+
+	terminal_cell *cells;  /* released once compressed */
+
+	/* once compressed, the lengths followed by the compressed cells */
+	byte *block;
+	uint  block_size;
+	uint  compressed_size;
+
+	/* the rows that the lines take at `rows_columns` columns */
+	uint rows_count;
+	uint rows_columns;
+
+	scrollback_page_state state;
+} scrollback_page;
+
+/* a page that is given to a job to compress, and then given back */
+typedef struct
+{
+	struct scrollback   *scrollback;
+	uint                 slot;
+	uintl                page_number;
+	terminal_cell       *cells;
+	uint                 cells_count;
+	byte                *lengths;
+	uint                 lengths_size;
+	byte                *block;
+	uint                 block_size;
+	uint                 compressed_size;
+} scrollback_compression;
+
+/* pages whose rows are counted by a job. it owns the arrays from when the
+   reflow is requested until it is done; meanwhile, the pages keep their lengths. */
+typedef struct
+{
+	uintl       first_page_number;
+	uint        pages_count;
+	uint        columns;
+	const byte *lengths[SCROLLBACK_REFLOW_PAGES_CAPACITY];
+	uint        lengths_sizes[SCROLLBACK_REFLOW_PAGES_CAPACITY];
+	uint        rows_counts[SCROLLBACK_REFLOW_PAGES_CAPACITY];
+	bit         requested;
+	atomic_bool done;
+} scrollback_reflow;
+
+/* the lines that scrolled off a terminal's grid. the newest pages keep their
+   cells as they are; older pages are compressed by jobs, and the oldest are
+   discarded to stay within `memory_capacity`. */
+typedef struct scrollback
+{
+	scrollback_page *pages;  /* a ring */
+	uint             pages_capacity;
+	uint             first_page;
+	uint             pages_count;
+	uintl            first_page_number;
+	uint             queued_pages_count;  /* the leading pages that are queued or compressed */
+
+	uintl first_line;
+	uintl lines_count;  /* including the open line */
+	uint  open_line_size;
+	bit   line_open : 1;  /* the last line continues on the next row */
+
+	uintl memory_capacity;
+	uintl memory_size;
+
+	/* the width that the lines are wrapped at; the pages before
+	   `reflow_page_number` may still be counted for another */
+	uint              columns;
+	uintl             reflow_page_number;
+	scrollback_reflow reflow;
+
+	/* the compressions that are requested but not applied, in slots that are
+	   taken by the main thread and marked as compressed by the jobs */
+	job_counter            jobs;
+	scrollback_compression compressions[SCROLLBACK_QUEUE_CAPACITY];
+	uint64                 taken_slots;
+	_Atomic uint64         compressed_slots;
+
+	/* for reading lines of compressed pages */
+	uintl          cached_page_number;
+	uint           cached_lengths_size;
+	uint           cached_open_line_size;
+	uint          *cached_offsets;
+	terminal_cell *cached_cells;
+	byte          *cached_planes;
+} scrollback;
+
+HOST void initialize_scrollback(uintl memory_capacity, scrollback *scrollback);
+HOST void terminate_scrollback(scrollback *scrollback);
+HOST void push_scrollback_row(const terminal_cell *cells, uint count, bit wrapped, scrollback *scrollback);
+HOST void update_scrollback(scrollback *scrollback);
+HOST uint get_scrollback_line(uintl line, const terminal_cell **cells, scrollback *scrollback);
+HOST uint count_scrollback_rows(uint size, uint columns);
+HOST void reflow_scrollback(uint columns, scrollback *scrollback);
+HOST uintl seek_scrollback_row(uintl rows_back, uintl *line, uint *row, scrollback *scrollback);
+
+/* the visible screen of a terminal. rows are kept in a ring, so scrolling
+   does not move cells. */
+typedef struct
+{
+	terminal_cell *cells;
+	uint           columns;
+	uint           rows;
+	uint           first_row;  /* the physical row of the top row */
+	uint           cursor_column;
+	uint           cursor_row;
+	terminal_cell  pen;        /* the attributes of written cells */
+	bit            pending_wrap : 1;
+	bit           *wrapped_rows; /* whether a row continues on the next one */
+	scrollback    *scrollback;   /* receives the rows that scroll off, if any */
+} terminal_grid;
+
+HOST void initialize_terminal_grid(uint columns, uint rows, terminal_grid *grid);
+HOST void terminate_terminal_grid(terminal_grid *grid);
+HOST void resize_terminal_grid(uint columns, uint rows, terminal_grid *grid);
+HOST terminal_cell *get_terminal_grid_row(uint row, const terminal_grid *grid);
+#define UTF8_ENCODING_CAPACITY 4
+
+/* writes `rune` as UTF-8 and returns how many bytes that took */
+HOST uint encode_utf8(utf32 rune, char *encoding);
+HOST uint get_terminal_cells_text(const terminal_cell *cells, uint count, char *buffer, uint capacity);
+HOST uint get_terminal_grid_row_text(uint row, char *buffer, uint capacity, const terminal_grid *grid);
+
+typedef enum
+{
+	VT_STATE_GROUND,
+	VT_STATE_ESCAPE,
+	VT_STATE_ESCAPE_INTERMEDIATE,
+	VT_STATE_CSI_ENTRY,
+	VT_STATE_CSI_PARAMETER,
+	VT_STATE_CSI_INTERMEDIATE,
+	VT_STATE_CSI_IGNORE,
+	VT_STATE_OSC_STRING,
+	VT_STATE_STRING,  /* DCS, SOS, PM and APC, which are ignored */
+} vt_state;
+
+#define VT_PARAMETERS_CAPACITY 16
+
+/* parses the output of a program into a grid */
+typedef struct
+{
+	vt_state state;
+	uint     parameters[VT_PARAMETERS_CAPACITY];
+	uint     parameters_count;
+	char     intermediate;
+	char     private_marker;
+	bit      string_escaped : 1;  /* an ESC was seen in a string; ST may follow */
+
+	/* a UTF-8 sequence may be split between two reads */
+	utf32 rune;
+	uint  rune_remaining_bytes;
+
+	uint          saved_cursor_column;
+	uint          saved_cursor_row;
+	terminal_cell saved_pen;
+
+	terminal_grid *grid;
+} vt_parser;
+
+HOST void parse_vt(const byte *data, uint size, vt_parser *parser);
+
+HOST void benchmark_vt(const char *path);
+HOST void benchmark_pseudoterminal(const char *path);
+
+/* a piece of a document's text, which is either of the file that the document
+   was opened from or of the text that was added to it since */
+typedef struct
+{
+	uintl offset;  /* in the document */
+	uintl size;
+	uintl source;  /* the offset in the file, or in the added text with `TEXT_PIECE_ADDED` */
+} text_piece;
+
+#define TEXT_PIECE_ADDED ((uintl)1 << 63)
+
+#define TEXT_NO_RECORD                UINT_MAXIMUM
+#define TEXT_NO_DELTAS                UINT_MAXIMUM
+#define TEXT_ROOT_RECORD              0
+#define TEXT_RECORD_COALESCING_PERIOD (TIME_SECONDS_FACTOR / 2)
+
+/* an edit replaces a run of pieces with others. its record keeps the pieces
+   that it removed, and once it is undone, the pieces that it inserted; both as
+   deltas, since the text itself is never copied. */
+typedef struct
+{
+	uint32 parent;
+	uint32 children;  /* the newest */
+	uint32 sibling;   /* the next older child of the parent */
+	uint32 redo;      /* the child that is redone */
+	uint32 first_piece;
+	uint32 removed_count;
+	uint32 inserted_count;
+	uint32 removed_deltas;   /* where the removed pieces are in the deltas */
+	uint32 inserted_deltas;  /* `TEXT_NO_DELTAS` until undone */
+} text_record;
+
+/* every state that the document has been in is a record of a tree, so an
+   undone edit is never lost to the edit that follows it */
+typedef struct
+{
+	text_record *records;
+	uint         records_count;
+	uint         records_capacity;
+	byte        *deltas;
+	uint         deltas_size;
+	uint         deltas_capacity;
+	uint         current;
+
+	/* the current record takes the edits that follow it closely, as long as
+	   they only touch the pieces that it inserted */
+	bit   open;
+	uintl edit_time;
+} text_history;
+
+#define TEXT_CHANGES_CAPACITY 64
+
+/* what an edit changed: `removed_size` bytes at `offset`, which became `inserted_size` */
+typedef struct
+{
+	uintl offset;
+	uintl removed_size;
+	uintl inserted_size;
+} text_change;
+
+/* a document: the file it was opened from is mapped and never written; what
+   is added to it is appended to `added`, which is never written over either */
+typedef struct
+{
+	const byte *original;
+	uintl       original_size;
+
+	byte *added;
+	uint  added_size;
+	uint  added_capacity;
+
+	text_piece *pieces;
+	uint        pieces_count;
+	uint        pieces_capacity;
+	uintl       size;
+
+	text_history history;
+
+	/* the jobs that read the pieces, of searches and highlighting; no edit may be made meanwhile */
+	uint readers_count;
+	uint edits_count;  /* so that what was found in the text is known to be stale */
+
+	/* the latest edits, the last at `edits_count`, so that what follows the text
+	   need only look again at what they changed */
+	text_change changes[TEXT_CHANGES_CAPACITY];
+	text_piece  changed_pieces[2];  /* the first and last that the edit being made removes */
+} text_buffer;
+
+HOST void open_text_buffer(const char *path, text_buffer *buffer);  /* an empty document without a path */
+HOST void close_text_buffer(text_buffer *buffer);
+HOST uint find_text_piece(uintl offset, const text_buffer *buffer);
+HOST const byte *get_text_piece_data(const text_piece *piece, const text_buffer *buffer);
+HOST uint read_text(uintl offset, uint size, byte *destination, const text_buffer *buffer);
+
+/* appends to the added text and returns the source of a piece of it */
+HOST uintl add_text(const byte *text, uint size, text_buffer *buffer);
+
+/* replaces `removed_count` pieces from `first` with `pieces`, whose offsets
+   are ignored, and records it */
+HOST void splice_text_pieces(uint first, uint removed_count, const text_piece *pieces, uint count, text_buffer *buffer);
+
+HOST void replace_text(uintl offset, uintl size, const byte *text, uint text_size, text_buffer *buffer);
+
+#define insert_text(offset, text, size, buffer) replace_text(offset, 0, text, size, buffer)
+#define delete_text(offset, size, buffer)       replace_text(offset, size, 0, 0, buffer)
+
+#define TEXT_REPLACEMENT_JOB_RUNS      (64 << 10)
+#define TEXT_REPLACEMENT_JOBS_CAPACITY 1024
+
+/* a job that makes the pieces of a stretch of the text with the runs in it
+   replaced, into as many pieces as it may need */
+typedef struct
+{
+	const text_buffer *buffer;
+	const uintl       *beginnings;
+	const uintl       *ends;  /* or every run is `run_size` long */
+	uint               runs_count;
+	uint               run_size;
+	uintl              begin;
+	uintl              end;
+	uintl              replacement;  /* the source of every replacement */
+	uint               replacement_size;
+	text_piece        *pieces;
+	uint               pieces_count;
+} text_replacement_job;
+
+/* replaces every one of the sorted runs of the text, which must not overlap,
+   with `text`, as a single edit */
+HOST void replace_text_runs(const uintl *beginnings, const uintl *ends, uint runs_count, uint run_size, const byte *text, uint text_size, text_buffer *buffer);
+
+/* the same for matches of a search, as an edit that is undone on its own */
+HOST void replace_text_matches(const uintl *matches, uint matches_count, uint match_size, const byte *text, uint text_size, text_buffer *buffer);
+
+HOST bit get_text_changes(uint edits_count, text_change *changes, const text_buffer *buffer);
+
+/* undo and redo give where the document changed */
+HOST void close_text_record(text_buffer *buffer);
+HOST bit  undo_text(uintl *offset, text_buffer *buffer);
+HOST bit  redo_text(uintl *offset, text_buffer *buffer);
+HOST void switch_text_branch(text_buffer *buffer);
+
+HOST void benchmark_text_buffer(const char *path);
+
+#define TEXT_PATTERN_CAPACITY    4096
+#define TEXT_SEARCH_SAMPLE_SIZE (64 << 10)
+#define TEXT_NO_MATCH            UINTL_MAXIMUM
+
+/* a literal to search for. candidates are found by two of its bytes at once,
+   the rarest in a sample of the document, and only then compared whole. */
+typedef struct
+{
+	const byte *bytes;
+	uint        size;
+	uint        rare_indices[2];
+	byte        rare_bytes[2];
+} text_pattern;
+
+HOST void compile_text_pattern(const byte *bytes, uint size, const text_buffer *buffer, text_pattern *pattern);
+HOST uintl find_pattern(const byte *data, uintl size, const text_pattern *pattern);
+HOST uintl find_text(uintl offset, uintl end, const text_pattern *pattern, const text_buffer *buffer);
+
+HOST void benchmark_text_search(const char *path, const char *literal);
+
+#define TEXT_SEARCH_CHUNK_SIZE      (8 << 20)
+#define TEXT_SEARCH_CHUNKS_CAPACITY 1024
+#define TEXT_SEARCH_STEP_SIZE       (1 << 20)  /* how much a job searches between looks at the cancellation */
+#define TEXT_SEARCH_RESULTS_CAPACITY 8
+#define TEXT_SEARCH_RESULTS_SIZE     (256 << 20)  /* that the matches of earlier queries may take */
+
+typedef struct
+{
+	struct text_search *search;
+	uintl               begin;
+	uintl               end;
+	const uintl        *candidates;  /* the matches of a query that the pattern extends, checked instead of searching */
+	uint                candidates_count;
+	uintl              *matches;
+	uint                matches_count;
+	uint                matches_capacity;
+	atomic_bool         done;
+} text_search_chunk;
+
+/* what an earlier query found, as far as it was searched before it changed */
+typedef struct
+{
+	byte   bytes[TEXT_PATTERN_CAPACITY];
+	uint   size;
+	uint   use;  /* when it was last searched for, so the oldest is forgotten first; 0 when it is unused */
+	uintl  searched_end;  /* every match that begins before it is there */
+	uintl *matches;
+	uint   matches_count;
+	uint   matches_capacity;
+} text_search_result;
+
+/* every match of a pattern in a document. jobs search chunks of it, and the
+   chunks that are done are merged in order, so the matches come sorted from
+   the first chunk on while the rest are searched.
+
+   as a query is typed, what each one found is kept until the document is
+   edited: a query that was searched before takes its matches back and only
+   searches on from where it stopped, and one that extends an earlier query
+   only checks its matches, as long as they cannot overlap and so are all the
+   places where the query could match. */
+typedef struct text_search
+{
+	text_buffer  *buffer;
+	uint          edits_count;  /* of the buffer when it was searched */
+	byte          bytes[TEXT_PATTERN_CAPACITY];
+	text_pattern  pattern;
+
+	text_search_chunk *chunks;
+	uint               chunks_count;
+	uint               merged_chunks_count;
+	job_counter        jobs;
+	atomic_bool        cancelled;
+	_Atomic uintl      found_count;  /* so far, merged or not */
+
+	uintl *matches;
+	uint   matches_count;
+	uint   matches_capacity;
+	uintl  searched_end;  /* of the chunks merged so far */
+	bit    running;
+
+	text_search_result results[TEXT_SEARCH_RESULTS_CAPACITY];
+	uint               uses_count;
+} text_search;
+
+/* a search begins zeroed, and must be cancelled before its buffer is edited */
+HOST void begin_text_search(const byte *bytes, uint size, text_buffer *buffer, text_search *search);
+HOST bit  update_text_search(text_search *search);
+HOST void cancel_text_search(text_search *search);
+HOST void end_text_search(text_search *search);
+
+HOST void benchmark_text_find_all(const char *path, const char *literal);
+HOST void benchmark_text_search_typing(const char *path, const char *query);
+HOST void benchmark_text_replace_all(const char *path, const char *literal, const char *replacement);
+
+#define REGEX_STATES_CAPACITY 16384
+#define REGEX_SETS_CAPACITY   256
+#define REGEX_CACHE_CAPACITY  (2 << 20)  /* of each automaton */
+#define REGEX_NO_STATE        UINT32_MAX
+
+typedef enum
+{
+	REGEX_STATE_BYTES,  /* takes a byte of its set */
+	REGEX_STATE_SPLIT,
+	REGEX_STATE_EMPTY,
+	REGEX_STATE_MATCH,
+} regex_state_kind;
+
+typedef struct
+{
+	uint32 next;
+	uint32 alternative;  /* of a split */
+	uint16 set;
+	uint8  kind;
+} regex_state;
+
+/* a Thompson automaton over bytes */
+typedef struct
+{
+	regex_state *states;
+	uint         states_count;
+	uint32       start;
+} regex_program;
+
+/* a deterministic automaton whose states are the sets of program states that
+   it reaches, made as they are first reached and all forgotten at once when
+   they outgrow `REGEX_CACHE_CAPACITY`. its transitions are by byte class. the
+   sets are in groups by where their matches began, the earliest first. */
+typedef struct
+{
+	const regex_program *program;
+	bit                  unanchored;  /* every position begins a match */
+
+	uint32  start_states[2];  /* by whether a match begins where the search does; `REGEX_NO_STATE` until made */
+	uint32 *transitions;      /* `REGEX_UNKNOWN_TRANSITION` until made */
+	bit    *matching;
+	uint32 *element_offsets;
+	uint32 *elements;
+	uint32 *table;
+	uint    states_count;
+	uint    states_capacity;
+	uint    elements_count;
+	uint    elements_capacity;
+	uint    table_capacity;
+	uint    flushes_count;
+} regex_dfa;
+
+/* matches are the leftmost, and the longest of those: one automaton reads
+   on until it knows where that match ends, and another reads back from there
+   to where it begins. a pattern that begins with a literal has the text where
+   no match is under way skipped by the literal search. */
+typedef struct
+{
+	regex_program forward;
+	regex_program reverse;
+	uint64        sets[REGEX_SETS_CAPACITY][4];
+	uint          sets_count;
+	uint8         classes[256];
+	byte          representatives[256];  /* a byte of every class */
+	uint          classes_count;
+	bit           line_beginning;  /* the pattern began with `^` */
+	bit           line_end;        /* and ended with `$` */
+
+	byte         prefix[TEXT_PATTERN_CAPACITY];
+	uint         prefix_size;
+	text_pattern prefix_pattern;
+
+	regex_dfa searcher;
+	regex_dfa reverse_matcher;
+
+	/* for finding the sets of states */
+	uint32 *stack;
+	uint32 *marks;
+	uint32  mark;
+	uint32 *closure;
+	uint    closure_count;
+	uint32 *saved;
+} text_regex;
+
+HOST bit  compile_text_regex(const char *source, uint size, const text_buffer *buffer, text_regex *regex);
+HOST void terminate_text_regex(text_regex *regex);
+HOST uintl find_text_regex(uintl offset, uintl *match_end, text_regex *regex, const text_buffer *buffer);
+
+HOST void benchmark_text_regex(const char *path, const char *source);
+
+/* where text is typed, and one end of a selection whose other is the anchor */
+typedef struct
+{
+	uintl position;
+	uintl anchor;
+} text_cursor;
+
+/* cursors in order, whose selections neither overlap nor meet, so that an
+   edit at every one of them is a single pass over the pieces */
+typedef struct
+{
+	text_cursor *cursors;
+	uint         cursors_count;
+	uint         cursors_capacity;
+
+	/* what an edit replaces, at every cursor */
+	uintl *beginnings;
+	uintl *ends;
+} text_cursors;
+
+HOST void add_text_cursor(uintl position, uintl anchor, text_cursors *cursors);
+HOST void select_text_matches(const uintl *matches, uint matches_count, uint match_size, text_cursors *cursors);
+HOST void terminate_text_cursors(text_cursors *cursors);
+
+/* edits at every cursor, each replacing its selection */
+HOST void type_at_text_cursors(const byte *text, uint size, text_cursors *cursors, text_buffer *buffer);
+HOST void erase_at_text_cursors(bit forward, text_cursors *cursors, text_buffer *buffer);
+HOST void move_text_cursors(bit forward, bit selecting, text_cursors *cursors, const text_buffer *buffer);
+
+HOST void benchmark_text_cursors(const char *path, const char *literal);
+
+/* what a byte of the text is highlighted as */
+typedef enum
+{
+	TEXT_TOKEN_PLAIN,
+	TEXT_TOKEN_IDENTIFIER,
+	TEXT_TOKEN_KEYWORD,
+	TEXT_TOKEN_TYPE,
+	TEXT_TOKEN_NUMBER,
+	TEXT_TOKEN_STRING,
+	TEXT_TOKEN_COMMENT,
+	TEXT_TOKEN_PREPROCESSOR,
+	TEXT_TOKEN_PUNCTUATION,
+	TEXT_TOKENS_COUNT,
+} text_token;
+
+#define TEXT_LEXER_TOKEN_END 0x8000  /* marks a transition from where a token ends into the next */
+#define TEXT_LEXER_UNKNOWN   0xff    /* as the state of a line */
+
+/* a lexer that the lexer generator made from a grammar: an automaton for every
+   mode, which finds the longest token that any of the mode's rules match, and
+   the first of those rules. the automata share one table with a row for every
+   state, whose first row leads nowhere. a file begins in the first mode, and
+   the state of a line is the mode that it begins in. */
+typedef struct
+{
+	const char   *name;
+	const char   *extensions;  /* of the files that it is for, separated by spaces */
+	const uint8  *classes;     /* of every byte, from 1 */
+	const uint16 *transitions; /* a row begins with the rule that its state accepts after 1, or 0, then has the rows that the classes lead to */
+	const uint8  *rule_tokens;
+	const uint8  *rule_modes;  /* that the rules lead to */
+	const uint16 *mode_starts; /* their rows */
+	uint          classes_count;
+	uint          states_count;
+	uint          modes_count;
+} text_lexer;
+
+HOST const text_lexer *find_text_lexer(const char *path);
+
+typedef struct
+{
+	uintl offset;
+	uint8 bracket;
+} text_bracket;
+
+typedef struct
+{
+	uint  left;
+	uint  right;
+	uintl gap;           /* from the bracket before, or from the beginning */
+	uintl length;        /* of the gaps of the subtree */
+	sint  depth;         /* how much deeper the subtree leaves the nesting */
+	sint  lowest_depth;  /* that the nesting is after any bracket of the subtree, from where it was before it */
+	uint8 bracket;
+} text_bracket_node;
+
+/* the brackets of a text, in a treap of the gaps between them. the first node
+   is none, and freed ones are linked by `left`. */
+typedef struct
+{
+	text_bracket_node *nodes;
+	uint               nodes_count;
+	uint               nodes_capacity;
+	uint               free_node;
+	uint               root;
+} text_brackets;
+
+HOST void replace_text_brackets(uintl begin, uintl end, sintl delta, const text_bracket *list, uint count, text_brackets *brackets);
+HOST void clear_text_brackets(text_brackets *brackets);
+HOST void terminate_text_brackets(text_brackets *brackets);
+HOST uint get_text_brackets(uintl begin, uintl end, text_bracket *list, uint capacity, const text_brackets *brackets);
+HOST bit  find_matching_text_bracket(uintl offset, uintl *match, const text_brackets *brackets);
+
+#define TEXT_HIGHLIGHT_LINE_CAPACITY (64 << 10)  /* longer lines are lexed in parts, which may cut their tokens */
+#define TEXT_HIGHLIGHT_STEP_LINES    4096        /* that a job lexes between looks at the cancellation */
+#define TEXT_FOLD_BRACKETS_CAPACITY  256         /* of a line that are looked at for a fold */
+
+/* the state of the lexer where every line begins. an edit only invalidates the
+   states of the lines that it touched, and those that follow are lexed again
+   only until one of them agrees with the state that was kept for it. what is
+   visible is lexed at once; the rest, by a job.
+
+   the states that are not known to be right are either `TEXT_LEXER_UNKNOWN`
+   or were right for the lines before them as they are, so that a line that
+   agrees with its kept state is right up to the next unknown one.
+
+   the brackets that are not in comments or strings are kept too, and found
+   again by the job, once every state is known, in the lines whose text or
+   state changed. */
+typedef struct
+{
+	text_buffer      *buffer;
+	const text_lexer *lexer;
+	uint              edits_count;  /* of the buffer when the lines were last caught up with it */
+
+	uintl *line_offsets;
+	uint8 *states;
+	uint   lines_count;
+	uint   lines_capacity;
+
+	_Atomic uint known_count;  /* of the lines from the first whose states are right */
+	job_counter  jobs;
+	atomic_bool  cancelled;
+	atomic_bool  done;
+	bit          running;
+
+	byte *line;      /* for lines that are cut between pieces */
+	byte *job_line;
+
+	text_brackets brackets;
+	uint          brackets_dirty_begin;  /* the lines whose brackets are to be found again */
+	uint          brackets_dirty_end;
+	text_bracket *found_brackets;
+	uint          found_brackets_capacity;
+	uint8        *job_tokens;
+} text_highlighter;
+
+HOST void begin_text_highlighting(const text_lexer *lexer, text_buffer *buffer, text_highlighter *highlighter);
+HOST bit  update_text_highlighting(uint visible_end, text_highlighter *highlighter);
+HOST void cancel_text_highlighting(text_highlighter *highlighter);  /* before the buffer is edited */
+HOST void end_text_highlighting(text_highlighter *highlighter);
+HOST uint find_text_line(uintl offset, const text_highlighter *highlighter);
+HOST uint highlight_text_line(uint line, uint8 *tokens, uint capacity, text_highlighter *highlighter);
+HOST bit  are_text_brackets_known(const text_highlighter *highlighter);
+HOST bit  match_text_bracket(uintl offset, uintl *match, const text_highlighter *highlighter);
+HOST uint find_text_fold(uint line, const text_highlighter *highlighter);
+
+HOST void benchmark_text_highlighting(const char *path);
+HOST void benchmark_text_lexers(const char *path);
+
+typedef enum
+{
+	KEY_CODE_NONE,
+	KEY_CODE_A, KEY_CODE_B, KEY_CODE_C, KEY_CODE_D, KEY_CODE_E, KEY_CODE_F, KEY_CODE_G, KEY_CODE_H, KEY_CODE_I,
+	KEY_CODE_J, KEY_CODE_K, KEY_CODE_L, KEY_CODE_M, KEY_CODE_N, KEY_CODE_O, KEY_CODE_P, KEY_CODE_Q, KEY_CODE_R,
+	KEY_CODE_S, KEY_CODE_T, KEY_CODE_U, KEY_CODE_V, KEY_CODE_W, KEY_CODE_X, KEY_CODE_Y, KEY_CODE_Z,
+	KEY_CODE_0, KEY_CODE_1, KEY_CODE_2, KEY_CODE_3, KEY_CODE_4, KEY_CODE_5, KEY_CODE_6, KEY_CODE_7, KEY_CODE_8, KEY_CODE_9,
+	KEY_CODE_F1, KEY_CODE_F2, KEY_CODE_F3, KEY_CODE_F4, KEY_CODE_F5, KEY_CODE_F6,
+	KEY_CODE_F7, KEY_CODE_F8, KEY_CODE_F9, KEY_CODE_F10, KEY_CODE_F11, KEY_CODE_F12,
+	KEY_CODE_ESCAPE,
+	KEY_CODE_ENTER,
+	KEY_CODE_TAB,
+	KEY_CODE_BACKSPACE,
+	KEY_CODE_SPACE,
+	KEY_CODE_INSERT,
+	KEY_CODE_DELETE,
+	KEY_CODE_LEFT,
+	KEY_CODE_RIGHT,
+	KEY_CODE_UP,
+	KEY_CODE_DOWN,
+	KEY_CODE_HOME,
+	KEY_CODE_END,
+	KEY_CODE_PAGE_UP,
+	KEY_CODE_PAGE_DOWN,
+	KEY_CODE_BACK_TICK,
+	KEY_CODE_MINUS,
+	KEY_CODE_EQUALS,
+	KEY_CODE_LEFT_BRACKET,
+	KEY_CODE_RIGHT_BRACKET,
+	KEY_CODE_BACKSLASH,
+	KEY_CODE_SEMICOLON,
+	KEY_CODE_APOSTROPHE,
+	KEY_CODE_COMMA,
+	KEY_CODE_PERIOD,
+	KEY_CODE_SLASH,
+	KEY_CODES_COUNT,
+} key_code;
+
+typedef enum
+{
+	KEY_MODIFIER_PRESSED = 1 << 0,  /* otherwise, released */
+	KEY_MODIFIER_CTRL    = 1 << 1,
+	KEY_MODIFIER_SHIFT   = 1 << 2,
+	KEY_MODIFIER_ALT     = 1 << 3,
+	KEY_MODIFIER_SUPER   = 1 << 4,
+} key_modifier;
+
+typedef struct
+{
+	uint16 modifiers;
+	uint16 code;
+} key;
+
+typedef struct
+{
+	uint        tag;
+	const char *name;
+	bit         is_custom : 1;  /* registered by a plugin */
+} message;
+
+#define MAPPING_KEYS_CAPACITY 4
+
+/* binds a key, or a chord of keys pressed one after another, to a message */
+typedef struct
+{
+	union
+	{
+		key key;
+		key keys[MAPPING_KEYS_CAPACITY];  /* ended by `KEY_CODE_NONE`, if shorter */
+	};
+	uint message;
+} mapping;
+
+/* the mappings form a trie, whose edges are kept in one open-addressed table
+   from a node and a key to the child */
+typedef struct
+{
+	uint32 node;
+	uint32 key;    /* `modifiers << 16 | code`, or 0 if the slot is empty */
+	uint32 child;
+} mapping_edge;
+
+typedef struct
+{
+	uint message;
+	bit  has_message  : 1;
+	bit  has_children : 1;  /* the node is a prefix of a chord */
+} mapping_node;
+
+#define MAPPING_ROOT_NODE 0
+#define MAPPING_NO_NODE   UINT_MAXIMUM
+
+typedef struct
+{
+	mapping_edge *edges;
+	uint          edges_capacity;
+	uint          edges_count;
+
+	mapping_node *nodes;
+	uint          nodes_capacity;
+	uint          nodes_count;
+
+	uint chord_node;  /* where the keys pressed so far lead */
+
+	message *messages;  /* the registered messages, by tag */
+	uint     messages_capacity;
+} mapping_table;
+
+typedef enum
+{
+	INPUT_EVENT_TAG_KEY,
+	INPUT_EVENT_TAG_TEXT,
+	INPUT_EVENT_TAG_CLOSE,
+} input_event_tag;
+
+typedef struct
+{
+	input_event_tag tag;
+	uintl           time;  /* when the platform received it */
+	key             key;
+	utf32           rune;  /* typed, as the keyboard's layout makes it */
+} input_event;
+
+#define INTERFACE_EVENTS_CAPACITY 256
+
+/* what the host tells plugins every frame */
+typedef struct
+{
+	message messages[INTERFACE_EVENTS_CAPACITY];  /* raised during the frame */
+	uint    events_count;
+
+	/* the keys pressed during the frame that no mapping took, and the text
+	   typed, in order, for whatever takes the keyboard */
+	input_event inputs[INTERFACE_EVENTS_CAPACITY];
+	uint        inputs_count;
+
+	/* how long the host may sleep before the next frame. it is `WAIT_FOREVER`
+	   before each tick; plugins lower it for whatever they animate */
+	uintl wait;
+
+	/* the size, in pixels, of the frame that the UI is laid out over */
+	uint frame_width;
+	uint frame_height;
+} interface;
+
+HOST void initialize_mappings(mapping_table *mappings);
+HOST void terminate_mappings(mapping_table *mappings);
+HOST void push_message(const message *message);
+HOST void push_mapping(const mapping *mapping);
+HOST void raise_message(uint tag);
+HOST bit  dispatch_key(key key);
+
+#define INPUT_QUEUE_CAPACITY 1024
+
+/* events from the platform's thread to the main thread, without locks: only
+   the platform's thread advances `head`, and only the main thread `tail` */
+typedef struct
+{
+	input_event    events[INPUT_QUEUE_CAPACITY];
+	_Atomic uint32 head;
+	_Atomic uint32 tail;
+} input_queue;
+
+HOST bit  push_input_event(const input_event *event, input_queue *queue);
+HOST bit  pop_input_event(input_event *event, input_queue *queue);
+HOST void process_input_events(void);
+
+typedef struct
+{
+	uint  events_count;
+	uintl latency_sum;
+	uintl latency_maximum;
+} input_statistics;
+
+/* what a plugin keeps between frames lives in this memory, which the host
+   owns, so that the plugin's code can be reloaded without losing it */
+#define PLUGIN_MEMORY_CAPACITY (1 << 20)
+
+typedef void plugin_initialize_function(interface *interface, void *memory, bit reloaded);
+typedef void plugin_tick_function(float32 elapse);
+typedef void plugin_terminate_function(void);
+
+typedef struct
+{
+	const char *path;
+	void       *library;
+	uint        version;  /* which copy of the library is loaded */
+	handle      watcher;  /* notifies of changes to the library's directory */
+
+	plugin_initialize_function *initialize;
+	plugin_tick_function       *tick;
+	plugin_terminate_function  *terminate;
+
+	byte *memory;
+} plugin;
+
+HOST void load_plugin(const char *path, plugin *plugin);
+HOST void unload_plugin(plugin *plugin);
+HOST void update_plugin(plugin *plugin);
 
 typedef struct
 {
@@ -166,7 +1371,224 @@ typedef struct
 	uint base;
 } rect;
 
-void get_window_frame_rect(rect *rect);
+/* returns whether there is a window; its frame is empty while it is minimized */
+HOST bit get_window_frame_rect(rect *rect);
+
+/* the UI is made anew every frame, by calls that open and close elements into
+   a tree in the frame arena. when the frame is drawn, `ui_finalize` lays the
+   tree out over the frame, indexes it for hit-testing and batches it for
+   drawing. */
+
+typedef struct
+{
+	float32 x, y;
+} position2_f32;
+
+typedef union
+{
+	struct { float32 w, h; };
+	struct { float32 width, height; };
+} size2_f32;
+
+typedef union
+{
+	struct { position2_f32 tl, br; };
+	struct
+	{
+		float32 left;
+		float32 top;
+		float32 right;
+		float32 base;
+	};
+} range2_f32;
+
+/* how an element's children are laid out: next to each other, under each
+   other, or each over the whole element */
+typedef enum
+{
+	ORIENTATION_HORIZONTAL,
+	ORIENTATION_VERTICAL,
+	ORIENTATION_TRANSCENDENTAL,
+} orientation;
+
+/* a `magnitude` of 0 fits the content. an element shrinks, when its parent is
+   short of room, to no less than `magnitude * strictness` */
+typedef struct
+{
+	float32 magnitude;
+	float32 strictness;
+} flex_f32;
+
+typedef enum
+{
+	UI_ELEMENT_TAG_BOX,
+	UI_ELEMENT_TAG_TEXT,
+} ui_element_tag;
+
+typedef struct
+{
+
+} ui_element_box;
+
+typedef struct
+{
+	const char *text;  /* in the frame arena */
+	uint        text_size;
+	font       *font;
+} ui_element_text;
+
+typedef struct ui_element ui_element;
+struct ui_element
+{
+	/* behavior */
+	bit         horizontally_expanding : 1;
+	bit         vertically_expanding   : 1;
+	orientation orientation;  /* of the children */
+
+	/* dimensionals */
+	flex_f32   width;
+	flex_f32   height;
+	size2_f32  content_size;  /* measured when finalizing */
+	range2_f32 range;
+
+	/* heirarchy */
+	ui_element *children;
+	ui_element *last_child;
+	ui_element *sibling;
+	uints       layer;  /* the depth in the heirarchy */
+
+	/* element-specifc */
+	ui_element_tag tag;
+	union
+	{
+		ui_element_box  box;
+		ui_element_text text;
+	} data[];
+};
+
+/* what is being built: the open element, to which the next elements are
+   added as children, and what they inherit */
+typedef struct
+{
+	ui_element *element;
+	font       *font;
+} ui_state;
+
+#define UI_STATES_CAPACITY 64
+
+/*
+	a uniform grid over the finalized elements' ranges, rebuilt every frame in
+	the frame arena. each cell lists, in painting order, the elements that
+	overlap it, so finding the topmost element under a point only looks at the
+	elements of one cell.
+*/
+#define UI_INDEX_CELL_SIZE 64.f
+
+typedef struct
+{
+	range2_f32   range;
+	uint         columns;
+	uint         rows;
+	uint        *cell_offsets;  /* `columns * rows + 1` offsets into `cell_elements` */
+	ui_element **cell_elements;
+	ui_element **elements;      /* in painting order */
+	uint         elements_count;
+} ui_index;
+
+/*
+	every finalized box becomes one quad, and every text one quad per glyph.
+	the quads are culled against the frame and sorted by layer and texture, so
+	that each run of quads sharing both is drawn with a single instanced draw.
+*/
+typedef enum
+{
+	UI_TEXTURE_NONE,
+	UI_TEXTURE_GLYPHS,
+	UI_TEXTURES_COUNT,
+} ui_texture;
+
+/* the quads of a frame beyond this many are not drawn */
+#define UI_QUADS_CAPACITY (1 << 16)
+
+/* compiled from `code/shader_ui.*` by `build.sh` and `build_shaders.bat` */
+#define UI_VERTEX_SHADER_PATH   "data/ui_vert.spv"
+#define UI_FRAGMENT_SHADER_PATH "data/ui_frag.spv"
+
+/* an instance of `shader_ui.vert` */
+typedef struct
+{
+	range2_f32 range;
+	uint       texture;
+	uint       layer;
+	uint       glyph;  /* the rune, into the glyphs of `default_font` */
+} ui_quad;
+
+typedef struct
+{
+	uints layer;
+	uints texture;
+	uint  first;  /* into `quads` */
+	uint  count;
+} ui_batch;
+
+typedef struct
+{
+	/* structure of arrays, padded to a multiple of 4 */
+	float32 *lefts;
+	float32 *tops;
+	float32 *rights;
+	float32 *bases;
+	uint    *keys;    /* `layer << 16 | texture` */
+	uint    *glyphs;
+	uint    *order;   /* into the arrays above */
+	uint     rects_count;
+
+	ui_quad  *quads;
+	uint      quads_count;
+	ui_batch *batches;
+	uint      batches_count;
+} ui_batches;
+
+HOST extern struct ui
+{
+	ui_state  states[UI_STATES_CAPACITY];
+	ui_state *state;  /* stenographic */
+
+	ui_element *roots;  /* each over the whole frame */
+	ui_element *last_root;
+
+	ui_index   index;
+	ui_batches batches;
+} *ui;
+
+HOST void ui_reset(void);
+
+HOST void ui_begin(void);
+HOST void ui_end  (void);
+
+HOST ui_element *ui_begin_element(ui_element_tag element_tag, const void *element_data);
+HOST void        ui_end_element  (void);
+
+HOST void ui_begin_box(void);
+HOST void ui_end_box  (void);
+HOST void ui_text     (const char *format, ...);
+
+/* these set the open element */
+HOST void ui_set_orientation(orientation orientation);
+HOST void ui_set_width      (float32 width);
+HOST void ui_set_height     (float32 height);
+HOST void ui_set_expanding  (bit horizontally, bit vertically);
+
+/* this sets what the open element's texts are made with */
+HOST void ui_set_font(font *font);
+
+HOST void ui_finalize(const range2_f32 *frame_range);
+
+HOST void        ui_index_elements(const range2_f32 *frame_range);
+HOST ui_element *ui_find_element_at(float32 x, float32 y);
+
+HOST void ui_batch_elements(const range2_f32 *frame_range);
+HOST void ui_record_batches(VkCommandBuffer command_buffer);
 
 typedef enum
 {
@@ -175,7 +1597,21 @@ typedef enum
 	VULKAN_QUEUES_COUNT,
 } vulkan_queue_index;
 
-extern struct vulkan
+#define VULKAN_SWAPCHAIN_IMAGES_CAPACITY 8
+#define VULKAN_FRAMES_COUNT              2
+
+typedef struct
+{
+	VkCommandBuffer command_buffer;
+	VkSemaphore     image_acquired;
+	VkFence         rendered;
+
+	VkBuffer        quads_buffer;  /* `UI_QUADS_CAPACITY` instances */
+	VkDeviceMemory  quads_memory;
+	ui_quad        *quads;         /* mapped */
+} vulkan_frame;
+
+HOST extern struct vulkan
 {
 	VkInstance instance;
 	VkDebugUtilsMessengerEXT debug_messenger;
@@ -210,18 +1646,60 @@ extern struct vulkan
 	VkExtent2D         swapchain_image_extent;
 	VkSurfaceFormatKHR swapchain_image_format;
 	VkPresentModeKHR   swapchain_presentation_mode;
+	uint               swapchain_images_count;
+	VkImage            swapchain_images[VULKAN_SWAPCHAIN_IMAGES_CAPACITY];
+	VkImageView        swapchain_image_views[VULKAN_SWAPCHAIN_IMAGES_CAPACITY];
+	VkFramebuffer      framebuffers[VULKAN_SWAPCHAIN_IMAGES_CAPACITY];
+	VkSemaphore        rendering_finished[VULKAN_SWAPCHAIN_IMAGES_CAPACITY];  /* by image, since presenting holds it */
+
+	VkRenderPass render_pass;
+
+	VkDescriptorSetLayout ui_descriptor_set_layout;
+	VkPipelineLayout      ui_pipeline_layout;
+	VkPipeline            ui_pipeline;
+	VkDescriptorPool      descriptor_pool;
+	VkDescriptorSet       ui_descriptor_sets[UI_TEXTURES_COUNT];
+
+	/* the glyphs of `default_font`, as they are in memory */
+	VkImage        glyphs_image;
+	VkDeviceMemory glyphs_memory;
+	VkImageView    glyphs_image_view;
+	VkSampler      glyphs_sampler;
+
+	VkCommandPool command_pool;
+
+	/* a frame is recorded while the one before it is drawn */
+	uint         frame;
+	vulkan_frame frames[VULKAN_FRAMES_COUNT];
 } vulkan;
 
-void _assert_vulkan_result(VkResult result, const char *file, uint line);
+HOST void _assert_vulkan_result(VkResult result, const char *file, uint line);
 
 #define assert_vulkan_result(result) _assert_vulkan_result(result, __FILE__, __LINE__)
 
-extern struct global
+HOST extern struct global
 {
 	bit terminability : 1;
+
+	/* reset at the beginning of every frame */
+	arena frame_arena;
+
+	mapping_table mappings;
+	interface     interface;
+
+	input_queue      input_queue;
+	input_statistics input_statistics;  /* reset every second */
+
+	job_system jobs;
+	reporter   reports;
+
+	allocation_statistics allocations[ALLOCATION_TAGS_COUNT];
 } global;
 
 extern thread_local struct context
 {
 	uintl clock_time;
+
+	job_worker   *job_worker;  /* none for the threads that are not workers */
+	report_queue *report_queue;
 } context;
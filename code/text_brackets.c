@@ -0,0 +1,341 @@
+/*
+
+the brackets of a text are kept in a treap ordered by where they are. a node
+keeps how far its bracket is from the one before it rather than where it is,
+so an edit moves every bracket after it by changing a single gap, and the
+brackets that it removed or added are split off or merged in, in logarithmic
+time however many brackets the text has.
+
+every subtree also keeps how long its gaps are together, how much deeper its
+brackets leave the nesting, and how low the nesting goes after any of them.
+the bracket that closes another is the first after it that leaves the nesting
+lower than it found it, which is found by going down a single path and passing
+over the subtrees that never go that low.
+
+a node's priority is a hash of its index, which balances the tree as random
+priorities would.
+
+*/
+
+#define TEXT_BRACKETS_SPINE_CAPACITY 256  /* of the right spine while a tree is built from a run of brackets */
+#define TEXT_BRACKETS_ANY_DEPTH      (1 << 30)
+
+inline static sint get_text_bracket_depth(uint8 bracket)
+{
+	return bracket == '(' || bracket == '[' || bracket == '{' ? 1 : -1;
+}
+
+static const bit text_bracket_characters[256] =
+{
+	['('] = 1, [')'] = 1, ['['] = 1, [']'] = 1, ['{'] = 1, ['}'] = 1,
+};
+
+inline static bit are_text_brackets_paired(uint8 opening, uint8 closing)
+{
+	return (opening == '(' && closing == ')') || (opening == '[' && closing == ']') || (opening == '{' && closing == '}');
+}
+
+inline static uint32 get_text_bracket_priority(uint node)
+{
+	uint32 hash = node * 0x9e3779b1u;
+	hash ^= hash >> 15;
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
+	return hash;
+}
+
+static void update_text_bracket_node(uint node, text_brackets *brackets)
+{
+	text_bracket_node       *own   = &brackets->nodes[node];
+	const text_bracket_node *left  = &brackets->nodes[own->left];
+	const text_bracket_node *right = &brackets->nodes[own->right];
+	sint                     depth = left->depth + get_text_bracket_depth(own->bracket);
+	own->length       = left->length + own->gap + right->length;
+	own->lowest_depth = own->left && left->lowest_depth < depth ? left->lowest_depth : depth;
+	if (own->right && depth + right->lowest_depth < own->lowest_depth) own->lowest_depth = depth + right->lowest_depth;
+	own->depth = depth + right->depth;
+}
+
+/* makes room for `count` more nodes, which need not come from the free ones */
+static void reserve_text_bracket_nodes(uint count, text_brackets *brackets)
+{
+	if (brackets->nodes && brackets->nodes_count + count <= brackets->nodes_capacity) return;
+
+	uint capacity = brackets->nodes_capacity ? brackets->nodes_capacity : 4096 / sizeof(text_bracket_node);
+	while (capacity < brackets->nodes_count + 1 + count) capacity *= 2;
+	text_bracket_node *nodes = allocate(capacity * sizeof(text_bracket_node), ALLOCATION_TAG_HIGHLIGHT);
+	if (brackets->nodes)
+	{
+		copy(nodes, brackets->nodes, brackets->nodes_count * sizeof(text_bracket_node));
+		deallocate(brackets->nodes, brackets->nodes_capacity * sizeof(text_bracket_node), ALLOCATION_TAG_HIGHLIGHT);
+	}
+	else
+	{
+		zero(&nodes[0], sizeof(text_bracket_node));
+		brackets->nodes_count = 1;
+	}
+	brackets->nodes          = nodes;
+	brackets->nodes_capacity = capacity;
+}
+
+static uint push_text_bracket_node(uint8 bracket, uintl gap, text_brackets *brackets)
+{
+	uint node = brackets->free_node;
+	if (node) brackets->free_node = brackets->nodes[node].left;
+	else node = brackets->nodes_count++;
+	assert(node < brackets->nodes_capacity);
+	brackets->nodes[node] = (text_bracket_node){ .gap = gap, .bracket = bracket };
+	update_text_bracket_node(node, brackets);
+	return node;
+}
+
+static void free_text_bracket_nodes(uint node, text_brackets *brackets)
+{
+	while (node)
+	{
+		text_bracket_node *own  = &brackets->nodes[node];
+		uint               left = own->left;
+		free_text_bracket_nodes(own->right, brackets);
+		own->left           = brackets->free_node;
+		brackets->free_node = node;
+		node                = left;
+	}
+}
+
+/* splits a subtree, whose first bracket follows `base`, into the brackets before `offset` and the rest */
+static void split_text_brackets(uint *before, uint *after, uint node, uintl base, uintl offset, text_brackets *brackets)
+{
+	if (!node)
+	{
+		*before = 0;
+		*after  = 0;
+		return;
+	}
+
+	text_bracket_node *own      = &brackets->nodes[node];
+	uintl              position = base + brackets->nodes[own->left].length + own->gap;
+	if (position < offset)
+	{
+		*before = node;
+		split_text_brackets(&own->right, after, own->right, position, offset, brackets);
+	}
+	else
+	{
+		*after = node;
+		split_text_brackets(before, &own->left, own->left, base, offset, brackets);
+	}
+	update_text_bracket_node(node, brackets);
+}
+
+/* joins two subtrees, all of whose brackets are in the order given */
+static uint merge_text_brackets(uint first, uint second, text_brackets *brackets)
+{
+	if (!first || !second) return first ? first : second;
+
+	text_bracket_node *nodes = brackets->nodes;
+	if (get_text_bracket_priority(first) > get_text_bracket_priority(second))
+	{
+		nodes[first].right = merge_text_brackets(nodes[first].right, second, brackets);
+		update_text_bracket_node(first, brackets);
+		return first;
+	}
+	nodes[second].left = merge_text_brackets(first, nodes[second].left, brackets);
+	update_text_bracket_node(second, brackets);
+	return second;
+}
+
+/* builds a subtree from brackets in order, the first of which follows `base`,
+   by keeping the right spine of what was built so far */
+static uint build_text_brackets(const text_bracket *list, uint count, uintl base, text_brackets *brackets)
+{
+	uint spine[TEXT_BRACKETS_SPINE_CAPACITY];
+	uint spine_count = 0;
+	for (uint i = 0; i < count; ++i)
+	{
+		uint node = push_text_bracket_node(list[i].bracket, list[i].offset - (i ? list[i - 1].offset : base), brackets);
+		uint left = 0;
+		while (spine_count && get_text_bracket_priority(spine[spine_count - 1]) < get_text_bracket_priority(node))
+		{
+			left = spine[--spine_count];
+			update_text_bracket_node(left, brackets);
+		}
+		brackets->nodes[node].left = left;
+		if (spine_count) brackets->nodes[spine[spine_count - 1]].right = node;
+		assert(spine_count < TEXT_BRACKETS_SPINE_CAPACITY);
+		spine[spine_count++] = node;
+	}
+	while (spine_count > 1) update_text_bracket_node(spine[--spine_count], brackets);
+	if (!spine_count) return 0;
+	update_text_bracket_node(spine[0], brackets);
+	return spine[0];
+}
+
+/* moves every bracket of a subtree by `delta`, which the gap of its first takes */
+static void move_text_brackets(uint node, sintl delta, text_brackets *brackets)
+{
+	for (; node; node = brackets->nodes[node].left)
+	{
+		text_bracket_node *own = &brackets->nodes[node];
+		own->length += delta;
+		if (!own->left) own->gap += delta;
+	}
+}
+
+/* replaces the brackets from `begin` to `end` with `count` others, which are
+   in order and where the edit leaves them, and moves those after by `delta` */
+void replace_text_brackets(uintl begin, uintl end, sintl delta, const text_bracket *list, uint count, text_brackets *brackets)
+{
+	reserve_text_bracket_nodes(count, brackets);
+
+	uint before;
+	uint within;
+	uint after;
+	split_text_brackets(&before, &after, brackets->root, 0, begin, brackets);
+	uintl before_length = brackets->nodes[before].length;
+	split_text_brackets(&within, &after, after, before_length, end, brackets);
+	uintl within_length = brackets->nodes[within].length;
+	free_text_bracket_nodes(within, brackets);
+
+	/* the first bracket after was as far from the last that was removed as it now is from the last that was added */
+	uint inserted = build_text_brackets(list, count, before_length, brackets);
+	move_text_brackets(after, within_length + delta - brackets->nodes[inserted].length, brackets);
+	brackets->root = merge_text_brackets(merge_text_brackets(before, inserted, brackets), after, brackets);
+}
+
+void clear_text_brackets(text_brackets *brackets)
+{
+	brackets->root      = 0;
+	brackets->free_node = 0;
+	if (brackets->nodes) brackets->nodes_count = 1;
+}
+
+void terminate_text_brackets(text_brackets *brackets)
+{
+	if (brackets->nodes) deallocate(brackets->nodes, brackets->nodes_capacity * sizeof(text_bracket_node), ALLOCATION_TAG_HIGHLIGHT);
+	zero(brackets, sizeof(*brackets));
+}
+
+static uint list_text_brackets(text_bracket *list, uint count, uint capacity, uint node, uintl base, uintl begin, uintl end, const text_brackets *brackets)
+{
+	while (node && count < capacity)
+	{
+		const text_bracket_node *own      = &brackets->nodes[node];
+		uintl                    position = base + brackets->nodes[own->left].length + own->gap;
+		if (position >= begin) count = list_text_brackets(list, count, capacity, own->left, base, begin, end, brackets);
+		if (position >= end || count == capacity) break;
+		if (position >= begin) list[count++] = (text_bracket){ position, own->bracket };
+		base = position;
+		node = own->right;
+	}
+	return count;
+}
+
+/* gives the brackets from `begin` to `end`, as many as `capacity`, and returns how many it gave */
+uint get_text_brackets(uintl begin, uintl end, text_bracket *list, uint capacity, const text_brackets *brackets)
+{
+	return list_text_brackets(list, 0, capacity, brackets->root, 0, begin, end, brackets);
+}
+
+/* the nesting after the bracket at `offset`, if there is one */
+static bit find_text_bracket(uintl offset, uint8 *bracket, sint *depth, const text_brackets *brackets)
+{
+	uintl base       = 0;
+	sint  base_depth = 0;
+	for (uint node = brackets->root; node;)
+	{
+		const text_bracket_node *own      = &brackets->nodes[node];
+		const text_bracket_node *left     = &brackets->nodes[own->left];
+		uintl                    position = base + left->length + own->gap;
+		if (offset < position)
+		{
+			node = own->left;
+			continue;
+		}
+
+		sint own_depth = base_depth + left->depth + get_text_bracket_depth(own->bracket);
+		if (offset == position)
+		{
+			*bracket = own->bracket;
+			*depth   = own_depth;
+			return 1;
+		}
+		base       = position;
+		base_depth = own_depth;
+		node       = own->right;
+	}
+	return 0;
+}
+
+/* the first bracket of a subtree from `begin` on that leaves the nesting at most as deep as `depth` */
+static uint find_next_text_bracket(uintl *position, uint node, uintl base, sint base_depth, uintl begin, sint depth, const text_brackets *brackets)
+{
+	while (node && base_depth + brackets->nodes[node].lowest_depth <= depth)
+	{
+		const text_bracket_node *own          = &brackets->nodes[node];
+		const text_bracket_node *left         = &brackets->nodes[own->left];
+		uintl                    own_position = base + left->length + own->gap;
+		if (own->left && base + left->length >= begin)
+		{
+			uint found = find_next_text_bracket(position, own->left, base, base_depth, begin, depth, brackets);
+			if (found) return found;
+		}
+
+		sint own_depth = base_depth + left->depth + get_text_bracket_depth(own->bracket);
+		if (own_position >= begin && own_depth <= depth)
+		{
+			*position = own_position;
+			return node;
+		}
+		base       = own_position;
+		base_depth = own_depth;
+		node       = own->right;
+	}
+	return 0;
+}
+
+/* the last bracket of a subtree before `end` that leaves the nesting at most as deep as `depth` */
+static uint find_previous_text_bracket(uintl *position, uint node, uintl base, sint base_depth, uintl end, sint depth, const text_brackets *brackets)
+{
+	while (node && base_depth + brackets->nodes[node].lowest_depth <= depth)
+	{
+		const text_bracket_node *own          = &brackets->nodes[node];
+		const text_bracket_node *left         = &brackets->nodes[own->left];
+		uintl                    own_position = base + left->length + own->gap;
+		if (own_position < end)
+		{
+			sint own_depth = base_depth + left->depth + get_text_bracket_depth(own->bracket);
+			uint found     = find_previous_text_bracket(position, own->right, own_position, own_depth, end, depth, brackets);
+			if (found) return found;
+			if (own_depth <= depth)
+			{
+				*position = own_position;
+				return node;
+			}
+		}
+		node = own->left;
+	}
+	return 0;
+}
+
+/* finds the bracket that pairs with the one at `offset`, if there is a bracket
+   there and the one that its nesting pairs it with is of its kind */
+bit find_matching_text_bracket(uintl offset, uintl *match, const text_brackets *brackets)
+{
+	uint8 bracket;
+	sint  depth;
+	if (!find_text_bracket(offset, &bracket, &depth, brackets)) return 0;
+
+	uint node;
+	if (get_text_bracket_depth(bracket) > 0)
+	{
+		node = find_next_text_bracket(match, brackets->root, 0, 0, offset + 1, depth - 1, brackets);
+		return node && are_text_brackets_paired(bracket, brackets->nodes[node].bracket);
+	}
+
+	/* the opening bracket follows the last one before that left the nesting as deep as this one leaves it */
+	uintl previous;
+	uint  previous_node = find_previous_text_bracket(&previous, brackets->root, 0, 0, offset, depth, brackets);
+	if (!previous_node && depth) return 0;
+	node = find_next_text_bracket(match, brackets->root, 0, 0, previous_node ? previous + 1 : 0, TEXT_BRACKETS_ANY_DEPTH, brackets);
+	return node && are_text_brackets_paired(brackets->nodes[node].bracket, bracket);
+}
@@ -0,0 +1,722 @@
+/*
+
+a document is a list of pieces, each of the file that it was opened from or of
+the text that was added to it. an edit replaces a run of pieces: the text that
+it inserts is appended to the added text, and the pieces that it begins and
+ends in are split. nothing that a piece refers to is ever written over, so the
+pieces that an edit removed are all that it takes to undo it, however much
+text they span.
+
+the history is a tree of records, one per edit. a record keeps the pieces that
+it removed as deltas: the size of each, and how far its source is from the end
+of the one before, in varints. the pieces that an edit splits share their
+source with what it removed, so most take a few bytes. the pieces that an edit
+inserted are in the document while it is current, so they are only kept once
+it is undone.
+
+*/
+
+#define TEXT_PIECES_INITIAL_CAPACITY  256
+#define TEXT_ADDED_INITIAL_CAPACITY   (64 << 10)
+#define TEXT_RECORDS_INITIAL_CAPACITY 256
+#define TEXT_DELTAS_INITIAL_CAPACITY  (16 << 10)
+
+/* two varints of 64 bits */
+#define TEXT_PIECE_DELTAS_CAPACITY 20
+
+/* grows `array` of `count` elements to hold at least `needed_count` */
+static void *grow_text_array(void *array, uint count, uint needed_count, uint element_size, uint *capacity)
+{
+	if (needed_count <= *capacity) return array;
+
+	uintl new_capacity = *capacity;
+	while (new_capacity < needed_count) new_capacity *= 2;
+	assert(new_capacity * element_size <= UINT_MAXIMUM);
+
+	void *new_array = allocate(new_capacity * element_size, ALLOCATION_TAG_BUFFER);
+	copy(new_array, array, count * element_size);
+	deallocate(array, *capacity * element_size, ALLOCATION_TAG_BUFFER);
+	*capacity = new_capacity;
+	return new_array;
+}
+
+inline static byte *write_text_varint(uintl value, byte *output)
+{
+	for (; value >= 0x80; value >>= 7) *output++ = 0x80 | (value & 0x7f);
+	*output++ = value;
+	return output;
+}
+
+inline static const byte *read_text_varint(const byte *input, uintl *value)
+{
+	uintl result = 0;
+	for (uint shift = 0;; shift += 7)
+	{
+		byte b = *input++;
+		result |= (uintl)(b & 0x7f) << shift;
+		if (!(b & 0x80)) break;
+	}
+	*value = result;
+	return input;
+}
+
+/* returns where the deltas of `pieces` begin */
+static uint encode_text_pieces(const text_piece *pieces, uint count, text_history *history)
+{
+	uint deltas = history->deltas_size;
+	assert((uintl)deltas + (uintl)count * TEXT_PIECE_DELTAS_CAPACITY <= UINT_MAXIMUM);
+	history->deltas = grow_text_array(history->deltas, history->deltas_size, deltas + count * TEXT_PIECE_DELTAS_CAPACITY, 1, &history->deltas_capacity);
+
+	byte *output = history->deltas + deltas;
+	uintl end    = 0;
+	for (uint i = 0; i < count; ++i)
+	{
+		uintl source = pieces[i].source & ~TEXT_PIECE_ADDED;
+		sintl delta  = (sintl)(source - end);
+		output = write_text_varint(pieces[i].size << 1 | !!(pieces[i].source & TEXT_PIECE_ADDED), output);
+		output = write_text_varint((uintl)(delta << 1) ^ (uintl)(delta >> 63), output);
+		end = source + pieces[i].size;
+	}
+	history->deltas_size = output - history->deltas;
+	return deltas;
+}
+
+/* leaves the offsets of `pieces` to be updated */
+static void decode_text_pieces(uint deltas, uint count, text_piece *pieces, const text_history *history)
+{
+	const byte *input = history->deltas + deltas;
+	uintl       end   = 0;
+	for (uint i = 0; i < count; ++i)
+	{
+		uintl size, delta;
+		input = read_text_varint(input, &size);
+		input = read_text_varint(input, &delta);
+		uintl source = end + ((delta >> 1) ^ -(delta & 1));
+		pieces[i].size   = size >> 1;
+		pieces[i].source = source | (size & 1 ? TEXT_PIECE_ADDED : 0);
+		end = source + pieces[i].size;
+	}
+}
+
+inline static uintl get_text_pieces_offset(uint index, const text_buffer *buffer)
+{
+	return index < buffer->pieces_count ? buffer->pieces[index].offset : buffer->size;
+}
+
+/* moves the pieces that follow the removed ones to fit `count` in their place,
+   and begins the change that the edit makes as the run of the removed pieces */
+static void make_text_pieces_room(uint first, uint removed_count, uint count, text_buffer *buffer)
+{
+	assert(!buffer->readers_count);
+	buffer->edits_count += 1;
+	text_change *change = &buffer->changes[buffer->edits_count % TEXT_CHANGES_CAPACITY];
+	change->offset       = get_text_pieces_offset(first, buffer);
+	change->removed_size = get_text_pieces_offset(first + removed_count, buffer) - change->offset;
+	if (removed_count)
+	{
+		buffer->changed_pieces[0] = buffer->pieces[first];
+		buffer->changed_pieces[1] = buffer->pieces[first + removed_count - 1];
+	}
+
+	uint pieces_count = buffer->pieces_count - removed_count + count;
+	buffer->pieces = grow_text_array(buffer->pieces, buffer->pieces_count, pieces_count, sizeof(text_piece), &buffer->pieces_capacity);
+	move(buffer->pieces + first + count, buffer->pieces + first + removed_count, (buffer->pieces_count - first - removed_count) * sizeof(text_piece));
+	buffer->pieces_count = pieces_count;
+}
+
+/* and ends it once the `count` pieces are in, leaving out of it what the first
+   and last of them keep of the pieces that they replaced */
+static void update_text_offsets(uint first, uint count, text_buffer *buffer)
+{
+	uintl offset = first ? buffer->pieces[first - 1].offset + buffer->pieces[first - 1].size : 0;
+	for (uint i = first; i < buffer->pieces_count; ++i)
+	{
+		assert(buffer->pieces[i].size);
+		buffer->pieces[i].offset = offset;
+		offset += buffer->pieces[i].size;
+	}
+
+	text_change *change = &buffer->changes[buffer->edits_count % TEXT_CHANGES_CAPACITY];
+	change->inserted_size = change->removed_size + offset - buffer->size;
+	buffer->size          = offset;
+	if (!change->removed_size || !count) return;
+
+	const text_piece *removed_first = &buffer->changed_pieces[0];
+	const text_piece *first_piece   = &buffer->pieces[first];
+	if (removed_first->source == first_piece->source)
+	{
+		uintl kept_size = removed_first->size < first_piece->size ? removed_first->size : first_piece->size;
+		change->offset        += kept_size;
+		change->removed_size  -= kept_size;
+		change->inserted_size -= kept_size;
+	}
+
+	const text_piece *removed_last = &buffer->changed_pieces[1];
+	const text_piece *last_piece   = &buffer->pieces[first + count - 1];
+	if (removed_last->source + removed_last->size == last_piece->source + last_piece->size)
+	{
+		uintl kept_size = removed_last->size < last_piece->size ? removed_last->size : last_piece->size;
+		if (kept_size > change->removed_size) kept_size = change->removed_size;
+		if (kept_size > change->inserted_size) kept_size = change->inserted_size;
+		change->removed_size  -= kept_size;
+		change->inserted_size -= kept_size;
+	}
+}
+
+void open_text_buffer(const char *path, text_buffer *buffer)
+{
+	zero(buffer, sizeof(*buffer));
+
+	/* the mapping keeps the file for as long as it is mapped */
+	if (path)
+	{
+		handle file = open_file(path);
+		buffer->original_size = get_size_of_file(file);
+		buffer->original      = map_file(buffer->original_size, file);
+		close_file(file);
+	}
+
+	buffer->added_capacity  = TEXT_ADDED_INITIAL_CAPACITY;
+	buffer->added           = allocate(buffer->added_capacity, ALLOCATION_TAG_BUFFER);
+	buffer->pieces_capacity = TEXT_PIECES_INITIAL_CAPACITY;
+	buffer->pieces          = allocate(buffer->pieces_capacity * sizeof(text_piece), ALLOCATION_TAG_BUFFER);
+	if (buffer->original_size) buffer->pieces[buffer->pieces_count++] = (text_piece){ 0, buffer->original_size, 0 };
+	buffer->size = buffer->original_size;
+
+	text_history *history = &buffer->history;
+	history->records_capacity = TEXT_RECORDS_INITIAL_CAPACITY;
+	history->records          = allocate(history->records_capacity * sizeof(text_record), ALLOCATION_TAG_BUFFER);
+	history->deltas_capacity  = TEXT_DELTAS_INITIAL_CAPACITY;
+	history->deltas           = allocate(history->deltas_capacity, ALLOCATION_TAG_BUFFER);
+	history->records[history->records_count++] = (text_record){
+		.parent          = TEXT_NO_RECORD,
+		.children        = TEXT_NO_RECORD,
+		.sibling         = TEXT_NO_RECORD,
+		.redo            = TEXT_NO_RECORD,
+		.removed_deltas  = TEXT_NO_DELTAS,
+		.inserted_deltas = TEXT_NO_DELTAS,
+	};
+	history->current = TEXT_ROOT_RECORD;
+}
+
+void close_text_buffer(text_buffer *buffer)
+{
+	text_history *history = &buffer->history;
+	deallocate(history->deltas, history->deltas_capacity, ALLOCATION_TAG_BUFFER);
+	deallocate(history->records, history->records_capacity * sizeof(text_record), ALLOCATION_TAG_BUFFER);
+	deallocate(buffer->pieces, buffer->pieces_capacity * sizeof(text_piece), ALLOCATION_TAG_BUFFER);
+	deallocate(buffer->added, buffer->added_capacity, ALLOCATION_TAG_BUFFER);
+	unmap_file(buffer->original, buffer->original_size);
+}
+
+/* returns the piece that holds `offset`, or the count of pieces at the end */
+uint find_text_piece(uintl offset, const text_buffer *buffer)
+{
+	if (offset >= buffer->size) return buffer->pieces_count;
+
+	/* the last piece that begins at or before `offset` */
+	uint low  = 0;
+	uint high = buffer->pieces_count;
+	while (low < high)
+	{
+		uint middle = low + (high - low) / 2;
+		if (buffer->pieces[middle].offset <= offset) low = middle + 1;
+		else high = middle;
+	}
+	return low - 1;
+}
+
+const byte *get_text_piece_data(const text_piece *piece, const text_buffer *buffer)
+{
+	if (piece->source & TEXT_PIECE_ADDED) return buffer->added + (piece->source & ~TEXT_PIECE_ADDED);
+	return buffer->original + piece->source;
+}
+
+uint read_text(uintl offset, uint size, byte *destination, const text_buffer *buffer)
+{
+	uint read_size = 0;
+	for (uint i = find_text_piece(offset, buffer); i < buffer->pieces_count && read_size < size; ++i)
+	{
+		const text_piece *piece       = &buffer->pieces[i];
+		uintl             piece_begin = offset + read_size - piece->offset;
+		uintl             piece_size  = piece->size - piece_begin;
+		uint              chunk_size  = piece_size < size - read_size ? piece_size : size - read_size;
+		copy(destination + read_size, get_text_piece_data(piece, buffer) + piece_begin, chunk_size);
+		read_size += chunk_size;
+	}
+	return read_size;
+}
+
+uintl add_text(const byte *text, uint size, text_buffer *buffer)
+{
+	assert(!buffer->readers_count);
+	assert((uintl)buffer->added_size + size <= UINT_MAXIMUM);
+	buffer->added = grow_text_array(buffer->added, buffer->added_size, buffer->added_size + size, 1, &buffer->added_capacity);
+	copy(buffer->added + buffer->added_size, text, size);
+
+	uintl source = buffer->added_size | TEXT_PIECE_ADDED;
+	buffer->added_size += size;
+	return source;
+}
+
+/* records an edit before it is made, or lets the current record take it */
+static void record_text_edit(uint first, uint removed_count, uint count, text_buffer *buffer)
+{
+	text_history *history = &buffer->history;
+	text_record  *current = &history->records[history->current];
+	uintl         time    = get_time();
+
+	if (history->open
+		&& time - history->edit_time < TEXT_RECORD_COALESCING_PERIOD
+		&& first >= current->first_piece
+		&& first + removed_count <= current->first_piece + current->inserted_count)
+	{
+		current->inserted_count = current->inserted_count - removed_count + count;
+		history->edit_time      = time;
+		return;
+	}
+
+	assert(history->records_count < TEXT_NO_RECORD);
+	history->records = grow_text_array(history->records, history->records_count, history->records_count + 1, sizeof(text_record), &history->records_capacity);
+	current = &history->records[history->current];
+
+	uint record = history->records_count++;
+	history->records[record] = (text_record){
+		.parent          = history->current,
+		.children        = TEXT_NO_RECORD,
+		.sibling         = current->children,
+		.redo            = TEXT_NO_RECORD,
+		.first_piece     = first,
+		.removed_count   = removed_count,
+		.inserted_count  = count,
+		.removed_deltas  = encode_text_pieces(buffer->pieces + first, removed_count, history),
+		.inserted_deltas = TEXT_NO_DELTAS,
+	};
+	current->children  = record;
+	current->redo      = record;
+	history->current   = record;
+	history->open      = 1;
+	history->edit_time = time;
+}
+
+void splice_text_pieces(uint first, uint removed_count, const text_piece *pieces, uint count, text_buffer *buffer)
+{
+	assert(first + removed_count <= buffer->pieces_count);
+	record_text_edit(first, removed_count, count, buffer);
+	make_text_pieces_room(first, removed_count, count, buffer);
+	copy(buffer->pieces + first, pieces, count * sizeof(text_piece));
+	update_text_offsets(first, count, buffer);
+}
+
+void replace_text(uintl offset, uintl size, const byte *text, uint text_size, text_buffer *buffer)
+{
+	assert(offset + size <= buffer->size);
+	if (!size && !text_size) return;
+
+	uint first       = find_text_piece(offset, buffer);
+	bit  at_boundary = first == buffer->pieces_count || buffer->pieces[first].offset == offset;
+
+	/* typing right after what was just added extends its piece */
+	if (!size && at_boundary && first)
+	{
+		text_piece piece = buffer->pieces[first - 1];
+		if (piece.source + piece.size == (buffer->added_size | TEXT_PIECE_ADDED))
+		{
+			add_text(text, text_size, buffer);
+			piece.size += text_size;
+			splice_text_pieces(first - 1, 1, &piece, 1, buffer);
+			return;
+		}
+	}
+
+	/* what is left of the pieces that the edit begins and ends in, and what it inserts between them */
+	text_piece pieces[3];
+	uint       count = 0;
+	uint       end   = size ? find_text_piece(offset + size - 1, buffer) + 1 : first;
+	if (!at_boundary)
+	{
+		const text_piece *piece = &buffer->pieces[first];
+		pieces[count++] = (text_piece){ .size = offset - piece->offset, .source = piece->source };
+		if (end == first) end = first + 1;
+	}
+	if (text_size) pieces[count++] = (text_piece){ .size = text_size, .source = add_text(text, text_size, buffer) };
+	if (end > first)
+	{
+		const text_piece *piece     = &buffer->pieces[end - 1];
+		uintl             piece_end = piece->offset + piece->size;
+		uintl             edit_end  = offset + size;
+		if (piece_end > edit_end) pieces[count++] = (text_piece){ .size = piece_end - edit_end, .source = piece->source + (edit_end - piece->offset) };
+	}
+	splice_text_pieces(first, end - first, pieces, count, buffer);
+}
+
+/* adds a piece after the others, or extends the last one if it is followed by it in its source */
+inline static void append_text_replacement_piece(text_piece piece, text_replacement_job *job)
+{
+	if (job->pieces_count && job->pieces[job->pieces_count - 1].source + job->pieces[job->pieces_count - 1].size == piece.source) job->pieces[job->pieces_count - 1].size += piece.size;
+	else job->pieces[job->pieces_count++] = piece;
+}
+
+static void replace_text_runs_in_job(void *parameter)
+{
+	text_replacement_job *job    = parameter;
+	const text_buffer    *buffer = job->buffer;
+	uint                  piece  = find_text_piece(job->begin, buffer);
+	uintl                 cursor = job->begin;
+	for (uint i = 0;; ++i)
+	{
+		/* the text up to the next run, cut from the pieces it is in */
+		uintl text_end = i < job->runs_count ? job->beginnings[i] : job->end;
+		while (cursor < text_end)
+		{
+			while (buffer->pieces[piece].offset + buffer->pieces[piece].size <= cursor) ++piece;
+			const text_piece *source    = &buffer->pieces[piece];
+			uintl             piece_end = source->offset + source->size < text_end ? source->offset + source->size : text_end;
+			append_text_replacement_piece((text_piece){ .size = piece_end - cursor, .source = source->source + (cursor - source->offset) }, job);
+			cursor = piece_end;
+		}
+		if (i == job->runs_count) break;
+
+		if (job->replacement_size) append_text_replacement_piece((text_piece){ .size = job->replacement_size, .source = job->replacement }, job);
+		cursor = job->ends ? job->ends[i] : text_end + job->run_size;
+	}
+}
+
+void replace_text_runs(const uintl *beginnings, const uintl *ends, uint runs_count, uint run_size, const byte *text, uint text_size, text_buffer *buffer)
+{
+	if (!runs_count) return;
+	uintl last_end = ends ? ends[runs_count - 1] : beginnings[runs_count - 1] + run_size;
+	assert(last_end <= buffer->size);
+
+	/* every replacement is a piece of the same added text, which follows what
+	   was added last, so the pieces that it ended are extended instead */
+	uintl replacement = text_size ? add_text(text, text_size, buffer) : 0;
+	uint  first       = beginnings[0] ? find_text_piece(beginnings[0] - 1, buffer) : 0;
+	uint  end         = last_end < buffer->size ? find_text_piece(last_end, buffer) + 1 : buffer->pieces_count;
+	uintl text_begin  = first < buffer->pieces_count ? buffer->pieces[first].offset : buffer->size;
+	uintl text_end    = end ? buffer->pieces[end - 1].offset + buffer->pieces[end - 1].size : 0;
+
+	/* the jobs split the runs evenly, and each makes the pieces from its first run to the next job's */
+	uint jobs_count = (runs_count + TEXT_REPLACEMENT_JOB_RUNS - 1) / TEXT_REPLACEMENT_JOB_RUNS;
+	if (jobs_count > TEXT_REPLACEMENT_JOBS_CAPACITY) jobs_count = TEXT_REPLACEMENT_JOBS_CAPACITY;
+	uint                  job_runs_count  = (runs_count + jobs_count - 1) / jobs_count;
+	text_replacement_job *jobs            = allocate(jobs_count * sizeof(text_replacement_job), ALLOCATION_TAG_BUFFER);
+	uintl                 pieces_capacity = 0;
+	for (uint i = 0; i < jobs_count; ++i)
+	{
+		uint  first_run = i * job_runs_count;
+		uint  end_run   = i + 1 == jobs_count ? runs_count : first_run + job_runs_count;
+		uintl begin     = i ? beginnings[first_run] : text_begin;
+		uintl job_end   = i + 1 == jobs_count ? text_end : beginnings[end_run];
+		jobs[i] = (text_replacement_job){
+			.buffer           = buffer,
+			.beginnings       = beginnings + first_run,
+			.ends             = ends ? ends + first_run : 0,
+			.runs_count       = end_run - first_run,
+			.run_size         = run_size,
+			.begin            = begin,
+			.end              = job_end,
+			.replacement      = replacement,
+			.replacement_size = text_size,
+			.pieces_count     = pieces_capacity,  /* where its pieces begin, until it runs */
+		};
+
+		/* the pieces it cuts, once more for every run that cuts one in two, and the replacements */
+		uint pieces_count = begin < job_end ? find_text_piece(job_end - 1, buffer) - find_text_piece(begin, buffer) + 1 : 0;
+		pieces_capacity += pieces_count + 2 * jobs[i].runs_count;
+	}
+	assert(pieces_capacity <= UINT_MAXIMUM);
+
+	text_piece *pieces  = allocate(pieces_capacity * sizeof(text_piece), ALLOCATION_TAG_BUFFER);
+	job_counter counter = {0};
+	for (uint i = 0; i < jobs_count; ++i)
+	{
+		jobs[i].pieces       = pieces + jobs[i].pieces_count;
+		jobs[i].pieces_count = 0;
+		push_job(replace_text_runs_in_job, &jobs[i], &counter);
+	}
+	wait_for_jobs(&counter);
+
+	/* the jobs' pieces are packed together, joined across their seams, and replace the ones they were cut from at once */
+	uint pieces_count = 0;
+	for (uint i = 0; i < jobs_count; ++i)
+	{
+		text_replacement_job *job    = &jobs[i];
+		uint                  joined = 0;
+		if (pieces_count && job->pieces_count && pieces[pieces_count - 1].source + pieces[pieces_count - 1].size == job->pieces[0].source)
+		{
+			pieces[pieces_count - 1].size += job->pieces[0].size;
+			joined = 1;
+		}
+		move(pieces + pieces_count, job->pieces + joined, (job->pieces_count - joined) * sizeof(text_piece));
+		pieces_count += job->pieces_count - joined;
+	}
+	splice_text_pieces(first, end - first, pieces, pieces_count, buffer);
+
+	deallocate(pieces, pieces_capacity * sizeof(text_piece), ALLOCATION_TAG_BUFFER);
+	deallocate(jobs, jobs_count * sizeof(text_replacement_job), ALLOCATION_TAG_BUFFER);
+}
+
+void replace_text_matches(const uintl *matches, uint matches_count, uint match_size, const byte *text, uint text_size, text_buffer *buffer)
+{
+	close_text_record(buffer);
+	replace_text_runs(matches, 0, matches_count, match_size, text, text_size, buffer);
+	close_text_record(buffer);
+}
+
+/* joins the changes since `edits_count` into one span of the text, as it is
+   now, that holds all of them; or returns 0 if they are too many to tell */
+bit get_text_changes(uint edits_count, text_change *changes, const text_buffer *buffer)
+{
+	uint count = buffer->edits_count - edits_count;
+	if (count > TEXT_CHANGES_CAPACITY) return 0;
+
+	zero(changes, sizeof(*changes));
+	uintl begin = UINTL_MAXIMUM;
+	uintl end   = 0;
+	sintl delta = 0;  /* what the span grew by */
+	for (uint i = 1; i <= count; ++i)
+	{
+		const text_change *change = &buffer->changes[(edits_count + i) % TEXT_CHANGES_CAPACITY];
+		uintl              inserted_end = change->offset + change->inserted_size;
+		if (begin == UINTL_MAXIMUM)
+		{
+			begin = change->offset;
+			end   = inserted_end;
+		}
+		else
+		{
+			/* the span so far moves with the text after the change, ends with
+			   the change if it ended within what the change removed, and takes
+			   what is between them */
+			if (end >= change->offset + change->removed_size) end = end - change->removed_size + change->inserted_size;
+			else if (end > change->offset)                    end = inserted_end;
+			if (end < inserted_end) end = inserted_end;
+			if (begin > change->offset) begin = change->offset;
+		}
+		delta += (sintl)change->inserted_size - (sintl)change->removed_size;
+	}
+	if (begin == UINTL_MAXIMUM) return 1;
+
+	changes->offset        = begin;
+	changes->inserted_size = end - begin;
+	changes->removed_size  = end - begin - delta;
+	return 1;
+}
+
+/* makes the next edit a record of its own */
+void close_text_record(text_buffer *buffer)
+{
+	buffer->history.open = 0;
+}
+
+bit undo_text(uintl *offset, text_buffer *buffer)
+{
+	text_history *history = &buffer->history;
+	if (history->current == TEXT_ROOT_RECORD) return 0;
+
+	text_record *record = &history->records[history->current];
+	if (record->inserted_deltas == TEXT_NO_DELTAS) record->inserted_deltas = encode_text_pieces(buffer->pieces + record->first_piece, record->inserted_count, history);
+	make_text_pieces_room(record->first_piece, record->inserted_count, record->removed_count, buffer);
+	decode_text_pieces(record->removed_deltas, record->removed_count, buffer->pieces + record->first_piece, history);
+	update_text_offsets(record->first_piece, record->removed_count, buffer);
+	*offset = get_text_pieces_offset(record->first_piece, buffer);
+
+	history->records[record->parent].redo = history->current;
+	history->current = record->parent;
+	history->open    = 0;
+	return 1;
+}
+
+bit redo_text(uintl *offset, text_buffer *buffer)
+{
+	text_history *history = &buffer->history;
+	uint          redo    = history->records[history->current].redo;
+	if (redo == TEXT_NO_RECORD) return 0;
+
+	const text_record *record = &history->records[redo];
+	make_text_pieces_room(record->first_piece, record->removed_count, record->inserted_count, buffer);
+	decode_text_pieces(record->inserted_deltas, record->inserted_count, buffer->pieces + record->first_piece, history);
+	update_text_offsets(record->first_piece, record->inserted_count, buffer);
+	*offset = get_text_pieces_offset(record->first_piece, buffer);
+
+	history->current = redo;
+	history->open    = 0;
+	return 1;
+}
+
+/* makes redo go to the next older child, or back to the newest */
+void switch_text_branch(text_buffer *buffer)
+{
+	text_history *history = &buffer->history;
+	text_record  *current = &history->records[history->current];
+	if (current->redo == TEXT_NO_RECORD) return;
+
+	uint sibling = history->records[current->redo].sibling;
+	current->redo = sibling != TEXT_NO_RECORD ? sibling : current->children;
+}
+
+#define TEXT_BENCHMARK_EDITS_COUNT 100000
+#define TEXT_BENCHMARK_CHUNK_SIZE  (1 << 20)
+#define TEXT_BENCHMARK_SPLIT_SIZE  (64 << 10)
+
+inline static uint32 next_text_benchmark_random(uint32 *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+static uint64 hash_text_buffer(byte *chunk, const text_buffer *buffer)
+{
+	uint64 hash = 0xcbf29ce484222325ull;
+	for (uintl offset = 0; offset < buffer->size; offset += TEXT_BENCHMARK_CHUNK_SIZE)
+	{
+		uint size = read_text(offset, TEXT_BENCHMARK_CHUNK_SIZE, chunk, buffer);
+		for (uint i = 0; i < size; ++i) hash = (hash ^ chunk[i]) * 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static uint get_text_history_size(const text_history *history)
+{
+	return history->records_count * sizeof(text_record) + history->deltas_size;
+}
+
+#define TEXT_CHANGES_CHECK_SIZE   256
+#define TEXT_CHANGES_CHECK_ROUNDS 4096
+
+/* joins bursts of edits that overlap each other, in a small document, and
+   checks that the span holds every byte that differs and no more than the text */
+static void check_text_changes(void)
+{
+	text_buffer buffer;
+	open_text_buffer(0, &buffer);
+	byte   before[TEXT_CHANGES_CHECK_SIZE];
+	byte   after[TEXT_CHANGES_CHECK_SIZE];
+	uint32 random = 0x2545f491;
+	for (uint round = 0; round < TEXT_CHANGES_CHECK_ROUNDS; ++round)
+	{
+		uint before_size = read_text(0, TEXT_CHANGES_CHECK_SIZE, before, &buffer);
+		uint edits_count = buffer.edits_count;
+
+		/* the edits stay near one place so that they overlap */
+		uintl place  = before_size ? next_text_benchmark_random(&random) % before_size : 0;
+		uint  bursts = 1 + next_text_benchmark_random(&random) % 8;
+		for (uint i = 0; i < bursts; ++i)
+		{
+			byte  inserted[6]   = "abcdef";
+			uintl offset        = place + next_text_benchmark_random(&random) % 8;
+			uintl removed_size  = next_text_benchmark_random(&random) % 6;
+			uint  inserted_size = next_text_benchmark_random(&random) % sizeof(inserted);
+			if (offset > buffer.size) offset = buffer.size;
+			if (removed_size > buffer.size - offset) removed_size = buffer.size - offset;
+			if (buffer.size - removed_size + inserted_size > TEXT_CHANGES_CHECK_SIZE) inserted_size = 0;
+			replace_text(offset, removed_size, inserted, inserted_size, &buffer);
+		}
+
+		text_change changes;
+		assert(get_text_changes(edits_count, &changes, &buffer));
+		uint after_size = read_text(0, TEXT_CHANGES_CHECK_SIZE, after, &buffer);
+		assert(changes.offset + changes.inserted_size <= after_size);
+		assert(changes.offset + changes.removed_size <= before_size);
+		assert(before_size - changes.removed_size + changes.inserted_size == after_size);
+		assert(!compare(before, after, changes.offset));
+		assert(!compare(before + changes.offset + changes.removed_size, after + changes.offset + changes.inserted_size, after_size - changes.offset - changes.inserted_size));
+	}
+	close_text_buffer(&buffer);
+}
+
+/* a session of typing and deleting over the file at `path`, undone and redone
+   whole, then an edit of the whole file in one splice */
+void benchmark_text_buffer(const char *path)
+{
+	check_text_changes();
+
+	text_buffer buffer;
+	open_text_buffer(path, &buffer);
+	byte  *chunk         = allocate(TEXT_BENCHMARK_CHUNK_SIZE, ALLOCATION_TAG_BUFFER);
+	uint64 original_hash = hash_text_buffer(chunk, &buffer);
+
+	/* bursts of keys at random places */
+	uint32 random        = 0x9e3779b9;
+	uintl  cursor        = 0;
+	uint   edits_count   = 0;
+	uintl  beginning_time = get_time();
+	while (edits_count < TEXT_BENCHMARK_EDITS_COUNT)
+	{
+		cursor = buffer.size ? (uintl)next_text_benchmark_random(&random) * next_text_benchmark_random(&random) % buffer.size : 0;
+		close_text_record(&buffer);
+		uint burst_size = 1 + next_text_benchmark_random(&random) % 16;
+		for (uint i = 0; i < burst_size && edits_count < TEXT_BENCHMARK_EDITS_COUNT; ++i, ++edits_count)
+		{
+			if (cursor && next_text_benchmark_random(&random) % 4 == 0) delete_text(--cursor, 1, &buffer);
+			else
+			{
+				byte key = 'a' + next_text_benchmark_random(&random) % 26;
+				insert_text(cursor++, &key, 1, &buffer);
+			}
+		}
+	}
+	float64 editing_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+	uint64  edited_hash  = hash_text_buffer(chunk, &buffer);
+	uint    history_size = get_text_history_size(&buffer.history);
+
+	uintl offset;
+	uint  undos_count = 0;
+	beginning_time = get_time();
+	while (undo_text(&offset, &buffer)) undos_count += 1;
+	float64 undoing_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+	assert(hash_text_buffer(chunk, &buffer) == original_hash);
+
+	beginning_time = get_time();
+	while (redo_text(&offset, &buffer));
+	float64 redoing_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+	assert(hash_text_buffer(chunk, &buffer) == edited_hash);
+
+	report_comment(
+		"%u edits in %.3f ms (%.0f ns each) made %u records and %u pieces; the history takes %u bytes (%u with the undone), the added text %u\n",
+		edits_count, editing_time * 1000, editing_time * TIME_SECONDS_FACTOR / edits_count, undos_count, buffer.pieces_count, history_size, get_text_history_size(&buffer.history), buffer.added_size);
+	report_comment("undoing them took %.3f ms, redoing them %.3f ms\n", undoing_time * 1000, redoing_time * 1000);
+
+	/* a byte of every split taken out in one edit, as a replacement of the whole file would be */
+	uint        pieces_count = 0;
+	uint        pieces_capacity = buffer.size / TEXT_BENCHMARK_SPLIT_SIZE + buffer.pieces_count + 1;
+	text_piece *pieces       = allocate(pieces_capacity * sizeof(text_piece), ALLOCATION_TAG_BUFFER);
+	for (uint i = 0; i < buffer.pieces_count; ++i)
+	{
+		text_piece piece = buffer.pieces[i];
+		while (piece.size > TEXT_BENCHMARK_SPLIT_SIZE)
+		{
+			pieces[pieces_count++] = (text_piece){ .size = TEXT_BENCHMARK_SPLIT_SIZE - 1, .source = piece.source };
+			piece.source += TEXT_BENCHMARK_SPLIT_SIZE;
+			piece.size   -= TEXT_BENCHMARK_SPLIT_SIZE;
+		}
+		pieces[pieces_count++] = piece;
+	}
+	uint removed_count = buffer.pieces_count;
+
+	beginning_time = get_time();
+	splice_text_pieces(0, removed_count, pieces, pieces_count, &buffer);
+	float64 splicing_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+	uintl   spliced_size  = buffer.size;
+
+	beginning_time = get_time();
+	undo_text(&offset, &buffer);
+	float64 undoing_splice_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+	assert(hash_text_buffer(chunk, &buffer) == edited_hash);
+
+	beginning_time = get_time();
+	redo_text(&offset, &buffer);
+	float64 redoing_splice_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+	assert(buffer.size == spliced_size);
+
+	report_comment(
+		"an edit of %llu bytes over %u pieces took %.3f ms, its undo %.3f ms and its redo %.3f ms\n",
+		buffer.size, pieces_count, splicing_time * 1000, undoing_splice_time * 1000, redoing_splice_time * 1000);
+
+	deallocate(pieces, pieces_capacity * sizeof(text_piece), ALLOCATION_TAG_BUFFER);
+	deallocate(chunk, TEXT_BENCHMARK_CHUNK_SIZE, ALLOCATION_TAG_BUFFER);
+	close_text_buffer(&buffer);
+}
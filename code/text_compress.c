@@ -0,0 +1,189 @@
+/*
+
+a byte-oriented LZ77 compressor whose blocks follow LZ4's layout: a sequence
+is a token (the high nibble counts literals, the low nibble counts the match
+length past the minimum of 4), lengths of 15 continue in bytes of 255, then the
+literals and a little-endian 16-bit offset. the last sequence has no match.
+
+it favours speed over ratio, which suits data that is mostly repetition, such
+as the planes of terminal cells.
+
+*/
+
+#define LZ_MINIMUM_MATCH_SIZE 4
+#define LZ_HASH_BITS          12
+#define LZ_MAXIMUM_OFFSET     65535
+
+/* the compressor leaves the last bytes as literals, so the decompressor can
+   copy matches without looking at the end */
+#define LZ_LAST_LITERALS_SIZE 5
+
+inline static uint32 load_lz_sequence(const byte *data)
+{
+	uint32 sequence;
+	copy(&sequence, data, sizeof(sequence));
+	return sequence;
+}
+
+inline static uint64 load_lz_word(const byte *data)
+{
+	uint64 word;
+	copy(&word, data, sizeof(word));
+	return word;
+}
+
+inline static uint hash_lz_sequence(uint32 sequence)
+{
+	return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+inline static byte *write_lz_length(uint length, byte *output)
+{
+	for (; length >= 255; length -= 255) *output++ = 255;
+	*output++ = length;
+	return output;
+}
+
+uint get_lz_bound(uint size)
+{
+	return size + size / 255 + 16;
+}
+
+uint compress_lz(const byte *source, uint size, byte *destination)
+{
+	uint32 table[1 << LZ_HASH_BITS];
+	fill(table, sizeof(table), 0xff);
+
+	const byte *input    = source;
+	const byte *end      = source + size;
+	const byte *literals = source;
+	byte       *output   = destination;
+
+	if (size > LZ_LAST_LITERALS_SIZE + LZ_MINIMUM_MATCH_SIZE)
+	{
+		const byte *match_limit = end - LZ_LAST_LITERALS_SIZE;
+		while (input + LZ_MINIMUM_MATCH_SIZE <= match_limit)
+		{
+			uint32 sequence  = load_lz_sequence(input);
+			uint   hash      = hash_lz_sequence(sequence);
+			uint32 candidate = table[hash];
+			table[hash] = input - source;
+
+			bit found = candidate != 0xffffffff
+			         && (uint)(input - source) - candidate <= LZ_MAXIMUM_OFFSET
+			         && load_lz_sequence(source + candidate) == sequence;
+			if (!found)
+			{
+				/* step faster through data that does not repeat */
+				input += 1 + ((input - literals) >> 6);
+				continue;
+			}
+
+			const byte *match = source + candidate;
+			uint match_size = LZ_MINIMUM_MATCH_SIZE;
+
+			/* extend the match a word at a time, then a byte at a time */
+			while (input + match_size + sizeof(uint64) <= match_limit)
+			{
+				uint64 difference = load_lz_word(match + match_size) ^ load_lz_word(input + match_size);
+				if (difference)
+				{
+					match_size += __builtin_ctzll(difference) / 8;
+					goto extended;
+				}
+				match_size += sizeof(uint64);
+			}
+			while (input + match_size < match_limit && match[match_size] == input[match_size]) match_size += 1;
+		extended:
+
+			uint  literals_size = input - literals;
+			byte *token = output++;
+			*token = (literals_size < 15 ? literals_size : 15) << 4;
+			if (literals_size >= 15) output = write_lz_length(literals_size - 15, output);
+			copy(output, literals, literals_size);
+			output += literals_size;
+
+			uint16 offset = input - match;
+			*output++ = offset & 0xff;
+			*output++ = offset >> 8;
+
+			uint extra_size = match_size - LZ_MINIMUM_MATCH_SIZE;
+			*token |= extra_size < 15 ? extra_size : 15;
+			if (extra_size >= 15) output = write_lz_length(extra_size - 15, output);
+
+			input   += match_size;
+			literals = input;
+		}
+	}
+
+	/* the last literals */
+	uint literals_size = end - literals;
+	*output++ = (literals_size < 15 ? literals_size : 15) << 4;
+	if (literals_size >= 15) output = write_lz_length(literals_size - 15, output);
+	copy(output, literals, literals_size);
+	output += literals_size;
+
+	return output - destination;
+}
+
+/* returns the size of the decompressed data, or `UINT_MAXIMUM` if `source` is
+   malformed or does not fit */
+uint decompress_lz(const byte *source, uint size, byte *destination, uint capacity)
+{
+	const byte *input      = source;
+	const byte *input_end  = source + size;
+	byte       *output     = destination;
+	byte       *output_end = destination + capacity;
+
+	while (input < input_end)
+	{
+		byte token = *input++;
+
+		uint literals_size = token >> 4;
+		if (literals_size == 15)
+		{
+			byte b;
+			do
+			{
+				if (input == input_end) return UINT_MAXIMUM;
+				b = *input++;
+				literals_size += b;
+			}
+			while (b == 255);
+		}
+		if (literals_size > (uint)(input_end - input) || literals_size > (uint)(output_end - output)) return UINT_MAXIMUM;
+		copy(output, input, literals_size);
+		input  += literals_size;
+		output += literals_size;
+
+		/* the last sequence has no match */
+		if (input == input_end) break;
+
+		if (input_end - input < 2) return UINT_MAXIMUM;
+		uint offset = input[0] | input[1] << 8;
+		input += 2;
+		if (!offset || offset > (uint)(output - destination)) return UINT_MAXIMUM;
+
+		uint match_size = token & 15;
+		if (match_size == 15)
+		{
+			byte b;
+			do
+			{
+				if (input == input_end) return UINT_MAXIMUM;
+				b = *input++;
+				match_size += b;
+			}
+			while (b == 255);
+		}
+		match_size += LZ_MINIMUM_MATCH_SIZE;
+		if (match_size > (uint)(output_end - output)) return UINT_MAXIMUM;
+
+		/* the match may overlap what it writes, so copy forwards */
+		const byte *match = output - offset;
+		for (uint i = 0; i < match_size; ++i) output[i] = match[i];
+		output += match_size;
+	}
+
+	return output - destination;
+}
@@ -0,0 +1,260 @@
+/*
+
+an edit at many cursors is made at all of them at once: what each replaces is
+a run of the text, and the runs are replaced in a single pass over the pieces
+that they fall in. the cursors are then moved by what the edits before them
+added and removed, in the same order, so an edit costs as much for a hundred
+thousand cursors as one pass over their pieces does.
+
+what is typed at every cursor is a piece of the same added text, which
+follows what was typed before it, so typing extends the pieces of every
+cursor rather than adding more of them.
+
+*/
+
+inline static uintl get_text_cursor_beginning(const text_cursor *cursor)
+{
+	return cursor->position < cursor->anchor ? cursor->position : cursor->anchor;
+}
+
+inline static uintl get_text_cursor_end(const text_cursor *cursor)
+{
+	return cursor->position > cursor->anchor ? cursor->position : cursor->anchor;
+}
+
+/* makes room for `count` cursors, and for a run at each */
+static void reserve_text_cursors(uint count, text_cursors *cursors)
+{
+	if (count <= cursors->cursors_capacity) return;
+
+	uint capacity = cursors->cursors_capacity ? cursors->cursors_capacity : 4096 / sizeof(uintl);
+	while (capacity < count) capacity *= 2;
+	text_cursor *new_cursors = allocate(capacity * sizeof(text_cursor), ALLOCATION_TAG_BUFFER);
+	if (cursors->cursors)
+	{
+		copy(new_cursors, cursors->cursors, cursors->cursors_count * sizeof(text_cursor));
+		deallocate(cursors->cursors, cursors->cursors_capacity * sizeof(text_cursor), ALLOCATION_TAG_BUFFER);
+		deallocate(cursors->beginnings, cursors->cursors_capacity * sizeof(uintl), ALLOCATION_TAG_BUFFER);
+		deallocate(cursors->ends, cursors->cursors_capacity * sizeof(uintl), ALLOCATION_TAG_BUFFER);
+	}
+	cursors->cursors          = new_cursors;
+	cursors->beginnings       = allocate(capacity * sizeof(uintl), ALLOCATION_TAG_BUFFER);
+	cursors->ends             = allocate(capacity * sizeof(uintl), ALLOCATION_TAG_BUFFER);
+	cursors->cursors_capacity = capacity;
+}
+
+/* joins the cursors whose selections overlap, or meet where one of them is empty */
+static void merge_text_cursors(text_cursors *cursors)
+{
+	if (!cursors->cursors_count) return;
+
+	uint count = 1;
+	for (uint i = 1; i < cursors->cursors_count; ++i)
+	{
+		text_cursor *last      = &cursors->cursors[count - 1];
+		text_cursor *cursor    = &cursors->cursors[i];
+		uintl        last_end  = get_text_cursor_end(last);
+		uintl        beginning = get_text_cursor_beginning(cursor);
+		if (beginning < last_end || (beginning == last_end && (last->position == last->anchor || cursor->position == cursor->anchor)))
+		{
+			uintl end = get_text_cursor_end(cursor) > last_end ? get_text_cursor_end(cursor) : last_end;
+			if (last->position >= last->anchor) last->position = end;
+			else last->anchor = end;
+			continue;
+		}
+		cursors->cursors[count++] = *cursor;
+	}
+	cursors->cursors_count = count;
+}
+
+void add_text_cursor(uintl position, uintl anchor, text_cursors *cursors)
+{
+	reserve_text_cursors(cursors->cursors_count + 1, cursors);
+
+	/* after the cursors that begin before it */
+	text_cursor cursor = { position, anchor };
+	uintl       beginning = get_text_cursor_beginning(&cursor);
+	uint        low       = 0;
+	uint        high      = cursors->cursors_count;
+	while (low < high)
+	{
+		uint middle = low + (high - low) / 2;
+		if (get_text_cursor_beginning(&cursors->cursors[middle]) <= beginning) low = middle + 1;
+		else high = middle;
+	}
+	move(cursors->cursors + low + 1, cursors->cursors + low, (cursors->cursors_count - low) * sizeof(text_cursor));
+	cursors->cursors[low]   = cursor;
+	cursors->cursors_count += 1;
+	merge_text_cursors(cursors);
+}
+
+/* a cursor at the end of every match, selecting it */
+void select_text_matches(const uintl *matches, uint matches_count, uint match_size, text_cursors *cursors)
+{
+	reserve_text_cursors(matches_count, cursors);
+	for (uint i = 0; i < matches_count; ++i) cursors->cursors[i] = (text_cursor){ matches[i] + match_size, matches[i] };
+	cursors->cursors_count = matches_count;
+	merge_text_cursors(cursors);
+}
+
+void terminate_text_cursors(text_cursors *cursors)
+{
+	if (cursors->cursors)
+	{
+		deallocate(cursors->cursors, cursors->cursors_capacity * sizeof(text_cursor), ALLOCATION_TAG_BUFFER);
+		deallocate(cursors->beginnings, cursors->cursors_capacity * sizeof(uintl), ALLOCATION_TAG_BUFFER);
+		deallocate(cursors->ends, cursors->cursors_capacity * sizeof(uintl), ALLOCATION_TAG_BUFFER);
+	}
+	zero(cursors, sizeof(*cursors));
+}
+
+/* the code point before or after `offset`. the cursors are stepped in order,
+   so the piece that it is in is found from the piece of the last step */
+static uintl step_text_code_point(uintl offset, bit forward, uint *piece, const text_buffer *buffer)
+{
+	if (forward ? offset == buffer->size : !offset) return offset;
+
+	uintl target = forward ? offset : offset - 1;
+	while (*piece + 1 < buffer->pieces_count && buffer->pieces[*piece + 1].offset <= target) ++*piece;
+	assert(buffer->pieces[*piece].offset <= target);
+	const text_piece *source = &buffer->pieces[*piece];
+	const byte       *data   = get_text_piece_data(source, buffer) + (target - source->offset);
+
+	if (forward ? *data < 0x80 : (*data & 0xc0) != 0x80) return forward ? offset + 1 : offset - 1;
+
+	/* a code point is at most 4 bytes; one that is cut between pieces is read whole */
+	byte bytes[4];
+	if (forward)
+	{
+		uint size = sizeof(bytes);
+		if (source->offset + source->size - target >= size) copy(bytes, data, size);
+		else size = read_text(offset, size, bytes, buffer);
+		uint step = 1;
+		while (step < size && (bytes[step] & 0xc0) == 0x80) ++step;
+		return offset + step;
+	}
+	uint size = offset < sizeof(bytes) ? offset : sizeof(bytes);
+	if (target + 1 - source->offset >= size) copy(bytes, data + 1 - size, size);
+	else read_text(offset - size, size, bytes, buffer);
+	uint step = 1;
+	while (step < size && (bytes[size - step] & 0xc0) == 0x80) ++step;
+	return offset - step;
+}
+
+/* replaces the runs at every cursor, and leaves each cursor after what replaced its run */
+static void replace_at_text_cursors(const byte *text, uint size, text_cursors *cursors, text_buffer *buffer)
+{
+	replace_text_runs(cursors->beginnings, cursors->ends, cursors->cursors_count, 0, text, size, buffer);
+
+	uintl removed_size = 0;
+	uintl added_size   = 0;
+	for (uint i = 0; i < cursors->cursors_count; ++i)
+	{
+		uintl position = cursors->beginnings[i] - removed_size + added_size + size;
+		cursors->cursors[i] = (text_cursor){ position, position };
+		removed_size += cursors->ends[i] - cursors->beginnings[i];
+		added_size   += size;
+	}
+	merge_text_cursors(cursors);
+}
+
+void type_at_text_cursors(const byte *text, uint size, text_cursors *cursors, text_buffer *buffer)
+{
+	for (uint i = 0; i < cursors->cursors_count; ++i)
+	{
+		cursors->beginnings[i] = get_text_cursor_beginning(&cursors->cursors[i]);
+		cursors->ends[i]       = get_text_cursor_end(&cursors->cursors[i]);
+	}
+	replace_at_text_cursors(text, size, cursors, buffer);
+}
+
+/* removes the selections, or the code points before or after the cursors without one */
+void erase_at_text_cursors(bit forward, text_cursors *cursors, text_buffer *buffer)
+{
+	uintl erased_size  = 0;
+	uintl previous_end = 0;
+	uint  piece        = 0;
+	for (uint i = 0; i < cursors->cursors_count; ++i)
+	{
+		text_cursor *cursor    = &cursors->cursors[i];
+		uintl        beginning = get_text_cursor_beginning(cursor);
+		uintl        end       = get_text_cursor_end(cursor);
+		if (beginning == end)
+		{
+			if (forward) end = step_text_code_point(end, 1, &piece, buffer);
+			else beginning = step_text_code_point(beginning, 0, &piece, buffer);
+		}
+
+		/* a code point that the cursor before took is not taken again */
+		if (beginning < previous_end) beginning = previous_end;
+		if (end < beginning) end = beginning;
+		cursors->beginnings[i] = beginning;
+		cursors->ends[i]       = end;
+		erased_size  += end - beginning;
+		previous_end  = end;
+	}
+	if (erased_size) replace_at_text_cursors(0, 0, cursors, buffer);
+}
+
+/* by a code point, or to the side of the selection it moves to when the selection is left */
+void move_text_cursors(bit forward, bit selecting, text_cursors *cursors, const text_buffer *buffer)
+{
+	uint piece = 0;
+	for (uint i = 0; i < cursors->cursors_count; ++i)
+	{
+		text_cursor *cursor = &cursors->cursors[i];
+		if (!selecting && cursor->position != cursor->anchor) cursor->position = forward ? get_text_cursor_end(cursor) : get_text_cursor_beginning(cursor);
+		else cursor->position = step_text_code_point(cursor->position, forward, &piece, buffer);
+		if (!selecting) cursor->anchor = cursor->position;
+	}
+	merge_text_cursors(cursors);
+}
+
+/* a word typed and erased at a cursor on every match of `literal` in the
+   file at `path`, a keystroke at a time, against typing at some of them one
+   cursor after another */
+void benchmark_text_cursors(const char *path, const char *literal)
+{
+	text_buffer buffer;
+	open_text_buffer(path, &buffer);
+	uint  literal_size  = strlen(literal);
+	uintl original_size = buffer.size;
+
+	text_search search = {0};
+	begin_text_search((const byte *)literal, literal_size, &buffer, &search);
+	while (update_text_search(&search)) thrd_yield();
+	text_cursors cursors = {0};
+	select_text_matches(search.matches, search.matches_count, literal_size, &cursors);
+	end_text_search(&search);
+
+	const char *word         = "hello";
+	float64     slowest_time = 0;
+	uintl       beginning_time;
+	for (uint i = 0; i < 10; ++i)
+	{
+		beginning_time = get_time();
+		if (i < 5) type_at_text_cursors((const byte *)word + i, 1, &cursors, &buffer);
+		else erase_at_text_cursors(0, &cursors, &buffer);
+		float64 keystroke_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+		if (keystroke_time > slowest_time) slowest_time = keystroke_time;
+	}
+	uint pieces_count = buffer.pieces_count;
+	assert(buffer.size == original_size - (uintl)cursors.cursors_count * literal_size);
+
+	beginning_time = get_time();
+	move_text_cursors(0, 1, &cursors, &buffer);
+	float64 moving_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+
+	/* the same keystroke at the last cursors, from the end so that the others stay where they are */
+	uint separate_count = cursors.cursors_count < 10000 ? cursors.cursors_count : 10000;
+	beginning_time = get_time();
+	for (uint i = 0; i < separate_count; ++i) insert_text(cursors.cursors[cursors.cursors_count - 1 - i].position, (const byte *)word, 1, &buffer);
+	float64 separate_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+
+	report_comment(
+		"%u cursors over %llu bytes: the slowest of 10 keystrokes took %.3f ms, leaving %u pieces; moving took %.3f ms; %u separate keystrokes took %.3f ms\n",
+		cursors.cursors_count, original_size, slowest_time * 1000, pieces_count, moving_time * 1000, separate_count, separate_time * 1000);
+
+	terminate_text_cursors(&cursors);
+	close_text_buffer(&buffer);
+}
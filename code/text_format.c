@@ -0,0 +1,778 @@
+/*
+
+printf-style formatting that never touches the heap.
+
+the supported specification is `%[flags][width][.precision][length]conversion`
+where
+	flags      are any of `-`, `0`, `+` and ` `;
+	width      and precision are decimal numbers or `*`;
+	length     is one of `hh`, `h`, `l`, `ll` and `z`;
+	conversion is one of `d`, `i`, `u`, `x`, `X`, `c`, `s`, `p`, `f` and `%`.
+
+the UI formats the same few strings every frame (the status bar, the line
+numbers), so `push_formatted_string` first packs the arguments and, if a string
+was already formatted with the same format and arguments, copies it instead of
+converting the arguments again.
+
+the arguments can also be packed into words, with strings copied, and
+formatted later on another thread; that is how reports are logged.
+
+*/
+
+typedef struct
+{
+	bit  left_justified : 1;
+	bit  zero_padded    : 1;
+	bit  signed_plus    : 1;
+	bit  signed_space   : 1;
+	bit  has_precision  : 1;
+	uint width;
+	uint precision;
+	uint length;  /* the size of the argument in bytes */
+	char conversion;
+} format_specification;
+
+/* where the arguments of a format are taken from: a `va_list`, or the words
+   that were packed from one. while packing, whatever is taken from the
+   `va_list` is also written to `pack`. */
+typedef struct
+{
+	va_list    *vargs;
+	const byte *packed;
+	byte       *pack;
+	byte       *pack_end;
+	bit         overflowed;
+	bit         cut;  /* a string was cut to what fit */
+} format_arguments;
+
+inline static void pack_format_word(uintl word, format_arguments *arguments)
+{
+	if (!arguments->pack) return;
+	if ((uint)(arguments->pack_end - arguments->pack) < sizeof(word))
+	{
+		arguments->overflowed = 1;
+		return;
+	}
+	copy(arguments->pack, &word, sizeof(word));
+	arguments->pack += sizeof(word);
+}
+
+inline static uintl take_packed_format_word(format_arguments *arguments)
+{
+	uintl word;
+	copy(&word, arguments->packed, sizeof(word));
+	arguments->packed += sizeof(word);
+	return word;
+}
+
+static sint take_format_int(format_arguments *arguments)
+{
+	if (!arguments->vargs) return (sint)take_packed_format_word(arguments);
+	sint value = va_arg(*arguments->vargs, int);
+	pack_format_word((uintl)(sintl)value, arguments);
+	return value;
+}
+
+static uint take_format_unsigned_int(format_arguments *arguments)
+{
+	if (!arguments->vargs) return (uint)take_packed_format_word(arguments);
+	uint value = va_arg(*arguments->vargs, unsigned int);
+	pack_format_word(value, arguments);
+	return value;
+}
+
+static uintl take_format_unsigned_long(format_arguments *arguments)
+{
+	if (!arguments->vargs) return take_packed_format_word(arguments);
+	uintl value = va_arg(*arguments->vargs, unsigned long long);
+	pack_format_word(value, arguments);
+	return value;
+}
+
+static uintl take_format_pointer(format_arguments *arguments)
+{
+	if (!arguments->vargs) return take_packed_format_word(arguments);
+	uintl value = (uintptr_t)va_arg(*arguments->vargs, void *);
+	pack_format_word(value, arguments);
+	return value;
+}
+
+static float64 take_format_float(format_arguments *arguments)
+{
+	float64 value;
+	if (!arguments->vargs)
+	{
+		uintl word = take_packed_format_word(arguments);
+		copy(&value, &word, sizeof(value));
+		return value;
+	}
+	value = va_arg(*arguments->vargs, float64);
+	uintl word;
+	copy(&word, &value, sizeof(word));
+	pack_format_word(word, arguments);
+	return value;
+}
+
+/* strings are packed as their length and their characters, which are cut to
+   what fits and padded to a word */
+static const char *take_format_string(format_arguments *arguments)
+{
+	if (!arguments->vargs)
+	{
+		uint        length = take_packed_format_word(arguments);
+		const char *string = (const char *)arguments->packed;
+		arguments->packed += (length + 1 + 7) & ~7u;
+		return string;
+	}
+
+	const char *string = va_arg(*arguments->vargs, const char *);
+	if (!string) string = "(null)";
+	if (arguments->pack)
+	{
+		uint available = arguments->pack_end - arguments->pack;
+		if (available < 2 * sizeof(uintl))
+		{
+			arguments->overflowed = 1;
+			return string;
+		}
+		uint maximum_length = ((available - sizeof(uintl)) & ~7u) - 1;
+		uint length         = 0;
+		while (string[length] && length < maximum_length) length += 1;
+		if (string[length]) arguments->cut = 1;
+		pack_format_word(length, arguments);
+		copy(arguments->pack, string, length);
+		fill(arguments->pack + length, ((length + 1 + 7) & ~7u) - length, 0);
+		arguments->pack += (length + 1 + 7) & ~7u;
+	}
+	return string;
+}
+
+/* parses the specification after a `%` and returns the character after it */
+static const char *parse_format_specification(const char *format, format_arguments *arguments, format_specification *specification)
+{
+	zero(specification, sizeof(*specification));
+
+	for (;; ++format)
+	{
+		switch (*format)
+		{
+		case '-': specification->left_justified = 1; continue;
+		case '0': specification->zero_padded    = 1; continue;
+		case '+': specification->signed_plus    = 1; continue;
+		case ' ': specification->signed_space   = 1; continue;
+		}
+		break;
+	}
+
+	if (*format == '*')
+	{
+		sint width = take_format_int(arguments);
+		if (width < 0)
+		{
+			specification->left_justified = 1;
+			width = -width;
+		}
+		specification->width = width;
+		format += 1;
+	}
+	else while (*format >= '0' && *format <= '9') specification->width = specification->width * 10 + (*format++ - '0');
+
+	if (*format == '.')
+	{
+		specification->has_precision = 1;
+		format += 1;
+		if (*format == '*')
+		{
+			sint precision = take_format_int(arguments);
+			specification->has_precision = precision >= 0;
+			specification->precision = precision >= 0 ? precision : 0;
+			format += 1;
+		}
+		else while (*format >= '0' && *format <= '9') specification->precision = specification->precision * 10 + (*format++ - '0');
+	}
+
+	specification->length = sizeof(int);
+	switch (*format)
+	{
+	case 'h':
+		format += 1;
+		specification->length = sizeof(short);
+		if (*format == 'h')
+		{
+			format += 1;
+			specification->length = sizeof(char);
+		}
+		break;
+	case 'l':
+		format += 1;
+		specification->length = sizeof(long);
+		if (*format == 'l')
+		{
+			format += 1;
+			specification->length = sizeof(long long);
+		}
+		break;
+	case 'z':
+		format += 1;
+		specification->length = sizeof(size_t);
+		break;
+	}
+
+	specification->conversion = *format ? *format++ : 0;
+	return format;
+}
+
+static uintl get_format_unsigned_argument(const format_specification *specification, format_arguments *arguments)
+{
+	switch (specification->length)
+	{
+	case sizeof(char):      return (unsigned char)take_format_unsigned_int(arguments);
+	case sizeof(short):     return (unsigned short)take_format_unsigned_int(arguments);
+	case sizeof(int):       return take_format_unsigned_int(arguments);
+	default:                return take_format_unsigned_long(arguments);
+	}
+}
+
+static sintl get_format_signed_argument(const format_specification *specification, format_arguments *arguments)
+{
+	switch (specification->length)
+	{
+	case sizeof(char):      return (signed char)take_format_int(arguments);
+	case sizeof(short):     return (short)take_format_int(arguments);
+	case sizeof(int):       return take_format_int(arguments);
+	default:                return (sintl)take_format_unsigned_long(arguments);
+	}
+}
+
+typedef struct
+{
+	char *buffer;
+	uint  capacity;
+	uint  length;
+} format_writer;
+
+inline static void write_format_characters(const char *characters, uint count, format_writer *writer)
+{
+	uint available = writer->capacity - writer->length;
+	if (count > available) count = available;
+	if (!count) return;
+	copy(writer->buffer + writer->length, characters, count);
+	writer->length += count;
+}
+
+inline static void write_format_padding(char character, uint count, format_writer *writer)
+{
+	uint available = writer->capacity - writer->length;
+	if (count > available) count = available;
+	if (!count) return;
+	fill(writer->buffer + writer->length, count, character);
+	writer->length += count;
+}
+
+/* writes `prefix`, then `digits` zero-extended to `precision`, justified in `width` */
+static void write_format_field(const format_specification *specification, const char *prefix, uint prefix_length, const char *digits, uint digits_length, uint precision, format_writer *writer)
+{
+	uint zeroes  = precision > digits_length ? precision - digits_length : 0;
+	uint length  = prefix_length + zeroes + digits_length;
+	uint padding = specification->width > length ? specification->width - length : 0;
+
+	if (!specification->left_justified && !specification->zero_padded) write_format_padding(' ', padding, writer);
+	write_format_characters(prefix, prefix_length, writer);
+	if (!specification->left_justified && specification->zero_padded) write_format_padding('0', padding, writer);
+	write_format_padding('0', zeroes, writer);
+	write_format_characters(digits, digits_length, writer);
+	if (specification->left_justified) write_format_padding(' ', padding, writer);
+}
+
+/* writes the digits of `value` at the end of `digits` and returns their count */
+static uint convert_unsigned_to_digits(uintl value, uint base, bit uppercase, char digits[24])
+{
+	const char *alphabet = uppercase ? "0123456789ABCDEF" : "0123456789abcdef";
+	char *digit = digits + 24;
+	if (base == 10)
+	{
+		/* two digits at a time halves the divisions */
+		static const char pairs[] =
+			"00010203040506070809"
+			"10111213141516171819"
+			"20212223242526272829"
+			"30313233343536373839"
+			"40414243444546474849"
+			"50515253545556575859"
+			"60616263646566676869"
+			"70717273747576777879"
+			"80818283848586878889"
+			"90919293949596979899";
+		while (value >= 100)
+		{
+			uint pair = (value % 100) * 2;
+			value /= 100;
+			*--digit = pairs[pair + 1];
+			*--digit = pairs[pair];
+		}
+		if (value >= 10)
+		{
+			*--digit = pairs[value * 2 + 1];
+			*--digit = pairs[value * 2];
+		}
+		else *--digit = '0' + value;
+	}
+	else
+	{
+		do *--digit = alphabet[value % base];
+		while (value /= base);
+	}
+	return (digits + 24) - digit;
+}
+
+static void write_format_integer(const format_specification *specification, format_arguments *arguments, format_writer *writer)
+{
+	char  prefix[2];
+	uint  prefix_length = 0;
+	uintl value;
+	uint  base = 10;
+
+	switch (specification->conversion)
+	{
+	case 'd':
+	case 'i':
+		{
+			sintl signed_value = get_format_signed_argument(specification, arguments);
+			if (signed_value < 0)
+			{
+				prefix[prefix_length++] = '-';
+				value = -(uintl)signed_value;
+			}
+			else
+			{
+				if (specification->signed_plus)       prefix[prefix_length++] = '+';
+				else if (specification->signed_space) prefix[prefix_length++] = ' ';
+				value = signed_value;
+			}
+		}
+		break;
+	case 'u':
+		value = get_format_unsigned_argument(specification, arguments);
+		break;
+	case 'x':
+	case 'X':
+		value = get_format_unsigned_argument(specification, arguments);
+		base = 16;
+		break;
+	case 'p':
+		value = take_format_pointer(arguments);
+		base = 16;
+		prefix[prefix_length++] = '0';
+		prefix[prefix_length++] = 'x';
+		break;
+	default: unreachable();
+	}
+
+	char digits[24];
+	uint digits_length = convert_unsigned_to_digits(value, base, specification->conversion == 'X', digits);
+	uint precision = specification->has_precision ? specification->precision : 1;
+
+	/* "%.0u" of zero is nothing */
+	if (!value && !precision) digits_length = 0;
+
+	format_specification field = *specification;
+	if (specification->has_precision) field.zero_padded = 0;
+	write_format_field(&field, prefix, prefix_length, digits + 24 - digits_length, digits_length, precision, writer);
+}
+
+/* good enough for displaying measurements; it does not round like `printf`
+   for values beyond 2^64 */
+static void write_format_float(const format_specification *specification, format_arguments *arguments, format_writer *writer)
+{
+	float64 value = take_format_float(arguments);
+	uint    precision = specification->has_precision ? specification->precision : 6;
+	if (precision > 17) precision = 17;
+
+	char prefix[1];
+	uint prefix_length = 0;
+	if (signbit(value))
+	{
+		prefix[prefix_length++] = '-';
+		value = -value;
+	}
+	else if (specification->signed_plus)  prefix[prefix_length++] = '+';
+	else if (specification->signed_space) prefix[prefix_length++] = ' ';
+
+	format_specification field = *specification;
+	if (isnan(value) || isinf(value))
+	{
+		field.zero_padded = 0;
+		write_format_field(&field, prefix, prefix_length, isnan(value) ? "nan" : "inf", 3, 0, writer);
+		return;
+	}
+
+	float64 scale = 1;
+	for (uint i = 0; i < precision; ++i) scale *= 10;
+
+	uintl whole    = (uintl)value;
+	uintl fraction = (uintl)((value - (float64)whole) * scale + 0.5);
+	if (fraction >= (uintl)scale)
+	{
+		whole    += 1;
+		fraction -= (uintl)scale;
+	}
+
+	char text[48];
+	uint text_length = 0;
+	{
+		char digits[24];
+		uint digits_length = convert_unsigned_to_digits(whole, 10, 0, digits);
+		copy(text, digits + 24 - digits_length, digits_length);
+		text_length += digits_length;
+	}
+	if (precision)
+	{
+		text[text_length++] = '.';
+		char digits[24];
+		uint digits_length = convert_unsigned_to_digits(fraction, 10, 0, digits);
+		fill(text + text_length, precision - digits_length, '0');
+		text_length += precision - digits_length;
+		copy(text + text_length, digits + 24 - digits_length, digits_length);
+		text_length += digits_length;
+	}
+	write_format_field(&field, prefix, prefix_length, text, text_length, 0, writer);
+}
+
+static uint format_string_from(char *buffer, uint capacity, const char *format, format_arguments *arguments)
+{
+	assert(capacity);
+
+	/* reserve the terminator */
+	format_writer writer = { buffer, capacity - 1, 0 };
+
+	while (*format)
+	{
+		/* copy the run up to the next specification at once */
+		const char *run = format;
+		while (*format && *format != '%') format += 1;
+		write_format_characters(run, format - run, &writer);
+		if (!*format) break;
+
+		format_specification specification;
+		format = parse_format_specification(format + 1, arguments, &specification);
+		switch (specification.conversion)
+		{
+		case 'd':
+		case 'i':
+		case 'u':
+		case 'x':
+		case 'X':
+		case 'p':
+			write_format_integer(&specification, arguments, &writer);
+			break;
+		case 'f':
+			write_format_float(&specification, arguments, &writer);
+			break;
+		case 'c':
+			{
+				char character = take_format_int(arguments);
+				specification.zero_padded = 0;
+				write_format_field(&specification, 0, 0, &character, 1, 0, &writer);
+			}
+			break;
+		case 's':
+			{
+				const char *string = take_format_string(arguments);
+				uint length = 0;
+				while (string[length] && (!specification.has_precision || length < specification.precision)) length += 1;
+				specification.zero_padded = 0;
+				write_format_field(&specification, 0, 0, string, length, 0, &writer);
+			}
+			break;
+		case '%':
+			write_format_characters("%", 1, &writer);
+			break;
+		default:
+			/* an unknown conversion is written verbatim */
+			write_format_characters("%", 1, &writer);
+			if (specification.conversion) write_format_characters(&specification.conversion, 1, &writer);
+			break;
+		}
+	}
+
+	buffer[writer.length] = 0;
+	return writer.length;
+}
+
+uint format_string_v(char *buffer, uint capacity, const char *format, va_list vargs)
+{
+	va_list vargs_copy;
+	va_copy(vargs_copy, vargs);
+	format_arguments arguments = { .vargs = &vargs_copy };
+	uint length = format_string_from(buffer, capacity, format, &arguments);
+	va_end(vargs_copy);
+	return length;
+}
+
+uint format_packed_string(char *buffer, uint capacity, const char *format, const byte *packed)
+{
+	format_arguments arguments = { .packed = packed };
+	return format_string_from(buffer, capacity, format, &arguments);
+}
+
+uint format_string(char *buffer, uint capacity, const char *format, ...)
+{
+	va_list vargs;
+	va_start(vargs, format);
+	uint length = format_string_v(buffer, capacity, format, vargs);
+	va_end(vargs);
+	return length;
+}
+
+/* takes every argument of `format`, which packs it */
+static void pack_format_arguments_into(const char *format, format_arguments *arguments)
+{
+	while (*format && !arguments->overflowed)
+	{
+		if (*format++ != '%') continue;
+
+		format_specification specification;
+		format = parse_format_specification(format, arguments, &specification);
+		switch (specification.conversion)
+		{
+		case 'd':
+		case 'i':
+			get_format_signed_argument(&specification, arguments);
+			break;
+		case 'u':
+		case 'x':
+		case 'X':
+			get_format_unsigned_argument(&specification, arguments);
+			break;
+		case 'p': take_format_pointer(arguments); break;
+		case 'f': take_format_float(arguments);   break;
+		case 'c': take_format_int(arguments);     break;
+		case 's': take_format_string(arguments);  break;
+		}
+	}
+}
+
+/* packs the arguments that `format` takes, so that they can be formatted
+   after the call returns. returns the size of what was packed, or
+   `UINT_MAXIMUM` if it does not fit. */
+uint pack_format_arguments(byte *buffer, uint capacity, const char *format, va_list vargs)
+{
+	va_list          vargs_copy;
+	va_copy(vargs_copy, vargs);
+	format_arguments arguments = { .vargs = &vargs_copy, .pack = buffer, .pack_end = buffer + capacity };
+	pack_format_arguments_into(format, &arguments);
+	va_end(vargs_copy);
+
+	return arguments.overflowed ? UINT_MAXIMUM : arguments.pack - buffer;
+}
+
+/* FNV-1a over 8 bytes at a time */
+inline static uintl hash_format_bytes(const void *bytes, uint size, uintl hash)
+{
+	const byte *b = bytes;
+	for (; size >= 8; b += 8, size -= 8)
+	{
+		uintl word;
+		copy(&word, b, 8);
+		hash = (hash ^ word) * 0x100000001b3;
+	}
+	for (; size; b += 1, size -= 1) hash = (hash ^ *b) * 0x100000001b3;
+	return hash;
+}
+
+#define FORMAT_CACHE_ENTRIES_CAPACITY   64
+#define FORMAT_CACHE_ARGUMENTS_CAPACITY 256
+#define FORMAT_CACHE_TEXT_CAPACITY      256
+
+/* a string and what it was formatted from. the arguments are packed, which
+   copies the strings that they point to, so that a hit compares them rather
+   than trusting a hash */
+typedef struct
+{
+	const char *format;
+	uint        arguments_size;
+	uint        length;
+	byte        arguments[FORMAT_CACHE_ARGUMENTS_CAPACITY];
+	char        text[FORMAT_CACHE_TEXT_CAPACITY];
+} format_cache_entry;
+
+static thread_local struct
+{
+	format_cache_entry entries[FORMAT_CACHE_ENTRIES_CAPACITY];
+	uintl              hits_count;
+	uintl              misses_count;
+} format_cache;
+
+const char *push_formatted_string_v(uint *size, arena *arena, const char *format, va_list vargs)
+{
+	byte             packed[FORMAT_CACHE_ARGUMENTS_CAPACITY];
+	va_list          vargs_copy;
+	va_copy(vargs_copy, vargs);
+	format_arguments arguments = { .vargs = &vargs_copy, .pack = packed, .pack_end = packed + sizeof(packed) };
+	pack_format_arguments_into(format, &arguments);
+	va_end(vargs_copy);
+
+	/* what does not pack whole is formatted every time */
+	format_cache_entry *entry       = 0;
+	uint                packed_size = arguments.pack - packed;
+	if (!arguments.overflowed && !arguments.cut)
+	{
+		uintl hash = hash_format_bytes(packed, packed_size, 0xcbf29ce484222325 ^ (uintptr_t)format);
+		entry = &format_cache.entries[hash % FORMAT_CACHE_ENTRIES_CAPACITY];
+	}
+
+	char *string;
+	uint  length;
+	if (entry && entry->format == format && entry->arguments_size == packed_size && !compare(entry->arguments, packed, packed_size))
+	{
+		format_cache.hits_count += 1;
+		length = entry->length;
+		string = push_into_arena(length + 1, 1, arena);
+		copy(string, entry->text, length + 1);
+	}
+	else
+	{
+		format_cache.misses_count += 1;
+
+		/* format into the rest of the arena, then keep only what was used */
+		string = (char *)arena->memory + arena->mass;
+		length = format_string_v(string, arena->capacity - arena->mass, format, vargs);
+		assert(arena->mass + length + 1 < arena->capacity);
+		push_into_arena(length + 1, 1, arena);
+
+		if (entry && length < FORMAT_CACHE_TEXT_CAPACITY)
+		{
+			entry->format         = format;
+			entry->arguments_size = packed_size;
+			entry->length         = length;
+			copy(entry->arguments, packed, packed_size);
+			copy(entry->text, string, length + 1);
+		}
+	}
+
+	if (size) *size = length;
+	return string;
+}
+
+const char *push_formatted_string(uint *size, arena *arena, const char *format, ...)
+{
+	va_list vargs;
+	va_start(vargs, format);
+	const char *string = push_formatted_string_v(size, arena, format, vargs);
+	va_end(vargs);
+	return string;
+}
+
+#define FORMAT_BENCHMARK_FRAMES_COUNT    100000
+#define FORMAT_BENCHMARK_LINES_COUNT     50
+#define FORMAT_BENCHMARK_BUFFER_CAPACITY 256
+
+typedef enum
+{
+	FORMAT_BENCHMARK_WAY_VSNPRINTF,
+	FORMAT_BENCHMARK_WAY_FORMAT,
+	FORMAT_BENCHMARK_WAY_CACHE,
+	FORMAT_BENCHMARK_WAYS_COUNT,
+} format_benchmark_way;
+
+/* formats a string the given way, and folds it into `hash` if there is one */
+static uint format_benchmark_string(format_benchmark_way way, uintl *hash, char *buffer, arena *arena, const char *format, ...)
+{
+	va_list vargs;
+	va_start(vargs, format);
+	const char *string = buffer;
+	uint        length;
+	switch (way)
+	{
+	case FORMAT_BENCHMARK_WAY_VSNPRINTF: length = vsnprintf(buffer, FORMAT_BENCHMARK_BUFFER_CAPACITY, format, vargs);       break;
+	case FORMAT_BENCHMARK_WAY_FORMAT:    length = format_string_v(buffer, FORMAT_BENCHMARK_BUFFER_CAPACITY, format, vargs); break;
+	case FORMAT_BENCHMARK_WAY_CACHE:     string = push_formatted_string_v(&length, arena, format, vargs);                   break;
+	default: unreachable();
+	}
+	va_end(vargs);
+	if (hash) *hash = hash_format_bytes(string, length, *hash);
+	return length;
+}
+
+/* what an editor formats every frame: a status bar whose cursor moves every
+   few frames, and the numbers of the visible lines, which scroll */
+typedef enum
+{
+	FORMAT_BENCHMARK_WORKLOAD_STATUS_BAR,
+	FORMAT_BENCHMARK_WORKLOAD_LINE_NUMBERS,
+	FORMAT_BENCHMARK_WORKLOADS_COUNT,
+} format_benchmark_workload;
+
+static const char *format_benchmark_workload_representations[FORMAT_BENCHMARK_WORKLOADS_COUNT] =
+{
+	[FORMAT_BENCHMARK_WORKLOAD_STATUS_BAR]   = "status bar",
+	[FORMAT_BENCHMARK_WORKLOAD_LINE_NUMBERS] = "line numbers",
+};
+
+static const uint format_benchmark_workload_strings_counts[FORMAT_BENCHMARK_WORKLOADS_COUNT] =
+{
+	[FORMAT_BENCHMARK_WORKLOAD_STATUS_BAR]   = 1,
+	[FORMAT_BENCHMARK_WORKLOAD_LINE_NUMBERS] = FORMAT_BENCHMARK_LINES_COUNT,
+};
+
+static void format_benchmark_frame(format_benchmark_workload workload, format_benchmark_way way, uint frame, uintl *hash, char *buffer, arena *arena)
+{
+	if (workload == FORMAT_BENCHMARK_WORKLOAD_STATUS_BAR)
+	{
+		uint  line        = 1 + frame / 64;
+		uint  column      = 1 + frame / 8 % 80;
+		uintl lines_count = 100000 + frame / 256;
+		format_benchmark_string(
+			way, hash, buffer, arena, "%s  %u:%u  %s  %llu lines%s",
+			"code/text_format.c", line, column, "c", (unsigned long long)lines_count, frame / 128 % 2 ? " (modified)" : "");
+	}
+	else
+	{
+		uint top_line = frame / 4 % 100000;
+		for (uint i = 0; i < FORMAT_BENCHMARK_LINES_COUNT; ++i) format_benchmark_string(way, hash, buffer, arena, "%*u", 6, top_line + i + 1);
+	}
+}
+
+void benchmark_format(void)
+{
+	char  buffer[FORMAT_BENCHMARK_BUFFER_CAPACITY];
+	arena arena;
+	initialize_arena(FORMAT_BENCHMARK_BUFFER_CAPACITY * (FORMAT_BENCHMARK_LINES_COUNT + 1), ALLOCATION_TAG_FRAME, &arena);
+
+	for (uint workload = 0; workload < FORMAT_BENCHMARK_WORKLOADS_COUNT; ++workload)
+	{
+		float64 strings_count = (float64)FORMAT_BENCHMARK_FRAMES_COUNT * format_benchmark_workload_strings_counts[workload];
+		float64 times[FORMAT_BENCHMARK_WAYS_COUNT];
+		zero(&format_cache, sizeof(format_cache));
+		for (uint way = 0; way < FORMAT_BENCHMARK_WAYS_COUNT; ++way)
+		{
+			uintl beginning_time = get_time();
+			for (uint frame = 0; frame < FORMAT_BENCHMARK_FRAMES_COUNT; ++frame)
+			{
+				reset_arena(&arena);
+				format_benchmark_frame(workload, way, frame, 0, buffer, &arena);
+			}
+			times[way] = (float64)(get_time() - beginning_time) / strings_count;
+		}
+		report_comment(
+			"%s: %.1f ns a string with vsnprintf, %.1f with format_string_v, %.1f with push_formatted_string_v, whose cache hit %llu times and missed %llu\n",
+			format_benchmark_workload_representations[workload],
+			times[FORMAT_BENCHMARK_WAY_VSNPRINTF], times[FORMAT_BENCHMARK_WAY_FORMAT], times[FORMAT_BENCHMARK_WAY_CACHE],
+			(unsigned long long)format_cache.hits_count, (unsigned long long)format_cache.misses_count);
+
+		/* every way makes the same strings, the cache from a warm start too */
+		uintl hashes[FORMAT_BENCHMARK_WAYS_COUNT];
+		for (uint way = 0; way < FORMAT_BENCHMARK_WAYS_COUNT; ++way)
+		{
+			hashes[way] = 0xcbf29ce484222325;
+			for (uint frame = 0; frame < FORMAT_BENCHMARK_FRAMES_COUNT; ++frame)
+			{
+				reset_arena(&arena);
+				format_benchmark_frame(workload, way, frame, &hashes[way], buffer, &arena);
+			}
+			assert(hashes[way] == hashes[0]);
+		}
+	}
+
+	terminate_arena(&arena);
+}
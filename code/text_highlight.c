@@ -0,0 +1,755 @@
+/*
+
+highlighting keeps, for every line, the state of the lexer where it begins:
+what the line is lexed from when it is drawn, and what tells how far an edit
+reaches. an edit forgets the states of the lines that it touched; from the
+first of them, lines are lexed again until the state at the end of one agrees
+with the state that was kept for the next, since nothing that the edit did can
+reach past it. typing in a line of code so lexes a line or two again, while
+opening a comment at the top of a file lexes the visible lines at once and
+leaves the rest to a job, which the next edit cancels.
+
+the lexers are made from the grammars in `code/lexers` when the editor is
+built, and a line's state is the mode that it begins in, which grammars keep
+to the few that a line can end in: in a comment that goes on, a string that a
+backslash continues, and so on.
+
+the brackets outside comments and strings are kept in a tree that edits move
+without finding them again. the lines whose text or state changed are noted,
+and once the job has lexed every line, it lexes those again with their tokens
+to find their brackets. matching a bracket or finding a fold goes down the
+tree, however far the other bracket is.
+
+*/
+
+/* the lexer for the extension of `path`, or the first lexer */
+const text_lexer *find_text_lexer(const char *path)
+{
+	const char *extension = 0;
+	for (const char *character = path; *character; ++character)
+	{
+		if (*character == '.') extension = character;
+		else if (*character == '/' || *character == '\\') extension = 0;
+	}
+	if (!extension) return &text_lexers[0];
+
+	uint extension_size = strlen(extension);
+	for (uint i = 0; i < TEXT_LEXERS_COUNT; ++i)
+	{
+		for (const char *candidate = text_lexers[i].extensions; *candidate;)
+		{
+			uint candidate_size = 0;
+			while (candidate[candidate_size] && candidate[candidate_size] != ' ') ++candidate_size;
+			if (candidate_size == extension_size && !compare(candidate, extension, extension_size)) return &text_lexers[i];
+			candidate += candidate_size;
+			while (*candidate == ' ') ++candidate;
+		}
+	}
+	return &text_lexers[0];
+}
+
+/* the longest token from `begin`, which is a byte on its own if no rule
+   matches it, and its rule after 1 */
+static uint lex_text_token(uint8 state, const byte *data, uint begin, uint size, uint *rule, const text_lexer *lexer)
+{
+	uint row = lexer->mode_starts[state];
+	uint end = begin + 1;
+	*rule = 0;
+	for (uint i = begin; i < size; ++i)
+	{
+		row = lexer->transitions[row + lexer->classes[data[i]]];
+		if (!row || row & TEXT_LEXER_TOKEN_END) break;
+		if (lexer->transitions[row])
+		{
+			*rule = lexer->transitions[row];
+			end   = i + 1;
+		}
+	}
+	return end;
+}
+
+/* lexes a part of a line from the mode `state`, giving the token of every byte
+   of it if `tokens`, and returns the mode after it.
+
+   the automaton goes from the end of a token into the next by itself, as long
+   as the token ends where the automaton can go no further. only where it must
+   go back to where a shorter token ended is the token found anew. without the
+   tokens, what ended last is kept without a branch, which would be mispredicted
+   at nearly every token.
+
+   a run of bytes that leads a state back to itself, as an identifier's, a
+   space's or a comment's do, is skipped without going through the rest: the
+   row stays the same, so the loads of the run do not wait on one another. */
+static uint8 lex_text(uint8 state, const byte *data, uint size, uint8 *tokens, const text_lexer *lexer)
+{
+	const uint8  *classes     = lexer->classes;
+	const uint16 *transitions = lexer->transitions;
+	uint          begin       = 0;  /* of the token being lexed */
+	while (begin < size)
+	{
+		uint row  = lexer->mode_starts[state];
+		uint rule = 0;  /* of the last token that ended */
+		if (tokens)
+		{
+			for (uint i = begin; i < size && row; ++i)
+			{
+				uint next = transitions[row + classes[data[i]]];
+				while (next == row && ++i < size) next = transitions[row + classes[data[i]]];
+				if (next & TEXT_LEXER_TOKEN_END)
+				{
+					rule = transitions[row];
+					fill(tokens + begin, i - begin, lexer->rule_tokens[rule - 1]);
+					begin = i;
+				}
+				row = next & ~TEXT_LEXER_TOKEN_END;
+			}
+		}
+		else
+		{
+			for (uint i = begin; i < size && row; ++i)
+			{
+				uint next  = transitions[row + classes[data[i]]];
+				while (next == row && ++i < size) next = transitions[row + classes[data[i]]];
+				bit  ended = next >> 15;
+				rule  = ended ? transitions[row] : rule;
+				begin = ended ? i : begin;
+				row   = next & ~TEXT_LEXER_TOKEN_END;
+			}
+		}
+		if (rule) state = lexer->rule_modes[rule - 1];
+
+		/* the last token reaches the end whole */
+		if (row && transitions[row])
+		{
+			rule = transitions[row];
+			if (tokens) fill(tokens + begin, size - begin, lexer->rule_tokens[rule - 1]);
+			return lexer->rule_modes[rule - 1];
+		}
+
+		uint end = lex_text_token(state, data, begin, size, &rule, lexer);
+		if (tokens) fill(tokens + begin, end - begin, rule ? lexer->rule_tokens[rule - 1] : TEXT_TOKEN_PLAIN);
+		if (rule) state = lexer->rule_modes[rule - 1];
+		begin = end;
+	}
+	return state;
+}
+
+/* lexes a line from `state`, with its line feed, and returns the state that
+   the next begins in, giving the tokens of as many of its bytes as `capacity`
+   if `tokens`. the pieces are walked from `piece` on, as the lines are usually
+   lexed in order. */
+static uint8 lex_text_line(uint8 state, uint line, uint8 *tokens, uint capacity, byte *scratch, uint *piece, const text_highlighter *highlighter)
+{
+	const text_buffer *buffer = highlighter->buffer;
+	uintl              begin  = highlighter->line_offsets[line];
+	uintl              end    = line + 1 < highlighter->lines_count ? highlighter->line_offsets[line + 1] : buffer->size;
+	if (*piece >= buffer->pieces_count || buffer->pieces[*piece].offset > begin) *piece = find_text_piece(begin, buffer);
+
+	for (uintl offset = begin; offset < end;)
+	{
+		while (buffer->pieces[*piece].offset + buffer->pieces[*piece].size <= offset) *piece += 1;
+
+		/* a line that is cut between pieces is read whole, or in parts if it is long */
+		const text_piece *part_piece = &buffer->pieces[*piece];
+		const byte       *data;
+		uint              size;
+		if (end <= part_piece->offset + part_piece->size && end - offset <= UINT_MAXIMUM / 2)
+		{
+			data = get_text_piece_data(part_piece, buffer) + (offset - part_piece->offset);
+			size = end - offset;
+		}
+		else
+		{
+			size = end - offset < TEXT_HIGHLIGHT_LINE_CAPACITY ? end - offset : TEXT_HIGHLIGHT_LINE_CAPACITY;
+			read_text(offset, size, scratch, buffer);
+			data = scratch;
+		}
+
+		uint done_size  = offset - begin;
+		uint given_size = !tokens || done_size >= capacity ? 0 : capacity - done_size < size ? capacity - done_size : size;
+		if (given_size) state = lex_text(state, data, given_size, tokens + done_size, highlighter->lexer);
+		if (given_size < size) state = lex_text(state, data + given_size, size - given_size, 0, highlighter->lexer);
+		offset += size;
+	}
+	return state;
+}
+
+/* notes that the brackets from line `begin` to `end` are to be found again */
+static void dirty_text_brackets(uint begin, uint end, text_highlighter *highlighter)
+{
+	if (highlighter->brackets_dirty_begin >= highlighter->brackets_dirty_end)
+	{
+		highlighter->brackets_dirty_begin = begin;
+		highlighter->brackets_dirty_end   = end;
+		return;
+	}
+	if (begin < highlighter->brackets_dirty_begin) highlighter->brackets_dirty_begin = begin;
+	if (end > highlighter->brackets_dirty_end) highlighter->brackets_dirty_end = end;
+}
+
+/* lexes the lines from the first whose state is not known, until the state
+   of `end` is known, and returns how many are known then */
+static uint lex_text_lines(uint known_count, uint end, byte *scratch, text_highlighter *highlighter)
+{
+	uint piece = 0;
+	if (end > highlighter->lines_count) end = highlighter->lines_count;
+	while (known_count < end)
+	{
+		uint8 state = lex_text_line(highlighter->states[known_count - 1], known_count - 1, 0, 0, scratch, &piece, highlighter);
+		if (state != highlighter->states[known_count])
+		{
+			dirty_text_brackets(known_count, known_count + 1, highlighter);
+			highlighter->states[known_count++] = state;
+			continue;
+		}
+
+		/* the kept states agree from here on, up to one that is not known */
+		const uint8 *unknown = memchr(highlighter->states + known_count, TEXT_LEXER_UNKNOWN, highlighter->lines_count - known_count);
+		known_count = unknown ? unknown - highlighter->states : highlighter->lines_count;
+	}
+	return known_count;
+}
+
+/* the offsets of the lines that begin after the line feeds from `begin` to
+   `end`, or only how many there are without `offsets` */
+static uint find_text_line_offsets(uintl begin, uintl end, uintl *offsets, const text_buffer *buffer)
+{
+	uint count = 0;
+	for (uint i = find_text_piece(begin, buffer); i < buffer->pieces_count && buffer->pieces[i].offset < end; ++i)
+	{
+		const text_piece *piece      = &buffer->pieces[i];
+		uintl             data_begin = begin > piece->offset ? begin - piece->offset : 0;
+		uintl             data_end   = end < piece->offset + piece->size ? end - piece->offset : piece->size;
+		const byte       *data       = get_text_piece_data(piece, buffer);
+		for (const byte *feed = data + data_begin; (feed = memchr(feed, '\n', data + data_end - feed)); ++feed)
+		{
+			if (offsets) offsets[count] = piece->offset + (feed - data) + 1;
+			count += 1;
+		}
+	}
+	return count;
+}
+
+static void reserve_text_lines(uint count, text_highlighter *highlighter)
+{
+	if (count <= highlighter->lines_capacity) return;
+
+	uint capacity = highlighter->lines_capacity ? highlighter->lines_capacity : 4096;
+	while (capacity < count) capacity *= 2;
+	uintl *line_offsets = allocate(capacity * sizeof(uintl), ALLOCATION_TAG_HIGHLIGHT);
+	uint8 *states       = allocate(capacity, ALLOCATION_TAG_HIGHLIGHT);
+	if (highlighter->line_offsets)
+	{
+		copy(line_offsets, highlighter->line_offsets, highlighter->lines_count * sizeof(uintl));
+		copy(states, highlighter->states, highlighter->lines_count);
+		deallocate(highlighter->line_offsets, highlighter->lines_capacity * sizeof(uintl), ALLOCATION_TAG_HIGHLIGHT);
+		deallocate(highlighter->states, highlighter->lines_capacity, ALLOCATION_TAG_HIGHLIGHT);
+	}
+	highlighter->line_offsets   = line_offsets;
+	highlighter->states         = states;
+	highlighter->lines_capacity = capacity;
+}
+
+/* finds every line, none of whose states are known but the first's */
+static void find_text_lines(text_highlighter *highlighter)
+{
+	const text_buffer *buffer      = highlighter->buffer;
+	uint               lines_count = find_text_line_offsets(0, buffer->size, 0, buffer) + 1;
+	reserve_text_lines(lines_count, highlighter);
+	highlighter->line_offsets[0] = 0;
+	find_text_line_offsets(0, buffer->size, highlighter->line_offsets + 1, buffer);
+	highlighter->states[0] = 0;
+	fill(highlighter->states + 1, lines_count - 1, TEXT_LEXER_UNKNOWN);
+	highlighter->lines_count = lines_count;
+	atomic_store(&highlighter->known_count, 1);
+	clear_text_brackets(&highlighter->brackets);
+	highlighter->brackets_dirty_begin = 0;
+	highlighter->brackets_dirty_end   = lines_count;
+}
+
+/* moves the lines to where the edits since they were last caught up left them */
+static void catch_up_text_lines(text_highlighter *highlighter)
+{
+	const text_buffer *buffer = highlighter->buffer;
+	text_change        change;
+	bit                changes_known = get_text_changes(highlighter->edits_count, &change, buffer);
+	highlighter->edits_count = buffer->edits_count;
+	if (!changes_known)
+	{
+		find_text_lines(highlighter);
+		return;
+	}
+	if (!change.removed_size && !change.inserted_size) return;
+
+	/* the lines that began in what was removed go, and those that begin in what
+	   was inserted come in their place; the ones after only move */
+	uint  first          = find_text_line(change.offset, highlighter);
+	uint  end            = find_text_line(change.offset + change.removed_size, highlighter) + 1;
+	uint  inserted_count = find_text_line_offsets(change.offset, change.offset + change.inserted_size, 0, buffer);
+	uint  kept_count     = highlighter->lines_count - end;
+	uint  lines_count    = first + 1 + inserted_count + kept_count;
+	sintl delta          = (sintl)change.inserted_size - (sintl)change.removed_size;
+	reserve_text_lines(lines_count, highlighter);
+	move(highlighter->line_offsets + first + 1 + inserted_count, highlighter->line_offsets + end, kept_count * sizeof(uintl));
+	move(highlighter->states + first + 1 + inserted_count, highlighter->states + end, kept_count);
+	for (uint i = first + 1 + inserted_count; i < lines_count; ++i) highlighter->line_offsets[i] += delta;
+	find_text_line_offsets(change.offset, change.offset + change.inserted_size, highlighter->line_offsets + first + 1, buffer);
+	highlighter->lines_count = lines_count;
+
+	/* the brackets that were removed go, and the lines that were edited are to be lexed for those that were inserted */
+	replace_text_brackets(change.offset, change.offset + change.removed_size, delta, 0, 0, &highlighter->brackets);
+	uint edited_end = first + 1 + inserted_count;
+	if (highlighter->brackets_dirty_begin < highlighter->brackets_dirty_end)
+	{
+		uint dirty_end = highlighter->brackets_dirty_end;
+		if (highlighter->brackets_dirty_begin > first) highlighter->brackets_dirty_begin = first;
+		highlighter->brackets_dirty_end = dirty_end <= first + 1 ? dirty_end : dirty_end >= end ? dirty_end + edited_end - end : edited_end;
+	}
+	dirty_text_brackets(first, edited_end, highlighter);
+
+	/* the edited lines are not known, nor is the line after them, which they end */
+	uint unknown_end = first + 2 + inserted_count < lines_count ? first + 2 + inserted_count : lines_count;
+	fill(highlighter->states + first + 1, unknown_end - first - 1, TEXT_LEXER_UNKNOWN);
+	if (atomic_load(&highlighter->known_count) > first + 1) atomic_store(&highlighter->known_count, first + 1);
+}
+
+static void reserve_found_text_brackets(uint count, text_highlighter *highlighter)
+{
+	if (count <= highlighter->found_brackets_capacity) return;
+
+	uint capacity = highlighter->found_brackets_capacity ? highlighter->found_brackets_capacity : 4096;
+	while (capacity < count) capacity *= 2;
+	text_bracket *found_brackets = allocate(capacity * sizeof(text_bracket), ALLOCATION_TAG_HIGHLIGHT);
+	if (highlighter->found_brackets)
+	{
+		copy(found_brackets, highlighter->found_brackets, highlighter->found_brackets_capacity * sizeof(text_bracket));
+		deallocate(highlighter->found_brackets, highlighter->found_brackets_capacity * sizeof(text_bracket), ALLOCATION_TAG_HIGHLIGHT);
+	}
+	highlighter->found_brackets          = found_brackets;
+	highlighter->found_brackets_capacity = capacity;
+}
+
+/* lexes the lines from `first` to `end` again with their tokens, which every
+   state must be known for, and puts their brackets in place of those that
+   were kept for them. the lines are lexed in parts that their tokens fit in,
+   and only those that are cut between pieces are read. */
+static void find_text_brackets(uint first, uint end, text_highlighter *highlighter)
+{
+	const text_buffer *buffer      = highlighter->buffer;
+	uintl              begin       = highlighter->line_offsets[first];
+	uintl              lines_end   = end < highlighter->lines_count ? highlighter->line_offsets[end] : buffer->size;
+	uint               piece       = find_text_piece(begin, buffer);
+	uint               found_count = 0;
+	for (uint line = first; line < end; ++line)
+	{
+		uint8 state    = highlighter->states[line];
+		uintl line_end = line + 1 < highlighter->lines_count ? highlighter->line_offsets[line + 1] : buffer->size;
+		for (uintl offset = highlighter->line_offsets[line]; offset < line_end;)
+		{
+			while (buffer->pieces[piece].offset + buffer->pieces[piece].size <= offset) piece += 1;
+
+			const text_piece *part_piece = &buffer->pieces[piece];
+			uint              size       = line_end - offset < TEXT_HIGHLIGHT_LINE_CAPACITY ? line_end - offset : TEXT_HIGHLIGHT_LINE_CAPACITY;
+			const byte       *data       = highlighter->job_line;
+			if (offset + size <= part_piece->offset + part_piece->size) data = get_text_piece_data(part_piece, buffer) + (offset - part_piece->offset);
+			else read_text(offset, size, highlighter->job_line, buffer);
+			state = lex_text(state, data, size, highlighter->job_tokens, highlighter->lexer);
+
+			/* every byte is written as if it were a bracket, and only counted if it is one */
+			reserve_found_text_brackets(found_count + size, highlighter);
+			text_bracket *found = highlighter->found_brackets;
+			for (uint i = 0; i < size; ++i)
+			{
+				found[found_count]  = (text_bracket){ offset + i, data[i] };
+				found_count        += text_bracket_characters[data[i]] & (highlighter->job_tokens[i] == TEXT_TOKEN_PUNCTUATION);
+			}
+			offset += size;
+		}
+	}
+	replace_text_brackets(begin, lines_end, 0, highlighter->found_brackets, found_count, &highlighter->brackets);
+}
+
+static void highlight_text_in_job(void *parameter)
+{
+	text_highlighter *highlighter = parameter;
+	uint              known_count = atomic_load_explicit(&highlighter->known_count, memory_order_relaxed);
+	while (known_count < highlighter->lines_count && !atomic_load_explicit(&highlighter->cancelled, memory_order_relaxed))
+	{
+		known_count = lex_text_lines(known_count, known_count + TEXT_HIGHLIGHT_STEP_LINES, highlighter->job_line, highlighter);
+		atomic_store_explicit(&highlighter->known_count, known_count, memory_order_release);
+	}
+
+	/* the kept state where it stopped may not follow from the line before */
+	if (known_count < highlighter->lines_count) highlighter->states[known_count] = TEXT_LEXER_UNKNOWN;
+
+	while (known_count == highlighter->lines_count && highlighter->brackets_dirty_begin < highlighter->brackets_dirty_end && !atomic_load_explicit(&highlighter->cancelled, memory_order_relaxed))
+	{
+		uint first = highlighter->brackets_dirty_begin;
+		uint end   = highlighter->brackets_dirty_end - first > TEXT_HIGHLIGHT_STEP_LINES ? first + TEXT_HIGHLIGHT_STEP_LINES : highlighter->brackets_dirty_end;
+		find_text_brackets(first, end, highlighter);
+		highlighter->brackets_dirty_begin = end;
+	}
+	atomic_store_explicit(&highlighter->done, 1, memory_order_release);
+	wake_main_thread();
+}
+
+static void finish_text_highlighting_job(text_highlighter *highlighter)
+{
+	wait_for_jobs(&highlighter->jobs);
+	highlighter->buffer->readers_count -= 1;
+	highlighter->running                = 0;
+}
+
+/* returns the line that holds `offset` */
+uint find_text_line(uintl offset, const text_highlighter *highlighter)
+{
+	uint low  = 1;
+	uint high = highlighter->lines_count;
+	while (low < high)
+	{
+		uint middle = low + (high - low) / 2;
+		if (highlighter->line_offsets[middle] <= offset) low = middle + 1;
+		else high = middle;
+	}
+	return low - 1;
+}
+
+void begin_text_highlighting(const text_lexer *lexer, text_buffer *buffer, text_highlighter *highlighter)
+{
+	zero(highlighter, sizeof(*highlighter));
+	highlighter->buffer      = buffer;
+	highlighter->lexer       = lexer;
+	highlighter->edits_count = buffer->edits_count;
+	highlighter->line        = allocate(TEXT_HIGHLIGHT_LINE_CAPACITY, ALLOCATION_TAG_HIGHLIGHT);
+	highlighter->job_line    = allocate(TEXT_HIGHLIGHT_LINE_CAPACITY, ALLOCATION_TAG_HIGHLIGHT);
+	highlighter->job_tokens  = allocate(TEXT_HIGHLIGHT_LINE_CAPACITY, ALLOCATION_TAG_HIGHLIGHT);
+	find_text_lines(highlighter);
+}
+
+/* catches up with the edits and lexes the lines before `visible_end` at once,
+   and the rest by a job, which then finds the brackets. returns whether the
+   job still runs. */
+bit update_text_highlighting(uint visible_end, text_highlighter *highlighter)
+{
+	if (highlighter->edits_count != highlighter->buffer->edits_count) catch_up_text_lines(highlighter);
+	if (visible_end > highlighter->lines_count) visible_end = highlighter->lines_count;
+
+	if (highlighter->running)
+	{
+		if (atomic_load_explicit(&highlighter->done, memory_order_acquire)) finish_text_highlighting_job(highlighter);
+		else if (atomic_load_explicit(&highlighter->known_count, memory_order_acquire) >= visible_end) return 1;
+		else cancel_text_highlighting(highlighter);
+	}
+
+	uint known_count = atomic_load(&highlighter->known_count);
+	if (known_count < visible_end)
+	{
+		known_count = lex_text_lines(known_count, visible_end, highlighter->line, highlighter);
+		if (known_count < highlighter->lines_count) highlighter->states[known_count] = TEXT_LEXER_UNKNOWN;
+		atomic_store(&highlighter->known_count, known_count);
+	}
+	if (known_count < highlighter->lines_count || highlighter->brackets_dirty_begin < highlighter->brackets_dirty_end)
+	{
+		atomic_store(&highlighter->cancelled, 0);
+		atomic_store(&highlighter->done, 0);
+		highlighter->running                 = 1;
+		highlighter->buffer->readers_count += 1;
+		push_job(highlight_text_in_job, highlighter, &highlighter->jobs);
+	}
+	return highlighter->running;
+}
+
+/* stops the job, which looks at the cancellation between steps, and keeps what it lexed */
+void cancel_text_highlighting(text_highlighter *highlighter)
+{
+	if (!highlighter->running) return;
+	atomic_store(&highlighter->cancelled, 1);
+	finish_text_highlighting_job(highlighter);
+}
+
+void end_text_highlighting(text_highlighter *highlighter)
+{
+	cancel_text_highlighting(highlighter);
+	if (highlighter->line_offsets)
+	{
+		deallocate(highlighter->line_offsets, highlighter->lines_capacity * sizeof(uintl), ALLOCATION_TAG_HIGHLIGHT);
+		deallocate(highlighter->states, highlighter->lines_capacity, ALLOCATION_TAG_HIGHLIGHT);
+	}
+	deallocate(highlighter->line, TEXT_HIGHLIGHT_LINE_CAPACITY, ALLOCATION_TAG_HIGHLIGHT);
+	deallocate(highlighter->job_line, TEXT_HIGHLIGHT_LINE_CAPACITY, ALLOCATION_TAG_HIGHLIGHT);
+	deallocate(highlighter->job_tokens, TEXT_HIGHLIGHT_LINE_CAPACITY, ALLOCATION_TAG_HIGHLIGHT);
+	if (highlighter->found_brackets) deallocate(highlighter->found_brackets, highlighter->found_brackets_capacity * sizeof(text_bracket), ALLOCATION_TAG_HIGHLIGHT);
+	terminate_text_brackets(&highlighter->brackets);
+	zero(highlighter, sizeof(*highlighter));
+}
+
+/* gives the tokens of a line whose state is known, as many as `capacity`, and
+   returns how many it gave */
+uint highlight_text_line(uint line, uint8 *tokens, uint capacity, text_highlighter *highlighter)
+{
+	assert(line < atomic_load_explicit(&highlighter->known_count, memory_order_acquire));
+	uint  piece = highlighter->buffer->pieces_count;
+	uintl end   = line + 1 < highlighter->lines_count ? highlighter->line_offsets[line + 1] - 1 : highlighter->buffer->size;
+	uintl size  = end - highlighter->line_offsets[line];
+	lex_text_line(highlighter->states[line], line, tokens, capacity, highlighter->line, &piece, highlighter);
+	return size < capacity ? size : capacity;
+}
+
+/* whether the brackets are right, which they are once the job that finds them
+   is done, until the next edit */
+bit are_text_brackets_known(const text_highlighter *highlighter)
+{
+	return !highlighter->running && highlighter->brackets_dirty_begin >= highlighter->brackets_dirty_end;
+}
+
+/* finds the bracket that pairs with the one at `offset`, if the brackets are known */
+bit match_text_bracket(uintl offset, uintl *match, const text_highlighter *highlighter)
+{
+	return are_text_brackets_known(highlighter) && find_matching_text_bracket(offset, match, &highlighter->brackets);
+}
+
+/* the last line of the fold that begins at `line`, which the first bracket of
+   the line that is closed on a later line opens, or `line` if there is none */
+uint find_text_fold(uint line, const text_highlighter *highlighter)
+{
+	if (!are_text_brackets_known(highlighter)) return line;
+
+	uintl        end = line + 1 < highlighter->lines_count ? highlighter->line_offsets[line + 1] : highlighter->buffer->size;
+	text_bracket list[TEXT_FOLD_BRACKETS_CAPACITY];
+	uint         count = get_text_brackets(highlighter->line_offsets[line], end, list, TEXT_FOLD_BRACKETS_CAPACITY, &highlighter->brackets);
+	for (uint i = 0; i < count; ++i)
+	{
+		uintl match;
+		if (get_text_bracket_depth(list[i].bracket) < 0 || !find_matching_text_bracket(list[i].offset, &match, &highlighter->brackets)) continue;
+		if (match >= end) return find_text_line(match, highlighter);
+	}
+	return line;
+}
+
+/* lexes the text anew, and checks that the lines and brackets that the
+   highlighter caught up with agree with it */
+static void check_text_highlighting(const text_lexer *lexer, text_highlighter *highlighter)
+{
+	while (update_text_highlighting(highlighter->lines_count, highlighter)) thrd_yield();
+	text_highlighter fresh;
+	begin_text_highlighting(lexer, highlighter->buffer, &fresh);
+	while (update_text_highlighting(fresh.lines_count, &fresh)) thrd_yield();
+	assert(fresh.lines_count == highlighter->lines_count);
+	assert(!compare(fresh.line_offsets, highlighter->line_offsets, fresh.lines_count * sizeof(uintl)));
+	assert(!compare(fresh.states, highlighter->states, fresh.lines_count));
+
+	text_bracket list[TEXT_FOLD_BRACKETS_CAPACITY];
+	text_bracket fresh_list[TEXT_FOLD_BRACKETS_CAPACITY];
+	for (uintl offset = 0;;)
+	{
+		uint count = get_text_brackets(offset, highlighter->buffer->size, list, TEXT_FOLD_BRACKETS_CAPACITY, &highlighter->brackets);
+		assert(get_text_brackets(offset, highlighter->buffer->size, fresh_list, TEXT_FOLD_BRACKETS_CAPACITY, &fresh.brackets) == count);
+		for (uint i = 0; i < count; ++i) assert(list[i].offset == fresh_list[i].offset && list[i].bracket == fresh_list[i].bracket);
+		if (count < TEXT_FOLD_BRACKETS_CAPACITY) break;
+		offset = list[count - 1].offset + 1;
+	}
+	end_text_highlighting(&fresh);
+}
+
+/* how long the whole file takes to lex, then how long typing at its top takes
+   until the visible lines are right and until every line is, against lexing
+   it all again */
+void benchmark_text_highlighting(const char *path)
+{
+	const uint visible_end = 64;
+
+	text_buffer buffer;
+	open_text_buffer(path, &buffer);
+
+	const text_lexer *lexer = find_text_lexer(path);
+	text_highlighter  highlighter;
+	uintl             beginning_time = get_time();
+	begin_text_highlighting(lexer, &buffer, &highlighter);
+	float64 lines_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+	float64 whole_time = 0;
+	while (update_text_highlighting(visible_end, &highlighter))
+	{
+		if (!whole_time && atomic_load(&highlighter.known_count) == highlighter.lines_count) whole_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+		thrd_yield();
+	}
+	float64 brackets_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+	if (!whole_time) whole_time = brackets_time;
+	report_comment(
+		"%u lines in %llu bytes, by the %s lexer: found in %.3f ms, lexed in %.3f ms (%.1f MB/s), with their brackets in %.3f ms\n",
+		highlighter.lines_count, buffer.size, lexer->name, lines_time * 1000, whole_time * 1000, buffer.size / (whole_time - lines_time) / 1e6, brackets_time * 1000);
+
+	/* types into a line near the top, then opens a comment above it and closes it again */
+	struct
+	{
+		const char *name;
+		const char *text;
+		bit         erasing;
+	} edits[] =
+	{
+		{ "typing a statement", "int x = 0;", 0 },
+		{ "opening a comment",  "/*",         0 },
+		{ "closing it",         "/*",         1 },
+	};
+	uint line = highlighter.lines_count > 10 ? 10 : highlighter.lines_count - 1;
+	for (uint i = 0; i < sizeof(edits) / sizeof(edits[0]); ++i)
+	{
+		uint    size         = strlen(edits[i].text);
+		uint    edits_count  = edits[i].erasing ? 1 : size;
+		float64 visible_time = 0;
+		float64 all_time     = 0;
+		for (uint j = 0; j < edits_count; ++j)
+		{
+			cancel_text_highlighting(&highlighter);
+			uintl offset = highlighter.line_offsets[line];
+			if (edits[i].erasing) delete_text(offset, size, &buffer);
+			else insert_text(offset + j, (const byte *)edits[i].text + j, 1, &buffer);
+
+			beginning_time = get_time();
+			update_text_highlighting(visible_end, &highlighter);
+			visible_time += (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+			while (update_text_highlighting(visible_end, &highlighter)) thrd_yield();
+			all_time += (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+		}
+		report_comment(
+			"%s: %.3f ms until the visible lines are lexed, %.3f ms until all are, per edit\n",
+			edits[i].name, visible_time * 1000 / edits_count, all_time * 1000 / edits_count);
+	}
+
+	/* bursts of edits around the line that overlap, each caught up with at
+	   once, as when typing outruns the frames; the last burst is more edits
+	   than the buffer keeps the changes of */
+	const char *burst_texts[]  = { "\n", "/*", "*/", "\"", "x", "{", "}" };
+	const uint  bursts_count   = 16;
+	uint32      random         = 0x9e3779b9;
+	uint        burst_edits    = 0;
+	float64     burst_time     = 0;
+	for (uint i = 0; i < bursts_count; ++i)
+	{
+		if (line >= highlighter.lines_count) line = highlighter.lines_count - 1;
+		cancel_text_highlighting(&highlighter);
+		uintl place      = highlighter.line_offsets[line];
+		uint  burst_size = i + 1 < bursts_count ? 2 + next_text_benchmark_random(&random) % 14 : TEXT_CHANGES_CAPACITY + 16;
+		for (uint j = 0; j < burst_size; ++j)
+		{
+			uintl offset = place + next_text_benchmark_random(&random) % 16;
+			if (offset > buffer.size) offset = buffer.size;
+			if (offset < buffer.size && next_text_benchmark_random(&random) % 3 == 0)
+			{
+				uintl size = 1 + next_text_benchmark_random(&random) % 8;
+				delete_text(offset, size < buffer.size - offset ? size : buffer.size - offset, &buffer);
+			}
+			else
+			{
+				const char *text = burst_texts[next_text_benchmark_random(&random) % (sizeof(burst_texts) / sizeof(burst_texts[0]))];
+				insert_text(offset, (const byte *)text, strlen(text), &buffer);
+			}
+		}
+		burst_edits += burst_size;
+
+		beginning_time = get_time();
+		while (update_text_highlighting(visible_end, &highlighter)) thrd_yield();
+		burst_time += (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+		check_text_highlighting(lexer, &highlighter);
+	}
+	if (line >= highlighter.lines_count) line = highlighter.lines_count - 1;
+	report_comment(
+		"%u bursts of %u edits in all: %.3f ms until all lines are lexed, per burst; each agrees with lexing it all again\n",
+		bursts_count, burst_edits, burst_time * 1000 / bursts_count);
+
+	/* what was lexed again agrees with lexing it all anew */
+	text_highlighter fresh;
+	beginning_time = get_time();
+	begin_text_highlighting(lexer, &buffer, &fresh);
+	while (update_text_highlighting(visible_end, &fresh)) thrd_yield();
+	float64 fresh_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+	assert(fresh.lines_count == highlighter.lines_count);
+	assert(!compare(fresh.line_offsets, highlighter.line_offsets, fresh.lines_count * sizeof(uintl)));
+	assert(!compare(fresh.states, highlighter.states, fresh.lines_count));
+	report_comment("lexing it all again, with its brackets: %.3f ms\n", fresh_time * 1000);
+
+	/* and so do the brackets that were moved and found again; those of the
+	   first lines are then matched, and their folds found */
+	text_bracket list[TEXT_FOLD_BRACKETS_CAPACITY];
+	text_bracket fresh_list[TEXT_FOLD_BRACKETS_CAPACITY];
+	uint         brackets_count = 0;
+	uint         matched_count  = 0;
+	uint         matches_count  = 0;
+	float64      match_time     = 0;
+	for (uintl offset = 0;;)
+	{
+		uint count = get_text_brackets(offset, buffer.size, list, TEXT_FOLD_BRACKETS_CAPACITY, &highlighter.brackets);
+		assert(get_text_brackets(offset, buffer.size, fresh_list, TEXT_FOLD_BRACKETS_CAPACITY, &fresh.brackets) == count);
+		for (uint i = 0; i < count; ++i) assert(list[i].offset == fresh_list[i].offset && list[i].bracket == fresh_list[i].bracket);
+		if (matched_count < (64 << 10))
+		{
+			beginning_time = get_time();
+			for (uint i = 0; i < count; ++i)
+			{
+				uintl match;
+				matches_count += match_text_bracket(list[i].offset, &match, &highlighter);
+			}
+			match_time    += (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+			matched_count += count;
+		}
+		brackets_count += count;
+		if (count < TEXT_FOLD_BRACKETS_CAPACITY) break;
+		offset = list[count - 1].offset + 1;
+	}
+	uint folds_count   = 0;
+	uint folded_count  = highlighter.lines_count < (64 << 10) ? highlighter.lines_count : 64 << 10;
+	beginning_time     = get_time();
+	for (uint i = 0; i < folded_count; ++i) folds_count += find_text_fold(i, &highlighter) != i;
+	float64 fold_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+	report_comment(
+		"%u brackets: %u of the first %u matched, %.3f us each; %u folds in the first %u lines, %.3f us a line\n",
+		brackets_count, matches_count, matched_count, match_time * 1e6 / (matched_count ? matched_count : 1), folds_count, folded_count, fold_time * 1e6 / folded_count);
+
+	uint8 tokens[256];
+	uint  tokens_count = highlight_text_line(line, tokens, sizeof(tokens), &highlighter);
+	report_comment("line %u has %u bytes highlighted, the first as %u\n", line, tokens_count, tokens_count ? tokens[0] : 0);
+
+	end_text_highlighting(&fresh);
+	end_text_highlighting(&highlighter);
+	close_text_buffer(&buffer);
+}
+
+/* how fast every lexer lexes the file at `path`, with and without giving the
+   tokens, in parts as long as the longest lines that are lexed whole */
+void benchmark_text_lexers(const char *path)
+{
+	const uint rounds_count = 4;
+
+	text_buffer buffer;
+	open_text_buffer(path, &buffer);
+	uint8 *tokens = allocate(TEXT_HIGHLIGHT_LINE_CAPACITY, ALLOCATION_TAG_HIGHLIGHT);
+
+	for (uint i = 0; i < TEXT_LEXERS_COUNT; ++i)
+	{
+		const text_lexer *lexer = &text_lexers[i];
+		float64           times[2];
+		uint8             states[2];
+		for (uint giving = 0; giving < 2; ++giving)
+		{
+			uintl beginning_time = get_time();
+			for (uint round = 0; round < rounds_count; ++round)
+			{
+				uint8 state = 0;
+				for (uintl offset = 0; offset < buffer.original_size; offset += TEXT_HIGHLIGHT_LINE_CAPACITY)
+				{
+					uint size = buffer.original_size - offset < TEXT_HIGHLIGHT_LINE_CAPACITY ? buffer.original_size - offset : TEXT_HIGHLIGHT_LINE_CAPACITY;
+					state = lex_text(state, buffer.original + offset, size, giving ? tokens : 0, lexer);
+				}
+				states[giving] = state;
+			}
+			times[giving] = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR / rounds_count;
+		}
+		assert(states[0] == states[1]);
+		report_comment(
+			"%s: %u states by %u byte classes (%u bytes of transitions): %.1f MB/s, %.1f MB/s giving the tokens\n",
+			lexer->name, lexer->states_count, lexer->classes_count, lexer->states_count * (lexer->classes_count + 1) * (uint)sizeof(uint16),
+			buffer.original_size / times[0] / 1e6, buffer.original_size / times[1] / 1e6);
+	}
+
+	deallocate(tokens, TEXT_HIGHLIGHT_LINE_CAPACITY, ALLOCATION_TAG_HIGHLIGHT);
+	close_text_buffer(&buffer);
+}
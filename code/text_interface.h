@@ -0,0 +1,21 @@
+#pragma once
+
+/* what a plugin is built against. the host loads the plugin, gives it memory
+   that outlives the plugin's code, and calls the functions that it exports;
+   everything else of the host is there to be called. */
+
+/* the host's declarations are imports to a plugin */
+#define PLUGIN
+#include "text.h"
+
+#if defined(ON_WIN32)
+	#define EXPORT __declspec(dllexport)
+#else
+	#define EXPORT __attribute__((visibility("default")))
+#endif
+
+/* called whenever the plugin is loaded; `reloaded` tells whether `memory` is
+   what an earlier copy of the plugin left, or zeros */
+EXPORT void initialize(interface *interface, void *memory, bit reloaded);
+EXPORT void tick(float32 elapse);
+EXPORT void terminate(void);
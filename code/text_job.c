@@ -0,0 +1,367 @@
+/*
+
+jobs are run by a thread for every processor, and by the main thread while it
+waits for them. a worker pushes the jobs that it
+makes to the bottom of its own deque and takes them back from there, so that
+what it works on stays in its caches; a worker that runs out steals from the
+top of another's deque, where the oldest and usually largest jobs are. a
+worker that finds nothing to steal spins for a while, then sleeps until a job
+is pushed.
+
+waiting for a group of jobs runs other jobs meanwhile, so that a job may push
+jobs of its own and wait for them without holding its worker up.
+
+*/
+
+#define JOB_SPINS_COUNT 64
+
+inline static bit push_job_to_deque(const job *job, job_deque *deque)
+{
+	sintl bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+	sintl top    = atomic_load_explicit(&deque->top, memory_order_acquire);
+	if (bottom - top >= JOB_DEQUE_CAPACITY) return 0;
+	deque->jobs[bottom & (JOB_DEQUE_CAPACITY - 1)] = *job;
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+	return 1;
+}
+
+inline static bit pop_job_from_deque(job *job, job_deque *deque)
+{
+	sintl bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+	atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	sintl top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+	if (top > bottom)
+	{
+		atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+		return 0;
+	}
+
+	*job = deque->jobs[bottom & (JOB_DEQUE_CAPACITY - 1)];
+	if (top < bottom) return 1;
+
+	/* the last job, which a thief may be taking as well */
+	bit taken = atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed);
+	atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+	return taken;
+}
+
+/* the job is copied before the exchange; if the slot was reused meanwhile,
+   the exchange fails and the copy is dropped */
+inline static bit steal_job_from_deque(job *job, job_deque *deque)
+{
+	sintl top = atomic_load_explicit(&deque->top, memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	sintl bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+	if (top >= bottom) return 0;
+
+	*job = deque->jobs[top & (JOB_DEQUE_CAPACITY - 1)];
+	return atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed);
+}
+
+inline static bit is_job_deque_empty(job_deque *deque)
+{
+	return atomic_load(&deque->top) >= atomic_load(&deque->bottom);
+}
+
+inline static uint32 get_job_random(job_worker *worker)
+{
+	/* xorshift */
+	uint32 random = worker->random;
+	random ^= random << 13;
+	random ^= random >> 17;
+	random ^= random << 5;
+	return worker->random = random;
+}
+
+static bit take_job(job *job, job_worker *worker)
+{
+	job_system *jobs = &global.jobs;
+	if (pop_job_from_deque(job, &worker->deque)) return 1;
+
+	uint first = get_job_random(worker) % jobs->workers_count;
+	for (uint i = 0; i < jobs->workers_count; ++i)
+	{
+		job_worker *victim = &jobs->workers[(first + i) % jobs->workers_count];
+		if (victim == worker) continue;
+		if (steal_job_from_deque(job, &victim->deque))
+		{
+			atomic_fetch_add_explicit(&worker->stolen_jobs_count, 1, memory_order_relaxed);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void run_job(const job *job, job_worker *worker)
+{
+	uint  mass           = worker->scratch.mass;
+	uintl beginning_time = worker->depth ? 0 : get_time();
+
+	worker->depth += 1;
+	job->function(job->parameter);
+	worker->depth -= 1;
+
+	worker->scratch.mass = mass;
+	if (job->counter) atomic_fetch_sub_explicit(&job->counter->count, 1, memory_order_release);
+
+	/* a job that runs while another waits is counted in the other's time */
+	if (!worker->depth) atomic_fetch_add_explicit(&worker->busy_time, get_time() - beginning_time, memory_order_relaxed);
+	atomic_fetch_add_explicit(&worker->jobs_count, 1, memory_order_relaxed);
+}
+
+static int work_on_jobs(void *parameter)
+{
+	job_system *jobs   = &global.jobs;
+	job_worker *worker = parameter;
+	context.job_worker = worker;
+
+	uint spins_count = 0;
+	while (!atomic_load_explicit(&jobs->terminating, memory_order_relaxed))
+	{
+		job job;
+		if (take_job(&job, worker))
+		{
+			run_job(&job, worker);
+			spins_count = 0;
+			continue;
+		}
+		if (++spins_count < JOB_SPINS_COUNT)
+		{
+			thrd_yield();
+			continue;
+		}
+		spins_count = 0;
+
+		/* the count is raised before the deques are looked at, and `push_job`
+		   looks at the count after it pushes, so one of the two sees the other */
+		mtx_lock(&jobs->mutex);
+		atomic_fetch_add(&jobs->sleepers_count, 1);
+		bit idle = !atomic_load(&jobs->terminating);
+		for (uint i = 0; idle && i < jobs->workers_count; ++i) idle = is_job_deque_empty(&jobs->workers[i].deque);
+		if (idle) cnd_wait(&jobs->condition, &jobs->mutex);
+		atomic_fetch_sub(&jobs->sleepers_count, 1);
+		mtx_unlock(&jobs->mutex);
+	}
+	return 0;
+}
+
+void initialize_jobs(void)
+{
+	job_system *jobs = &global.jobs;
+	zero(jobs, sizeof(*jobs));
+
+	jobs->workers_count = 1 + get_processors_count();
+	if (jobs->workers_count > JOB_WORKERS_CAPACITY) jobs->workers_count = JOB_WORKERS_CAPACITY;
+	jobs->workers = allocate(jobs->workers_count * sizeof(job_worker), ALLOCATION_TAG_JOBS);
+	assert(mtx_init(&jobs->mutex, mtx_plain) == thrd_success);
+	assert(cnd_init(&jobs->condition) == thrd_success);
+	assert(mtx_init(&jobs->main_mutex, mtx_plain) == thrd_success);
+
+	for (uint i = 0; i < jobs->workers_count; ++i)
+	{
+		job_worker *worker = &jobs->workers[i];
+		worker->index  = i;
+		worker->random = 0x9e3779b9u * (i + 1);
+		initialize_arena(JOB_SCRATCH_CAPACITY, ALLOCATION_TAG_JOBS, &worker->scratch);
+	}
+
+	/* the main thread is the first worker, but only works while it waits, so
+	   the jobs that it pushes are left to the others */
+	context.job_worker = &jobs->workers[0];
+	for (uint i = 1; i < jobs->workers_count; ++i) assert(thrd_create(&jobs->workers[i].thread, work_on_jobs, &jobs->workers[i]) == thrd_success);
+}
+
+void terminate_jobs(void)
+{
+	job_system *jobs = &global.jobs;
+
+	mtx_lock(&jobs->mutex);
+	atomic_store(&jobs->terminating, 1);
+	cnd_broadcast(&jobs->condition);
+	mtx_unlock(&jobs->mutex);
+	for (uint i = 1; i < jobs->workers_count; ++i) thrd_join(jobs->workers[i].thread, 0);
+
+	for (uint i = 0; i < jobs->workers_count; ++i) terminate_arena(&jobs->workers[i].scratch);
+	cnd_destroy(&jobs->condition);
+	mtx_destroy(&jobs->mutex);
+	mtx_destroy(&jobs->main_mutex);
+	deallocate(jobs->workers, jobs->workers_count * sizeof(job_worker), ALLOCATION_TAG_JOBS);
+	context.job_worker = 0;
+}
+
+/* can only be called from a worker, which includes the main thread and jobs
+   themselves */
+void push_job(job_function *function, void *parameter, job_counter *counter)
+{
+	job_system *jobs   = &global.jobs;
+	job_worker *worker = context.job_worker;
+	assert(worker);
+
+	job job = { function, parameter, counter };
+	if (counter) atomic_fetch_add_explicit(&counter->count, 1, memory_order_relaxed);
+
+	/* when the deque is full, the job is as well run now */
+	if (!push_job_to_deque(&job, &worker->deque))
+	{
+		run_job(&job, worker);
+		return;
+	}
+
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(&jobs->sleepers_count, memory_order_relaxed))
+	{
+		mtx_lock(&jobs->mutex);
+		cnd_signal(&jobs->condition);
+		mtx_unlock(&jobs->mutex);
+	}
+}
+
+/* can be called from any thread */
+void push_main_job(job_function *function, void *parameter, job_counter *counter)
+{
+	job_system *jobs = &global.jobs;
+	if (counter) atomic_fetch_add_explicit(&counter->count, 1, memory_order_relaxed);
+	for (;;)
+	{
+		mtx_lock(&jobs->main_mutex);
+		bit pushed = jobs->main_jobs_count < JOB_MAIN_QUEUE_CAPACITY;
+		if (pushed) jobs->main_jobs[jobs->main_jobs_count++] = (job){ function, parameter, counter };
+		mtx_unlock(&jobs->main_mutex);
+		if (pushed) break;
+		thrd_yield();
+	}
+	wake_main_thread();
+}
+
+void run_main_jobs(void)
+{
+	job_system *jobs = &global.jobs;
+	job         main_jobs[JOB_MAIN_QUEUE_CAPACITY];
+
+	mtx_lock(&jobs->main_mutex);
+	uint main_jobs_count = jobs->main_jobs_count;
+	copy(main_jobs, jobs->main_jobs, main_jobs_count * sizeof(job));
+	jobs->main_jobs_count = 0;
+	mtx_unlock(&jobs->main_mutex);
+
+	for (uint i = 0; i < main_jobs_count; ++i) run_job(&main_jobs[i], &jobs->workers[0]);
+}
+
+/* runs jobs, this worker's first, until those of `counter` have finished. the
+   main thread runs its own queue as well, since what it waits for may be
+   waiting on a job that only it can run */
+void wait_for_jobs(job_counter *counter)
+{
+	job_worker *worker = context.job_worker;
+	assert(worker);
+	bit main = worker == &global.jobs.workers[0];
+	while (atomic_load_explicit(&counter->count, memory_order_acquire))
+	{
+		job job;
+		if (take_job(&job, worker)) run_job(&job, worker);
+		else
+		{
+			if (main) run_main_jobs();
+			thrd_yield();
+		}
+	}
+}
+
+void report_job_statistics(float32 elapsed_time)
+{
+	job_system *jobs = &global.jobs;
+	for (uint i = 0; i < jobs->workers_count; ++i)
+	{
+		job_worker *worker = &jobs->workers[i];
+		uintl busy_time         = atomic_exchange_explicit(&worker->busy_time, 0, memory_order_relaxed);
+		uint  jobs_count        = atomic_exchange_explicit(&worker->jobs_count, 0, memory_order_relaxed);
+		uint  stolen_jobs_count = atomic_exchange_explicit(&worker->stolen_jobs_count, 0, memory_order_relaxed);
+		if (!jobs_count) continue;
+		report_verbose("worker %u: %.1f%% busy, %u jobs, %u stolen\n", i, (float64)busy_time / TIME_SECONDS_FACTOR / elapsed_time * 100, jobs_count, stolen_jobs_count);
+	}
+}
+
+/* the benchmark sums a range by halving it into jobs down to a grain, which
+   makes many small jobs that mostly wait on each other */
+
+#define JOB_BENCHMARK_SIZE  (1 << 24)
+#define JOB_BENCHMARK_GRAIN (1 << 12)
+
+typedef struct
+{
+	const uint32 *values;
+	uint          count;
+	uintl         sum;
+} job_benchmark_range;
+
+static void sum_job_benchmark_range(void *parameter)
+{
+	job_benchmark_range *range = parameter;
+	if (range->count <= JOB_BENCHMARK_GRAIN)
+	{
+		uintl sum = 0;
+		for (uint i = 0; i < range->count; ++i) sum += range->values[i];
+		range->sum = sum;
+		return;
+	}
+
+	uint                half        = range->count / 2;
+	job_benchmark_range halves[2]   =
+	{
+		{ range->values,        half,                0 },
+		{ range->values + half, range->count - half, 0 },
+	};
+	job_counter counter = {0};
+	push_job(sum_job_benchmark_range, &halves[0], &counter);
+	sum_job_benchmark_range(&halves[1]);
+	wait_for_jobs(&counter);
+	range->sum = halves[0].sum + halves[1].sum;
+}
+
+void benchmark_jobs(void)
+{
+	uint32 *values       = allocate(JOB_BENCHMARK_SIZE * sizeof(uint32), ALLOCATION_TAG_JOBS);
+	uintl   expected_sum = 0;
+	for (uint i = 0; i < JOB_BENCHMARK_SIZE; ++i) expected_sum += values[i] = i * 2654435761u >> 16;
+
+	const uint rounds_count = 16;
+
+	/* the same sum on this thread alone, to compare with */
+	uintl beginning_time = get_time();
+	for (uint i = 0; i < rounds_count; ++i)
+	{
+		uintl sum = 0;
+		for (uint j = 0; j < JOB_BENCHMARK_SIZE; ++j) sum += values[j];
+		assert(sum == expected_sum);
+	}
+	float64 serial_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR / rounds_count;
+
+	/* count only what the benchmark does */
+	for (uint i = 0; i < global.jobs.workers_count; ++i)
+	{
+		job_worker *worker = &global.jobs.workers[i];
+		atomic_store(&worker->busy_time, 0);
+		atomic_store(&worker->jobs_count, 0);
+		atomic_store(&worker->stolen_jobs_count, 0);
+	}
+
+	beginning_time = get_time();
+	for (uint i = 0; i < rounds_count; ++i)
+	{
+		job_benchmark_range range = { values, JOB_BENCHMARK_SIZE, 0 };
+		sum_job_benchmark_range(&range);
+		assert(range.sum == expected_sum);
+	}
+	float64 elapsed_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+	float64 parallel_time = elapsed_time / rounds_count;
+	float64 jobs_count    = 2.0 * JOB_BENCHMARK_SIZE / JOB_BENCHMARK_GRAIN - 1;
+
+	report_comment(
+		"fork/join on %u workers: %.3f ms per sum against %.3f ms serially (%.2fx), %.0f ns per job\n",
+		global.jobs.workers_count, parallel_time * 1000, serial_time * 1000, serial_time / parallel_time, parallel_time * TIME_SECONDS_FACTOR / jobs_count);
+	report_job_statistics(elapsed_time);
+
+	deallocate(values, JOB_BENCHMARK_SIZE * sizeof(uint32), ALLOCATION_TAG_JOBS);
+}
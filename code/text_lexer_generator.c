@@ -0,0 +1,864 @@
+/*
+
+makes the lexers of the editor from grammars, as tables in a header that the
+unity build includes:
+
+	text_lexer_generator <header> <grammar>...
+
+a grammar names its lexer and the extensions of the files that it is for,
+then its modes, the first of which every file begins in:
+
+	lexer c .c .h
+	mode code
+		keyword auto|break|case
+		comment /\*  -> block_comment
+		include other_mode -> code
+
+a rule is a token, a pattern, and the mode that it leads to, if not the one
+that it is in. an include takes the rules of another mode after those
+before it, and the ones that lead nowhere of their own lead to its mode, if it
+has one. patterns are regular expressions over bytes: literals, escapes (`\n`,
+`\t`, `\r`, `\f`, `\v`, `\xhh`, or of any other byte), `.` for any byte but a
+line feed, classes, groups, `|`, `*`, `+` and `?`. they have no spaces, which
+are written `\ `. lines that begin with `#` are comments.
+
+every mode becomes a deterministic automaton that finds the longest token that
+any of its rules match, and the first of those rules. the automata are
+minimized together, into one table whose columns are the classes of bytes that
+no state tells apart.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+typedef uint8_t  byte;
+typedef uint8_t  uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef uint64_t uint64;
+typedef unsigned uint;
+typedef _Bool    bit;
+
+#define GENERATOR_NAME_CAPACITY   64
+#define GENERATOR_LINE_CAPACITY   4096
+#define GENERATOR_RULES_CAPACITY  254  /* the rule after 1 is kept in a byte */
+#define GENERATOR_MODES_CAPACITY  254  /* as the state of a line, which is unknown at 0xff */
+#define GENERATOR_ITEMS_CAPACITY  1024
+#define GENERATOR_NFA_CAPACITY    (1 << 18)
+#define GENERATOR_SETS_CAPACITY   (1 << 14)
+#define GENERATOR_DFA_CAPACITY    (1 << 15)
+#define GENERATOR_INCLUDES_DEPTH  16
+#define GENERATOR_SAME_MODE       0xff
+#define GENERATOR_TOKEN_END       0x8000  /* of a transition from the end of a token into the next */
+
+typedef enum
+{
+	NFA_STATE_BYTES,  /* takes a byte of its set */
+	NFA_STATE_SPLIT,
+	NFA_STATE_EMPTY,
+	NFA_STATE_ACCEPT,
+} nfa_state_kind;
+
+typedef struct
+{
+	uint32 next;
+	uint32 alternative;  /* of a split */
+	uint16 set;
+	uint8  rule;         /* that an accepting state accepts */
+	uint8  kind;
+} nfa_state;
+
+typedef struct
+{
+	uint32 start;
+	uint32 end;  /* an empty state that leads nowhere yet */
+} nfa_fragment;
+
+/* a rule of a mode, or the rules of another that it includes */
+typedef struct
+{
+	bit  included;
+	char token[GENERATOR_NAME_CAPACITY];  /* or the included mode */
+	char target[GENERATOR_NAME_CAPACITY]; /* or empty */
+	char *pattern;
+	uint line;
+} grammar_item;
+
+typedef struct
+{
+	char name[GENERATOR_NAME_CAPACITY];
+	uint first_item;
+	uint items_count;
+} grammar_mode;
+
+typedef struct
+{
+	const char *path;
+	char        name[GENERATOR_NAME_CAPACITY];
+	char        extensions[GENERATOR_LINE_CAPACITY];
+
+	grammar_item items[GENERATOR_ITEMS_CAPACITY];
+	uint         items_count;
+	grammar_mode modes[GENERATOR_MODES_CAPACITY];
+	uint         modes_count;
+
+	/* the rules of every mode, with their includes taken in */
+	const grammar_item *rules[GENERATOR_RULES_CAPACITY];
+	uint8               rule_modes[GENERATOR_RULES_CAPACITY];
+	uint                rules_count;
+	uint                mode_rules[GENERATOR_MODES_CAPACITY + 1];  /* where the rules of each mode begin */
+
+	nfa_state *nfa;
+	uint       nfa_count;
+	uint64   (*sets)[4];
+	uint       sets_count;
+	uint32     mode_nfa_starts[GENERATOR_MODES_CAPACITY];
+
+	/* the classes of bytes that the sets tell apart */
+	uint8 classes[256];
+	uint  classes_count;
+
+	/* the deterministic automaton, whose states are sets of states of the other */
+	uint32 *elements;
+	uint    elements_count;
+	uint    elements_capacity;
+	uint32 *element_offsets;
+	uint32 *transitions;  /* by class */
+	uint8  *accepted_rules;
+	uint    dfa_count;
+	uint32  mode_dfa_starts[GENERATOR_MODES_CAPACITY];
+	uint32 *table;  /* of the states, by their hash */
+	uint    table_capacity;
+
+	/* for finding the sets of states */
+	uint32 *stack;
+	uint32 *marks;
+	uint32  mark;
+	uint32 *closure;
+	uint    closure_count;
+
+	const char *pattern;  /* being parsed */
+	uint        pattern_line;
+} grammar;
+
+static void fail(const grammar *grammar, uint line, const char *message, const char *detail)
+{
+	fprintf(stderr, "%s:%u: %s%s%s\n", grammar->path, line, message, detail ? ": " : "", detail ? detail : "");
+	exit(1);
+}
+
+static void *allocate_zeroed(size_t size)
+{
+	void *memory = calloc(1, size ? size : 1);
+	if (!memory)
+	{
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+	return memory;
+}
+
+static char *copy_string(const char *string)
+{
+	size_t size = strlen(string) + 1;
+	return memcpy(allocate_zeroed(size), string, size);
+}
+
+/* the next word of a line, which ends at a space, or 0 at the end */
+static char *take_grammar_word(char **line)
+{
+	char *word = *line;
+	while (*word == ' ' || *word == '\t') ++word;
+	if (!*word) return 0;
+	char *end = word;
+	while (*end && *end != ' ' && *end != '\t')
+	{
+		if (*end == '\\' && end[1]) ++end;
+		++end;
+	}
+	if (*end) *end++ = 0;
+	*line = end;
+	return word;
+}
+
+static void copy_grammar_name(char *name, const char *word, const grammar *grammar, uint line)
+{
+	if (strlen(word) >= GENERATOR_NAME_CAPACITY) fail(grammar, line, "the name is too long", word);
+	strcpy(name, word);
+}
+
+static void read_grammar(const char *path, grammar *grammar)
+{
+	grammar->path = path;
+	FILE *file = fopen(path, "rb");
+	if (!file) fail(grammar, 0, "the grammar cannot be opened", 0);
+
+	char line_text[GENERATOR_LINE_CAPACITY];
+	for (uint line = 1; fgets(line_text, sizeof(line_text), file); ++line)
+	{
+		char *line_end = line_text + strlen(line_text);
+		while (line_end > line_text && (line_end[-1] == '\n' || line_end[-1] == '\r')) *--line_end = 0;
+
+		char *rest  = line_text;
+		char *first = take_grammar_word(&rest);
+		if (!first || first[0] == '#') continue;
+
+		if (!strcmp(first, "lexer"))
+		{
+			char *name = take_grammar_word(&rest);
+			if (!name) fail(grammar, line, "the lexer has no name", 0);
+			copy_grammar_name(grammar->name, name, grammar, line);
+			for (char *extension; (extension = take_grammar_word(&rest));)
+			{
+				if (extension[0] != '.') fail(grammar, line, "an extension begins with '.'", extension);
+				if (grammar->extensions[0]) strcat(grammar->extensions, " ");
+				strcat(grammar->extensions, extension);
+			}
+			continue;
+		}
+		if (!grammar->name[0]) fail(grammar, line, "the grammar does not begin with its lexer", 0);
+
+		if (!strcmp(first, "mode"))
+		{
+			char *name = take_grammar_word(&rest);
+			if (!name) fail(grammar, line, "the mode has no name", 0);
+			if (grammar->modes_count == GENERATOR_MODES_CAPACITY) fail(grammar, line, "there are too many modes", 0);
+			grammar_mode *mode = &grammar->modes[grammar->modes_count++];
+			copy_grammar_name(mode->name, name, grammar, line);
+			mode->first_item = grammar->items_count;
+			continue;
+		}
+		if (!grammar->modes_count) fail(grammar, line, "a rule is not in a mode", 0);
+		if (grammar->items_count == GENERATOR_ITEMS_CAPACITY) fail(grammar, line, "there are too many rules", 0);
+
+		grammar_item *item = &grammar->items[grammar->items_count++];
+		item->line     = line;
+		item->included = !strcmp(first, "include");
+		char *second   = take_grammar_word(&rest);
+		if (!second) fail(grammar, line, item->included ? "the include has no mode" : "the rule has no pattern", first);
+		copy_grammar_name(item->token, item->included ? second : first, grammar, line);
+		if (!item->included) item->pattern = copy_string(second);
+
+		char *arrow = take_grammar_word(&rest);
+		if (arrow)
+		{
+			char *target = take_grammar_word(&rest);
+			if (strcmp(arrow, "->") || !target || take_grammar_word(&rest)) fail(grammar, line, "a rule ends with `-> mode`", 0);
+			copy_grammar_name(item->target, target, grammar, line);
+		}
+		grammar->modes[grammar->modes_count - 1].items_count += 1;
+	}
+	fclose(file);
+	if (!grammar->modes_count) fail(grammar, 0, "the grammar has no modes", 0);
+}
+
+static uint find_grammar_mode(const char *name, const grammar *grammar, uint line)
+{
+	for (uint i = 0; i < grammar->modes_count; ++i)
+	{
+		if (!strcmp(grammar->modes[i].name, name)) return i;
+	}
+	fail(grammar, line, "there is no such mode", name);
+	return 0;
+}
+
+/* takes the rules of a mode in, with those of the modes that it includes */
+static void take_grammar_rules(uint mode_index, uint8 target, uint depth, grammar *grammar)
+{
+	const grammar_mode *mode = &grammar->modes[mode_index];
+	if (depth == GENERATOR_INCLUDES_DEPTH) fail(grammar, 0, "the includes go too deep", mode->name);
+	for (uint i = mode->first_item; i < mode->first_item + mode->items_count; ++i)
+	{
+		const grammar_item *item        = &grammar->items[i];
+		uint8               item_target = item->target[0] ? find_grammar_mode(item->target, grammar, item->line) : target;
+		if (item->included)
+		{
+			take_grammar_rules(find_grammar_mode(item->token, grammar, item->line), item_target, depth + 1, grammar);
+			continue;
+		}
+		if (grammar->rules_count == GENERATOR_RULES_CAPACITY) fail(grammar, item->line, "there are too many rules", 0);
+		grammar->rules[grammar->rules_count]      = item;
+		grammar->rule_modes[grammar->rules_count] = item_target;
+		grammar->rules_count += 1;
+	}
+}
+
+static uint32 push_nfa_state(nfa_state_kind kind, uint32 next, uint32 alternative, grammar *grammar)
+{
+	if (grammar->nfa_count == GENERATOR_NFA_CAPACITY) fail(grammar, grammar->pattern_line, "the patterns are too complex", 0);
+	grammar->nfa[grammar->nfa_count] = (nfa_state){ .kind = kind, .next = next, .alternative = alternative };
+	return grammar->nfa_count++;
+}
+
+static uint16 push_nfa_set(grammar *grammar)
+{
+	if (grammar->sets_count == GENERATOR_SETS_CAPACITY) fail(grammar, grammar->pattern_line, "the patterns have too many sets", 0);
+	memset(grammar->sets[grammar->sets_count], 0, sizeof(grammar->sets[0]));
+	return grammar->sets_count++;
+}
+
+static void add_to_nfa_set(uint16 set, uint first, uint last, grammar *grammar)
+{
+	for (uint value = first; value <= last; ++value) grammar->sets[set][value >> 6] |= (uint64)1 << (value & 63);
+}
+
+static nfa_fragment make_nfa_set_fragment(uint16 set, grammar *grammar)
+{
+	uint32 end   = push_nfa_state(NFA_STATE_EMPTY, 0, 0, grammar);
+	uint32 start = push_nfa_state(NFA_STATE_BYTES, end, 0, grammar);
+	grammar->nfa[start].set = set;
+	return (nfa_fragment){ start, end };
+}
+
+static byte parse_pattern_escape(grammar *grammar)
+{
+	char value = *grammar->pattern++;
+	switch (value)
+	{
+	case 0:   fail(grammar, grammar->pattern_line, "the pattern ends in an escape", 0); return 0;
+	case 'n': return '\n';
+	case 't': return '\t';
+	case 'r': return '\r';
+	case 'f': return '\f';
+	case 'v': return '\v';
+	case 'x':
+	{
+		uint digits = 0;
+		for (uint i = 0; i < 2; ++i)
+		{
+			char digit = *grammar->pattern++;
+			if      (digit >= '0' && digit <= '9') digits = digits * 16 + digit - '0';
+			else if (digit >= 'a' && digit <= 'f') digits = digits * 16 + digit - 'a' + 10;
+			else if (digit >= 'A' && digit <= 'F') digits = digits * 16 + digit - 'A' + 10;
+			else fail(grammar, grammar->pattern_line, "`\\x` takes two hexadecimal digits", 0);
+		}
+		return digits;
+	}
+	default: return value;
+	}
+}
+
+static nfa_fragment parse_pattern_alternation(grammar *grammar);
+
+static nfa_fragment parse_pattern_atom(grammar *grammar)
+{
+	char value = *grammar->pattern++;
+	if (value == '(')
+	{
+		nfa_fragment fragment = parse_pattern_alternation(grammar);
+		if (*grammar->pattern++ != ')') fail(grammar, grammar->pattern_line, "a group is not closed", 0);
+		return fragment;
+	}
+
+	uint16 set = push_nfa_set(grammar);
+	if (value == '[')
+	{
+		bit negated = *grammar->pattern == '^';
+		if (negated) grammar->pattern += 1;
+		for (bit first = 1; first || *grammar->pattern != ']'; first = 0)
+		{
+			char item = *grammar->pattern++;
+			if (!item) fail(grammar, grammar->pattern_line, "a class is not closed", 0);
+			byte low = item == '\\' ? parse_pattern_escape(grammar) : (byte)item;
+			byte high = low;
+			if (grammar->pattern[0] == '-' && grammar->pattern[1] && grammar->pattern[1] != ']')
+			{
+				grammar->pattern += 1;
+				item = *grammar->pattern++;
+				high = item == '\\' ? parse_pattern_escape(grammar) : (byte)item;
+				if (high < low) fail(grammar, grammar->pattern_line, "a range of a class is backwards", 0);
+			}
+			add_to_nfa_set(set, low, high, grammar);
+		}
+		grammar->pattern += 1;
+		if (negated)
+		{
+			for (uint i = 0; i < 4; ++i) grammar->sets[set][i] = ~grammar->sets[set][i];
+		}
+	}
+	else if (value == '.')
+	{
+		add_to_nfa_set(set, 0, 255, grammar);
+		grammar->sets[set]['\n' >> 6] &= ~((uint64)1 << ('\n' & 63));
+	}
+	else if (value == '\\')
+	{
+		byte escaped = parse_pattern_escape(grammar);
+		add_to_nfa_set(set, escaped, escaped, grammar);
+	}
+	else if (value == 0 || value == ')' || value == '|' || value == '*' || value == '+' || value == '?')
+	{
+		fail(grammar, grammar->pattern_line, "the pattern expects a byte, a class or a group", 0);
+	}
+	else add_to_nfa_set(set, (byte)value, (byte)value, grammar);
+	return make_nfa_set_fragment(set, grammar);
+}
+
+static nfa_fragment parse_pattern_repetition(grammar *grammar)
+{
+	nfa_fragment fragment = parse_pattern_atom(grammar);
+	for (char value = *grammar->pattern; value == '*' || value == '+' || value == '?'; value = *++grammar->pattern)
+	{
+		uint32 end   = push_nfa_state(NFA_STATE_EMPTY, 0, 0, grammar);
+		uint32 split = push_nfa_state(NFA_STATE_SPLIT, fragment.start, end, grammar);
+		if (value == '?')
+		{
+			grammar->nfa[fragment.end].next = end;
+			fragment.start = split;
+		}
+		else
+		{
+			grammar->nfa[fragment.end].next = split;
+			if (value == '*') fragment.start = split;
+		}
+		fragment.end = end;
+	}
+	return fragment;
+}
+
+static nfa_fragment parse_pattern_sequence(grammar *grammar)
+{
+	char value = *grammar->pattern;
+	if (!value || value == ')' || value == '|')
+	{
+		uint32 empty = push_nfa_state(NFA_STATE_EMPTY, 0, 0, grammar);
+		return (nfa_fragment){ empty, empty };
+	}
+
+	nfa_fragment fragment = parse_pattern_repetition(grammar);
+	for (value = *grammar->pattern; value && value != ')' && value != '|'; value = *grammar->pattern)
+	{
+		nfa_fragment next = parse_pattern_repetition(grammar);
+		grammar->nfa[fragment.end].next = next.start;
+		fragment.end = next.end;
+	}
+	return fragment;
+}
+
+static nfa_fragment parse_pattern_alternation(grammar *grammar)
+{
+	nfa_fragment fragment = parse_pattern_sequence(grammar);
+	while (*grammar->pattern == '|')
+	{
+		grammar->pattern += 1;
+		nfa_fragment alternative = parse_pattern_sequence(grammar);
+		uint32       end         = push_nfa_state(NFA_STATE_EMPTY, 0, 0, grammar);
+		grammar->nfa[fragment.end].next    = end;
+		grammar->nfa[alternative.end].next = end;
+		fragment.start = push_nfa_state(NFA_STATE_SPLIT, fragment.start, alternative.start, grammar);
+		fragment.end   = end;
+	}
+	return fragment;
+}
+
+/* an automaton for every mode that matches any of its rules */
+static void make_grammar_nfa(grammar *grammar)
+{
+	grammar->nfa  = allocate_zeroed(GENERATOR_NFA_CAPACITY * sizeof(nfa_state));
+	grammar->sets = allocate_zeroed(GENERATOR_SETS_CAPACITY * sizeof(grammar->sets[0]));
+	push_nfa_state(NFA_STATE_EMPTY, 0, 0, grammar);  /* so that 0 leads nowhere */
+
+	for (uint mode = 0; mode < grammar->modes_count; ++mode)
+	{
+		uint32 start = 0;
+		for (uint rule = grammar->mode_rules[mode + 1]; rule-- > grammar->mode_rules[mode];)
+		{
+			grammar->pattern      = grammar->rules[rule]->pattern;
+			grammar->pattern_line = grammar->rules[rule]->line;
+			nfa_fragment fragment = parse_pattern_alternation(grammar);
+			if (*grammar->pattern) fail(grammar, grammar->pattern_line, "the pattern has an unmatched ')'", 0);
+			uint32 accept = push_nfa_state(NFA_STATE_ACCEPT, 0, 0, grammar);
+			grammar->nfa[accept].rule       = rule;
+			grammar->nfa[fragment.end].next = accept;
+			start = start ? push_nfa_state(NFA_STATE_SPLIT, fragment.start, start, grammar) : fragment.start;
+		}
+		if (!start) fail(grammar, 0, "a mode has no rules", grammar->modes[mode].name);
+		grammar->mode_nfa_starts[mode] = start;
+	}
+}
+
+/* splits the bytes into the classes that every set takes whole or not at all */
+static void make_grammar_classes(grammar *grammar)
+{
+	grammar->classes_count = 1;
+	for (uint set = 0; set < grammar->sets_count; ++set)
+	{
+		/* a class becomes two where the set takes some of it */
+		uint16 split_classes[256][2];
+		uint   count = 0;
+		memset(split_classes, 0xff, sizeof(split_classes));
+		for (uint value = 0; value < 256; ++value)
+		{
+			bit     taken       = grammar->sets[set][value >> 6] >> (value & 63) & 1;
+			uint16 *split_class = &split_classes[grammar->classes[value]][taken];
+			if (*split_class == UINT16_MAX) *split_class = count++;
+			grammar->classes[value] = *split_class;
+		}
+		grammar->classes_count = count;
+	}
+}
+
+static void add_to_grammar_closure(uint32 state, grammar *grammar)
+{
+	uint stack_count = 0;
+	grammar->stack[stack_count++] = state;
+	while (stack_count)
+	{
+		uint32 current = grammar->stack[--stack_count];
+		if (grammar->marks[current] == grammar->mark) continue;
+		grammar->marks[current] = grammar->mark;
+		const nfa_state *nfa_state = &grammar->nfa[current];
+		switch (nfa_state->kind)
+		{
+		case NFA_STATE_SPLIT:
+			grammar->stack[stack_count++] = nfa_state->alternative;
+			grammar->stack[stack_count++] = nfa_state->next;
+			break;
+		case NFA_STATE_EMPTY:
+			if (nfa_state->next) grammar->stack[stack_count++] = nfa_state->next;
+			break;
+		default:
+			grammar->closure[grammar->closure_count++] = current;
+			break;
+		}
+	}
+}
+
+static int compare_grammar_states(const void *left, const void *right)
+{
+	uint32 a = *(const uint32 *)left;
+	uint32 b = *(const uint32 *)right;
+	return a < b ? -1 : a > b;
+}
+
+static uint32 hash_grammar_closure(const uint32 *states, uint count)
+{
+	uint32 hash = 2166136261u;
+	for (uint i = 0; i < count; ++i) hash = (hash ^ states[i]) * 16777619u;
+	return hash;
+}
+
+/* the state of the deterministic automaton for the closure, made if it is new */
+static uint32 find_grammar_dfa_state(grammar *grammar)
+{
+	qsort(grammar->closure, grammar->closure_count, sizeof(uint32), compare_grammar_states);
+	uint32 *states = grammar->closure;
+	uint    count  = grammar->closure_count;
+	uint    slot   = hash_grammar_closure(states, count) & (grammar->table_capacity - 1);
+	for (;; slot = (slot + 1) & (grammar->table_capacity - 1))
+	{
+		uint32 state = grammar->table[slot];
+		if (state == UINT32_MAX) break;
+		uint32 offset = grammar->element_offsets[state];
+		if (grammar->element_offsets[state + 1] - offset == count && !memcmp(grammar->elements + offset, states, count * sizeof(uint32))) return state;
+	}
+
+	if (grammar->dfa_count == GENERATOR_DFA_CAPACITY) fail(grammar, 0, "the lexer has too many states", 0);
+	while (grammar->elements_count + count > grammar->elements_capacity)
+	{
+		grammar->elements_capacity *= 2;
+		grammar->elements = realloc(grammar->elements, grammar->elements_capacity * sizeof(uint32));
+		if (!grammar->elements) fail(grammar, 0, "out of memory", 0);
+	}
+	uint32 state = grammar->dfa_count++;
+	memcpy(grammar->elements + grammar->elements_count, states, count * sizeof(uint32));
+	grammar->elements_count              += count;
+	grammar->element_offsets[state + 1]   = grammar->elements_count;
+	grammar->table[slot]                  = state;
+
+	/* the first rule of those that it accepts */
+	uint rule = GENERATOR_RULES_CAPACITY;
+	for (uint i = 0; i < count; ++i)
+	{
+		const nfa_state *nfa_state = &grammar->nfa[states[i]];
+		if (nfa_state->kind == NFA_STATE_ACCEPT && nfa_state->rule < rule) rule = nfa_state->rule;
+	}
+	grammar->accepted_rules[state] = rule < GENERATOR_RULES_CAPACITY ? rule + 1 : 0;
+	return state;
+}
+
+/* makes every state that the modes reach, with the state of the empty set first, which leads nowhere */
+static void make_grammar_dfa(grammar *grammar)
+{
+	grammar->stack             = allocate_zeroed(grammar->nfa_count * 2 * sizeof(uint32));
+	grammar->marks             = allocate_zeroed(grammar->nfa_count * sizeof(uint32));
+	grammar->closure           = allocate_zeroed(grammar->nfa_count * sizeof(uint32));
+	grammar->elements_capacity = 1 << 16;
+	grammar->elements          = allocate_zeroed(grammar->elements_capacity * sizeof(uint32));
+	grammar->element_offsets   = allocate_zeroed((GENERATOR_DFA_CAPACITY + 1) * sizeof(uint32));
+	grammar->transitions       = allocate_zeroed((size_t)GENERATOR_DFA_CAPACITY * grammar->classes_count * sizeof(uint32));
+	grammar->accepted_rules    = allocate_zeroed(GENERATOR_DFA_CAPACITY);
+	grammar->table_capacity    = GENERATOR_DFA_CAPACITY * 2;
+	grammar->table             = allocate_zeroed(grammar->table_capacity * sizeof(uint32));
+	memset(grammar->table, 0xff, grammar->table_capacity * sizeof(uint32));
+
+	grammar->closure_count = 0;
+	find_grammar_dfa_state(grammar);
+	for (uint mode = 0; mode < grammar->modes_count; ++mode)
+	{
+		grammar->mark         += 1;
+		grammar->closure_count = 0;
+		add_to_grammar_closure(grammar->mode_nfa_starts[mode], grammar);
+		uint32 start = find_grammar_dfa_state(grammar);
+		if (grammar->accepted_rules[start])
+		{
+			const grammar_item *rule = grammar->rules[grammar->accepted_rules[start] - 1];
+			fail(grammar, rule->line, "the rule matches nothing", rule->pattern);
+		}
+		grammar->mode_dfa_starts[mode] = start;
+	}
+
+	/* a byte of every class */
+	byte representatives[256];
+	for (uint value = 256; value--;) representatives[grammar->classes[value]] = value;
+
+	for (uint32 state = 0; state < grammar->dfa_count; ++state)
+	{
+		for (uint class = 0; class < grammar->classes_count; ++class)
+		{
+			byte value = representatives[class];
+			grammar->mark         += 1;
+			grammar->closure_count = 0;
+			for (uint32 i = grammar->element_offsets[state]; i < grammar->element_offsets[state + 1]; ++i)
+			{
+				const nfa_state *nfa_state = &grammar->nfa[grammar->elements[i]];
+				if (nfa_state->kind == NFA_STATE_BYTES && grammar->sets[nfa_state->set][value >> 6] >> (value & 63) & 1) add_to_grammar_closure(nfa_state->next, grammar);
+			}
+			grammar->transitions[(size_t)state * grammar->classes_count + class] = find_grammar_dfa_state(grammar);
+		}
+	}
+}
+
+/* joins the states that no text tells apart, by refining the partition of the
+   states by what they accept until every block leads to the same blocks; the
+   block of the empty set comes first */
+static void minimize_grammar_dfa(grammar *grammar)
+{
+	uint    count      = grammar->dfa_count;
+	uint    columns    = grammar->classes_count;
+	uint32 *blocks     = allocate_zeroed(count * sizeof(uint32));
+	uint32 *new_blocks = allocate_zeroed(count * sizeof(uint32));
+	uint32 *signature  = allocate_zeroed((columns + 1) * sizeof(uint32));
+	uint32 *firsts     = allocate_zeroed(count * sizeof(uint32));  /* a state of every block */
+	uint    blocks_count   = 0;
+	uint    table_capacity = 1;
+	while (table_capacity < count * 2) table_capacity *= 2;
+	uint32 *table = allocate_zeroed(table_capacity * sizeof(uint32));
+
+	for (uint state = 0; state < count; ++state) blocks[state] = grammar->accepted_rules[state];
+	for (uint old_count = 0;; old_count = blocks_count)
+	{
+		memset(table, 0xff, table_capacity * sizeof(uint32));
+		blocks_count = 0;
+		for (uint state = 0; state < count; ++state)
+		{
+			signature[0] = blocks[state];
+			for (uint class = 0; class < columns; ++class) signature[class + 1] = blocks[grammar->transitions[(size_t)state * columns + class]];
+			uint slot = hash_grammar_closure(signature, columns + 1) & (table_capacity - 1);
+			for (;; slot = (slot + 1) & (table_capacity - 1))
+			{
+				uint32 block = table[slot];
+				if (block == UINT32_MAX)
+				{
+					table[slot]          = blocks_count;
+					firsts[blocks_count] = state;
+					new_blocks[state]    = blocks_count++;
+					break;
+				}
+
+				uint32 other = firsts[block];
+				bit    same  = blocks[other] == blocks[state];
+				for (uint class = 0; same && class < columns; ++class)
+				{
+					same = blocks[grammar->transitions[(size_t)other * columns + class]] == signature[class + 1];
+				}
+				if (same)
+				{
+					new_blocks[state] = block;
+					break;
+				}
+			}
+		}
+		memcpy(blocks, new_blocks, count * sizeof(uint32));
+		if (blocks_count == old_count) break;
+	}
+
+	/* the empty set was the first state, so its block is the first */
+	uint32 *transitions    = allocate_zeroed((size_t)blocks_count * columns * sizeof(uint32));
+	uint8  *accepted_rules = allocate_zeroed(blocks_count);
+	for (uint block = 0; block < blocks_count; ++block)
+	{
+		uint32 state = firsts[block];
+		accepted_rules[block] = grammar->accepted_rules[state];
+		for (uint class = 0; class < columns; ++class) transitions[(size_t)block * columns + class] = blocks[grammar->transitions[(size_t)state * columns + class]];
+	}
+	for (uint mode = 0; mode < grammar->modes_count; ++mode) grammar->mode_dfa_starts[mode] = blocks[grammar->mode_dfa_starts[mode]];
+
+	free(grammar->transitions);
+	free(grammar->accepted_rules);
+	grammar->transitions    = transitions;
+	grammar->accepted_rules = accepted_rules;
+	grammar->dfa_count      = blocks_count;
+	free(blocks);
+	free(new_blocks);
+	free(signature);
+	free(table);
+	free(firsts);
+}
+
+/* joins the classes whose columns are the same in every state */
+static void merge_grammar_classes(grammar *grammar)
+{
+	uint  columns = grammar->classes_count;
+	uint8 merged[256];
+	uint  merged_count = 0;
+	uint8 firsts[256];
+	for (uint class = 0; class < columns; ++class)
+	{
+		uint other = 0;
+		for (; other < merged_count; ++other)
+		{
+			uint state = 0;
+			while (state < grammar->dfa_count && grammar->transitions[(size_t)state * columns + class] == grammar->transitions[(size_t)state * columns + firsts[other]]) ++state;
+			if (state == grammar->dfa_count) break;
+		}
+		if (other == merged_count) firsts[merged_count++] = class;
+		merged[class] = other;
+	}
+
+	uint32 *transitions = allocate_zeroed((size_t)grammar->dfa_count * merged_count * sizeof(uint32));
+	for (uint state = 0; state < grammar->dfa_count; ++state)
+	{
+		for (uint class = 0; class < merged_count; ++class) transitions[(size_t)state * merged_count + class] = grammar->transitions[(size_t)state * columns + firsts[class]];
+	}
+	for (uint value = 0; value < 256; ++value) grammar->classes[value] = merged[grammar->classes[value]];
+	free(grammar->transitions);
+	grammar->transitions   = transitions;
+	grammar->classes_count = merged_count;
+}
+
+static void write_grammar_numbers(FILE *file, const char *type, const char *name, const grammar *grammar, const uint32 *numbers, uint count)
+{
+	fprintf(file, "static const %s text_lexer_%s_%s[%u] =\n{", type, grammar->name, name, count);
+	for (uint i = 0; i < count; ++i) fprintf(file, "%s%u,", i % 16 ? " " : "\n\t", numbers[i]);
+	fprintf(file, "\n};\n\n");
+}
+
+/* every row of the table begins with the rule that its state accepts, and the
+   states that the classes lead to are the offsets of their rows, so that the
+   lexer need not multiply to find them. where a state that accepts leads
+   nowhere, the longest token ends, and it leads instead to where the next
+   token's first byte leads, marked as the end of a token, so that the lexer
+   goes on without starting over. */
+static void write_grammar(FILE *file, const grammar *grammar)
+{
+	uint row_size = grammar->classes_count + 1;
+	uint count    = grammar->dfa_count * row_size;
+	if (count > GENERATOR_TOKEN_END) fail(grammar, 0, "the lexer's table is too large", 0);
+
+	uint32 *numbers = allocate_zeroed((count > 256 ? count : 256) * sizeof(uint32));
+	fprintf(file, "/* %s: %u modes, %u rules, %u states, %u byte classes */\n\n", grammar->path, grammar->modes_count, grammar->rules_count, grammar->dfa_count, grammar->classes_count);
+
+	for (uint value = 0; value < 256; ++value) numbers[value] = grammar->classes[value] + 1;
+	write_grammar_numbers(file, "uint8", "classes", grammar, numbers, 256);
+	for (uint state = 0; state < grammar->dfa_count; ++state)
+	{
+		uint rule = grammar->accepted_rules[state];
+		numbers[state * row_size] = rule;
+		for (uint class = 0; class < grammar->classes_count; ++class)
+		{
+			uint32 next = grammar->transitions[(size_t)state * grammar->classes_count + class];
+			if (!next && rule) next = grammar->transitions[(size_t)grammar->mode_dfa_starts[grammar->rule_modes[rule - 1]] * grammar->classes_count + class];
+			numbers[state * row_size + class + 1] = next * row_size | (!grammar->transitions[(size_t)state * grammar->classes_count + class] && rule ? GENERATOR_TOKEN_END : 0);
+		}
+	}
+	write_grammar_numbers(file, "uint16", "transitions", grammar, numbers, count);
+	for (uint i = 0; i < grammar->rules_count; ++i) numbers[i] = grammar->rule_modes[i];
+	write_grammar_numbers(file, "uint8", "rule_modes", grammar, numbers, grammar->rules_count);
+	for (uint i = 0; i < grammar->modes_count; ++i) numbers[i] = grammar->mode_dfa_starts[i] * row_size;
+	write_grammar_numbers(file, "uint16", "mode_starts", grammar, numbers, grammar->modes_count);
+
+	fprintf(file, "static const uint8 text_lexer_%s_rule_tokens[%u] =\n{\n", grammar->name, grammar->rules_count);
+	for (uint i = 0; i < grammar->rules_count; ++i)
+	{
+		fprintf(file, "\tTEXT_TOKEN_");
+		for (const char *name = grammar->rules[i]->token; *name; ++name) fputc(*name >= 'a' && *name <= 'z' ? *name - 'a' + 'A' : *name, file);
+		fprintf(file, ",\n");
+	}
+	fprintf(file, "};\n\n");
+	free(numbers);
+}
+
+int main(int arguments_count, char **arguments)
+{
+	if (arguments_count < 3)
+	{
+		fprintf(stderr, "usage: %s <header> <grammar>...\n", arguments[0]);
+		return 1;
+	}
+
+	uint      grammars_count = arguments_count - 2;
+	grammar **grammars       = allocate_zeroed(grammars_count * sizeof(grammar *));
+	for (uint i = 0; i < grammars_count; ++i)
+	{
+		grammar *grammar = grammars[i] = allocate_zeroed(sizeof(*grammar));
+		read_grammar(arguments[i + 2], grammar);
+		for (uint mode = 0; mode < grammar->modes_count; ++mode)
+		{
+			grammar->mode_rules[mode] = grammar->rules_count;
+			take_grammar_rules(mode, GENERATOR_SAME_MODE, 0, grammar);
+			for (uint rule = grammar->mode_rules[mode]; rule < grammar->rules_count; ++rule)
+			{
+				if (grammar->rule_modes[rule] == GENERATOR_SAME_MODE) grammar->rule_modes[rule] = mode;
+			}
+		}
+		grammar->mode_rules[grammar->modes_count] = grammar->rules_count;
+		make_grammar_nfa(grammar);
+		make_grammar_classes(grammar);
+		make_grammar_dfa(grammar);
+		minimize_grammar_dfa(grammar);
+		merge_grammar_classes(grammar);
+	}
+
+	/* written whole or not at all, so that a failed build leaves no half of a header */
+	char temporary_path[GENERATOR_LINE_CAPACITY];
+	snprintf(temporary_path, sizeof(temporary_path), "%s.new", arguments[1]);
+	FILE *file = fopen(temporary_path, "wb");
+	if (!file)
+	{
+		fprintf(stderr, "%s cannot be written\n", temporary_path);
+		return 1;
+	}
+	fprintf(file, "/* made by text_lexer_generator from the grammars in code/lexers; do not edit */\n\n");
+	for (uint i = 0; i < grammars_count; ++i) write_grammar(file, grammars[i]);
+
+	fprintf(file, "static const text_lexer text_lexers[] =\n{\n");
+	for (uint i = 0; i < grammars_count; ++i)
+	{
+		const grammar *grammar = grammars[i];
+		const char    *name    = grammar->name;
+		fprintf(file, "\t{\n");
+		fprintf(file, "\t\t.name           = \"%s\",\n", name);
+		fprintf(file, "\t\t.extensions     = \"%s\",\n", grammar->extensions);
+		fprintf(file, "\t\t.classes        = text_lexer_%s_classes,\n", name);
+		fprintf(file, "\t\t.transitions    = text_lexer_%s_transitions,\n", name);
+		fprintf(file, "\t\t.rule_tokens    = text_lexer_%s_rule_tokens,\n", name);
+		fprintf(file, "\t\t.rule_modes     = text_lexer_%s_rule_modes,\n", name);
+		fprintf(file, "\t\t.mode_starts    = text_lexer_%s_mode_starts,\n", name);
+		fprintf(file, "\t\t.classes_count  = %u,\n", grammar->classes_count);
+		fprintf(file, "\t\t.states_count   = %u,\n", grammar->dfa_count);
+		fprintf(file, "\t\t.modes_count    = %u,\n", grammar->modes_count);
+		fprintf(file, "\t},\n");
+	}
+	fprintf(file, "};\n\n#define TEXT_LEXERS_COUNT %u\n", grammars_count);
+	remove(arguments[1]);
+	if (fclose(file) || rename(temporary_path, arguments[1]))
+	{
+		fprintf(stderr, "%s cannot be written\n", arguments[1]);
+		return 1;
+	}
+	return 0;
+}
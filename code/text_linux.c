@@ -1,5 +1,11 @@
 struct linux
 {
+	/* the main thread waits on all of these at once */
+	handle      events;
+	handle      waker;  /* written to by other threads to wake the main thread */
+	handle      timer;
+	bit         timer_armed;
+	atomic_bool woken;  /* whether `waker` was written to since the main thread last woke */
 } linux;
 
 inline uintl get_time(void)
@@ -9,18 +15,24 @@ inline uintl get_time(void)
 	return ts.tv_sec * 1000000000 + ts.tv_nsec;
 }
 
-inline void *allocate(uint size)
+inline void *allocate_pages(uint size)
 {
 	void *memory = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
 	assert(memory != MAP_FAILED);
 	return memory;
 }
 
-inline void deallocate(void *memory, uint size)
+inline void deallocate_pages(void *memory, uint size)
 {
 	assert(munmap(memory, size) != -1);
 }
 
+uint get_processors_count(void)
+{
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? count : 1;
+}
+
 inline handle open_file(const char *path)
 {
 	handle handle = open(path, O_RDONLY);
@@ -48,9 +60,394 @@ inline void close_file(handle handle)
 	assert(close(handle) != -1);
 }
 
+inline const byte *map_file(uintl size, handle handle)
+{
+	if (!size) return 0;
+	void *memory = mmap(0, size, PROT_READ, MAP_PRIVATE, handle, 0);
+	assert(memory != MAP_FAILED);
+	return memory;
+}
+
+inline void unmap_file(const byte *memory, uintl size)
+{
+	if (size) assert(munmap((void *)memory, size) != -1);
+}
+
+/* adds `handle` to what the main thread waits on; whoever owns it reads it */
+static void watch_handle(handle handle)
+{
+	struct epoll_event event = { .events = EPOLLIN, .data.fd = handle };
+	assert(epoll_ctl(linux.events, EPOLL_CTL_ADD, handle, &event) != -1);
+}
+
+void wait_for_events(uintl timeout)
+{
+	/* a zero timeout only polls, and a finite one arms the timer, which is
+	   finer than `epoll_wait`'s milliseconds */
+	int epoll_timeout = timeout ? -1 : 0;
+	if (timeout && timeout != WAIT_FOREVER)
+	{
+		struct itimerspec specification = { .it_value = { timeout / (uintl)TIME_SECONDS_FACTOR, timeout % (uintl)TIME_SECONDS_FACTOR } };
+		assert(timerfd_settime(linux.timer, 0, &specification, 0) != -1);
+		linux.timer_armed = 1;
+	}
+	else if (linux.timer_armed)
+	{
+		/* so that a stale expiration does not wake a later wait */
+		assert(timerfd_settime(linux.timer, 0, &(struct itimerspec){0}, 0) != -1);
+		linux.timer_armed = 0;
+	}
+
+	struct epoll_event events[8];
+	int events_count = epoll_wait(linux.events, events, countof(events), epoll_timeout);
+	assert(events_count != -1 || errno == EINTR);
+	for (int i = 0; i < events_count; ++i)
+	{
+		uint64 value;
+		if (events[i].data.fd == linux.waker)
+		{
+			read(linux.waker, &value, sizeof(value));
+
+			/* an exchange rather than a store, so that what was done before the
+			   wakes that this one absorbed is visible */
+			atomic_exchange(&linux.woken, 0);
+		}
+		else if (events[i].data.fd == linux.timer)
+		{
+			read(linux.timer, &value, sizeof(value));
+			linux.timer_armed = 0;
+		}
+	}
+}
+
+/* can be called from any thread; only the first call since the main thread
+   last woke writes to the eventfd */
+void wake_main_thread(void)
+{
+	if (atomic_exchange(&linux.woken, 1)) return;
+	uint64 value = 1;
+	write(linux.waker, &value, sizeof(value));
+}
+
+static int read_pseudoterminal_output(void *parameter)
+{
+	pseudoterminal *pseudoterminal = parameter;
+	for (;;)
+	{
+		uint size;
+		byte *region = begin_ring_write(&size, &pseudoterminal->output_ring);
+		if (!size)
+		{
+			if (atomic_load_explicit(&pseudoterminal->closing, memory_order_relaxed)) break;
+
+			/* the editor is behind; the program blocks on its writes meanwhile */
+			thrd_sleep(&(struct timespec){ .tv_nsec = 100000 }, 0);
+			continue;
+		}
+
+		/* wait for output, or for the pseudoterminal to be closed, which may be
+		   long before the slave side gives EIO: a background process can hold
+		   it open after the program exits */
+		struct pollfd polled[] =
+		{
+			{ .fd = pseudoterminal->output, .events = POLLIN },
+			{ .fd = pseudoterminal->closer, .events = POLLIN },
+		};
+		if (poll(polled, countof(polled), -1) == -1)
+		{
+			if (errno == EINTR) continue;
+			break;
+		}
+		if (polled[1].revents) break;
+
+		ssize_t result = read(pseudoterminal->output, region, size);
+		if (result == -1 && errno == EINTR) continue;
+
+		/* the slave side gives EIO once the program and its children exit */
+		if (result <= 0) break;
+
+		end_ring_write(result, &pseudoterminal->output_ring);
+		atomic_fetch_add_explicit(&pseudoterminal->bytes_read_count, result, memory_order_relaxed);
+		wake_main_thread();
+	}
+	atomic_store(&pseudoterminal->exited, 1);
+	wake_main_thread();
+	return 0;
+}
+
+void open_pseudoterminal(const char *program, uint columns, uint rows, pseudoterminal *pseudoterminal)
+{
+	zero(pseudoterminal, sizeof(*pseudoterminal));
+
+	handle master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+	assert(master != -1);
+	assert(!grantpt(master));
+	assert(!unlockpt(master));
+	const char *slave_path = ptsname(master);
+	assert(slave_path);
+
+	struct winsize size = { .ws_row = rows, .ws_col = columns };
+	assert(ioctl(master, TIOCSWINSZ, &size) != -1);
+
+	pid_t process = fork();
+	assert(process != -1);
+	if (!process)
+	{
+		/* become the session leader, so the slave becomes the controlling terminal */
+		setsid();
+		handle slave = open(slave_path, O_RDWR);
+		if (slave == -1) _exit(127);
+		ioctl(slave, TIOCSCTTY, 0);
+		dup2(slave, STDIN_FILENO);
+		dup2(slave, STDOUT_FILENO);
+		dup2(slave, STDERR_FILENO);
+		if (slave > STDERR_FILENO) close(slave);
+
+		signal(SIGCHLD, SIG_DFL);
+		setenv("TERM", "xterm-256color", 1);
+		execlp(program, program, (char *)0);
+		_exit(127);
+	}
+
+	pseudoterminal->input        = master;
+	pseudoterminal->output       = master;
+	pseudoterminal->closer       = eventfd(0, EFD_CLOEXEC);
+	pseudoterminal->process      = process;
+	pseudoterminal->opening_time = get_time();
+	assert(pseudoterminal->closer != -1);
+	initialize_ring(PSEUDOTERMINAL_OUTPUT_CAPACITY, ALLOCATION_TAG_TERMINAL, &pseudoterminal->output_ring);
+	assert(thrd_create(&pseudoterminal->reader, read_pseudoterminal_output, pseudoterminal) == thrd_success);
+}
+
+void close_pseudoterminal(pseudoterminal *pseudoterminal)
+{
+	/* the reader stops without waiting for the slave side to be let go */
+	atomic_store(&pseudoterminal->closing, 1);
+	uint64 value = 1;
+	write(pseudoterminal->closer, &value, sizeof(value));
+
+	/* hang up the whole session, and kill it if the program ignores that */
+	kill(-pseudoterminal->process, SIGHUP);
+	uintl hanging_up_time = get_time();
+	for (;;)
+	{
+		pid_t result = waitpid(pseudoterminal->process, 0, WNOHANG);
+		if (result == pseudoterminal->process || (result == -1 && errno != EINTR)) break;
+		if (get_time() - hanging_up_time >= PSEUDOTERMINAL_HANGUP_TIMEOUT)
+		{
+			report_caution("%i ignored the hangup, so it is killed\n", pseudoterminal->process);
+			kill(-pseudoterminal->process, SIGKILL);
+			while (waitpid(pseudoterminal->process, 0, 0) == -1 && errno == EINTR);
+			break;
+		}
+		thrd_sleep(&(struct timespec){ .tv_nsec = 1000000 }, 0);
+	}
+	thrd_join(pseudoterminal->reader, 0);
+	close(pseudoterminal->output);
+	close(pseudoterminal->closer);
+
+	float64 elapsed_time = (float64)(get_time() - pseudoterminal->opening_time) / TIME_SECONDS_FACTOR;
+	float64 megabytes    = (float64)atomic_load(&pseudoterminal->bytes_read_count) / (1 << 20);
+	report_verbose("pseudoterminal read %.1f MB in %.1f s (%.1f MB/s)\n", megabytes, elapsed_time, megabytes / elapsed_time);
+
+	terminate_ring(&pseudoterminal->output_ring);
+}
+
+uint write_to_pseudoterminal(const void *data, uint size, pseudoterminal *pseudoterminal)
+{
+	uint written_size = 0;
+	while (written_size < size)
+	{
+		ssize_t result = write(pseudoterminal->input, (const byte *)data + written_size, size - written_size);
+		if (result == -1 && errno == EINTR) continue;
+		if (result <= 0) break;
+		written_size += result;
+	}
+	return written_size;
+}
+
+void resize_pseudoterminal(uint columns, uint rows, pseudoterminal *pseudoterminal)
+{
+	struct winsize size = { .ws_row = rows, .ws_col = columns };
+	ioctl(pseudoterminal->input, TIOCSWINSZ, &size);
+}
+
+/* copies what is left of `source` to `destination`, through interruptions and
+   short writes; `errno` tells why it did not */
+static bit copy_file_data(handle source, handle destination)
+{
+	byte buffer[64 << 10];
+	for (;;)
+	{
+		ssize_t size = read(source, buffer, sizeof(buffer));
+		if (size == -1 && errno == EINTR) continue;
+		if (size == -1) return 0;
+		if (size == 0)  return 1;
+		for (ssize_t written = 0; written < size;)
+		{
+			ssize_t result = write(destination, buffer + written, size - written);
+			if (result == -1 && errno == EINTR) continue;
+			if (result == -1) return 0;
+			written += result;
+		}
+	}
+}
+
+/* loads a copy of the plugin's library, so that the compiler can rewrite the
+   library while the copy runs, and so that `dlopen` does not return the copy
+   that is already open */
+static bit open_plugin_library(plugin *plugin)
+{
+	char copy_path[PATH_MAX];
+	snprintf(copy_path, sizeof(copy_path), "%s.%u", plugin->path, plugin->version + 1);
+
+	handle source = open(plugin->path, O_RDONLY | O_CLOEXEC);
+	if (source == -1) return 0;
+	handle destination = open(copy_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0755);
+	if (destination == -1)
+	{
+		report_caution("could not create %s: %s\n", copy_path, strerror(errno));
+		close(source);
+		return 0;
+	}
+	bit copied = copy_file_data(source, destination);
+	int error  = errno;
+	close(source);
+	if (close(destination) == -1 && copied) copied = 0, error = errno;
+	if (!copied)
+	{
+		report_caution("could not copy %s to %s: %s\n", plugin->path, copy_path, strerror(error));
+		unlink(copy_path);
+		return 0;
+	}
+
+	void *library = dlopen(copy_path, RTLD_NOW | RTLD_LOCAL);
+	if (!library)
+	{
+		report_caution("could not load %s: %s\n", plugin->path, dlerror());
+		unlink(copy_path);
+		return 0;
+	}
+	plugin_initialize_function *initialize = (plugin_initialize_function *)dlsym(library, "initialize");
+	plugin_tick_function       *tick       = (plugin_tick_function *)dlsym(library, "tick");
+	plugin_terminate_function  *terminate  = (plugin_terminate_function *)dlsym(library, "terminate");
+	if (!initialize || !tick || !terminate)
+	{
+		report_caution("%s does not export initialize, tick and terminate\n", plugin->path);
+		dlclose(library);
+		unlink(copy_path);
+		return 0;
+	}
+
+	/* the new copy is good, so let go of the old one */
+	if (plugin->library)
+	{
+		flush_reports();
+		dlclose(plugin->library);
+		snprintf(copy_path, sizeof(copy_path), "%s.%u", plugin->path, plugin->version);
+		unlink(copy_path);
+	}
+	plugin->library    = library;
+	plugin->initialize = initialize;
+	plugin->tick       = tick;
+	plugin->terminate  = terminate;
+	plugin->version   += 1;
+	return 1;
+}
+
+void load_plugin(const char *path, plugin *plugin)
+{
+	zero(plugin, sizeof(*plugin));
+	plugin->path   = path;
+	plugin->memory = allocate(PLUGIN_MEMORY_CAPACITY, ALLOCATION_TAG_PLUGIN);
+
+	/* watch the directory rather than the file, which the compiler may replace */
+	plugin->watcher = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	assert(plugin->watcher != -1);
+	char directory[PATH_MAX];
+	snprintf(directory, sizeof(directory), "%s", path);
+	char *separator = strrchr(directory, '/');
+	if (separator) *separator = 0;
+	else directory[0] = '.', directory[1] = 0;
+	int watch = inotify_add_watch(plugin->watcher, directory, IN_CLOSE_WRITE | IN_MOVED_TO);
+	assert(watch != -1);
+	watch_handle(plugin->watcher);
+
+	/* without its library the host runs on, and loads it once it is built */
+	if (!open_plugin_library(plugin))
+	{
+		report_caution("could not load %s; it is loaded once it is built\n", path);
+		return;
+	}
+	plugin->initialize(&global.interface, plugin->memory, 0);
+}
+
+void unload_plugin(plugin *plugin)
+{
+	if (plugin->library)
+	{
+		plugin->terminate();
+		flush_reports();
+		dlclose(plugin->library);
+		char copy_path[PATH_MAX];
+		snprintf(copy_path, sizeof(copy_path), "%s.%u", plugin->path, plugin->version);
+		unlink(copy_path);
+	}
+	close(plugin->watcher);
+	deallocate(plugin->memory, PLUGIN_MEMORY_CAPACITY, ALLOCATION_TAG_PLUGIN);
+}
+
+/* swaps in the plugin's library if it was rewritten since the last frame; its
+   memory stays as it is */
+void update_plugin(plugin *plugin)
+{
+	const char *name = strrchr(plugin->path, '/');
+	name = name ? name + 1 : plugin->path;
+
+	bit changed = 0;
+	alignas(struct inotify_event) byte buffer[4096];
+	ssize_t size;
+	while ((size = read(plugin->watcher, buffer, sizeof(buffer))) > 0)
+	{
+		for (byte *event_memory = buffer; event_memory < buffer + size;)
+		{
+			const struct inotify_event *event = (const struct inotify_event *)event_memory;
+			if (event->len && !compare_string(event->name, name)) changed = 1;
+			event_memory += sizeof(struct inotify_event) + event->len;
+		}
+	}
+	if (!changed) return;
+
+	bit reloaded = plugin->library != 0;
+	if (open_plugin_library(plugin))
+	{
+		report_comment("%s %s\n", reloaded ? "reloaded" : "loaded", plugin->path);
+		plugin->initialize(&global.interface, plugin->memory, reloaded);
+	}
+}
+
+/* there is no window on Linux yet, so the frame is empty */
+bit get_window_frame_rect(rect *rect)
+{
+	zero(rect, sizeof(*rect));
+	return 0;
+}
+
 static void initialize(void)
 {
-	/* create the window */
+	/* create what the main thread waits on */
+	{
+		linux.events = epoll_create1(EPOLL_CLOEXEC);
+		assert(linux.events != -1);
+		linux.waker = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		assert(linux.waker != -1);
+		linux.timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+		assert(linux.timer != -1);
+		watch_handle(linux.waker);
+		watch_handle(linux.timer);
+	}
+
+	/* create the window; its connection's handle is to be watched as well */
 	{
 
 	}
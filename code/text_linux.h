@@ -1,8 +1,31 @@
 #pragma once
 
+#define _GNU_SOURCE
+
+/* GNU modes predefine `linux`, which names the platform's state */
+#undef linux
+
 #include <sys/mman.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <termios.h>
+#include <dlfcn.h>
+#include <limits.h>
+#include <string.h>
+#include <stdalign.h>
+#include <sys/inotify.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <poll.h>
 
 typedef int handle;
+
+#define PLUGIN_DEFAULT_PATH "build/text_terminal.so"
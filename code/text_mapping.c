@@ -0,0 +1,182 @@
+/*
+
+key mappings are a trie: each key of a chord leads from a node to its child,
+and the node that the last key leads to holds the message. the edges of every
+node are kept in one open-addressed table, keyed by the node and the key, so
+a key press is dispatched with a single probe however many mappings there are.
+
+*/
+
+#define MAPPING_EDGES_INITIAL_CAPACITY 256
+#define MAPPING_NODES_INITIAL_CAPACITY 128
+
+inline static uint32 pack_key(key key)
+{
+	return (uint32)key.modifiers << 16 | key.code;
+}
+
+inline static uint hash_mapping_edge(uint32 node, uint32 key, uint capacity)
+{
+	uint64 hash = ((uint64)node << 32 | key) * 0x9e3779b97f4a7c15ull;
+	return (hash >> 32) & (capacity - 1);
+}
+
+void initialize_mappings(mapping_table *mappings)
+{
+	zero(mappings, sizeof(*mappings));
+	mappings->edges_capacity = MAPPING_EDGES_INITIAL_CAPACITY;
+	mappings->edges          = allocate(mappings->edges_capacity * sizeof(mapping_edge), ALLOCATION_TAG_MAPPINGS);
+	zero(mappings->edges, mappings->edges_capacity * sizeof(mapping_edge));
+	mappings->nodes_capacity = MAPPING_NODES_INITIAL_CAPACITY;
+	mappings->nodes          = allocate(mappings->nodes_capacity * sizeof(mapping_node), ALLOCATION_TAG_MAPPINGS);
+	mappings->nodes[MAPPING_ROOT_NODE] = (mapping_node){0};
+	mappings->nodes_count    = 1;
+	mappings->chord_node     = MAPPING_ROOT_NODE;
+}
+
+void terminate_mappings(mapping_table *mappings)
+{
+	deallocate(mappings->edges, mappings->edges_capacity * sizeof(mapping_edge), ALLOCATION_TAG_MAPPINGS);
+	deallocate(mappings->nodes, mappings->nodes_capacity * sizeof(mapping_node), ALLOCATION_TAG_MAPPINGS);
+	if (mappings->messages) deallocate(mappings->messages, mappings->messages_capacity * sizeof(message), ALLOCATION_TAG_MAPPINGS);
+}
+
+static uint find_mapping_child(uint32 node, uint32 key, const mapping_table *mappings)
+{
+	for (uint i = hash_mapping_edge(node, key, mappings->edges_capacity);; i = (i + 1) & (mappings->edges_capacity - 1))
+	{
+		const mapping_edge *edge = &mappings->edges[i];
+		if (!edge->key) return MAPPING_NO_NODE;
+		if (edge->node == node && edge->key == key) return edge->child;
+	}
+}
+
+static void insert_mapping_edge(uint32 node, uint32 key, uint32 child, mapping_table *mappings)
+{
+	uint i = hash_mapping_edge(node, key, mappings->edges_capacity);
+	while (mappings->edges[i].key) i = (i + 1) & (mappings->edges_capacity - 1);
+	mappings->edges[i] = (mapping_edge){ node, key, child };
+	mappings->edges_count += 1;
+}
+
+/* keeps the table at most half full, so probes stay short */
+static void grow_mapping_edges(mapping_table *mappings)
+{
+	mapping_edge *edges          = mappings->edges;
+	uint          edges_capacity = mappings->edges_capacity;
+
+	mappings->edges_capacity = edges_capacity * 2;
+	mappings->edges          = allocate(mappings->edges_capacity * sizeof(mapping_edge), ALLOCATION_TAG_MAPPINGS);
+	mappings->edges_count    = 0;
+	zero(mappings->edges, mappings->edges_capacity * sizeof(mapping_edge));
+	for (uint i = 0; i < edges_capacity; ++i)
+	{
+		if (edges[i].key) insert_mapping_edge(edges[i].node, edges[i].key, edges[i].child, mappings);
+	}
+	deallocate(edges, edges_capacity * sizeof(mapping_edge), ALLOCATION_TAG_MAPPINGS);
+}
+
+static uint push_mapping_node(mapping_table *mappings)
+{
+	if (mappings->nodes_count == mappings->nodes_capacity)
+	{
+		mapping_node *nodes = allocate(mappings->nodes_capacity * 2 * sizeof(mapping_node), ALLOCATION_TAG_MAPPINGS);
+		copy(nodes, mappings->nodes, mappings->nodes_count * sizeof(mapping_node));
+		deallocate(mappings->nodes, mappings->nodes_capacity * sizeof(mapping_node), ALLOCATION_TAG_MAPPINGS);
+		mappings->nodes           = nodes;
+		mappings->nodes_capacity *= 2;
+	}
+	mappings->nodes[mappings->nodes_count] = (mapping_node){0};
+	return mappings->nodes_count++;
+}
+
+void push_message(const message *input_message)
+{
+	mapping_table *mappings = &global.mappings;
+	if (input_message->tag >= mappings->messages_capacity)
+	{
+		uint     messages_capacity = mappings->messages_capacity ? mappings->messages_capacity : 64;
+		while (messages_capacity <= input_message->tag) messages_capacity *= 2;
+		message *messages = allocate(messages_capacity * sizeof(message), ALLOCATION_TAG_MAPPINGS);
+		if (mappings->messages)
+		{
+			copy(messages, mappings->messages, mappings->messages_capacity * sizeof(message));
+			deallocate(mappings->messages, mappings->messages_capacity * sizeof(message), ALLOCATION_TAG_MAPPINGS);
+		}
+		mappings->messages          = messages;
+		mappings->messages_capacity = messages_capacity;
+	}
+
+	message *message   = &mappings->messages[input_message->tag];
+	*message           = *input_message;
+	message->is_custom = 1;
+}
+
+/* a later mapping of the same keys replaces the earlier */
+void push_mapping(const mapping *mapping)
+{
+	mapping_table *mappings = &global.mappings;
+
+	uint node = MAPPING_ROOT_NODE;
+	for (uint i = 0; i < MAPPING_KEYS_CAPACITY && mapping->keys[i].code != KEY_CODE_NONE; ++i)
+	{
+		uint32 key   = pack_key(mapping->keys[i]);
+		uint   child = find_mapping_child(node, key, mappings);
+		if (child == MAPPING_NO_NODE)
+		{
+			if ((mappings->edges_count + 1) * 2 > mappings->edges_capacity) grow_mapping_edges(mappings);
+			child = push_mapping_node(mappings);
+			insert_mapping_edge(node, key, child, mappings);
+		}
+		if (node != MAPPING_ROOT_NODE) mappings->nodes[node].has_children = 1;
+		node = child;
+	}
+	assert(node != MAPPING_ROOT_NODE);
+
+	mappings->nodes[node].message     = mapping->message;
+	mappings->nodes[node].has_message = 1;
+}
+
+void raise_message(uint tag)
+{
+	mapping_table *mappings  = &global.mappings;
+	interface     *interface = &global.interface;
+	assert(tag < mappings->messages_capacity);
+	if (interface->events_count == INTERFACE_EVENTS_CAPACITY)
+	{
+		report_caution("dropped message: %s\n", mappings->messages[tag].name);
+		return;
+	}
+	interface->messages[interface->events_count++] = mappings->messages[tag];
+}
+
+/* raises the message that `key` completes, if any. returns whether the key
+   was taken by a mapping; if not, it is for whatever has the focus. */
+bit dispatch_key(key key)
+{
+	mapping_table *mappings = &global.mappings;
+	uint32         packed   = pack_key(key);
+
+	uint child = find_mapping_child(mappings->chord_node, packed, mappings);
+	if (child == MAPPING_NO_NODE && mappings->chord_node != MAPPING_ROOT_NODE)
+	{
+		/* releasing the keys of a chord does not break it */
+		if (!(key.modifiers & KEY_MODIFIER_PRESSED)) return 1;
+
+		/* the chord ends here, but what was pressed of it may be a mapping of its own */
+		const mapping_node *node = &mappings->nodes[mappings->chord_node];
+		if (node->has_message) raise_message(node->message);
+		mappings->chord_node = MAPPING_ROOT_NODE;
+		child = find_mapping_child(MAPPING_ROOT_NODE, packed, mappings);
+	}
+	if (child == MAPPING_NO_NODE) return 0;
+
+	const mapping_node *node = &mappings->nodes[child];
+	if (node->has_children) mappings->chord_node = child;
+	else
+	{
+		raise_message(node->message);
+		mappings->chord_node = MAPPING_ROOT_NODE;
+	}
+	return 1;
+}
@@ -0,0 +1,1065 @@
+/*
+
+a pattern is parsed straight into a Thompson automaton over bytes, once as it
+reads and once reversed. whatever takes a code point, such as `.` or a negated
+class, takes it as one of the sequences of bytes that UTF-8 allows, so an
+automaton never stops within a code point.
+
+the automata are run as deterministic ones, whose states are made as the text
+reaches them: a state is a set of program states, and its transitions are by
+class of bytes, the bytes that no set of the pattern tells apart. the states
+of an automaton are kept until they outgrow their cache, and are then all
+forgotten, so a pattern that makes a state at every byte is as slow as the
+program would be, but never slower.
+
+the syntax is that of extended regular expressions: `|`, `*`, `+`, `?`, `{m}`,
+`{m,}`, `{m,n}`, groups, `.`, classes, `\d`, `\w`, `\s` and their negations,
+and `^` and `$` at the ends of the pattern. `.` and negated classes do not take
+the end of a line.
+
+*/
+
+#define REGEX_UNKNOWN_TRANSITION UINT32_MAX
+#define REGEX_MATCHING_STATE     ((uint32)1 << 31)  /* marks a transition to a matching state */
+#define REGEX_DEAD_STATE         0
+#define REGEX_IDLE_STATE         1  /* of the searcher, where no match is under way */
+#define REGEX_REPETITIONS_LIMIT  1000
+
+/* the elements of a set that are not program states */
+#define REGEX_GROUP_END (REGEX_NO_STATE - 1)
+#define REGEX_SEARCHING (REGEX_NO_STATE - 2)  /* the set begins another match at the next position */
+
+#define REGEX_CLOSURE_CAPACITY ((REGEX_STATES_CAPACITY + 1) * 2 + 1)
+
+typedef struct
+{
+	uint32 start;
+	uint32 outs;  /* the fields that are left to point at what follows, chained through themselves */
+} regex_fragment;
+
+typedef struct
+{
+	const byte    *source;
+	uint           size;
+	uint           position;
+	text_regex    *regex;
+	regex_program *program;
+	bit            reversed;
+	const char    *error;
+} regex_parser;
+
+inline static bit has_regex_set_byte(const uint64 *set, byte b)
+{
+	return (set[b >> 6] >> (b & 63)) & 1;
+}
+
+inline static void add_regex_set_range(uint64 *set, byte low, byte high)
+{
+	for (uint b = low; b <= high; ++b) set[b >> 6] |= (uint64)1 << (b & 63);
+}
+
+static uint add_regex_set(const uint64 *set, regex_parser *parser)
+{
+	text_regex *regex = parser->regex;
+	for (uint i = 0; i < regex->sets_count; ++i)
+	{
+		if (!compare(regex->sets[i], set, sizeof(regex->sets[i]))) return i;
+	}
+	if (regex->sets_count == REGEX_SETS_CAPACITY)
+	{
+		parser->error = "too many classes";
+		return 0;
+	}
+	copy(regex->sets[regex->sets_count], set, sizeof(regex->sets[0]));
+	return regex->sets_count++;
+}
+
+static uint32 emit_regex_state(regex_state_kind kind, uint set, regex_parser *parser)
+{
+	regex_program *program = parser->program;
+	if (program->states_count == REGEX_STATES_CAPACITY)
+	{
+		/* the spare state takes what does not fit until the error is seen */
+		parser->error = "the pattern is too complex";
+		program->states[REGEX_STATES_CAPACITY] = (regex_state){ REGEX_NO_STATE, REGEX_NO_STATE, 0, REGEX_STATE_EMPTY };
+		return REGEX_STATES_CAPACITY;
+	}
+	program->states[program->states_count] = (regex_state){ REGEX_NO_STATE, REGEX_NO_STATE, set, kind };
+	return program->states_count++;
+}
+
+inline static uint32 *get_regex_out(uint32 out, regex_program *program)
+{
+	regex_state *state = &program->states[out >> 1];
+	return out & 1 ? &state->alternative : &state->next;
+}
+
+static void patch_regex_outs(uint32 outs, uint32 target, regex_program *program)
+{
+	while (outs != REGEX_NO_STATE)
+	{
+		uint32 *out = get_regex_out(outs, program);
+		outs = *out;
+		*out = target;
+	}
+}
+
+static uint32 append_regex_outs(uint32 outs, uint32 other_outs, regex_program *program)
+{
+	if (outs == REGEX_NO_STATE) return other_outs;
+	uint32 last = outs;
+	for (uint32 next = *get_regex_out(last, program); next != REGEX_NO_STATE; next = *get_regex_out(last, program)) last = next;
+	*get_regex_out(last, program) = other_outs;
+	return outs;
+}
+
+static regex_fragment make_regex_bytes(const uint64 *set, regex_parser *parser)
+{
+	uint32 state = emit_regex_state(REGEX_STATE_BYTES, add_regex_set(set, parser), parser);
+	return (regex_fragment){ state, state << 1 };
+}
+
+static regex_fragment make_regex_empty(regex_parser *parser)
+{
+	uint32 state = emit_regex_state(REGEX_STATE_EMPTY, 0, parser);
+	return (regex_fragment){ state, state << 1 };
+}
+
+/* `first` is what comes first in the text, whichever way it is read */
+static regex_fragment concatenate_regex(regex_fragment first, regex_fragment second, regex_parser *parser)
+{
+	if (parser->reversed)
+	{
+		regex_fragment swapped = first;
+		first  = second;
+		second = swapped;
+	}
+	patch_regex_outs(first.outs, second.start, parser->program);
+	return (regex_fragment){ first.start, second.outs };
+}
+
+static regex_fragment alternate_regex(regex_fragment fragment, regex_fragment other, regex_parser *parser)
+{
+	uint32 state = emit_regex_state(REGEX_STATE_SPLIT, 0, parser);
+	parser->program->states[state].next        = fragment.start;
+	parser->program->states[state].alternative = other.start;
+	return (regex_fragment){ state, append_regex_outs(fragment.outs, other.outs, parser->program) };
+}
+
+static regex_fragment repeat_regex(regex_fragment fragment, byte operator, regex_parser *parser)
+{
+	uint32 state = emit_regex_state(REGEX_STATE_SPLIT, 0, parser);
+	parser->program->states[state].next = fragment.start;
+	switch (operator)
+	{
+	case '*':
+		patch_regex_outs(fragment.outs, state, parser->program);
+		return (regex_fragment){ state, state << 1 | 1 };
+	case '+':
+		patch_regex_outs(fragment.outs, state, parser->program);
+		return (regex_fragment){ fragment.start, state << 1 | 1 };
+	case '?':
+		return (regex_fragment){ state, append_regex_outs(fragment.outs, state << 1 | 1, parser->program) };
+	default: unreachable();
+	}
+}
+
+/* the bytes of a code point, as a sequence */
+static regex_fragment make_regex_sequence(const byte *bytes, uint size, regex_parser *parser)
+{
+	regex_fragment fragment = {0};
+	for (uint i = 0; i < size; ++i)
+	{
+		uint64 set[4] = {0};
+		add_regex_set_range(set, bytes[i], bytes[i]);
+		regex_fragment next = make_regex_bytes(set, parser);
+		fragment = i ? concatenate_regex(fragment, next, parser) : next;
+	}
+	return fragment;
+}
+
+/* any code point: a byte of `ascii`, or any sequence of two to four bytes */
+static regex_fragment make_regex_code_point(const uint64 *ascii, regex_parser *parser)
+{
+	static const byte leads[3][2] = { { 0xc2, 0xdf }, { 0xe0, 0xef }, { 0xf0, 0xf4 } };
+
+	regex_fragment fragment = make_regex_bytes(ascii, parser);
+	for (uint length = 0; length < 3; ++length)
+	{
+		uint64 lead[4] = {0};
+		add_regex_set_range(lead, leads[length][0], leads[length][1]);
+		regex_fragment sequence = make_regex_bytes(lead, parser);
+		for (uint i = 0; i <= length; ++i)
+		{
+			uint64 continuation[4] = {0};
+			add_regex_set_range(continuation, 0x80, 0xbf);
+			sequence = concatenate_regex(sequence, make_regex_bytes(continuation, parser), parser);
+		}
+		fragment = alternate_regex(fragment, sequence, parser);
+	}
+	return fragment;
+}
+
+inline static bit is_regex_end(const regex_parser *parser)
+{
+	return parser->position == parser->size;
+}
+
+inline static byte peek_regex(const regex_parser *parser)
+{
+	return is_regex_end(parser) ? 0 : parser->source[parser->position];
+}
+
+static uint get_utf8_size(byte lead)
+{
+	if (lead < 0x80)           return 1;
+	if ((lead & 0xe0) == 0xc0) return 2;
+	if ((lead & 0xf0) == 0xe0) return 3;
+	if ((lead & 0xf8) == 0xf0) return 4;
+	return 1;
+}
+
+/* the ASCII of `\d`, `\w` and `\s`; returns whether it is one of them, negated or not */
+static bit get_regex_shorthand(byte letter, uint64 *set, bit *negated)
+{
+	zero(set, 4 * sizeof(uint64));
+	*negated = letter >= 'A' && letter <= 'Z';
+	switch (letter | 0x20)
+	{
+	case 'd':
+		add_regex_set_range(set, '0', '9');
+		return 1;
+	case 'w':
+		add_regex_set_range(set, '0', '9');
+		add_regex_set_range(set, 'a', 'z');
+		add_regex_set_range(set, 'A', 'Z');
+		add_regex_set_range(set, '_', '_');
+		return 1;
+	case 's':
+		add_regex_set_range(set, '\t', '\r');
+		add_regex_set_range(set, ' ', ' ');
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+static byte get_regex_escaped_byte(byte letter)
+{
+	switch (letter)
+	{
+	case 'n': return '\n';
+	case 't': return '\t';
+	case 'r': return '\r';
+	case 'f': return '\f';
+	case 'v': return '\v';
+	case '0': return 0;
+	default:  return letter;
+	}
+}
+
+/* the complement of `set` within ASCII, without the end of a line */
+static void negate_regex_set(uint64 *set)
+{
+	set[0] = ~set[0];
+	set[1] = ~set[1];
+	set[2] = 0;
+	set[3] = 0;
+	set['\n' >> 6] &= ~((uint64)1 << ('\n' & 63));
+}
+
+static regex_fragment parse_regex_class(regex_parser *parser)
+{
+	uint64         set[4]   = {0};
+	bit            negated  = 0;
+	regex_fragment multibyte = {0};
+	bit            has_multibyte = 0;
+
+	if (peek_regex(parser) == '^')
+	{
+		negated = 1;
+		parser->position += 1;
+	}
+	for (bit first = 1; !is_regex_end(parser) && (first || peek_regex(parser) != ']'); first = 0)
+	{
+		byte b = parser->source[parser->position++];
+		if (b == '\\' && !is_regex_end(parser))
+		{
+			byte   letter = parser->source[parser->position++];
+			uint64 shorthand[4];
+			bit    shorthand_negated;
+			if (get_regex_shorthand(letter, shorthand, &shorthand_negated))
+			{
+				if (shorthand_negated) negate_regex_set(shorthand);
+				for (uint i = 0; i < 4; ++i) set[i] |= shorthand[i];
+				continue;
+			}
+			b = get_regex_escaped_byte(letter);
+		}
+		else if (b >= 0x80)
+		{
+			/* a code point beyond ASCII is one more sequence, and cannot begin a range */
+			uint size = get_utf8_size(b);
+			if (negated || parser->position - 1 + size > parser->size || peek_regex(parser) == '-')
+			{
+				parser->error = "classes take code points beyond ASCII only one by one, and not negated";
+				return make_regex_empty(parser);
+			}
+			regex_fragment sequence = make_regex_sequence(parser->source + parser->position - 1, size, parser);
+			multibyte     = has_multibyte ? alternate_regex(multibyte, sequence, parser) : sequence;
+			has_multibyte = 1;
+			parser->position += size - 1;
+			continue;
+		}
+
+		byte high = b;
+		if (peek_regex(parser) == '-' && parser->position + 1 < parser->size && parser->source[parser->position + 1] != ']')
+		{
+			parser->position += 1;
+			high = parser->source[parser->position++];
+			if (high == '\\' && !is_regex_end(parser)) high = get_regex_escaped_byte(parser->source[parser->position++]);
+			if (high < b || high >= 0x80)
+			{
+				parser->error = "a range is out of order or beyond ASCII";
+				return make_regex_empty(parser);
+			}
+		}
+		add_regex_set_range(set, b, high);
+	}
+	if (is_regex_end(parser))
+	{
+		parser->error = "a class is not closed";
+		return make_regex_empty(parser);
+	}
+	parser->position += 1;
+
+	if (negated)
+	{
+		negate_regex_set(set);
+		return make_regex_code_point(set, parser);
+	}
+	if (!has_multibyte) return make_regex_bytes(set, parser);
+	if (!set[0] && !set[1]) return multibyte;
+	return alternate_regex(make_regex_bytes(set, parser), multibyte, parser);
+}
+
+static regex_fragment parse_regex_alternation(regex_parser *parser);
+
+static regex_fragment parse_regex_atom(regex_parser *parser)
+{
+	byte b = parser->source[parser->position++];
+	switch (b)
+	{
+	case '(':
+	{
+		if (parser->position + 1 < parser->size && parser->source[parser->position] == '?' && parser->source[parser->position + 1] == ':') parser->position += 2;
+		regex_fragment fragment = parse_regex_alternation(parser);
+		if (peek_regex(parser) != ')')
+		{
+			parser->error = "a group is not closed";
+			return fragment;
+		}
+		parser->position += 1;
+		return fragment;
+	}
+	case '[':
+		return parse_regex_class(parser);
+	case '.':
+	{
+		uint64 set[4] = {0};
+		negate_regex_set(set);
+		return make_regex_code_point(set, parser);
+	}
+	case '\\':
+	{
+		if (is_regex_end(parser))
+		{
+			parser->error = "the pattern ends with an escape";
+			return make_regex_empty(parser);
+		}
+		byte   letter = parser->source[parser->position++];
+		uint64 set[4];
+		bit    negated;
+		if (get_regex_shorthand(letter, set, &negated))
+		{
+			if (!negated) return make_regex_bytes(set, parser);
+			negate_regex_set(set);
+			return make_regex_code_point(set, parser);
+		}
+		if ((letter | 0x20) == 'b')
+		{
+			parser->error = "word boundaries are unsupported";
+			return make_regex_empty(parser);
+		}
+		byte escaped = get_regex_escaped_byte(letter);
+		return make_regex_sequence(&escaped, 1, parser);
+	}
+	case ')':
+	case '*':
+	case '+':
+	case '?':
+	case '{':
+	case '|':
+		parser->error = "an operator has nothing to apply to";
+		return make_regex_empty(parser);
+	case '^':
+	case '$':
+		parser->error = "anchors are only supported at the ends of the pattern";
+		return make_regex_empty(parser);
+	default:
+	{
+		uint size = get_utf8_size(b);
+		if (parser->position - 1 + size > parser->size) size = 1;
+		regex_fragment fragment = make_regex_sequence(parser->source + parser->position - 1, size, parser);
+		parser->position += size - 1;
+		return fragment;
+	}
+	}
+}
+
+static bit parse_regex_count(regex_parser *parser, uint *count)
+{
+	if (peek_regex(parser) < '0' || peek_regex(parser) > '9') return 0;
+	uint value = 0;
+	while (peek_regex(parser) >= '0' && peek_regex(parser) <= '9' && value <= REGEX_REPETITIONS_LIMIT) value = value * 10 + (parser->source[parser->position++] - '0');
+	*count = value;
+	return 1;
+}
+
+static regex_fragment parse_regex_repetition(regex_parser *parser)
+{
+	uint           atom_position = parser->position;
+	regex_fragment fragment      = parse_regex_atom(parser);
+	for (;;)
+	{
+		byte operator = peek_regex(parser);
+		if (operator == '*' || operator == '+' || operator == '?')
+		{
+			parser->position += 1;
+			fragment = repeat_regex(fragment, operator, parser);
+		}
+		else if (operator == '{')
+		{
+			/* a counted repetition is of the atom alone, which is parsed again for every copy */
+			uint minimum, maximum;
+			parser->position += 1;
+			if (!parse_regex_count(parser, &minimum))
+			{
+				parser->error = "a repetition has no count";
+				return fragment;
+			}
+			maximum = minimum;
+			if (peek_regex(parser) == ',')
+			{
+				parser->position += 1;
+				if (!parse_regex_count(parser, &maximum)) maximum = UINT_MAXIMUM;
+			}
+			if (peek_regex(parser) != '}' || maximum < minimum || minimum > REGEX_REPETITIONS_LIMIT || (maximum != UINT_MAXIMUM && maximum > REGEX_REPETITIONS_LIMIT))
+			{
+				parser->error = "a repetition is malformed or too long";
+				return fragment;
+			}
+			uint end_position = ++parser->position;
+
+			regex_fragment repetition = minimum ? fragment : make_regex_empty(parser);
+			for (uint i = 1; i < minimum && !parser->error; ++i)
+			{
+				parser->position = atom_position;
+				repetition = concatenate_regex(repetition, parse_regex_atom(parser), parser);
+			}
+			if (maximum == UINT_MAXIMUM)
+			{
+				if (minimum) parser->position = atom_position;
+				regex_fragment copy = minimum ? parse_regex_atom(parser) : fragment;
+				repetition = concatenate_regex(repetition, repeat_regex(copy, '*', parser), parser);
+			}
+			for (uint i = minimum; maximum != UINT_MAXIMUM && i < maximum && !parser->error; ++i)
+			{
+				regex_fragment copy = fragment;
+				if (i || minimum)
+				{
+					parser->position = atom_position;
+					copy = parse_regex_atom(parser);
+				}
+				repetition = concatenate_regex(repetition, repeat_regex(copy, '?', parser), parser);
+			}
+			parser->position = end_position;
+			fragment         = repetition;
+		}
+		else break;
+
+		/* a lazy repetition is the same as a greedy one, since matches are the longest */
+		if (peek_regex(parser) == '?') parser->position += 1;
+	}
+	return fragment;
+}
+
+static regex_fragment parse_regex_concatenation(regex_parser *parser)
+{
+	regex_fragment fragment = {0};
+	bit            empty    = 1;
+	while (!is_regex_end(parser) && peek_regex(parser) != '|' && peek_regex(parser) != ')' && !parser->error)
+	{
+		regex_fragment next = parse_regex_repetition(parser);
+		fragment = empty ? next : concatenate_regex(fragment, next, parser);
+		empty    = 0;
+	}
+	return empty ? make_regex_empty(parser) : fragment;
+}
+
+static regex_fragment parse_regex_alternation(regex_parser *parser)
+{
+	regex_fragment fragment = parse_regex_concatenation(parser);
+	while (peek_regex(parser) == '|' && !parser->error)
+	{
+		parser->position += 1;
+		fragment = alternate_regex(fragment, parse_regex_concatenation(parser), parser);
+	}
+	return fragment;
+}
+
+static const char *compile_regex_program(const byte *source, uint size, bit reversed, text_regex *regex, regex_program *program)
+{
+	program->states       = allocate((REGEX_STATES_CAPACITY + 1) * sizeof(regex_state), ALLOCATION_TAG_SEARCH);
+	program->states_count = 0;
+
+	regex_parser   parser   = { source, size, 0, regex, program, reversed, 0 };
+	regex_fragment fragment = parse_regex_alternation(&parser);
+	if (!parser.error && !is_regex_end(&parser)) parser.error = "a group is closed that was not opened";
+
+	/* the end of a line that `$` or `^` asks for is read as a byte, after the
+	   match or, reading back, before it */
+	uint64 newline[4] = {0};
+	add_regex_set_range(newline, '\n', '\n');
+	if (!reversed && regex->line_end)      fragment = concatenate_regex(fragment, make_regex_bytes(newline, &parser), &parser);
+	if (reversed && regex->line_beginning) fragment = concatenate_regex(make_regex_bytes(newline, &parser), fragment, &parser);
+
+	uint32 match = emit_regex_state(REGEX_STATE_MATCH, 0, &parser);
+	patch_regex_outs(fragment.outs, match, program);
+	program->start = fragment.start;
+	return parser.error;
+}
+
+/* the literal that every match begins with, unless the pattern has alternatives */
+static void extract_regex_prefix(const byte *source, uint size, text_regex *regex)
+{
+	uint depth = 0;
+	for (uint i = 0; i < size; ++i)
+	{
+		if (source[i] == '\\') i += 1;
+		else if (source[i] == '(') depth += 1;
+		else if (source[i] == ')') depth -= 1;
+		else if (source[i] == '[')
+		{
+			for (i += 2; i < size && source[i] != ']'; ++i) if (source[i] == '\\') i += 1;
+		}
+		else if (source[i] == '|' && !depth) return;
+	}
+
+	for (uint i = 0; i < size && regex->prefix_size < TEXT_PATTERN_CAPACITY;)
+	{
+		byte b         = source[i];
+		uint next      = i + 1;
+		if (b == '\\')
+		{
+			if (next == size) break;
+			byte letter = source[next++];
+			bit  negated;
+			uint64 set[4];
+			if (get_regex_shorthand(letter, set, &negated) || (letter | 0x20) == 'b') break;
+			b = get_regex_escaped_byte(letter);
+		}
+		else if (b == '(' || b == ')' || b == '[' || b == '.' || b == '*' || b == '+' || b == '?' || b == '{' || b == '|' || b == '$') break;
+
+		/* a code point that may be repeated or left out ends the prefix before it, and one that is repeated after it */
+		uint code_point_end = b >= 0x80 && source[i] != '\\' ? i + get_utf8_size(b) : next;
+		if (code_point_end > size) break;
+		byte after = code_point_end < size ? source[code_point_end] : 0;
+		if (after == '*' || after == '?' || after == '{') break;
+		if (code_point_end - i + regex->prefix_size > TEXT_PATTERN_CAPACITY) break;
+		if (source[i] == '\\') regex->prefix[regex->prefix_size++] = b;
+		else
+		{
+			copy(regex->prefix + regex->prefix_size, source + i, code_point_end - i);
+			regex->prefix_size += code_point_end - i;
+		}
+		i = code_point_end;
+		if (after == '+') break;
+	}
+}
+
+static void compute_regex_classes(text_regex *regex)
+{
+	/* a class begins wherever a set begins or ends, and the end of a line is a class of its own */
+	uint64 boundaries[4] = {0};
+	add_regex_set_range(boundaries, '\n', '\n' + 1);
+	for (uint i = 0; i < regex->sets_count; ++i)
+	{
+		for (uint b = 1; b < 256; ++b)
+		{
+			if (has_regex_set_byte(regex->sets[i], b) != has_regex_set_byte(regex->sets[i], b - 1)) add_regex_set_range(boundaries, b, b);
+		}
+	}
+	uint class = 0;
+	for (uint b = 0; b < 256; ++b)
+	{
+		if (b && has_regex_set_byte(boundaries, b)) class += 1;
+		regex->classes[b]             = class;
+		regex->representatives[class] = b;
+	}
+	regex->classes_count = class + 1;
+}
+
+static void initialize_regex_dfa(const regex_program *program, bit unanchored, text_regex *regex, regex_dfa *dfa)
+{
+	zero(dfa, sizeof(*dfa));
+	dfa->program           = program;
+	dfa->unanchored        = unanchored;
+	dfa->states_capacity   = REGEX_CACHE_CAPACITY / (regex->classes_count * sizeof(uint32) + 6 * sizeof(uint32));
+	dfa->elements_capacity = dfa->states_capacity * 4 + REGEX_CLOSURE_CAPACITY * 2;  /* room for the special states and the largest set after a flush */
+	dfa->table_capacity    = 1;
+	while (dfa->table_capacity < dfa->states_capacity * 2) dfa->table_capacity *= 2;
+	dfa->transitions     = allocate(dfa->states_capacity * regex->classes_count * sizeof(uint32), ALLOCATION_TAG_SEARCH);
+	dfa->matching        = allocate(dfa->states_capacity * sizeof(bit), ALLOCATION_TAG_SEARCH);
+	dfa->element_offsets = allocate((dfa->states_capacity + 1) * sizeof(uint32), ALLOCATION_TAG_SEARCH);
+	dfa->elements        = allocate(dfa->elements_capacity * sizeof(uint32), ALLOCATION_TAG_SEARCH);
+	dfa->table           = allocate(dfa->table_capacity * sizeof(uint32), ALLOCATION_TAG_SEARCH);
+}
+
+static void terminate_regex_dfa(const text_regex *regex, regex_dfa *dfa)
+{
+	deallocate(dfa->table, dfa->table_capacity * sizeof(uint32), ALLOCATION_TAG_SEARCH);
+	deallocate(dfa->elements, dfa->elements_capacity * sizeof(uint32), ALLOCATION_TAG_SEARCH);
+	deallocate(dfa->element_offsets, (dfa->states_capacity + 1) * sizeof(uint32), ALLOCATION_TAG_SEARCH);
+	deallocate(dfa->matching, dfa->states_capacity * sizeof(bit), ALLOCATION_TAG_SEARCH);
+	deallocate(dfa->transitions, dfa->states_capacity * regex->classes_count * sizeof(uint32), ALLOCATION_TAG_SEARCH);
+}
+
+/* adds the program states that `state` leads to without a byte, unless an
+   earlier group of the set already has them */
+static void add_regex_closure(uint32 state, const regex_program *program, text_regex *regex)
+{
+	uint stack_count = 0;
+	regex->stack[stack_count++] = state;
+	while (stack_count)
+	{
+		uint32 index = regex->stack[--stack_count];
+		if (index == REGEX_NO_STATE || regex->marks[index] == regex->mark) continue;
+		regex->marks[index] = regex->mark;
+
+		const regex_state *program_state = &program->states[index];
+		switch (program_state->kind)
+		{
+		case REGEX_STATE_SPLIT:
+			regex->stack[stack_count++] = program_state->alternative;
+			regex->stack[stack_count++] = program_state->next;
+			break;
+		case REGEX_STATE_EMPTY:
+			regex->stack[stack_count++] = program_state->next;
+			break;
+		default:
+			regex->closure[regex->closure_count++] = index;
+			break;
+		}
+	}
+}
+
+inline static void begin_regex_closure(text_regex *regex)
+{
+	regex->closure_count = 0;
+	if (!++regex->mark)
+	{
+		zero(regex->marks, (REGEX_STATES_CAPACITY + 1) * sizeof(uint32));
+		regex->mark = 1;
+	}
+}
+
+/* ends the group that the closure ends with, if it is not empty, and returns
+   whether it matches. its elements are sorted so that a set has one spelling */
+static bit end_regex_group(uint beginning, const regex_program *program, text_regex *regex)
+{
+	static const uint gaps[] = { 701, 301, 132, 57, 23, 10, 4, 1 };
+	uint32 *group = regex->closure + beginning;
+	uint    count = regex->closure_count - beginning;
+	if (!count) return 0;
+	for (uint g = 0; g < countof(gaps); ++g)
+	{
+		uint gap = gaps[g];
+		for (uint i = gap; i < count; ++i)
+		{
+			uint32 element = group[i];
+			uint   j       = i;
+			for (; j >= gap && group[j - gap] > element; j -= gap) group[j] = group[j - gap];
+			group[j] = element;
+		}
+	}
+
+	bit matching = 0;
+	for (uint i = 0; i < count; ++i) matching |= program->states[group[i]].kind == REGEX_STATE_MATCH;
+	regex->closure[regex->closure_count++] = REGEX_GROUP_END;
+	return matching;
+}
+
+/* the set that a search begins with: a match from here, if `started`, and,
+   unless that one is already found, from every later position */
+static void begin_regex_start_closure(bit started, const regex_dfa *dfa, text_regex *regex)
+{
+	begin_regex_closure(regex);
+	bit matching = 0;
+	if (started)
+	{
+		add_regex_closure(dfa->program->start, dfa->program, regex);
+		matching = end_regex_group(0, dfa->program, regex);
+	}
+	if (dfa->unanchored && !matching) regex->closure[regex->closure_count++] = REGEX_SEARCHING;
+}
+
+static void flush_regex_dfa(regex_dfa *dfa)
+{
+	fill(dfa->table, dfa->table_capacity * sizeof(uint32), 0xff);
+	dfa->start_states[0]    = REGEX_NO_STATE;
+	dfa->start_states[1]    = REGEX_NO_STATE;
+	dfa->states_count       = 0;
+	dfa->elements_count     = 0;
+	dfa->element_offsets[0] = 0;
+}
+
+/* returns the state of the set in the closure, made if it is new, or `REGEX_NO_STATE` when the cache is full */
+static uint32 find_regex_dfa_state(text_regex *regex, regex_dfa *dfa)
+{
+	uint64 hash = 0xcbf29ce484222325ull;
+	for (uint i = 0; i < regex->closure_count; ++i) hash = (hash ^ regex->closure[i]) * 0x100000001b3ull;
+	for (uint slot = hash & (dfa->table_capacity - 1);; slot = (slot + 1) & (dfa->table_capacity - 1))
+	{
+		uint32 state = dfa->table[slot];
+		if (state == REGEX_NO_STATE)
+		{
+			if (dfa->states_count == dfa->states_capacity || dfa->elements_count + regex->closure_count > dfa->elements_capacity) return REGEX_NO_STATE;
+
+			state = dfa->states_count++;
+			dfa->table[slot] = state;
+			copy(dfa->elements + dfa->elements_count, regex->closure, regex->closure_count * sizeof(uint32));
+			dfa->elements_count += regex->closure_count;
+			dfa->element_offsets[state + 1] = dfa->elements_count;
+			fill(dfa->transitions + state * regex->classes_count, regex->classes_count * sizeof(uint32), 0xff);
+
+			dfa->matching[state] = 0;
+			for (uint i = 0; i < regex->closure_count; ++i)
+			{
+				uint32 element = regex->closure[i];
+				dfa->matching[state] |= element < dfa->program->states_count && dfa->program->states[element].kind == REGEX_STATE_MATCH;
+			}
+			return state;
+		}
+
+		uint32 begin = dfa->element_offsets[state];
+		uint32 count = dfa->element_offsets[state + 1] - begin;
+		if (count == regex->closure_count && !compare(dfa->elements + begin, regex->closure, count * sizeof(uint32))) return state;
+	}
+}
+
+/* the dead state is always the first, and the searcher's idle state the second */
+static void add_regex_special_states(text_regex *regex, regex_dfa *dfa)
+{
+	begin_regex_closure(regex);
+	find_regex_dfa_state(regex, dfa);
+	if (!dfa->unanchored) return;
+	begin_regex_start_closure(!regex->line_beginning, dfa, regex);
+	find_regex_dfa_state(regex, dfa);
+}
+
+/* the state of the closure, after a flush if the cache is full */
+static uint32 add_regex_dfa_state(text_regex *regex, regex_dfa *dfa)
+{
+	uint32 state = find_regex_dfa_state(regex, dfa);
+	if (state != REGEX_NO_STATE) return state;
+
+	copy(regex->saved, regex->closure, regex->closure_count * sizeof(uint32));
+	uint saved_count = regex->closure_count;
+	flush_regex_dfa(dfa);
+	dfa->flushes_count += 1;
+	add_regex_special_states(regex, dfa);
+	copy(regex->closure, regex->saved, saved_count * sizeof(uint32));
+	regex->closure_count = saved_count;
+	state = find_regex_dfa_state(regex, dfa);
+	assert(state != REGEX_NO_STATE);
+	return state;
+}
+
+static uint32 get_regex_start_state(bit started, text_regex *regex, regex_dfa *dfa)
+{
+	if (dfa->start_states[started] != REGEX_NO_STATE) return dfa->start_states[started];
+	if (!dfa->states_count) add_regex_special_states(regex, dfa);
+	begin_regex_start_closure(started, dfa, regex);
+	uint32 state = add_regex_dfa_state(regex, dfa);
+	dfa->start_states[started] = state;
+	return state;
+}
+
+/* makes the transition of `state` by `class`, and returns it with whether it
+   matches. a program state is left to the earliest group that reaches it, and
+   a group that matches drops the groups after it, since their matches would
+   begin later */
+static uint32 make_regex_transition(uint32 state, uint class, text_regex *regex, regex_dfa *dfa)
+{
+	const regex_program *program = dfa->program;
+	byte                 b       = regex->representatives[class];
+
+	begin_regex_closure(regex);
+	uint beginning = 0;
+	bit  matching  = 0;
+	bit  searching = 0;
+	for (uint32 i = dfa->element_offsets[state]; i < dfa->element_offsets[state + 1] && !matching; ++i)
+	{
+		uint32 element = dfa->elements[i];
+		if (element == REGEX_GROUP_END)
+		{
+			matching  = end_regex_group(beginning, program, regex);
+			beginning = regex->closure_count;
+		}
+		else if (element == REGEX_SEARCHING) searching = 1;
+		else
+		{
+			const regex_state *program_state = &program->states[element];
+			if (program_state->kind == REGEX_STATE_BYTES && has_regex_set_byte(regex->sets[program_state->set], b)) add_regex_closure(program_state->next, program, regex);
+		}
+	}
+	if (searching)
+	{
+		if (!regex->line_beginning || b == '\n')
+		{
+			add_regex_closure(program->start, program, regex);
+			matching = end_regex_group(beginning, program, regex);
+		}
+		if (!matching) regex->closure[regex->closure_count++] = REGEX_SEARCHING;
+	}
+
+	/* the transition is kept only if the cache was not flushed for its target */
+	uint flushes_count = dfa->flushes_count;
+	uint32 target = add_regex_dfa_state(regex, dfa);
+	uint32 transition = target | (dfa->matching[target] ? REGEX_MATCHING_STATE : 0);
+	if (flushes_count == dfa->flushes_count) dfa->transitions[state * regex->classes_count + class] = transition;
+	return transition;
+}
+
+inline static uint32 take_regex_transition(uint32 state, byte b, text_regex *regex, regex_dfa *dfa)
+{
+	uint   class      = regex->classes[b];
+	uint32 transition = dfa->transitions[state * regex->classes_count + class];
+	return transition == REGEX_UNKNOWN_TRANSITION ? make_regex_transition(state, class, regex, dfa) : transition;
+}
+
+inline static byte get_text_byte(uintl offset, const text_buffer *buffer)
+{
+	const text_piece *piece = &buffer->pieces[find_text_piece(offset, buffer)];
+	return get_text_piece_data(piece, buffer)[offset - piece->offset];
+}
+
+inline static bit begins_regex_line(uintl offset, const text_buffer *buffer)
+{
+	return !offset || get_text_byte(offset - 1, buffer) == '\n';
+}
+
+/* returns where the leftmost match that begins at or after `offset` ends, the
+   longest if several begin there, or `TEXT_NO_MATCH`. the searcher reads on
+   until none of its groups can match again. with a prefix, the text from where
+   no match is under way to the next occurrence of the prefix is skipped. */
+static uintl find_regex_match_end(uintl offset, text_regex *regex, const text_buffer *buffer)
+{
+	regex_dfa *dfa            = &regex->searcher;
+	uint32     special_states = regex->prefix_size ? REGEX_IDLE_STATE + 1 : REGEX_DEAD_STATE + 1;
+	uintl      end            = TEXT_NO_MATCH;
+	for (;;)
+	{
+		if (regex->prefix_size)
+		{
+			offset = find_text(offset, buffer->size, &regex->prefix_pattern, buffer);
+			if (offset == TEXT_NO_MATCH) return TEXT_NO_MATCH;
+		}
+
+		uint32 state = get_regex_start_state(!regex->line_beginning || begins_regex_line(offset, buffer), regex, dfa);
+		if (dfa->matching[state]) end = offset;
+
+		uintl idle_offset = TEXT_NO_MATCH;
+		for (uint i = find_text_piece(offset, buffer); i < buffer->pieces_count && idle_offset == TEXT_NO_MATCH; ++i)
+		{
+			const text_piece *piece = &buffer->pieces[i];
+			const byte       *data  = get_text_piece_data(piece, buffer);
+			for (uintl j = offset > piece->offset ? offset - piece->offset : 0; j < piece->size; ++j)
+			{
+				uint   class      = regex->classes[data[j]];
+				uint32 transition = dfa->transitions[state * regex->classes_count + class];
+				if (transition >= REGEX_MATCHING_STATE || transition < special_states)
+				{
+					if (transition == REGEX_UNKNOWN_TRANSITION) transition = make_regex_transition(state, class, regex, dfa);
+					if (transition & REGEX_MATCHING_STATE) end = piece->offset + j + 1 - regex->line_end;
+					transition &= ~REGEX_MATCHING_STATE;
+					if (transition == REGEX_DEAD_STATE) return end;
+					if (transition == REGEX_IDLE_STATE && regex->prefix_size)
+					{
+						idle_offset = piece->offset + j + 1;
+						break;
+					}
+				}
+				state = transition;
+			}
+		}
+		if (idle_offset == TEXT_NO_MATCH)
+		{
+			/* the end of the text ends a line */
+			if (regex->line_end && (take_regex_transition(state, '\n', regex, dfa) & REGEX_MATCHING_STATE)) end = buffer->size;
+			return end;
+		}
+		offset = idle_offset;
+	}
+}
+
+/* returns where the longest match that ends at `end` begins, reading back no further than `offset` */
+static uintl find_regex_beginning(uintl offset, uintl end, text_regex *regex, const text_buffer *buffer)
+{
+	regex_dfa *dfa       = &regex->reverse_matcher;
+	uint32     state     = get_regex_start_state(1, regex, dfa);
+	uintl      beginning = dfa->matching[state] ? end : TEXT_NO_MATCH;
+
+	/* after `^`, the byte before the match is read too */
+	uintl floor = offset && regex->line_beginning ? offset - 1 : offset;
+	for (uint i = end > floor ? find_text_piece(end - 1, buffer) : 0; end > floor; --i)
+	{
+		const text_piece *piece       = &buffer->pieces[i];
+		const byte       *data        = get_text_piece_data(piece, buffer);
+		uintl             piece_floor = floor > piece->offset ? floor - piece->offset : 0;
+		for (uintl j = (end < piece->offset + piece->size ? end : piece->offset + piece->size) - piece->offset; j > piece_floor; --j)
+		{
+			uint   class      = regex->classes[data[j - 1]];
+			uint32 transition = dfa->transitions[state * regex->classes_count + class];
+			if (transition == REGEX_UNKNOWN_TRANSITION) transition = make_regex_transition(state, class, regex, dfa);
+			if (transition & REGEX_MATCHING_STATE) beginning = piece->offset + j - 1 + regex->line_beginning;
+			state = transition & ~REGEX_MATCHING_STATE;
+			if (state == REGEX_DEAD_STATE) goto found;
+		}
+		if (floor >= piece->offset) break;
+	}
+
+	/* the beginning of the text begins a line */
+	if (regex->line_beginning && !offset && (take_regex_transition(state, '\n', regex, dfa) & REGEX_MATCHING_STATE)) beginning = 0;
+found:
+	assert(beginning != TEXT_NO_MATCH);
+	return beginning;
+}
+
+bit compile_text_regex(const char *source, uint size, const text_buffer *buffer, text_regex *regex)
+{
+	zero(regex, offsetof(text_regex, searcher));
+	const byte *bytes       = (const byte *)source;
+	uint        source_size = size;
+	if (size && bytes[0] == '^')
+	{
+		regex->line_beginning = 1;
+		bytes += 1;
+		size  -= 1;
+	}
+	if (size && bytes[size - 1] == '$' && (size < 2 || bytes[size - 2] != '\\'))
+	{
+		regex->line_end = 1;
+		size -= 1;
+	}
+
+	const char *error = compile_regex_program(bytes, size, 0, regex, &regex->forward);
+	if (!error) error = compile_regex_program(bytes, size, 1, regex, &regex->reverse);
+	else regex->reverse.states = allocate((REGEX_STATES_CAPACITY + 1) * sizeof(regex_state), ALLOCATION_TAG_SEARCH);
+	compute_regex_classes(regex);
+
+	regex->stack   = allocate((REGEX_STATES_CAPACITY + 1) * 2 * sizeof(uint32), ALLOCATION_TAG_SEARCH);
+	regex->marks   = allocate((REGEX_STATES_CAPACITY + 1) * sizeof(uint32), ALLOCATION_TAG_SEARCH);
+	regex->closure = allocate(REGEX_CLOSURE_CAPACITY * sizeof(uint32), ALLOCATION_TAG_SEARCH);
+	regex->saved   = allocate(REGEX_CLOSURE_CAPACITY * sizeof(uint32), ALLOCATION_TAG_SEARCH);
+	initialize_regex_dfa(&regex->forward, 1, regex, &regex->searcher);
+	initialize_regex_dfa(&regex->reverse, 0, regex, &regex->reverse_matcher);
+	for (regex_dfa *dfa = &regex->searcher; dfa <= &regex->reverse_matcher; ++dfa) flush_regex_dfa(dfa);
+
+	if (error)
+	{
+		report_caution("/%.*s/: %s\n", source_size, source, error);
+		return 0;
+	}
+
+	extract_regex_prefix(bytes, size, regex);
+	if (regex->prefix_size) compile_text_pattern(regex->prefix, regex->prefix_size, buffer, &regex->prefix_pattern);
+	return 1;
+}
+
+void terminate_text_regex(text_regex *regex)
+{
+	for (regex_dfa *dfa = &regex->searcher; dfa <= &regex->reverse_matcher; ++dfa) terminate_regex_dfa(regex, dfa);
+	deallocate(regex->saved, REGEX_CLOSURE_CAPACITY * sizeof(uint32), ALLOCATION_TAG_SEARCH);
+	deallocate(regex->closure, REGEX_CLOSURE_CAPACITY * sizeof(uint32), ALLOCATION_TAG_SEARCH);
+	deallocate(regex->marks, (REGEX_STATES_CAPACITY + 1) * sizeof(uint32), ALLOCATION_TAG_SEARCH);
+	deallocate(regex->stack, (REGEX_STATES_CAPACITY + 1) * 2 * sizeof(uint32), ALLOCATION_TAG_SEARCH);
+	deallocate(regex->reverse.states, (REGEX_STATES_CAPACITY + 1) * sizeof(regex_state), ALLOCATION_TAG_SEARCH);
+	deallocate(regex->forward.states, (REGEX_STATES_CAPACITY + 1) * sizeof(regex_state), ALLOCATION_TAG_SEARCH);
+}
+
+/* returns where the leftmost match at or after `offset` begins, or `TEXT_NO_MATCH`, and where it ends */
+uintl find_text_regex(uintl offset, uintl *match_end, text_regex *regex, const text_buffer *buffer)
+{
+	if (offset > buffer->size) return TEXT_NO_MATCH;
+	uintl end = find_regex_match_end(offset, regex, buffer);
+	if (end == TEXT_NO_MATCH) return TEXT_NO_MATCH;
+	*match_end = end;
+	return find_regex_beginning(offset, end, regex, buffer);
+}
+
+/* every match of the pattern in the file at `path`, then patterns that are
+   slow to match or to fail for other engines */
+void benchmark_text_regex(const char *path, const char *source)
+{
+	text_buffer buffer;
+	open_text_buffer(path, &buffer);
+
+	text_regex regex;
+	if (compile_text_regex(source, strlen(source), &buffer, &regex))
+	{
+		uintl matches_count  = 0;
+		uintl beginning_time = get_time();
+		for (uintl offset = 0, end; (offset = find_text_regex(offset, &end, &regex, &buffer)) != TEXT_NO_MATCH; offset = end > offset ? end : offset + 1) matches_count += 1;
+		float64 elapsed_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+		report_comment(
+			"%llu matches of /%s/ in %llu bytes: %.3f ms, %.2f GB/s; %u classes, %u states, %u flushes%s\n",
+			matches_count, source, buffer.size, elapsed_time * 1000, buffer.size / elapsed_time / 1e9, regex.classes_count,
+			regex.searcher.states_count + regex.reverse_matcher.states_count,
+			regex.searcher.flushes_count + regex.reverse_matcher.flushes_count,
+			regex.prefix_size ? ", by its prefix" : "");
+	}
+	terminate_text_regex(&regex);
+	close_text_buffer(&buffer);
+
+	/* a run of `a` that ends with a `c`: patterns that backtracking takes
+	   exponential time for, and that trying every beginning takes quadratic
+	   time for, all in one pass */
+	open_text_buffer(0, &buffer);
+	byte line[256];
+	fill(line, sizeof(line), 'a');
+	for (uint i = 0; i < (1 << 20) / sizeof(line); ++i) insert_text(buffer.size, line, sizeof(line), &buffer);
+	insert_text(buffer.size, (const byte *)"c", 1, &buffer);
+
+	static const struct { const char *source; uintl beginning; } pathologicals[] =
+	{
+		{ "(a|aa)*(a|aa)*(a|aa)*b", TEXT_NO_MATCH },
+		{ "a+b",                    TEXT_NO_MATCH },
+		{ "a*c?b|c",                1 << 20 },
+		{ "a+c$",                   0 },
+	};
+	for (uint i = 0; i < countof(pathologicals); ++i)
+	{
+		const char *pathological = pathologicals[i].source;
+		compile_text_regex(pathological, strlen(pathological), &buffer, &regex);
+		uintl   end            = 0;
+		uintl   beginning_time = get_time();
+		uintl   match          = find_text_regex(0, &end, &regex, &buffer);
+		float64 elapsed_time   = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+		assert(match == pathologicals[i].beginning);
+		report_comment("/%s/ %s over %llu bytes in %.3f ms\n", pathological, match == TEXT_NO_MATCH ? "failed" : "matched", buffer.size, elapsed_time * 1000);
+		terminate_text_regex(&regex);
+	}
+	close_text_buffer(&buffer);
+}
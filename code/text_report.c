@@ -0,0 +1,284 @@
+/*
+
+a report costs the thread that makes it a copy of its arguments into the
+thread's queue. the logger thread formats the reports and writes them to the
+standard error and to a file, in the order they were made across threads.
+
+a queue that is full drops what is pushed to it, and the drops are counted by
+severity and reported by the logger.
+
+*/
+
+static const char *severity_representations[] =
+{
+	[SEVERITY_VERBOSE] = "VERBOSE",
+	[SEVERITY_COMMENT] = "COMMENT",
+	[SEVERITY_CAUTION] = "CAUTION",
+	[SEVERITY_FAILURE] = "FAILURE",
+};
+
+static uint format_report(const report_entry *entry, char *text, uint capacity)
+{
+	uint length = format_string(text, capacity, "[%s] %s:%u: ", severity_representations[entry->severity], entry->file, entry->line);
+	if (entry->format) length += format_packed_string(text + length, capacity - length, entry->format, entry->arguments);
+	else               length += format_string(text + length, capacity - length, "%s", (const char *)entry->arguments);
+	return length;
+}
+
+inline static bit is_report_queue_empty(report_queue *queue)
+{
+	return atomic_load(&queue->head) == atomic_load(&queue->tail);
+}
+
+/* called as a thread that reported exits */
+static void release_report_queue(void *parameter)
+{
+	report_queue *queue = parameter;
+	if (atomic_exchange_explicit(&queue->state, REPORT_QUEUE_STATE_LEFT, memory_order_acq_rel) == REPORT_QUEUE_STATE_ABANDONED) deallocate(queue, sizeof(report_queue), ALLOCATION_TAG_REPORTS);
+}
+
+/* takes a queue that a thread left, or makes one */
+static report_queue *acquire_report_queue(void)
+{
+	reporter *reports = &global.reports;
+	for (report_queue *queue = atomic_load_explicit(&reports->queues, memory_order_acquire); queue; queue = queue->next)
+	{
+		uint32 state = REPORT_QUEUE_STATE_LEFT;
+		if (atomic_compare_exchange_strong_explicit(&queue->state, &state, REPORT_QUEUE_STATE_OWNED, memory_order_acquire, memory_order_relaxed)) return queue;
+	}
+
+	report_queue *queue = allocate(sizeof(report_queue), ALLOCATION_TAG_REPORTS);
+	atomic_init(&queue->head, 0);
+	atomic_init(&queue->tail, 0);
+	atomic_init(&queue->state, REPORT_QUEUE_STATE_OWNED);
+	queue->next = atomic_load_explicit(&reports->queues, memory_order_relaxed);
+	while (!atomic_compare_exchange_weak_explicit(&reports->queues, &queue->next, queue, memory_order_release, memory_order_relaxed));
+	return queue;
+}
+
+static void wake_logger(void)
+{
+	reporter *reports = &global.reports;
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(&reports->sleeping, memory_order_relaxed))
+	{
+		mtx_lock(&reports->mutex);
+		cnd_signal(&reports->condition);
+		mtx_unlock(&reports->mutex);
+	}
+}
+
+void _report(const char *file, uint line, severity severity, const char *message, ...)
+{
+	reporter *reports = &global.reports;
+
+	va_list vargs;
+	va_start(vargs, message);
+
+	/* the count is raised before `running` is looked at, and `stop_reports`
+	   looks at the count after it lowers `running`, so one of the two sees the
+	   other */
+	atomic_fetch_add(&reports->reporters_count, 1);
+
+	/* before the logger starts and after it stops, reports are written at once */
+	if (!atomic_load(&reports->running))
+	{
+		atomic_fetch_sub(&reports->reporters_count, 1);
+		report_entry entry = { .file = file, .line = line, .severity = severity };
+		format_string_v((char *)entry.arguments, sizeof(entry.arguments), message, vargs);
+		va_end(vargs);
+
+		char text[REPORT_TEXT_CAPACITY];
+		uint length = format_report(&entry, text, sizeof(text));
+		fwrite(text, 1, length, stderr);
+		if (reports->file) fwrite(text, 1, length, reports->file);
+		return;
+	}
+
+	if (!context.report_queue)
+	{
+		context.report_queue = acquire_report_queue();
+		tss_set(reports->queue_key, context.report_queue);
+	}
+	report_queue *queue = context.report_queue;
+
+	uint32 head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+	uint32 tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+	if (head - tail == REPORT_QUEUE_CAPACITY)
+	{
+		va_end(vargs);
+		atomic_fetch_add_explicit(&reports->dropped_counts[severity], 1, memory_order_relaxed);
+		atomic_fetch_sub(&reports->reporters_count, 1);
+		return;
+	}
+
+	report_entry *entry = &queue->entries[head & (REPORT_QUEUE_CAPACITY - 1)];
+	entry->time     = get_time();
+	entry->file     = file;
+	entry->format   = message;
+	entry->line     = line;
+	entry->severity = severity;
+	if (pack_format_arguments(entry->arguments, sizeof(entry->arguments), message, vargs) == UINT_MAXIMUM)
+	{
+		/* too many arguments to pack, so they are formatted here */
+		entry->format = 0;
+		format_string_v((char *)entry->arguments, sizeof(entry->arguments), message, vargs);
+	}
+	va_end(vargs);
+	atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+
+	wake_logger();
+	if (severity == SEVERITY_FAILURE) flush_reports();
+	atomic_fetch_sub(&reports->reporters_count, 1);
+}
+
+#define REPORT_OUTPUT_CAPACITY (64 << 10)
+
+static void write_reports(const char *text, uint size)
+{
+	reporter *reports = &global.reports;
+	fwrite(text, 1, size, stderr);
+	if (reports->file) fwrite(text, 1, size, reports->file);
+}
+
+/* writes the reports of every queue, the oldest first, and returns how many */
+static uint drain_reports(char *output)
+{
+	reporter *reports       = &global.reports;
+	uint      output_size   = 0;
+	uint      reports_count = 0;
+	for (;;)
+	{
+		report_queue *oldest_queue = 0;
+		uintl         oldest_time  = UINTL_MAXIMUM;
+		for (report_queue *queue = atomic_load_explicit(&reports->queues, memory_order_acquire); queue; queue = queue->next)
+		{
+			uint32 tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+			uint32 head = atomic_load_explicit(&queue->head, memory_order_acquire);
+			if (head == tail) continue;
+			uintl time = queue->entries[tail & (REPORT_QUEUE_CAPACITY - 1)].time;
+			if (time < oldest_time)
+			{
+				oldest_queue = queue;
+				oldest_time  = time;
+			}
+		}
+		if (!oldest_queue) break;
+
+		if (REPORT_OUTPUT_CAPACITY - output_size < REPORT_TEXT_CAPACITY)
+		{
+			write_reports(output, output_size);
+			output_size = 0;
+		}
+		uint32 tail = atomic_load_explicit(&oldest_queue->tail, memory_order_relaxed);
+		output_size += format_report(&oldest_queue->entries[tail & (REPORT_QUEUE_CAPACITY - 1)], output + output_size, REPORT_TEXT_CAPACITY);
+		atomic_store_explicit(&oldest_queue->tail, tail + 1, memory_order_release);
+		reports_count += 1;
+	}
+
+	for (uint i = 0; i < SEVERITIES_COUNT; ++i)
+	{
+		uintl dropped_count = atomic_exchange_explicit(&reports->dropped_counts[i], 0, memory_order_relaxed);
+		if (!dropped_count) continue;
+		if (REPORT_OUTPUT_CAPACITY - output_size < REPORT_TEXT_CAPACITY)
+		{
+			write_reports(output, output_size);
+			output_size = 0;
+		}
+		output_size += format_string(output + output_size, REPORT_TEXT_CAPACITY, "[CAUTION] dropped %llu %s reports\n", dropped_count, severity_representations[i]);
+	}
+
+	if (output_size) write_reports(output, output_size);
+	if (reports_count && reports->file) fflush(reports->file);
+	return reports_count;
+}
+
+static int log_reports(void *parameter)
+{
+	reporter *reports = &global.reports;
+	char     *output  = allocate(REPORT_OUTPUT_CAPACITY, ALLOCATION_TAG_REPORTS);
+	for (;;)
+	{
+		/* whatever was pushed before the logger was stopped is still written */
+		bit running = atomic_load(&reports->running);
+		if (drain_reports(output)) continue;
+		if (!running) break;
+
+		/* `sleeping` is raised before the queues are looked at, and `_report`
+		   looks at it after it pushes, so one of the two sees the other */
+		mtx_lock(&reports->mutex);
+		atomic_store(&reports->sleeping, 1);
+		bit idle = atomic_load(&reports->running);
+		for (report_queue *queue = atomic_load(&reports->queues); idle && queue; queue = queue->next) idle = is_report_queue_empty(queue);
+		if (idle) cnd_wait(&reports->condition, &reports->mutex);
+		atomic_store(&reports->sleeping, 0);
+		mtx_unlock(&reports->mutex);
+	}
+	deallocate(output, REPORT_OUTPUT_CAPACITY, ALLOCATION_TAG_REPORTS);
+	return 0;
+}
+
+void initialize_reports(const char *path)
+{
+	reporter *reports = &global.reports;
+	reports->file = fopen(path, "wb");
+	if (!reports->file) report_caution("could not open %s for the reports\n", path);
+	assert(tss_create(&reports->queue_key, release_report_queue) == thrd_success);
+	assert(mtx_init(&reports->mutex, mtx_plain) == thrd_success);
+	assert(cnd_init(&reports->condition) == thrd_success);
+	atomic_store(&reports->running, 1);
+	assert(thrd_create(&reports->logger, log_reports, 0) == thrd_success);
+}
+
+void stop_reports(void)
+{
+	reporter *reports = &global.reports;
+	if (!atomic_load(&reports->running)) return;
+
+	mtx_lock(&reports->mutex);
+	atomic_store(&reports->running, 0);
+	cnd_signal(&reports->condition);
+	mtx_unlock(&reports->mutex);
+	while (atomic_load(&reports->reporters_count)) thrd_yield();
+	thrd_join(reports->logger, 0);
+
+	/* the queues of threads that are still running are left to them, as they
+	   may yet exit and release them */
+	for (report_queue *queue = atomic_exchange(&reports->queues, 0); queue;)
+	{
+		report_queue *next  = queue->next;
+		uint32        state = REPORT_QUEUE_STATE_OWNED;
+		if (queue == context.report_queue || !atomic_compare_exchange_strong(&queue->state, &state, REPORT_QUEUE_STATE_ABANDONED)) deallocate(queue, sizeof(report_queue), ALLOCATION_TAG_REPORTS);
+		queue = next;
+	}
+	context.report_queue = 0;
+	tss_set(reports->queue_key, 0);
+}
+
+void terminate_reports(void)
+{
+	reporter *reports = &global.reports;
+	stop_reports();
+	tss_delete(reports->queue_key);
+	cnd_destroy(&reports->condition);
+	mtx_destroy(&reports->mutex);
+	if (reports->file) fclose(reports->file);
+	reports->file = 0;
+}
+
+/* waits until the logger has written every report so far; reports refer to
+   their formats and files, so this must be done before a library that made
+   them is unloaded */
+void flush_reports(void)
+{
+	reporter *reports = &global.reports;
+	if (!atomic_load(&reports->running)) return;
+	for (report_queue *queue = atomic_load(&reports->queues); queue; queue = queue->next)
+	{
+		while (!is_report_queue_empty(queue))
+		{
+			wake_logger();
+			thrd_yield();
+		}
+	}
+}
@@ -0,0 +1,512 @@
+/*
+
+the scrollback is a ring of pages of lines. a page is filled with the rows that
+scroll off the grid until it runs out of cells or lines, and is then sealed.
+except for the newest few, sealed pages are handed to jobs, which split their
+cells into byte planes (so that the attributes and the high bytes of the runes
+become long runs) and compress them. the jobs never touch the pages
+themselves: they get the cells and give back a block, which the main thread
+swaps in on its next update. the oldest pages are discarded
+whenever the scrollback exceeds its memory capacity.
+
+lines are kept whole, however many rows they wrapped over, so a change of width
+only changes how many rows each line takes. the rows of the pages that are
+looked at are counted at once; a job counts the rest in the background.
+
+*/
+
+#define SCROLLBACK_LENGTHS_CAPACITY (SCROLLBACK_PAGE_LINES_CAPACITY * 3)
+#define SCROLLBACK_CELLS_SIZE       (SCROLLBACK_PAGE_CELLS_CAPACITY * sizeof(terminal_cell))
+
+inline static scrollback_page *get_scrollback_page(uint index, const scrollback *scrollback)
+{
+	return &scrollback->pages[(scrollback->first_page + index) & (scrollback->pages_capacity - 1)];
+}
+
+inline static byte *write_scrollback_length(uint length, byte *output)
+{
+	for (; length >= 0x80; length >>= 7) *output++ = 0x80 | (length & 0x7f);
+	*output++ = length;
+	return output;
+}
+
+inline static const byte *read_scrollback_length(const byte *input, uint *length)
+{
+	uint value = 0;
+	for (uint shift = 0;; shift += 7)
+	{
+		byte b = *input++;
+		value |= (uint)(b & 0x7f) << shift;
+		if (!(b & 0x80)) break;
+	}
+	*length = value;
+	return input;
+}
+
+uint count_scrollback_rows(uint size, uint columns)
+{
+	return size ? (size + columns - 1) / columns : 1;
+}
+
+static uint count_scrollback_page_rows(const byte *lengths, uint lengths_size, uint columns)
+{
+	uint        rows_count = 0;
+	const byte *end        = lengths + lengths_size;
+	while (lengths < end)
+	{
+		uint length;
+		lengths = read_scrollback_length(lengths, &length);
+		rows_count += count_scrollback_rows(length, columns);
+	}
+	return rows_count;
+}
+
+/* splits `count` cells into `sizeof(terminal_cell)` planes, or joins them back */
+static void shuffle_terminal_cells(const terminal_cell *cells, uint count, byte *planes)
+{
+	const byte *bytes = (const byte *)cells;
+	for (uint i = 0; i < count; ++i)
+	{
+		for (uint j = 0; j < sizeof(terminal_cell); ++j) planes[j * count + i] = bytes[i * sizeof(terminal_cell) + j];
+	}
+}
+
+static void unshuffle_terminal_cells(const byte *planes, uint count, terminal_cell *cells)
+{
+	byte *bytes = (byte *)cells;
+	for (uint i = 0; i < count; ++i)
+	{
+		for (uint j = 0; j < sizeof(terminal_cell); ++j) bytes[i * sizeof(terminal_cell) + j] = planes[j * count + i];
+	}
+}
+
+static void compress_scrollback_page(void *parameter)
+{
+	scrollback_compression *compression = parameter;
+	arena                  *scratch     = &context.job_worker->scratch;
+	byte                   *planes      = push_array(byte, SCROLLBACK_CELLS_SIZE, scratch);
+	byte                   *compressed  = push_array(byte, get_lz_bound(SCROLLBACK_CELLS_SIZE), scratch);
+
+	shuffle_terminal_cells(compression->cells, compression->cells_count, planes);
+	compression->compressed_size = compress_lz(planes, compression->cells_count * sizeof(terminal_cell), compressed);
+	compression->block_size      = compression->lengths_size + compression->compressed_size;
+	compression->block           = allocate(compression->block_size, ALLOCATION_TAG_SCROLLBACK);
+	copy(compression->block, compression->lengths, compression->lengths_size);
+	copy(compression->block + compression->lengths_size, compressed, compression->compressed_size);
+
+	atomic_fetch_or_explicit(&compression->scrollback->compressed_slots, (uint64)1 << compression->slot, memory_order_release);
+	wake_main_thread();
+}
+
+/* counting rows is quick, and someone may be waiting for it */
+static void count_scrollback_reflow_rows(void *parameter)
+{
+	scrollback_reflow *reflow = parameter;
+	for (uint i = 0; i < reflow->pages_count; ++i) reflow->rows_counts[i] = count_scrollback_page_rows(reflow->lengths[i], reflow->lengths_sizes[i], reflow->columns);
+	atomic_store_explicit(&reflow->done, 1, memory_order_release);
+	wake_main_thread();
+}
+
+void initialize_scrollback(uintl memory_capacity, scrollback *scrollback)
+{
+	zero(scrollback, sizeof(*scrollback));
+	scrollback->memory_capacity    = memory_capacity;
+	scrollback->pages_capacity     = 64;
+	scrollback->pages              = allocate(scrollback->pages_capacity * sizeof(scrollback_page), ALLOCATION_TAG_SCROLLBACK);
+	scrollback->cached_page_number = -1;
+	scrollback->columns            = 80;
+	scrollback->cached_offsets     = allocate((SCROLLBACK_PAGE_LINES_CAPACITY + 1) * sizeof(uint), ALLOCATION_TAG_SCROLLBACK);
+	scrollback->cached_cells       = allocate(SCROLLBACK_CELLS_SIZE, ALLOCATION_TAG_SCROLLBACK);
+	scrollback->cached_planes      = allocate(SCROLLBACK_CELLS_SIZE, ALLOCATION_TAG_SCROLLBACK);
+}
+
+static void release_scrollback_page(scrollback_page *page)
+{
+	if (page->cells) deallocate(page->cells, SCROLLBACK_CELLS_SIZE, ALLOCATION_TAG_SCROLLBACK);
+	if (page->block) deallocate(page->block, page->block_size, ALLOCATION_TAG_SCROLLBACK);
+	else deallocate(page->lengths, page->state == SCROLLBACK_PAGE_STATE_OPEN ? SCROLLBACK_LENGTHS_CAPACITY : page->lengths_size, ALLOCATION_TAG_SCROLLBACK);
+}
+
+void terminate_scrollback(scrollback *scrollback)
+{
+	wait_for_jobs(&scrollback->jobs);
+
+	/* the cells of discarded pages are still with their compressions */
+	for (uint64 slots = scrollback->taken_slots; slots; slots &= slots - 1)
+	{
+		const scrollback_compression *compression = &scrollback->compressions[__builtin_ctzll(slots)];
+		if (compression->page_number < scrollback->first_page_number)
+		{
+			deallocate(compression->cells, SCROLLBACK_CELLS_SIZE, ALLOCATION_TAG_SCROLLBACK);
+			deallocate(compression->lengths, compression->lengths_size, ALLOCATION_TAG_SCROLLBACK);
+		}
+		deallocate(compression->block, compression->block_size, ALLOCATION_TAG_SCROLLBACK);
+	}
+	for (uint i = 0; i < scrollback->pages_count; ++i) release_scrollback_page(get_scrollback_page(i, scrollback));
+	deallocate(scrollback->pages, scrollback->pages_capacity * sizeof(scrollback_page), ALLOCATION_TAG_SCROLLBACK);
+	deallocate(scrollback->cached_offsets, (SCROLLBACK_PAGE_LINES_CAPACITY + 1) * sizeof(uint), ALLOCATION_TAG_SCROLLBACK);
+	deallocate(scrollback->cached_cells, SCROLLBACK_CELLS_SIZE, ALLOCATION_TAG_SCROLLBACK);
+	deallocate(scrollback->cached_planes, SCROLLBACK_CELLS_SIZE, ALLOCATION_TAG_SCROLLBACK);
+}
+
+static void seal_scrollback_page(scrollback_page *page, scrollback *scrollback)
+{
+	/* keep only the used lengths */
+	uint  lengths_size = page->lengths_size ? page->lengths_size : 1;
+	byte *lengths      = allocate(lengths_size, ALLOCATION_TAG_SCROLLBACK);
+	copy(lengths, page->lengths, page->lengths_size);
+	deallocate(page->lengths, SCROLLBACK_LENGTHS_CAPACITY, ALLOCATION_TAG_SCROLLBACK);
+	page->lengths      = lengths;
+	page->lengths_size = lengths_size;
+
+	scrollback->memory_size -= get_allocation_size(SCROLLBACK_LENGTHS_CAPACITY);
+	scrollback->memory_size += get_allocation_size(lengths_size);
+	page->state = SCROLLBACK_PAGE_STATE_SEALED;
+
+	page->rows_count   = count_scrollback_page_rows(page->lengths, page->lengths_size, scrollback->columns);
+	page->rows_columns = scrollback->columns;
+}
+
+static scrollback_page *open_scrollback_page(scrollback *scrollback)
+{
+	if (scrollback->pages_count == scrollback->pages_capacity)
+	{
+		uint pages_capacity = scrollback->pages_capacity * 2;
+		scrollback_page *pages = allocate(pages_capacity * sizeof(scrollback_page), ALLOCATION_TAG_SCROLLBACK);
+		for (uint i = 0; i < scrollback->pages_count; ++i) pages[i] = *get_scrollback_page(i, scrollback);
+		deallocate(scrollback->pages, scrollback->pages_capacity * sizeof(scrollback_page), ALLOCATION_TAG_SCROLLBACK);
+		scrollback->pages          = pages;
+		scrollback->pages_capacity = pages_capacity;
+		scrollback->first_page     = 0;
+	}
+
+	scrollback_page *page = get_scrollback_page(scrollback->pages_count++, scrollback);
+	*page = (scrollback_page)
+	{
+		.first_line = scrollback->first_line + scrollback->lines_count,
+		.cells      = allocate(SCROLLBACK_CELLS_SIZE, ALLOCATION_TAG_SCROLLBACK),
+		.lengths    = allocate(SCROLLBACK_LENGTHS_CAPACITY, ALLOCATION_TAG_SCROLLBACK),
+		.state      = SCROLLBACK_PAGE_STATE_OPEN,
+	};
+	scrollback->memory_size += SCROLLBACK_CELLS_SIZE + get_allocation_size(SCROLLBACK_LENGTHS_CAPACITY);
+	return page;
+}
+
+static void close_scrollback_line(scrollback *scrollback)
+{
+	scrollback_page *page = get_scrollback_page(scrollback->pages_count - 1, scrollback);
+	page->lengths_size = write_scrollback_length(scrollback->open_line_size, page->lengths + page->lengths_size) - page->lengths;
+	scrollback->line_open      = 0;
+	scrollback->open_line_size = 0;
+}
+
+void push_scrollback_row(const terminal_cell *cells, uint count, bit wrapped, scrollback *scrollback)
+{
+	if (scrollback->line_open && scrollback->open_line_size + count > SCROLLBACK_LINE_CAPACITY) close_scrollback_line(scrollback);
+
+	scrollback_page *page = scrollback->pages_count ? get_scrollback_page(scrollback->pages_count - 1, scrollback) : 0;
+	if (!scrollback->line_open)
+	{
+		bit fits = page && page->lines_count < SCROLLBACK_PAGE_LINES_CAPACITY && page->cells_count + count <= SCROLLBACK_PAGE_CELLS_CAPACITY;
+		if (!fits)
+		{
+			if (page) seal_scrollback_page(page, scrollback);
+			page = open_scrollback_page(scrollback);
+		}
+		page->lines_count         += 1;
+		scrollback->lines_count   += 1;
+		scrollback->line_open      = 1;
+		scrollback->open_line_size = 0;
+	}
+	else if (page->cells_count + count > SCROLLBACK_PAGE_CELLS_CAPACITY)
+	{
+		/* move the open line to a page of its own */
+		uint size = scrollback->open_line_size;
+		page->lines_count -= 1;
+		page->cells_count -= size;
+		seal_scrollback_page(page, scrollback);
+		const terminal_cell *line_cells = page->cells + page->cells_count;
+
+		page = open_scrollback_page(scrollback);
+		page->first_line  -= 1;
+		page->lines_count  = 1;
+		page->cells_count  = size;
+		copy(page->cells, line_cells, size * sizeof(terminal_cell));
+	}
+
+	copy(page->cells + page->cells_count, cells, count * sizeof(terminal_cell));
+	page->cells_count          += count;
+	scrollback->open_line_size += count;
+
+	if (!wrapped) close_scrollback_line(scrollback);
+}
+
+void reflow_scrollback(uint columns, scrollback *scrollback)
+{
+	assert(columns);
+	if (columns == scrollback->columns) return;
+	scrollback->columns            = columns;
+	scrollback->reflow_page_number = scrollback->first_page_number + scrollback->pages_count;
+}
+
+void update_scrollback(scrollback *scrollback)
+{
+	scrollback_reflow *reflow = &scrollback->reflow;
+
+	/* take what the job has counted */
+	bit reflowed  = reflow->requested && atomic_load_explicit(&reflow->done, memory_order_acquire);
+	bit reflowing = reflow->requested && !reflowed;
+	if (reflowed)
+	{
+		if (reflow->columns == scrollback->columns)
+		{
+			for (uint i = 0; i < reflow->pages_count; ++i)
+			{
+				scrollback_page *page = get_scrollback_page(reflow->first_page_number + i - scrollback->first_page_number, scrollback);
+				page->rows_count   = reflow->rows_counts[i];
+				page->rows_columns = reflow->columns;
+			}
+		}
+		reflow->requested = 0;
+		atomic_store_explicit(&reflow->done, 0, memory_order_relaxed);
+	}
+
+	/* swap in what the jobs have compressed, unless that would free the lengths
+	   that are being counted */
+	if (!reflowing)
+	{
+		uint64 slots = atomic_exchange_explicit(&scrollback->compressed_slots, 0, memory_order_acquire);
+		for (; slots; slots &= slots - 1)
+		{
+			uint                          slot   = __builtin_ctzll(slots);
+			const scrollback_compression *result = &scrollback->compressions[slot];
+			scrollback->taken_slots &= ~((uint64)1 << slot);
+
+			/* the page was discarded while it was queued, so its cells were left to us */
+			if (result->page_number < scrollback->first_page_number)
+			{
+				deallocate(result->cells, SCROLLBACK_CELLS_SIZE, ALLOCATION_TAG_SCROLLBACK);
+				deallocate(result->lengths, result->lengths_size, ALLOCATION_TAG_SCROLLBACK);
+				deallocate(result->block, result->block_size, ALLOCATION_TAG_SCROLLBACK);
+				continue;
+			}
+
+			scrollback_page *page = get_scrollback_page(result->page_number - scrollback->first_page_number, scrollback);
+			scrollback->memory_size -= SCROLLBACK_CELLS_SIZE + get_allocation_size(page->lengths_size);
+			scrollback->memory_size += get_allocation_size(result->block_size);
+			deallocate(page->cells, SCROLLBACK_CELLS_SIZE, ALLOCATION_TAG_SCROLLBACK);
+			deallocate(page->lengths, page->lengths_size, ALLOCATION_TAG_SCROLLBACK);
+			page->cells           = 0;
+			page->block           = result->block;
+			page->block_size      = result->block_size;
+			page->lengths         = result->block;
+			page->compressed_size = result->compressed_size;
+			page->state           = SCROLLBACK_PAGE_STATE_COMPRESSED;
+			if (scrollback->cached_page_number == result->page_number) scrollback->cached_page_number = -1;
+		}
+	}
+
+	/* queue the pages that are no longer hot */
+	uint cold_pages_count = scrollback->pages_count > SCROLLBACK_HOT_PAGES_COUNT ? scrollback->pages_count - SCROLLBACK_HOT_PAGES_COUNT : 0;
+	while (scrollback->queued_pages_count < cold_pages_count && ~scrollback->taken_slots)
+	{
+		uint slot = __builtin_ctzll(~scrollback->taken_slots);
+		scrollback->taken_slots |= (uint64)1 << slot;
+
+		scrollback_page        *page        = get_scrollback_page(scrollback->queued_pages_count, scrollback);
+		scrollback_compression *compression = &scrollback->compressions[slot];
+		*compression = (scrollback_compression)
+		{
+			.scrollback   = scrollback,
+			.slot         = slot,
+			.page_number  = scrollback->first_page_number + scrollback->queued_pages_count,
+			.cells        = page->cells,
+			.cells_count  = page->cells_count,
+			.lengths      = page->lengths,
+			.lengths_size = page->lengths_size,
+		};
+		page->state = SCROLLBACK_PAGE_STATE_QUEUED;
+		scrollback->queued_pages_count += 1;
+		push_job(compress_scrollback_page, compression, &scrollback->jobs);
+	}
+
+	/* discard the oldest pages. the cells of a queued page are released when its
+	   compression comes back, which the queue's capacity bounds */
+	while (scrollback->memory_size > scrollback->memory_capacity && scrollback->pages_count > SCROLLBACK_HOT_PAGES_COUNT)
+	{
+		if (reflowing && scrollback->first_page_number >= reflow->first_page_number) break;
+
+		scrollback_page *page = get_scrollback_page(0, scrollback);
+		if (page->block) scrollback->memory_size -= get_allocation_size(page->block_size);
+		else             scrollback->memory_size -= SCROLLBACK_CELLS_SIZE + get_allocation_size(page->lengths_size);
+		scrollback->first_line  += page->lines_count;
+		scrollback->lines_count -= page->lines_count;
+		if (scrollback->cached_page_number == scrollback->first_page_number) scrollback->cached_page_number = -1;
+		if (page->state != SCROLLBACK_PAGE_STATE_QUEUED) release_scrollback_page(page);
+
+		scrollback->first_page = (scrollback->first_page + 1) & (scrollback->pages_capacity - 1);
+		scrollback->first_page_number += 1;
+		scrollback->pages_count       -= 1;
+		if (scrollback->queued_pages_count) scrollback->queued_pages_count -= 1;
+	}
+
+	/* give a job the next pages to count, from the newest to the oldest */
+	if (!reflowing && scrollback->reflow_page_number > scrollback->first_page_number)
+	{
+		reflow->columns     = scrollback->columns;
+		reflow->pages_count = 0;
+		while (scrollback->reflow_page_number > scrollback->first_page_number && reflow->pages_count < SCROLLBACK_REFLOW_PAGES_CAPACITY)
+		{
+			uintl            page_number = scrollback->reflow_page_number - 1;
+			scrollback_page *page        = get_scrollback_page(page_number - scrollback->first_page_number, scrollback);
+			if (page->state != SCROLLBACK_PAGE_STATE_OPEN && page->rows_columns != scrollback->columns)
+			{
+				reflow->first_page_number                  = page_number;
+				reflow->lengths[reflow->pages_count]       = page->lengths;
+				reflow->lengths_sizes[reflow->pages_count] = page->lengths_size;
+				reflow->pages_count                       += 1;
+			}
+			else if (reflow->pages_count) break;  /* the pages of a batch are consecutive */
+			scrollback->reflow_page_number = page_number;
+		}
+
+		if (reflow->pages_count)
+		{
+			/* the batch was gathered backwards */
+			for (uint i = 0, j = reflow->pages_count - 1; i < j; ++i, --j)
+			{
+				const byte *lengths = reflow->lengths[i];
+				uint        size    = reflow->lengths_sizes[i];
+				reflow->lengths[i]       = reflow->lengths[j];
+				reflow->lengths_sizes[i] = reflow->lengths_sizes[j];
+				reflow->lengths[j]       = lengths;
+				reflow->lengths_sizes[j] = size;
+			}
+
+			reflow->requested = 1;
+			push_job(count_scrollback_reflow_rows, reflow, &scrollback->jobs);
+		}
+	}
+}
+
+/* finds the page of `line` with a binary search over the ring */
+static uint find_scrollback_page(uintl line, const scrollback *scrollback)
+{
+	uint low  = 0;
+	uint high = scrollback->pages_count;
+	while (high - low > 1)
+	{
+		uint middle = (low + high) / 2;
+		if (get_scrollback_page(middle, scrollback)->first_line <= line) low = middle;
+		else high = middle;
+	}
+	return low;
+}
+
+uint get_scrollback_line(uintl line, const terminal_cell **cells, scrollback *scrollback)
+{
+	assert(line >= scrollback->first_line && line < scrollback->first_line + scrollback->lines_count);
+
+	uint                   index       = find_scrollback_page(line, scrollback);
+	uintl                  page_number = scrollback->first_page_number + index;
+	const scrollback_page *page        = get_scrollback_page(index, scrollback);
+
+	/* the offsets of the lines of the page, of which the last may be open */
+	bit cached = scrollback->cached_page_number == page_number
+	          && scrollback->cached_lengths_size == page->lengths_size
+	          && scrollback->cached_open_line_size == scrollback->open_line_size;
+	if (!cached)
+	{
+		uint       *offsets = scrollback->cached_offsets;
+		const byte *lengths = page->lengths;
+		uint        i       = 0;
+		offsets[0] = 0;
+		for (; i < page->lines_count && lengths < page->lengths + page->lengths_size; ++i)
+		{
+			uint length;
+			lengths = read_scrollback_length(lengths, &length);
+			offsets[i + 1] = offsets[i] + length;
+		}
+		if (i < page->lines_count) offsets[i + 1] = offsets[i] + scrollback->open_line_size;
+
+		if (!page->cells)
+		{
+			uint size = decompress_lz(page->block + page->lengths_size, page->compressed_size, scrollback->cached_planes, page->cells_count * sizeof(terminal_cell));
+			assert(size == page->cells_count * sizeof(terminal_cell));
+			unshuffle_terminal_cells(scrollback->cached_planes, page->cells_count, scrollback->cached_cells);
+		}
+		scrollback->cached_page_number    = page_number;
+		scrollback->cached_lengths_size   = page->lengths_size;
+		scrollback->cached_open_line_size = scrollback->open_line_size;
+	}
+
+	uint line_index = line - page->first_line;
+	*cells = (page->cells ? page->cells : scrollback->cached_cells) + scrollback->cached_offsets[line_index];
+	return scrollback->cached_offsets[line_index + 1] - scrollback->cached_offsets[line_index];
+}
+
+/* the rows that a page takes at the current width, counting them if no job
+   has */
+static uint get_scrollback_page_rows(scrollback_page *page, scrollback *scrollback)
+{
+	if (page->state == SCROLLBACK_PAGE_STATE_OPEN)
+	{
+		uint rows_count = count_scrollback_page_rows(page->lengths, page->lengths_size, scrollback->columns);
+		if (scrollback->line_open) rows_count += count_scrollback_rows(scrollback->open_line_size, scrollback->columns);
+		return rows_count;
+	}
+
+	if (page->rows_columns != scrollback->columns)
+	{
+		page->rows_count   = count_scrollback_page_rows(page->lengths, page->lengths_size, scrollback->columns);
+		page->rows_columns = scrollback->columns;
+	}
+	return page->rows_count;
+}
+
+/* finds the row that is `rows_back` rows before the end of the scrollback, as
+   a line and a row of it. returns how far back that is, which is less if the
+   scrollback has fewer rows. */
+uintl seek_scrollback_row(uintl rows_back, uintl *line, uint *row, scrollback *scrollback)
+{
+	*line = scrollback->first_line + scrollback->lines_count;
+	*row  = 0;
+	if (!rows_back) return 0;
+
+	uintl passed_rows_count = 0;
+	for (uint i = scrollback->pages_count; i--;)
+	{
+		scrollback_page *page       = get_scrollback_page(i, scrollback);
+		uint             rows_count = get_scrollback_page_rows(page, scrollback);
+		if (passed_rows_count + rows_count < rows_back)
+		{
+			passed_rows_count += rows_count;
+			continue;
+		}
+
+		/* walk to the row from the start of the page */
+		uint        target = rows_count - (rows_back - passed_rows_count);
+		const byte *lengths = page->lengths;
+		const byte *end     = page->lengths + page->lengths_size;
+		uint        rows    = 0;
+		for (uint j = 0;; ++j)
+		{
+			assert(j < page->lines_count);
+			uint length;
+			if (lengths < end) lengths = read_scrollback_length(lengths, &length);
+			else length = scrollback->open_line_size;
+
+			uint line_rows_count = count_scrollback_rows(length, scrollback->columns);
+			if (rows + line_rows_count > target)
+			{
+				*line = page->first_line + j;
+				*row  = target - rows;
+				return rows_back;
+			}
+			rows += line_rows_count;
+		}
+	}
+
+	*line = scrollback->first_line;
+	return passed_rows_count;
+}
@@ -0,0 +1,644 @@
+/*
+
+a literal is searched for by two of its bytes: a vector of positions is
+compared with the one byte at its offset in the pattern and with the other at
+its own, and only the positions where both match are compared whole. the two
+are the rarest of the pattern in a sample of the document, so that few
+positions pass in the text that is searched, not in text in general.
+
+the pieces of a document are searched one by one, where they are; a match that
+begins in a piece and ends in the next is found in a window over the seam.
+
+*/
+
+void compile_text_pattern(const byte *bytes, uint size, const text_buffer *buffer, text_pattern *pattern)
+{
+	assert(size && size <= TEXT_PATTERN_CAPACITY);
+	pattern->bytes = bytes;
+	pattern->size  = size;
+
+	uint frequencies[256] = {0};
+	uint sampled_size     = 0;
+	for (uint i = 0; i < buffer->pieces_count && sampled_size < TEXT_SEARCH_SAMPLE_SIZE; ++i)
+	{
+		const text_piece *piece       = &buffer->pieces[i];
+		const byte       *data        = get_text_piece_data(piece, buffer);
+		uint              sample_size = piece->size < TEXT_SEARCH_SAMPLE_SIZE - sampled_size ? piece->size : TEXT_SEARCH_SAMPLE_SIZE - sampled_size;
+		for (uint j = 0; j < sample_size; ++j) frequencies[data[j]] += 1;
+		sampled_size += sample_size;
+	}
+
+	/* the ends win ties, so that a candidate is more likely to be a match */
+	uint first = size - 1;
+	for (uint i = 0; i < size; ++i)
+	{
+		if (frequencies[bytes[i]] < frequencies[bytes[first]]) first = i;
+	}
+	uint second = first ? 0 : size - 1;
+	for (uint i = 0; i < size; ++i)
+	{
+		if (i == first) continue;
+		if (bytes[second] == bytes[first] || (bytes[i] != bytes[first] && frequencies[bytes[i]] < frequencies[bytes[second]])) second = i;
+	}
+
+	pattern->rare_indices[0] = first;
+	pattern->rare_indices[1] = second;
+	pattern->rare_bytes[0]   = bytes[first];
+	pattern->rare_bytes[1]   = bytes[second];
+}
+
+/* returns where the first match in `data` begins, or `size` */
+uintl find_pattern(const byte *data, uintl size, const text_pattern *pattern)
+{
+	if (size < pattern->size) return size;
+
+	uintl       last_start = size - pattern->size;
+	const byte *first      = data + pattern->rare_indices[0];
+	const byte *second     = data + pattern->rare_indices[1];
+	uintl       i          = 0;
+#if defined(__AVX2__)
+	{
+		const __m256i first_byte  = _mm256_set1_epi8(pattern->rare_bytes[0]);
+		const __m256i second_byte = _mm256_set1_epi8(pattern->rare_bytes[1]);
+		for (; i + 32 <= last_start + 1; i += 32)
+		{
+			__m256i firsts  = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(first + i)), first_byte);
+			__m256i seconds = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(second + i)), second_byte);
+			uint    mask    = _mm256_movemask_epi8(_mm256_and_si256(firsts, seconds));
+			for (; mask; mask &= mask - 1)
+			{
+				uintl candidate = i + __builtin_ctz(mask);
+				if (!compare(data + candidate, pattern->bytes, pattern->size)) return candidate;
+			}
+		}
+	}
+#endif
+#if defined(__SSE2__)
+	{
+		const __m128i first_byte  = _mm_set1_epi8(pattern->rare_bytes[0]);
+		const __m128i second_byte = _mm_set1_epi8(pattern->rare_bytes[1]);
+		for (; i + 16 <= last_start + 1; i += 16)
+		{
+			__m128i firsts  = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(first + i)), first_byte);
+			__m128i seconds = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(second + i)), second_byte);
+			uint    mask    = _mm_movemask_epi8(_mm_and_si128(firsts, seconds));
+			for (; mask; mask &= mask - 1)
+			{
+				uintl candidate = i + __builtin_ctz(mask);
+				if (!compare(data + candidate, pattern->bytes, pattern->size)) return candidate;
+			}
+		}
+	}
+#endif
+	for (; i <= last_start; ++i)
+	{
+		if (first[i] == pattern->rare_bytes[0] && second[i] == pattern->rare_bytes[1] && !compare(data + i, pattern->bytes, pattern->size)) return i;
+	}
+	return size;
+}
+
+/* returns where the first match that begins in [`offset`, `end`) begins, or `TEXT_NO_MATCH` */
+uintl find_text(uintl offset, uintl end, const text_pattern *pattern, const text_buffer *buffer)
+{
+	if (end > buffer->size) end = buffer->size;
+	if (offset >= end) return TEXT_NO_MATCH;
+
+	/* what a match that begins before `end` may take */
+	uintl limit = end + pattern->size - 1 < buffer->size ? end + pattern->size - 1 : buffer->size;
+	for (uint i = find_text_piece(offset, buffer); i < buffer->pieces_count && buffer->pieces[i].offset < limit; ++i)
+	{
+		const text_piece *piece     = &buffer->pieces[i];
+		uintl             piece_end = piece->offset + piece->size < limit ? piece->offset + piece->size : limit;
+		uintl             begin     = offset > piece->offset ? offset - piece->offset : 0;
+		uintl             remainder = piece_end - piece->offset - begin;
+		uintl             match     = find_pattern(get_text_piece_data(piece, buffer) + begin, remainder, pattern);
+		if (match != remainder) return piece->offset + begin + match;
+
+		/* the matches that begin in the last bytes of the piece */
+		if (pattern->size > 1 && piece_end < limit)
+		{
+			byte  window[2 * TEXT_PATTERN_CAPACITY];
+			uint  tail_size   = remainder < pattern->size - 1 ? remainder : pattern->size - 1;
+			uintl tail_offset = piece_end - tail_size;
+			uint  window_size = tail_size + pattern->size - 1 < limit - tail_offset ? tail_size + pattern->size - 1 : limit - tail_offset;
+			window_size = read_text(tail_offset, window_size, window, buffer);
+			match = find_pattern(window, window_size, pattern);
+			if (match < tail_size) return tail_offset + match;
+		}
+	}
+	return TEXT_NO_MATCH;
+}
+
+/* makes room for `count` more matches */
+static void reserve_text_search_matches(uint count, uintl **matches, uint matches_count, uint *matches_capacity)
+{
+	if (matches_count + count <= *matches_capacity) return;
+
+	uint capacity = *matches_capacity ? *matches_capacity : 4096 / sizeof(uintl);
+	while (capacity < matches_count + count) capacity *= 2;
+	uintl *new_matches = allocate(capacity * sizeof(uintl), ALLOCATION_TAG_SEARCH);
+	if (*matches)
+	{
+		copy(new_matches, *matches, matches_count * sizeof(uintl));
+		deallocate(*matches, *matches_capacity * sizeof(uintl), ALLOCATION_TAG_SEARCH);
+	}
+	*matches          = new_matches;
+	*matches_capacity = capacity;
+}
+
+inline static bit matches_text(uintl offset, const text_pattern *pattern, const text_buffer *buffer)
+{
+	byte window[TEXT_PATTERN_CAPACITY];
+	return read_text(offset, pattern->size, window, buffer) == pattern->size && !compare(window, pattern->bytes, pattern->size);
+}
+
+static void search_text_chunk(void *parameter)
+{
+	text_search_chunk *chunk     = parameter;
+	text_search       *search    = chunk->search;
+	const text_buffer *buffer    = search->buffer;
+	uint               size      = search->pattern.size;
+	uintl              next      = chunk->begin;  /* the end of the last match */
+	uint               candidate = 0;
+	uint               piece     = chunk->candidates_count ? find_text_piece(chunk->candidates[0], buffer) : 0;
+	for (uintl step = chunk->begin; step < chunk->end && !atomic_load_explicit(&search->cancelled, memory_order_relaxed); step += TEXT_SEARCH_STEP_SIZE)
+	{
+		uintl step_end    = step + TEXT_SEARCH_STEP_SIZE < chunk->end ? step + TEXT_SEARCH_STEP_SIZE : chunk->end;
+		uint  found_count = 0;
+		if (chunk->candidates)
+		{
+			/* the candidates are in order, so the piece that each begins in is found by walking the pieces */
+			for (; candidate < chunk->candidates_count && chunk->candidates[candidate] < step_end; ++candidate)
+			{
+				uintl match = chunk->candidates[candidate];
+				if (match < next) continue;
+				while (piece + 1 < buffer->pieces_count && buffer->pieces[piece + 1].offset <= match) ++piece;
+				const text_piece *match_piece = &buffer->pieces[piece];
+				if (match + size <= match_piece->offset + match_piece->size)
+				{
+					if (compare(get_text_piece_data(match_piece, buffer) + (match - match_piece->offset), search->pattern.bytes, size)) continue;
+				}
+				else if (!matches_text(match, &search->pattern, buffer)) continue;
+				reserve_text_search_matches(1, &chunk->matches, chunk->matches_count, &chunk->matches_capacity);
+				chunk->matches[chunk->matches_count++] = match;
+				next         = match + size;
+				found_count += 1;
+			}
+		}
+		else
+		{
+			for (uintl match = find_text(next, step_end, &search->pattern, buffer); match != TEXT_NO_MATCH; match = find_text(next, step_end, &search->pattern, buffer))
+			{
+				reserve_text_search_matches(1, &chunk->matches, chunk->matches_count, &chunk->matches_capacity);
+				chunk->matches[chunk->matches_count++] = match;
+				next         = match + size;
+				found_count += 1;
+			}
+			if (next < step_end) next = step_end;
+		}
+		atomic_fetch_add_explicit(&search->found_count, found_count, memory_order_relaxed);
+	}
+	atomic_store_explicit(&chunk->done, 1, memory_order_release);
+	wake_main_thread();
+}
+
+static void release_text_search_chunks(text_search *search)
+{
+	for (uint i = search->merged_chunks_count; i < search->chunks_count; ++i)
+	{
+		text_search_chunk *chunk = &search->chunks[i];
+		if (chunk->matches) deallocate(chunk->matches, chunk->matches_capacity * sizeof(uintl), ALLOCATION_TAG_SEARCH);
+	}
+	deallocate(search->chunks, search->chunks_count * sizeof(text_search_chunk), ALLOCATION_TAG_SEARCH);
+	search->chunks         = 0;
+	search->buffer->readers_count -= 1;
+	search->running        = 0;
+}
+
+static void forget_text_search_result(text_search_result *result)
+{
+	if (result->matches) deallocate(result->matches, result->matches_capacity * sizeof(uintl), ALLOCATION_TAG_SEARCH);
+	result->matches = 0;
+	result->use     = 0;
+}
+
+/* keeps what the last query found, in place of what it found before or of the oldest result */
+static void keep_text_search_result(text_search *search)
+{
+	text_search_result *kept = &search->results[0];
+	for (uint i = 0; i < TEXT_SEARCH_RESULTS_CAPACITY; ++i)
+	{
+		text_search_result *result = &search->results[i];
+		if (result->use && result->size == search->pattern.size && !compare(result->bytes, search->bytes, result->size))
+		{
+			kept = result;
+			break;
+		}
+		if (result->use < kept->use) kept = result;
+	}
+	forget_text_search_result(kept);
+
+	copy(kept->bytes, search->bytes, search->pattern.size);
+	kept->size             = search->pattern.size;
+	kept->use              = ++search->uses_count;
+	kept->searched_end     = search->searched_end;
+	kept->matches          = search->matches;
+	kept->matches_count    = search->matches_count;
+	kept->matches_capacity = search->matches_capacity;
+	search->matches          = 0;
+	search->matches_count    = 0;
+	search->matches_capacity = 0;
+
+	/* the oldest are forgotten until the rest fit, though the last is always kept */
+	for (;;)
+	{
+		uintl               size   = 0;
+		text_search_result *oldest = kept;
+		for (uint i = 0; i < TEXT_SEARCH_RESULTS_CAPACITY; ++i)
+		{
+			text_search_result *result = &search->results[i];
+			if (!result->use) continue;
+			size += (uintl)result->matches_capacity * sizeof(uintl);
+			if (result->use < oldest->use) oldest = result;
+		}
+		if (size <= TEXT_SEARCH_RESULTS_SIZE || oldest == kept) break;
+		forget_text_search_result(oldest);
+	}
+}
+
+/* whether a match of the pattern may begin within another, so that a search that skips over matches misses some places it matches */
+static bit overlaps_text_pattern(const byte *bytes, uint size)
+{
+	for (uint shift = 1; shift < size; ++shift)
+	{
+		if (!compare(bytes, bytes + shift, size - shift)) return 1;
+	}
+	return 0;
+}
+
+/* splits [`begin`, `end`) into chunks, which check the candidates that begin in them if there are any */
+static void push_text_search_chunks(uintl begin, uintl end, uint chunks_count, const text_search_result *candidates, text_search *search)
+{
+	uintl        chunk_size = (end - begin + chunks_count - 1) / chunks_count;
+	const uintl *candidate  = candidates ? candidates->matches : 0;
+	for (uint i = 0; i < chunks_count; ++i)
+	{
+		text_search_chunk *chunk = &search->chunks[search->chunks_count++];
+		*chunk = (text_search_chunk){
+			.search = search,
+			.begin  = begin + i * chunk_size,
+			.end    = i + 1 == chunks_count ? end : begin + (i + 1) * chunk_size,
+		};
+		if (candidates)
+		{
+			/* the first candidate after the chunk, by bisection */
+			const uintl *candidates_end = candidates->matches + candidates->matches_count;
+			const uintl *low            = candidate;
+			const uintl *high           = candidates_end;
+			while (low < high)
+			{
+				const uintl *middle = low + (high - low) / 2;
+				if (*middle < chunk->end) low = middle + 1;
+				else high = middle;
+			}
+			chunk->candidates       = candidate;
+			chunk->candidates_count = low - candidate;
+			candidate               = low;
+
+			/* a chunk without candidates has no matches either */
+			if (!chunk->candidates_count) atomic_store_explicit(&chunk->done, 1, memory_order_relaxed);
+		}
+	}
+}
+
+/* how many chunks [`begin`, `end`) is split into: as big as they need to be to stay within the capacity */
+inline static uint count_text_search_chunks(uintl begin, uintl end)
+{
+	uintl chunks_count = (end - begin + TEXT_SEARCH_CHUNK_SIZE - 1) / TEXT_SEARCH_CHUNK_SIZE;
+	if (chunks_count > TEXT_SEARCH_CHUNKS_CAPACITY) chunks_count = TEXT_SEARCH_CHUNKS_CAPACITY;
+	return chunks_count;
+}
+
+void begin_text_search(const byte *bytes, uint size, text_buffer *buffer, text_search *search)
+{
+	cancel_text_search(search);
+
+	/* what was found in another document or before an edit is of no use */
+	if (search->buffer != buffer || search->edits_count != buffer->edits_count)
+	{
+		for (uint i = 0; i < TEXT_SEARCH_RESULTS_CAPACITY; ++i) forget_text_search_result(&search->results[i]);
+	}
+	else if (search->pattern.size) keep_text_search_result(search);
+	search->matches_count = 0;
+
+	copy(search->bytes, bytes, size);
+	compile_text_pattern(search->bytes, size, buffer, &search->pattern);
+	search->buffer      = buffer;
+	search->edits_count = buffer->edits_count;
+	atomic_store(&search->cancelled, 0);
+
+	/* the query was searched before: its matches are taken back and searched on from where they end.
+	   otherwise the longest earlier query that this one extends has its matches checked, as far as they go */
+	text_search_result *candidates   = 0;
+	uintl               searched_end = 0;
+	for (uint i = 0; i < TEXT_SEARCH_RESULTS_CAPACITY; ++i)
+	{
+		text_search_result *result = &search->results[i];
+		if (!result->use || result->size > size || compare(result->bytes, bytes, result->size)) continue;
+		if (result->size == size)
+		{
+			if (search->matches) deallocate(search->matches, search->matches_capacity * sizeof(uintl), ALLOCATION_TAG_SEARCH);
+			search->matches          = result->matches;
+			search->matches_count    = result->matches_count;
+			search->matches_capacity = result->matches_capacity;
+			searched_end             = result->searched_end;
+			result->matches          = 0;
+			forget_text_search_result(result);
+			candidates = 0;
+			break;
+		}
+		if ((!candidates || result->size > candidates->size) && result->searched_end && !overlaps_text_pattern(result->bytes, result->size)) candidates = result;
+	}
+	if (candidates) candidates->use = ++search->uses_count;
+	atomic_store(&search->found_count, search->matches_count);
+
+	uintl checked_end           = candidates ? candidates->searched_end : 0;
+	uintl search_begin          = candidates ? checked_end : searched_end;
+	uint  checked_chunks_count  = count_text_search_chunks(0, checked_end);
+	uint  searched_chunks_count = count_text_search_chunks(search_begin, buffer->size);
+	if (!checked_chunks_count && !searched_chunks_count) searched_chunks_count = 1;
+
+	search->chunks_count        = 0;
+	search->merged_chunks_count = 0;
+	search->searched_end        = searched_end;
+	search->chunks              = allocate((checked_chunks_count + searched_chunks_count) * sizeof(text_search_chunk), ALLOCATION_TAG_SEARCH);
+	search->running             = 1;
+	buffer->readers_count      += 1;
+	if (checked_chunks_count) push_text_search_chunks(0, checked_end, checked_chunks_count, candidates, search);
+	if (searched_chunks_count) push_text_search_chunks(search_begin, buffer->size, searched_chunks_count, 0, search);
+
+	/* the workers steal the oldest jobs first, so the chunks are searched about in order */
+	for (uint i = 0; i < search->chunks_count; ++i)
+	{
+		if (!atomic_load_explicit(&search->chunks[i].done, memory_order_relaxed)) push_job(search_text_chunk, &search->chunks[i], &search->jobs);
+	}
+}
+
+/* merges the chunks that are done, in order, and returns whether the search still runs */
+bit update_text_search(text_search *search)
+{
+	if (!search->running) return 0;
+
+	uint size = search->pattern.size;
+	for (; search->merged_chunks_count < search->chunks_count; ++search->merged_chunks_count)
+	{
+		text_search_chunk *chunk = &search->chunks[search->merged_chunks_count];
+		if (!atomic_load_explicit(&chunk->done, memory_order_acquire)) break;
+
+		/* a chunk's first matches may overlap the last match of the chunk before,
+		   so it is searched again from there until they agree */
+		uintl next = search->matches_count ? search->matches[search->matches_count - 1] + size : 0;
+		uint  i    = 0;
+		while (i < chunk->matches_count && chunk->matches[i] < next)
+		{
+			uintl match = find_text(next, chunk->end, &search->pattern, search->buffer);
+			while (i < chunk->matches_count && chunk->matches[i] < match) ++i;
+			if (match == TEXT_NO_MATCH || (i < chunk->matches_count && chunk->matches[i] == match)) break;
+			reserve_text_search_matches(1, &search->matches, search->matches_count, &search->matches_capacity);
+			search->matches[search->matches_count++] = match;
+			next = match + size;
+		}
+		reserve_text_search_matches(chunk->matches_count - i, &search->matches, search->matches_count, &search->matches_capacity);
+		copy(search->matches + search->matches_count, chunk->matches + i, (chunk->matches_count - i) * sizeof(uintl));
+		search->matches_count += chunk->matches_count - i;
+		search->searched_end   = chunk->end;
+
+		if (chunk->matches) deallocate(chunk->matches, chunk->matches_capacity * sizeof(uintl), ALLOCATION_TAG_SEARCH);
+		chunk->matches = 0;
+	}
+
+	if (search->merged_chunks_count == search->chunks_count)
+	{
+		wait_for_jobs(&search->jobs);
+		release_text_search_chunks(search);
+		atomic_store(&search->found_count, search->matches_count);
+	}
+	return search->running;
+}
+
+/* stops the jobs, which look at the cancellation between steps, and keeps what was merged */
+void cancel_text_search(text_search *search)
+{
+	if (!search->running) return;
+	atomic_store(&search->cancelled, 1);
+	wait_for_jobs(&search->jobs);
+	release_text_search_chunks(search);
+}
+
+void end_text_search(text_search *search)
+{
+	cancel_text_search(search);
+	if (search->matches) deallocate(search->matches, search->matches_capacity * sizeof(uintl), ALLOCATION_TAG_SEARCH);
+	search->matches          = 0;
+	search->matches_count    = 0;
+	search->matches_capacity = 0;
+	search->pattern.size     = 0;
+	for (uint i = 0; i < TEXT_SEARCH_RESULTS_CAPACITY; ++i) forget_text_search_result(&search->results[i]);
+}
+
+/* every match of `literal` in the file at `path`, against `memmem`, then over
+   pieces that are cut in the middle of every match */
+void benchmark_text_search(const char *path, const char *literal)
+{
+	text_buffer buffer;
+	open_text_buffer(path, &buffer);
+
+	text_pattern pattern;
+	uint         literal_size = strlen(literal);
+	compile_text_pattern((const byte *)literal, literal_size, &buffer, &pattern);
+
+	const uint rounds_count = 4;
+
+	uintl matches_count  = 0;
+	uintl beginning_time = get_time();
+	for (uint i = 0; i < rounds_count; ++i)
+	{
+		matches_count = 0;
+		for (uintl offset = find_text(0, buffer.size, &pattern, &buffer); offset != TEXT_NO_MATCH; offset = find_text(offset + literal_size, buffer.size, &pattern, &buffer)) matches_count += 1;
+	}
+	float64 search_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR / rounds_count;
+	report_comment(
+		"%llu matches of \"%s\" (found by '%c' and '%c') in %llu bytes: %.3f ms, %.2f GB/s\n",
+		matches_count, literal, pattern.rare_bytes[0], pattern.rare_bytes[1], buffer.size, search_time * 1000, buffer.size / search_time / 1e9);
+
+#if defined(ON_LINUX)
+	{
+		uintl library_matches_count = 0;
+		beginning_time = get_time();
+		for (uint i = 0; i < rounds_count; ++i)
+		{
+			library_matches_count = 0;
+			const byte *end = buffer.original + buffer.original_size;
+			for (const byte *match = buffer.original; match && (match = memmem(match, end - match, literal, literal_size)); match += literal_size) library_matches_count += 1;
+		}
+		float64 library_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR / rounds_count;
+		assert(library_matches_count == matches_count);
+		report_comment("memmem: %.3f ms, %.2f GB/s\n", library_time * 1000, buffer.size / library_time / 1e9);
+	}
+#endif
+
+	if (literal_size > 1 && matches_count && buffer.pieces_count == 1)
+	{
+		text_piece *pieces       = allocate((matches_count + 1) * sizeof(text_piece), ALLOCATION_TAG_BUFFER);
+		uint        pieces_count = 0;
+		uintl       cut          = 0;
+		for (uintl offset = find_text(0, buffer.size, &pattern, &buffer); offset != TEXT_NO_MATCH; offset = find_text(offset + literal_size, buffer.size, &pattern, &buffer))
+		{
+			pieces[pieces_count++] = (text_piece){ .size = offset + 1 - cut, .source = cut };
+			cut = offset + 1;
+		}
+		pieces[pieces_count++] = (text_piece){ .size = buffer.size - cut, .source = cut };
+		splice_text_pieces(0, 1, pieces, pieces_count, &buffer);
+
+		uintl pieces_matches_count = 0;
+		beginning_time = get_time();
+		for (uintl offset = find_text(0, buffer.size, &pattern, &buffer); offset != TEXT_NO_MATCH; offset = find_text(offset + literal_size, buffer.size, &pattern, &buffer)) pieces_matches_count += 1;
+		float64 pieces_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+		assert(pieces_matches_count == matches_count);
+		report_comment("over %u pieces: %.3f ms, %.2f GB/s\n", buffer.pieces_count, pieces_time * 1000, buffer.size / pieces_time / 1e9);
+
+		deallocate(pieces, (matches_count + 1) * sizeof(text_piece), ALLOCATION_TAG_BUFFER);
+	}
+
+	close_text_buffer(&buffer);
+}
+
+/* how soon the first matches come and how long all take, against a search on
+   the main thread alone, then how soon a search stops when it is cancelled */
+void benchmark_text_find_all(const char *path, const char *literal)
+{
+	text_buffer buffer;
+	open_text_buffer(path, &buffer);
+	uint literal_size = strlen(literal);
+
+	text_pattern pattern;
+	compile_text_pattern((const byte *)literal, literal_size, &buffer, &pattern);
+	uintl *matches          = 0;
+	uint   matches_count    = 0;
+	uint   matches_capacity = 0;
+	uintl  beginning_time   = get_time();
+	for (uintl offset = find_text(0, buffer.size, &pattern, &buffer); offset != TEXT_NO_MATCH; offset = find_text(offset + literal_size, buffer.size, &pattern, &buffer))
+	{
+		reserve_text_search_matches(1, &matches, matches_count, &matches_capacity);
+		matches[matches_count++] = offset;
+	}
+	float64 serial_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+
+	text_search search = {0};
+	float64     first_time = 0;
+	beginning_time = get_time();
+	begin_text_search((const byte *)literal, literal_size, &buffer, &search);
+	while (update_text_search(&search))
+	{
+		if (!first_time && search.matches_count) first_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+		thrd_yield();
+	}
+	float64 parallel_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+	assert(search.matches_count == matches_count && !compare(search.matches, matches, matches_count * sizeof(uintl)));
+	if (matches) deallocate(matches, matches_capacity * sizeof(uintl), ALLOCATION_TAG_SEARCH);
+	end_text_search(&search);
+
+	beginning_time = get_time();
+	begin_text_search((const byte *)literal, literal_size, &buffer, &search);
+	cancel_text_search(&search);
+	float64 cancellation_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+
+	report_comment(
+		"%u matches in %llu bytes on %u workers: the first in %.3f ms, all in %.3f ms (%.2f GB/s) against %.3f ms alone; a cancelled search took %.3f ms\n",
+		matches_count, buffer.size, global.jobs.workers_count, first_time * 1000, parallel_time * 1000, buffer.size / parallel_time / 1e9, serial_time * 1000, cancellation_time * 1000);
+
+	end_text_search(&search);
+	close_text_buffer(&buffer);
+}
+
+/* a query typed a byte at a time and then erased, searching at every
+   keystroke, against searching for every query from nothing */
+void benchmark_text_search_typing(const char *path, const char *query)
+{
+	text_buffer buffer;
+	open_text_buffer(path, &buffer);
+	uint query_size = strlen(query);
+
+	text_search search      = {0};
+	text_search fresh       = {0};
+	float64     typing_time = 0;
+	float64     fresh_time  = 0;
+	for (uint i = 1; i < 2 * query_size; ++i)
+	{
+		uint  size           = i <= query_size ? i : 2 * query_size - i;
+		uintl beginning_time = get_time();
+		begin_text_search((const byte *)query, size, &buffer, &search);
+		while (update_text_search(&search)) thrd_yield();
+		float64 keystroke_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+
+		beginning_time = get_time();
+		begin_text_search((const byte *)query, size, &buffer, &fresh);
+		while (update_text_search(&fresh)) thrd_yield();
+		float64 query_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+		assert(search.matches_count == fresh.matches_count && !compare(search.matches, fresh.matches, fresh.matches_count * sizeof(uintl)));
+		end_text_search(&fresh);
+
+		report_comment("\"%.*s\": %u matches in %.3f ms, against %.3f ms from nothing\n", size, query, search.matches_count, keystroke_time * 1000, query_time * 1000);
+		typing_time += keystroke_time;
+		fresh_time  += query_time;
+	}
+	report_comment("%u keystrokes over %llu bytes: %.3f ms, against %.3f ms from nothing\n", 2 * query_size - 1, buffer.size, typing_time * 1000, fresh_time * 1000);
+
+	end_text_search(&search);
+	close_text_buffer(&buffer);
+}
+
+/* every match of `literal` in the file at `path` replaced at once, then
+   undone and redone, against replacing matches one by one */
+void benchmark_text_replace_all(const char *path, const char *literal, const char *replacement)
+{
+	text_buffer buffer;
+	open_text_buffer(path, &buffer);
+	uint  literal_size     = strlen(literal);
+	uint  replacement_size = strlen(replacement);
+	uintl original_size    = buffer.size;
+
+	text_search search = {0};
+	begin_text_search((const byte *)literal, literal_size, &buffer, &search);
+	while (update_text_search(&search)) thrd_yield();
+
+	uintl beginning_time = get_time();
+	replace_text_matches(search.matches, search.matches_count, literal_size, (const byte *)replacement, replacement_size, &buffer);
+	float64 replacement_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+	assert(buffer.size == original_size + (uintl)search.matches_count * replacement_size - (uintl)search.matches_count * literal_size);
+	uint pieces_count = buffer.pieces_count;
+
+	uintl offset;
+	beginning_time = get_time();
+	undo_text(&offset, &buffer);
+	float64 undo_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+	assert(buffer.size == original_size);
+	beginning_time = get_time();
+	redo_text(&offset, &buffer);
+	float64 redo_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+	assert(buffer.pieces_count == pieces_count);
+
+	/* the last matches one by one, from the end so that the others stay where they were found */
+	undo_text(&offset, &buffer);
+	uint separate_count = search.matches_count < 10000 ? search.matches_count : 10000;
+	beginning_time = get_time();
+	for (uint i = 0; i < separate_count; ++i) replace_text(search.matches[search.matches_count - 1 - i], literal_size, (const byte *)replacement, replacement_size, &buffer);
+	float64 separate_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+
+	report_comment(
+		"%u matches of \"%s\" in %llu bytes replaced at once into %u pieces: %.3f ms, undone in %.3f ms and redone in %.3f ms; %u replaced one by one: %.3f ms\n",
+		search.matches_count, literal, original_size, pieces_count, replacement_time * 1000, undo_time * 1000, redo_time * 1000, separate_count, separate_time * 1000);
+
+	end_text_search(&search);
+	close_text_buffer(&buffer);
+}
@@ -0,0 +1,562 @@
+/*
+
+the UI is made anew every frame: its user opens and closes elements, which are
+added to a tree in the frame arena, and sets the open element's size and how it
+lays its children out. when the frame is drawn, the UI is -finalized-:
+	1) every element is measured, from its content up;
+	2) every element is placed, from the frame down, where elements that expand
+	   share the room that is left, and those that do not yield some of theirs
+	   when there is not enough;
+	3) the elements are indexed for hit-testing;
+	4) the elements are batched into quads for drawing.
+
+*/
+
+uint ui_element_size_table[] =
+{
+	[UI_ELEMENT_TAG_BOX]  = sizeof(ui_element_box),
+	[UI_ELEMENT_TAG_TEXT] = sizeof(ui_element_text),
+};
+
+static struct ui main_ui =
+{
+
+};
+
+struct ui *ui = &main_ui;
+
+void ui_reset(void)
+{
+	ui->state     = 0;
+	ui->roots     = 0;
+	ui->last_root = 0;
+}
+
+static void ui_push_state(ui_element *element)
+{
+	ui_state *state = ui->state ? ui->state + 1 : ui->states;
+	assert(state < ui->states + UI_STATES_CAPACITY);
+	state->element = element;
+	state->font    = ui->state ? ui->state->font : &default_font;
+	ui->state      = state;
+}
+
+static void ui_pop_state(void)
+{
+	assert(ui->state);
+	ui->state = ui->state == ui->states ? 0 : ui->state - 1;
+}
+
+ui_element *ui_begin_element(ui_element_tag element_tag, const void *element_data)
+{
+	uint        element_data_size = ui_element_size_table[element_tag];
+	ui_element *element           = push_into_arena(sizeof(ui_element) + element_data_size, _Alignof(ui_element), &global.frame_arena);
+	zero(element, sizeof(*element));
+	element->tag = element_tag;
+	copy(element->data, element_data, element_data_size);
+
+	if (ui->state)
+	{
+		ui_element *parent = ui->state->element;
+		if (parent->last_child) parent->last_child->sibling = element;
+		else                    parent->children            = element;
+		parent->last_child = element;
+	}
+	else
+	{
+		if (ui->last_root) ui->last_root->sibling = element;
+		else               ui->roots              = element;
+		ui->last_root = element;
+	}
+
+	ui_push_state(element);
+	return element;
+}
+
+void ui_end_element(void)
+{
+	ui_pop_state();
+}
+
+void ui_begin(void)
+{
+	assert(!ui->state);  /* roots do not nest */
+	ui_begin_element(UI_ELEMENT_TAG_BOX, &(ui_element_box){});
+	ui_set_expanding(1, 1);
+}
+
+void ui_end(void)
+{
+	ui_end_element();
+	assert(!ui->state);
+}
+
+void ui_begin_box(void)
+{
+	assert(ui->state);
+	ui_begin_element(UI_ELEMENT_TAG_BOX, &(ui_element_box){});
+}
+
+void ui_end_box(void)
+{
+	ui_end_element();
+}
+
+void ui_text(const char *format, ...)
+{
+	assert(ui->state);
+	ui_element_text text;
+	text.font = ui->state->font;
+
+	va_list vargs;
+	va_start(vargs, format);
+	text.text = push_formatted_string_v(&text.text_size, &global.frame_arena, format, vargs);
+	va_end(vargs);
+
+	ui_element *element = ui_begin_element(UI_ELEMENT_TAG_TEXT, &text);
+	element->horizontally_expanding = 1;
+	element->height.strictness      = 1.f;  /* a line is cut rather than squashed */
+	ui_end_element();
+}
+
+void ui_set_orientation(orientation orientation)
+{
+	ui->state->element->orientation = orientation;
+}
+
+void ui_set_width(float32 width)
+{
+	ui->state->element->width.magnitude = width;
+}
+
+void ui_set_height(float32 height)
+{
+	ui->state->element->height.magnitude = height;
+}
+
+void ui_set_expanding(bit horizontally, bit vertically)
+{
+	ui->state->element->horizontally_expanding = horizontally;
+	ui->state->element->vertically_expanding   = vertically;
+}
+
+void ui_set_font(font *font)
+{
+	ui->state->font = font;
+}
+
+/* the size that an element asks of its parent */
+static size2_f32 ui_get_element_size(const ui_element *element)
+{
+	size2_f32 size;
+	size.width  = element->width.magnitude  ? element->width.magnitude  : element->content_size.width;
+	size.height = element->height.magnitude ? element->height.magnitude : element->content_size.height;
+	return size;
+}
+
+/*
+	this is okay to be recursive because we have a fixed amount of UI elements
+	that was given by the programmer, and because rendering the UI has it's
+	codecycle. essentially, if the Stack overflows, it's the programmer's fault
+	for trying to be unlimiting.
+		- Emhyr 18.10.2024
+*/
+static void ui_measure_element(ui_element *element)
+{
+	size2_f32 content = {0};
+	if (element->tag == UI_ELEMENT_TAG_TEXT)
+	{
+		const ui_element_text *text = &element->data->text;
+		content.width  = (float32)text->text_size * text->font->glyph_width;
+		content.height = (float32)text->font->glyph_height;
+	}
+
+	for (ui_element *child = element->children; child; child = child->sibling)
+	{
+		ui_measure_element(child);
+		size2_f32 size = ui_get_element_size(child);
+		switch (element->orientation)
+		{
+		case ORIENTATION_HORIZONTAL:
+			content.width += size.width;
+			if (size.height > content.height) content.height = size.height;
+			break;
+		case ORIENTATION_VERTICAL:
+			content.height += size.height;
+			if (size.width > content.width) content.width = size.width;
+			break;
+		case ORIENTATION_TRANSCENDENTAL:
+			if (size.width  > content.width)  content.width  = size.width;
+			if (size.height > content.height) content.height = size.height;
+			break;
+		default: unreachable();
+		}
+	}
+	element->content_size = content;
+}
+
+static void ui_place_element(ui_element *element, const range2_f32 *range)
+{
+	element->range = *range;
+	if (!element->children) return;
+
+	size2_f32 room     = { .width = range->right - range->left, .height = range->base - range->top };
+	bit       vertical = element->orientation == ORIENTATION_VERTICAL;
+
+	/* along the orientation: what the children that do not expand ask, what
+	   they could yield of it, and how many share what is left */
+	float32 asked           = 0;
+	float32 yieldable       = 0;
+	uint    expanding_count = 0;
+	if (element->orientation != ORIENTATION_TRANSCENDENTAL)
+	{
+		for (ui_element *child = element->children; child; child = child->sibling)
+		{
+			if (vertical ? child->vertically_expanding : child->horizontally_expanding)
+			{
+				expanding_count += 1;
+				continue;
+			}
+			size2_f32 size       = ui_get_element_size(child);
+			float32   along      = vertical ? size.height : size.width;
+			float32   strictness = vertical ? child->height.strictness : child->width.strictness;
+			asked     += along;
+			yieldable += along * (1.f - strictness);
+		}
+	}
+	float32 spare    = (vertical ? room.height : room.width) - asked;
+	float32 yielding = spare < 0 && yieldable > 0 ? (-spare < yieldable ? -spare / yieldable : 1.f) : 0;
+	float32 share    = spare > 0 && expanding_count ? spare / expanding_count : 0;
+
+	float32 offset = vertical ? range->top : range->left;
+	for (ui_element *child = element->children; child; child = child->sibling)
+	{
+		size2_f32  size        = ui_get_element_size(child);
+		range2_f32 child_range = *range;
+		if (!child->horizontally_expanding && size.width  < room.width)  child_range.right = range->left + size.width;
+		if (!child->vertically_expanding   && size.height < room.height) child_range.base  = range->top  + size.height;
+
+		if (element->orientation != ORIENTATION_TRANSCENDENTAL)
+		{
+			float32 along;
+			if (vertical ? child->vertically_expanding : child->horizontally_expanding) along = share;
+			else
+			{
+				float32 strictness = vertical ? child->height.strictness : child->width.strictness;
+				along = vertical ? size.height : size.width;
+				along -= along * (1.f - strictness) * yielding;
+			}
+
+			if (vertical)
+			{
+				child_range.top  = offset;
+				child_range.base = offset + along;
+			}
+			else
+			{
+				child_range.left  = offset;
+				child_range.right = offset + along;
+			}
+			offset += along;
+		}
+
+		/* what does not fit is cut */
+		if (child_range.right > range->right)     child_range.right = range->right;
+		if (child_range.base  > range->base)      child_range.base  = range->base;
+		if (child_range.left  > child_range.right) child_range.left  = child_range.right;
+		if (child_range.top   > child_range.base)  child_range.top   = child_range.base;
+
+		ui_place_element(child, &child_range);
+	}
+}
+
+void ui_finalize(const range2_f32 *frame_range)
+{
+	assert(!ui->state);  /* every element was ended */
+	for (ui_element *root = ui->roots; root; root = root->sibling)
+	{
+		ui_measure_element(root);
+		ui_place_element(root, frame_range);
+	}
+	ui_index_elements(frame_range);
+	ui_batch_elements(frame_range);
+}
+
+/* parents are painted before their children, and children before the
+   siblings that follow their parent */
+static uint ui_gather_elements(ui_element *element, uints layer, ui_element **elements)
+{
+	uint count = 0;
+	for (; element; element = element->sibling)
+	{
+		if (elements)
+		{
+			elements[count] = element;
+			element->layer  = layer;
+		}
+		count += 1;
+		count += ui_gather_elements(element->children, layer + 1, elements ? elements + count : 0);
+	}
+	return count;
+}
+
+static void ui_get_element_cells(const ui_element *element, uint *left, uint *top, uint *right, uint *base)
+{
+	const ui_index *index = &ui->index;
+	float32 l = (element->range.left  - index->range.left) / UI_INDEX_CELL_SIZE;
+	float32 t = (element->range.top   - index->range.top)  / UI_INDEX_CELL_SIZE;
+	float32 r = (element->range.right - index->range.left) / UI_INDEX_CELL_SIZE;
+	float32 b = (element->range.base  - index->range.top)  / UI_INDEX_CELL_SIZE;
+	*left  = clamp(l, 0.f, (float32)(index->columns - 1));
+	*top   = clamp(t, 0.f, (float32)(index->rows    - 1));
+	*right = clamp(r, 0.f, (float32)(index->columns - 1));
+	*base  = clamp(b, 0.f, (float32)(index->rows    - 1));
+}
+
+void ui_index_elements(const range2_f32 *frame_range)
+{
+	ui_index *index = &ui->index;
+	arena    *arena = &global.frame_arena;
+
+	index->range          = *frame_range;
+	index->columns        = (uint)((frame_range->right - frame_range->left) / UI_INDEX_CELL_SIZE) + 1;
+	index->rows           = (uint)((frame_range->base  - frame_range->top)  / UI_INDEX_CELL_SIZE) + 1;
+	index->elements_count = ui_gather_elements(ui->roots, 0, 0);
+	index->elements       = push_array(ui_element *, index->elements_count, arena);
+	ui_gather_elements(ui->roots, 0, index->elements);
+
+	uint cells_count = index->columns * index->rows;
+	index->cell_offsets = push_array(uint, cells_count + 1, arena);
+	zero(index->cell_offsets, (cells_count + 1) * sizeof(uint));
+
+	/* count the elements of each cell */
+	uint references_count = 0;
+	for (uint i = 0; i < index->elements_count; ++i)
+	{
+		uint left, top, right, base;
+		ui_get_element_cells(index->elements[i], &left, &top, &right, &base);
+		for (uint y = top; y <= base; ++y)
+		{
+			for (uint x = left; x <= right; ++x) index->cell_offsets[y * index->columns + x + 1] += 1;
+		}
+		references_count += (right - left + 1) * (base - top + 1);
+	}
+	for (uint i = 0; i < cells_count; ++i) index->cell_offsets[i + 1] += index->cell_offsets[i];
+
+	/* fill the cells; `cursors` is the next free slot of each cell */
+	index->cell_elements = push_array(ui_element *, references_count, arena);
+	uint *cursors = push_array(uint, cells_count, arena);
+	copy(cursors, index->cell_offsets, cells_count * sizeof(uint));
+	for (uint i = 0; i < index->elements_count; ++i)
+	{
+		uint left, top, right, base;
+		ui_get_element_cells(index->elements[i], &left, &top, &right, &base);
+		for (uint y = top; y <= base; ++y)
+		{
+			for (uint x = left; x <= right; ++x) index->cell_elements[cursors[y * index->columns + x]++] = index->elements[i];
+		}
+	}
+}
+
+ui_element *ui_find_element_at(float32 x, float32 y)
+{
+	const ui_index *index = &ui->index;
+	if (!index->elements_count) return 0;
+
+	vec2 point = { x, y };
+	vec2 frame[2] = { { index->range.left, index->range.top }, { index->range.right, index->range.base } };
+	if (!glm_aabb2d_point(frame, point)) return 0;
+
+	uint column = (uint)((x - index->range.left) / UI_INDEX_CELL_SIZE);
+	uint row    = (uint)((y - index->range.top)  / UI_INDEX_CELL_SIZE);
+	uint cell   = row * index->columns + column;
+
+	/* the last element in painting order is the topmost */
+	for (uint i = index->cell_offsets[cell + 1]; i-- > index->cell_offsets[cell];)
+	{
+		ui_element *element = index->cell_elements[i];
+		vec2 range[2] = { { element->range.left, element->range.top }, { element->range.right, element->range.base } };
+		if (glm_aabb2d_point(range, point)) return element;
+	}
+	return 0;
+}
+
+/* returns the number of rects that overlap `frame_range`, moving their indices
+   to the front of `batches->order` */
+static uint ui_cull_rects(ui_batches *batches, const range2_f32 *frame_range)
+{
+	uint visible_count = 0;
+	uint i = 0;
+#if defined(__SSE2__)
+	{
+		__m128 frame_left  = _mm_set1_ps(frame_range->left);
+		__m128 frame_top   = _mm_set1_ps(frame_range->top);
+		__m128 frame_right = _mm_set1_ps(frame_range->right);
+		__m128 frame_base  = _mm_set1_ps(frame_range->base);
+		for (; i + 4 <= batches->rects_count; i += 4)
+		{
+			__m128 visible = _mm_and_ps(
+				_mm_and_ps(_mm_cmplt_ps(_mm_load_ps(batches->lefts  + i), frame_right), _mm_cmpgt_ps(_mm_load_ps(batches->rights + i), frame_left)),
+				_mm_and_ps(_mm_cmplt_ps(_mm_load_ps(batches->tops   + i), frame_base),  _mm_cmpgt_ps(_mm_load_ps(batches->bases  + i), frame_top)));
+			uint mask = _mm_movemask_ps(visible);
+			while (mask)
+			{
+				uint lane = __builtin_ctz(mask);
+				batches->order[visible_count++] = i + lane;
+				mask &= mask - 1;
+			}
+		}
+	}
+#endif
+	for (; i < batches->rects_count; ++i)
+	{
+		bit visible = batches->lefts[i] < frame_range->right && batches->rights[i] > frame_range->left
+		           && batches->tops[i]  < frame_range->base  && batches->bases[i]  > frame_range->top;
+		if (visible) batches->order[visible_count++] = i;
+	}
+	return visible_count;
+}
+
+/* a stable least-significant-digit radix sort of `order` by `keys`, which
+   keeps the painting order within a layer and texture */
+static void ui_sort_rects(uint *order, uint count, const uint *keys, arena *arena)
+{
+	uint *scratch = push_array(uint, count, arena);
+	for (uint shift = 0; shift < 32; shift += 8)
+	{
+		uint histogram[257] = {};
+		for (uint i = 0; i < count; ++i) histogram[((keys[order[i]] >> shift) & 0xff) + 1] += 1;
+
+		/* skip the digits that every key shares */
+		if (histogram[((keys[order[0]] >> shift) & 0xff) + 1] == count) continue;
+
+		for (uint i = 0; i < 256; ++i) histogram[i + 1] += histogram[i];
+		for (uint i = 0; i < count; ++i) scratch[histogram[(keys[order[i]] >> shift) & 0xff]++] = order[i];
+		copy(order, scratch, count * sizeof(uint));
+	}
+}
+
+void ui_batch_elements(const range2_f32 *frame_range)
+{
+	ui_batches     *batches = &ui->batches;
+	const ui_index *index   = &ui->index;
+	arena          *arena   = &global.frame_arena;
+
+	/* a box is one rect, and a text at most one for each of its bytes */
+	uint capacity = 0;
+	for (uint i = 0; i < index->elements_count; ++i)
+	{
+		const ui_element *element = index->elements[i];
+		capacity += element->tag == UI_ELEMENT_TAG_TEXT ? element->data->text.text_size : 1;
+	}
+	capacity = (capacity + 3) & ~3u;
+	batches->lefts  = push_into_arena(capacity * sizeof(float32), 16, arena);
+	batches->tops   = push_into_arena(capacity * sizeof(float32), 16, arena);
+	batches->rights = push_into_arena(capacity * sizeof(float32), 16, arena);
+	batches->bases  = push_into_arena(capacity * sizeof(float32), 16, arena);
+	batches->keys   = push_array(uint, capacity, arena);
+	batches->glyphs = push_array(uint, capacity, arena);
+	batches->order  = push_array(uint, capacity, arena);
+
+	uint count = 0;
+	for (uint i = 0; i < index->elements_count; ++i)
+	{
+		const ui_element *element = index->elements[i];
+		if (element->tag == UI_ELEMENT_TAG_TEXT)
+		{
+			/* the glyphs that the font has and that fit the element */
+			const ui_element_text *text = &element->data->text;
+			float32 glyph_width  = text->font->glyph_width;
+			float32 glyph_height = text->font->glyph_height;
+			if (element->range.top + glyph_height > element->range.base) continue;
+			for (uint j = 0; j < text->text_size; ++j)
+			{
+				uintb   rune = text->text[j];
+				float32 left = element->range.left + j * glyph_width;
+				if (left + glyph_width > element->range.right) break;
+				if (rune <= ' ' || rune >= FONT_GLYPHS_CAPACITY) continue;
+
+				batches->lefts[count]  = left;
+				batches->tops[count]   = element->range.top;
+				batches->rights[count] = left + glyph_width;
+				batches->bases[count]  = element->range.top + glyph_height;
+				batches->keys[count]   = (uint)element->layer << 16 | UI_TEXTURE_GLYPHS;
+				batches->glyphs[count] = rune;
+				count += 1;
+			}
+		}
+		else
+		{
+			batches->lefts[count]  = element->range.left;
+			batches->tops[count]   = element->range.top;
+			batches->rights[count] = element->range.right;
+			batches->bases[count]  = element->range.base;
+			batches->keys[count]   = (uint)element->layer << 16 | UI_TEXTURE_NONE;
+			batches->glyphs[count] = 0;
+			count += 1;
+		}
+	}
+	batches->rects_count = count;
+
+	batches->quads_count   = ui_cull_rects(batches, frame_range);
+	batches->batches_count = 0;
+	if (!batches->quads_count) return;
+
+	ui_sort_rects(batches->order, batches->quads_count, batches->keys, arena);
+
+	/* what is cut is on top, since the quads are sorted by layer */
+	if (batches->quads_count > UI_QUADS_CAPACITY)
+	{
+		report_caution("%u quads of the UI are not drawn\n", batches->quads_count - UI_QUADS_CAPACITY);
+		batches->quads_count = UI_QUADS_CAPACITY;
+	}
+
+	batches->quads   = push_array(ui_quad, batches->quads_count, arena);
+	batches->batches = push_array(ui_batch, batches->quads_count, arena);
+	ui_batch *batch = 0;
+	for (uint i = 0; i < batches->quads_count; ++i)
+	{
+		uint j   = batches->order[i];
+		uint key = batches->keys[j];
+		batches->quads[i] = (ui_quad)
+		{
+			.range   = { .left = batches->lefts[j], .top = batches->tops[j], .right = batches->rights[j], .base = batches->bases[j] },
+			.texture = key & 0xffff,
+			.layer   = key >> 16,
+			.glyph   = batches->glyphs[j],
+		};
+
+		if (!batch || batch->layer != key >> 16 || batch->texture != (key & 0xffff))
+		{
+			batch = &batches->batches[batches->batches_count++];
+			batch->layer   = key >> 16;
+			batch->texture = key & 0xffff;
+			batch->first   = i;
+			batch->count   = 0;
+		}
+		batch->count += 1;
+	}
+}
+
+/* the UI's pipeline is expected to be bound, and the quads as its per-instance
+   vertex buffer */
+void ui_record_batches(VkCommandBuffer command_buffer)
+{
+	const ui_batches *batches       = &ui->batches;
+	uint              bound_texture = UI_TEXTURES_COUNT;
+	for (uint i = 0; i < batches->batches_count; ++i)
+	{
+		const ui_batch *batch = &batches->batches[i];
+
+		/* batches of one layer alternate between few textures, but each layer
+		   starts with its boxes, so most are bound once a layer */
+		if (batch->texture != bound_texture)
+		{
+			vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan.ui_pipeline_layout, 0, 1, &vulkan.ui_descriptor_sets[batch->texture], 0, 0);
+			bound_texture = batch->texture;
+		}
+
+		/* each quad is two triangles made in the vertex shader */
+		vkCmdDraw(command_buffer, 6, batch->count, 0, batch->first);
+	}
+}
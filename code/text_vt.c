@@ -0,0 +1,809 @@
+/*
+
+a parser of the VT/xterm escape sequences that programs write to a terminal,
+modelled after the state machine of DEC's VT500 (as described by Paul
+Williams).
+
+most of what a program writes is printable ASCII, so the ground state does not
+step through the machine byte by byte: it scans 32 bytes at a time for the
+next control, escape or non-ASCII byte, and copies everything before it into
+the grid at once.
+
+*/
+
+void initialize_terminal_grid(uint columns, uint rows, terminal_grid *grid)
+{
+	zero(grid, sizeof(*grid));
+	grid->columns      = columns;
+	grid->rows         = rows;
+	grid->cells        = allocate(columns * rows * sizeof(terminal_cell), ALLOCATION_TAG_TERMINAL);
+	grid->wrapped_rows = allocate(rows * sizeof(bit), ALLOCATION_TAG_TERMINAL);
+	grid->pen          = (terminal_cell){ .rune = ' ', .foreground = TERMINAL_DEFAULT_FOREGROUND, .background = TERMINAL_DEFAULT_BACKGROUND };
+	for (uint i = 0; i < columns * rows; ++i) grid->cells[i] = grid->pen;
+}
+
+void terminate_terminal_grid(terminal_grid *grid)
+{
+	deallocate(grid->cells, grid->columns * grid->rows * sizeof(terminal_cell), ALLOCATION_TAG_TERMINAL);
+	deallocate(grid->wrapped_rows, grid->rows * sizeof(bit), ALLOCATION_TAG_TERMINAL);
+}
+
+inline terminal_cell *get_terminal_grid_row(uint row, const terminal_grid *grid)
+{
+	uint physical_row = grid->first_row + row;
+	if (physical_row >= grid->rows) physical_row -= grid->rows;
+	return grid->cells + physical_row * grid->columns;
+}
+
+static bit *get_terminal_grid_row_wrapping(uint row, const terminal_grid *grid)
+{
+	uint physical_row = grid->first_row + row;
+	if (physical_row >= grid->rows) physical_row -= grid->rows;
+	return &grid->wrapped_rows[physical_row];
+}
+
+uint encode_utf8(utf32 rune, char *encoding)
+{
+	if (rune < 0x80)
+	{
+		encoding[0] = rune;
+		return 1;
+	}
+	if (rune < 0x800)
+	{
+		encoding[0] = 0xc0 | (rune >> 6);
+		encoding[1] = 0x80 | (rune & 0x3f);
+		return 2;
+	}
+	if (rune < 0x10000)
+	{
+		encoding[0] = 0xe0 | (rune >> 12);
+		encoding[1] = 0x80 | ((rune >> 6) & 0x3f);
+		encoding[2] = 0x80 | (rune & 0x3f);
+		return 3;
+	}
+	encoding[0] = 0xf0 | (rune >> 18);
+	encoding[1] = 0x80 | ((rune >> 12) & 0x3f);
+	encoding[2] = 0x80 | ((rune >> 6) & 0x3f);
+	encoding[3] = 0x80 | (rune & 0x3f);
+	return 4;
+}
+
+uint get_terminal_cells_text(const terminal_cell *cells, uint count, char *buffer, uint capacity)
+{
+	/* trailing blanks are not text */
+	while (count && cells[count - 1].rune == ' ') count -= 1;
+
+	uint size = 0;
+	for (uint i = 0; i < count; ++i)
+	{
+		char encoding[UTF8_ENCODING_CAPACITY];
+		uint encoding_size = encode_utf8(cells[i].rune, encoding);
+		if (size + encoding_size >= capacity) break;
+		copy(buffer + size, encoding, encoding_size);
+		size += encoding_size;
+	}
+	buffer[size] = 0;
+	return size;
+}
+
+uint get_terminal_grid_row_text(uint row, char *buffer, uint capacity, const terminal_grid *grid)
+{
+	return get_terminal_cells_text(get_terminal_grid_row(row, grid), grid->columns, buffer, capacity);
+}
+
+static void clear_terminal_cells(terminal_cell *cells, uint count, const terminal_grid *grid)
+{
+	terminal_cell blank = { .rune = ' ', .foreground = grid->pen.foreground, .background = grid->pen.background };
+	for (uint i = 0; i < count; ++i) cells[i] = blank;
+}
+
+static void push_terminal_grid_row_to_scrollback(uint row, terminal_grid *grid)
+{
+	if (!grid->scrollback) return;
+
+	const terminal_cell *cells = get_terminal_grid_row(row, grid);
+	bit wrapped = *get_terminal_grid_row_wrapping(row, grid);
+
+	/* the blanks after the text are padding, unless the line continues */
+	uint count = grid->columns;
+	if (!wrapped) while (count && cells[count - 1].rune == ' ' && cells[count - 1].background == TERMINAL_DEFAULT_BACKGROUND) count -= 1;
+	push_scrollback_row(cells, count, wrapped, grid->scrollback);
+}
+
+static void scroll_terminal_grid(terminal_grid *grid)
+{
+	push_terminal_grid_row_to_scrollback(0, grid);
+
+	/* the top row becomes the bottom row */
+	clear_terminal_cells(get_terminal_grid_row(0, grid), grid->columns, grid);
+	*get_terminal_grid_row_wrapping(0, grid) = 0;
+	grid->first_row += 1;
+	if (grid->first_row == grid->rows) grid->first_row = 0;
+}
+
+/* rows are dropped from the top, into the scrollback, until the cursor's row
+   fits. rows are cut or padded to the new width rather than rewrapped,
+   since programs redraw the screen when they are told of the new size. */
+void resize_terminal_grid(uint columns, uint rows, terminal_grid *grid)
+{
+	if (columns == grid->columns && rows == grid->rows) return;
+
+	uint dropped_rows_count = grid->cursor_row + 1 > rows ? grid->cursor_row + 1 - rows : 0;
+	for (uint i = 0; i < dropped_rows_count; ++i) push_terminal_grid_row_to_scrollback(i, grid);
+
+	terminal_cell *cells        = allocate(columns * rows * sizeof(terminal_cell), ALLOCATION_TAG_TERMINAL);
+	bit           *wrapped_rows = allocate(rows * sizeof(bit), ALLOCATION_TAG_TERMINAL);
+	terminal_cell  blank        = { .rune = ' ', .foreground = TERMINAL_DEFAULT_FOREGROUND, .background = TERMINAL_DEFAULT_BACKGROUND };
+	for (uint i = 0; i < rows; ++i)
+	{
+		terminal_cell *row = cells + i * columns;
+		uint           old_row = dropped_rows_count + i;
+		uint           kept_columns_count = 0;
+		if (old_row < grid->rows)
+		{
+			kept_columns_count = columns < grid->columns ? columns : grid->columns;
+			copy(row, get_terminal_grid_row(old_row, grid), kept_columns_count * sizeof(terminal_cell));
+			wrapped_rows[i] = *get_terminal_grid_row_wrapping(old_row, grid) && columns >= grid->columns;
+		}
+		else wrapped_rows[i] = 0;
+		for (uint j = kept_columns_count; j < columns; ++j) row[j] = blank;
+	}
+
+	terminate_terminal_grid(grid);
+	grid->cells         = cells;
+	grid->wrapped_rows  = wrapped_rows;
+	grid->columns       = columns;
+	grid->rows          = rows;
+	grid->first_row     = 0;
+	grid->cursor_row   -= dropped_rows_count;
+	grid->pending_wrap  = 0;
+	if (grid->cursor_column >= columns) grid->cursor_column = columns - 1;
+	if (grid->scrollback) reflow_scrollback(columns, grid->scrollback);
+}
+
+static void feed_terminal_line(terminal_grid *grid)
+{
+	if (grid->cursor_row + 1 == grid->rows) scroll_terminal_grid(grid);
+	else grid->cursor_row += 1;
+}
+
+/* writes `count` cells of `runes` (or of `ascii`, widened) at the cursor,
+   wrapping at the right margin */
+static void write_terminal_grid(const byte *ascii, const utf32 *runes, uint count, terminal_grid *grid)
+{
+	while (count)
+	{
+		if (grid->pending_wrap)
+		{
+			*get_terminal_grid_row_wrapping(grid->cursor_row, grid) = 1;
+			grid->cursor_column = 0;
+			grid->pending_wrap  = 0;
+			feed_terminal_line(grid);
+		}
+
+		uint available_count = grid->columns - grid->cursor_column;
+		uint written_count   = count < available_count ? count : available_count;
+
+		terminal_cell *cells = get_terminal_grid_row(grid->cursor_row, grid) + grid->cursor_column;
+		terminal_cell  cell  = grid->pen;
+		if (ascii)
+		{
+			for (uint i = 0; i < written_count; ++i)
+			{
+				cell.rune = ascii[i];
+				cells[i]  = cell;
+			}
+			ascii += written_count;
+		}
+		else
+		{
+			for (uint i = 0; i < written_count; ++i)
+			{
+				cell.rune = runes[i];
+				cells[i]  = cell;
+			}
+			runes += written_count;
+		}
+		count -= written_count;
+
+		grid->cursor_column += written_count;
+		if (grid->cursor_column == grid->columns)
+		{
+			grid->cursor_column = grid->columns - 1;
+			grid->pending_wrap  = 1;
+		}
+	}
+}
+
+/* returns the length of the leading run of printable ASCII */
+static uint scan_vt_ground(const byte *data, uint size)
+{
+	uint i = 0;
+#if defined(__AVX2__)
+	{
+		const __m256i space    = _mm256_set1_epi8(0x20);
+		const __m256i deletion = _mm256_set1_epi8(0x7f);
+		for (; i + 32 <= size; i += 32)
+		{
+			__m256i bytes = _mm256_loadu_si256((const __m256i *)(data + i));
+
+			/* compared as signed, bytes above 0x7f are below 0x20 too */
+			__m256i special = _mm256_or_si256(_mm256_cmpgt_epi8(space, bytes), _mm256_cmpeq_epi8(bytes, deletion));
+			uint mask = _mm256_movemask_epi8(special);
+			if (mask) return i + __builtin_ctz(mask);
+		}
+	}
+#endif
+#if defined(__SSE2__)
+	{
+		const __m128i space    = _mm_set1_epi8(0x20);
+		const __m128i deletion = _mm_set1_epi8(0x7f);
+		for (; i + 16 <= size; i += 16)
+		{
+			__m128i bytes = _mm_loadu_si128((const __m128i *)(data + i));
+			__m128i special = _mm_or_si128(_mm_cmpgt_epi8(space, bytes), _mm_cmpeq_epi8(bytes, deletion));
+			uint mask = _mm_movemask_epi8(special);
+			if (mask) return i + __builtin_ctz(mask);
+		}
+	}
+#endif
+	for (; i < size; ++i)
+	{
+		if (data[i] < 0x20 || data[i] >= 0x7f) break;
+	}
+	return i;
+}
+
+static void execute_vt_control(byte control, vt_parser *parser)
+{
+	terminal_grid *grid = parser->grid;
+	switch (control)
+	{
+	case '\b':
+		if (grid->cursor_column) grid->cursor_column -= 1;
+		grid->pending_wrap = 0;
+		break;
+	case '\t':
+		grid->cursor_column = (grid->cursor_column + 8) & ~7u;
+		if (grid->cursor_column >= grid->columns) grid->cursor_column = grid->columns - 1;
+		grid->pending_wrap = 0;
+		break;
+	case '\n':
+	case '\v':
+	case '\f':
+		feed_terminal_line(grid);
+		grid->pending_wrap = 0;
+		break;
+	case '\r':
+		grid->cursor_column = 0;
+		grid->pending_wrap  = 0;
+		break;
+	default:
+		/* BEL and the rest do nothing on screen */
+		break;
+	}
+}
+
+/* the parameter at `index`, where 0 and absence mean `fallback` */
+inline static uint get_vt_parameter(uint index, uint fallback, const vt_parser *parser)
+{
+	uint parameter = index < parser->parameters_count ? parser->parameters[index] : 0;
+	return parameter ? parameter : fallback;
+}
+
+/* maps a 24-bit color to the 6x6x6 cube of the 256-color palette */
+inline static uint8 approximate_vt_color(uint red, uint green, uint blue)
+{
+	return 16 + 36 * (red * 5 / 255) + 6 * (green * 5 / 255) + (blue * 5 / 255);
+}
+
+static void select_vt_graphic_rendition(vt_parser *parser)
+{
+	terminal_cell *pen = &parser->grid->pen;
+	if (!parser->parameters_count) parser->parameters[parser->parameters_count++] = 0;
+
+	for (uint i = 0; i < parser->parameters_count; ++i)
+	{
+		uint parameter = parser->parameters[i];
+		switch (parameter)
+		{
+		case 0:
+			pen->foreground = TERMINAL_DEFAULT_FOREGROUND;
+			pen->background = TERMINAL_DEFAULT_BACKGROUND;
+			pen->attributes = 0;
+			break;
+		case 1:  pen->attributes |=  TERMINAL_ATTRIBUTE_BOLD;      break;
+		case 4:  pen->attributes |=  TERMINAL_ATTRIBUTE_UNDERLINE; break;
+		case 7:  pen->attributes |=  TERMINAL_ATTRIBUTE_INVERSE;   break;
+		case 22: pen->attributes &= ~TERMINAL_ATTRIBUTE_BOLD;      break;
+		case 24: pen->attributes &= ~TERMINAL_ATTRIBUTE_UNDERLINE; break;
+		case 27: pen->attributes &= ~TERMINAL_ATTRIBUTE_INVERSE;   break;
+		case 39: pen->foreground = TERMINAL_DEFAULT_FOREGROUND;    break;
+		case 49: pen->background = TERMINAL_DEFAULT_BACKGROUND;    break;
+		case 38:
+		case 48:
+			{
+				uint8 color;
+				if (i + 2 < parser->parameters_count && parser->parameters[i + 1] == 5)
+				{
+					color = parser->parameters[i + 2];
+					i += 2;
+				}
+				else if (i + 4 < parser->parameters_count && parser->parameters[i + 1] == 2)
+				{
+					color = approximate_vt_color(parser->parameters[i + 2] & 0xff, parser->parameters[i + 3] & 0xff, parser->parameters[i + 4] & 0xff);
+					i += 4;
+				}
+				else break;
+				if (parameter == 38) pen->foreground = color;
+				else                 pen->background = color;
+			}
+			break;
+		default:
+			if      (parameter >= 30  && parameter <= 37)  pen->foreground = parameter - 30;
+			else if (parameter >= 40  && parameter <= 47)  pen->background = parameter - 40;
+			else if (parameter >= 90  && parameter <= 97)  pen->foreground = parameter - 90 + 8;
+			else if (parameter >= 100 && parameter <= 107) pen->background = parameter - 100 + 8;
+			break;
+		}
+	}
+}
+
+static void dispatch_vt_escape(byte final, vt_parser *parser)
+{
+	terminal_grid *grid = parser->grid;
+	if (parser->intermediate) return;
+
+	switch (final)
+	{
+	case 'D': /* IND */
+		feed_terminal_line(grid);
+		break;
+	case 'E': /* NEL */
+		grid->cursor_column = 0;
+		feed_terminal_line(grid);
+		break;
+	case 'M': /* RI; without scrolling regions, only moves up */
+		if (grid->cursor_row) grid->cursor_row -= 1;
+		break;
+	case '7': /* DECSC */
+		parser->saved_cursor_column = grid->cursor_column;
+		parser->saved_cursor_row    = grid->cursor_row;
+		parser->saved_pen           = grid->pen;
+		break;
+	case '8': /* DECRC; the grid may have shrunk since the cursor was saved */
+		grid->cursor_column = parser->saved_cursor_column < grid->columns ? parser->saved_cursor_column : grid->columns - 1;
+		grid->cursor_row    = parser->saved_cursor_row < grid->rows ? parser->saved_cursor_row : grid->rows - 1;
+		grid->pen           = parser->saved_pen;
+		break;
+	case 'c': /* RIS */
+		grid->pen = (terminal_cell){ .rune = ' ', .foreground = TERMINAL_DEFAULT_FOREGROUND, .background = TERMINAL_DEFAULT_BACKGROUND };
+		for (uint row = 0; row < grid->rows; ++row) clear_terminal_cells(get_terminal_grid_row(row, grid), grid->columns, grid);
+		grid->cursor_column = 0;
+		grid->cursor_row    = 0;
+		break;
+	}
+	grid->pending_wrap = 0;
+}
+
+static void dispatch_vt_control_sequence(byte final, vt_parser *parser)
+{
+	terminal_grid *grid = parser->grid;
+
+	/* private modes (such as "?25h") and the rest are not emulated */
+	if (parser->private_marker || parser->intermediate) return;
+
+	uint columns = grid->columns;
+	uint rows    = grid->rows;
+	terminal_cell *row = get_terminal_grid_row(grid->cursor_row, grid);
+	switch (final)
+	{
+	case 'A': /* CUU */
+		grid->cursor_row -= clamp(get_vt_parameter(0, 1, parser), 0, grid->cursor_row);
+		break;
+	case 'B': /* CUD */
+		grid->cursor_row += clamp(get_vt_parameter(0, 1, parser), 0, rows - 1 - grid->cursor_row);
+		break;
+	case 'C': /* CUF */
+		grid->cursor_column += clamp(get_vt_parameter(0, 1, parser), 0, columns - 1 - grid->cursor_column);
+		break;
+	case 'D': /* CUB */
+		grid->cursor_column -= clamp(get_vt_parameter(0, 1, parser), 0, grid->cursor_column);
+		break;
+	case 'E': /* CNL */
+		grid->cursor_row += clamp(get_vt_parameter(0, 1, parser), 0, rows - 1 - grid->cursor_row);
+		grid->cursor_column = 0;
+		break;
+	case 'F': /* CPL */
+		grid->cursor_row -= clamp(get_vt_parameter(0, 1, parser), 0, grid->cursor_row);
+		grid->cursor_column = 0;
+		break;
+	case 'G': /* CHA */
+		grid->cursor_column = clamp(get_vt_parameter(0, 1, parser), 1, columns) - 1;
+		break;
+	case 'd': /* VPA */
+		grid->cursor_row = clamp(get_vt_parameter(0, 1, parser), 1, rows) - 1;
+		break;
+	case 'H': /* CUP */
+	case 'f': /* HVP */
+		grid->cursor_row    = clamp(get_vt_parameter(0, 1, parser), 1, rows) - 1;
+		grid->cursor_column = clamp(get_vt_parameter(1, 1, parser), 1, columns) - 1;
+		break;
+	case 'J': /* ED */
+		switch (get_vt_parameter(0, 0, parser))
+		{
+		case 0:
+			clear_terminal_cells(row + grid->cursor_column, columns - grid->cursor_column, grid);
+			for (uint i = grid->cursor_row + 1; i < rows; ++i) clear_terminal_cells(get_terminal_grid_row(i, grid), columns, grid);
+			break;
+		case 1:
+			for (uint i = 0; i < grid->cursor_row; ++i) clear_terminal_cells(get_terminal_grid_row(i, grid), columns, grid);
+			clear_terminal_cells(row, grid->cursor_column + 1, grid);
+			break;
+		case 2:
+		case 3:
+			for (uint i = 0; i < rows; ++i) clear_terminal_cells(get_terminal_grid_row(i, grid), columns, grid);
+			break;
+		}
+		break;
+	case 'K': /* EL */
+		switch (get_vt_parameter(0, 0, parser))
+		{
+		case 0: clear_terminal_cells(row + grid->cursor_column, columns - grid->cursor_column, grid); break;
+		case 1: clear_terminal_cells(row, grid->cursor_column + 1, grid);                             break;
+		case 2: clear_terminal_cells(row, columns, grid);                                             break;
+		}
+		break;
+	case 'X': /* ECH */
+		clear_terminal_cells(row + grid->cursor_column, clamp(get_vt_parameter(0, 1, parser), 0, columns - grid->cursor_column), grid);
+		break;
+	case 'P': /* DCH */
+		{
+			uint count = clamp(get_vt_parameter(0, 1, parser), 0, columns - grid->cursor_column);
+			move(row + grid->cursor_column, row + grid->cursor_column + count, (columns - grid->cursor_column - count) * sizeof(terminal_cell));
+			clear_terminal_cells(row + columns - count, count, grid);
+		}
+		break;
+	case '@': /* ICH */
+		{
+			uint count = clamp(get_vt_parameter(0, 1, parser), 0, columns - grid->cursor_column);
+			move(row + grid->cursor_column + count, row + grid->cursor_column, (columns - grid->cursor_column - count) * sizeof(terminal_cell));
+			clear_terminal_cells(row + grid->cursor_column, count, grid);
+		}
+		break;
+	case 'm': /* SGR */
+		select_vt_graphic_rendition(parser);
+		return;
+	default:
+		return;
+	}
+	grid->pending_wrap = 0;
+}
+
+static void enter_vt_state(vt_state state, vt_parser *parser)
+{
+	parser->state = state;
+	switch (state)
+	{
+	case VT_STATE_ESCAPE:
+		parser->rune_remaining_bytes = 0;
+		/* fallthrough */
+	case VT_STATE_CSI_ENTRY:
+		parser->parameters_count = 0;
+		parser->parameters[0]    = 0;
+		parser->intermediate     = 0;
+		parser->private_marker   = 0;
+		break;
+	case VT_STATE_OSC_STRING:
+	case VT_STATE_STRING:
+		parser->string_escaped = 0;
+		break;
+	default:
+		break;
+	}
+}
+
+static void decode_vt_utf8(byte b, vt_parser *parser)
+{
+	if (parser->rune_remaining_bytes)
+	{
+		if ((b & 0xc0) == 0x80)
+		{
+			parser->rune = parser->rune << 6 | (b & 0x3f);
+			if (--parser->rune_remaining_bytes) return;
+			write_terminal_grid(0, &parser->rune, 1, parser->grid);
+			return;
+		}
+
+		/* a truncated sequence; the byte begins something else */
+		parser->rune_remaining_bytes = 0;
+		utf32 replacement = 0xfffd;
+		write_terminal_grid(0, &replacement, 1, parser->grid);
+		if (b < 0x80)
+		{
+			if (b >= 0x20 && b != 0x7f) write_terminal_grid(&b, 0, 1, parser->grid);
+			else if (b < 0x20)          execute_vt_control(b, parser);
+			return;
+		}
+	}
+
+	if      ((b & 0xe0) == 0xc0) { parser->rune = b & 0x1f; parser->rune_remaining_bytes = 1; }
+	else if ((b & 0xf0) == 0xe0) { parser->rune = b & 0x0f; parser->rune_remaining_bytes = 2; }
+	else if ((b & 0xf8) == 0xf0) { parser->rune = b & 0x07; parser->rune_remaining_bytes = 3; }
+	else
+	{
+		utf32 replacement = 0xfffd;
+		write_terminal_grid(0, &replacement, 1, parser->grid);
+	}
+}
+
+static void parse_vt_byte(byte b, vt_parser *parser)
+{
+	/* these abort any sequence */
+	if (b == 0x18 || b == 0x1a)
+	{
+		enter_vt_state(VT_STATE_GROUND, parser);
+		return;
+	}
+	if (b == 0x1b && parser->state != VT_STATE_OSC_STRING && parser->state != VT_STATE_STRING)
+	{
+		enter_vt_state(VT_STATE_ESCAPE, parser);
+		return;
+	}
+
+	switch (parser->state)
+	{
+	case VT_STATE_GROUND:
+		if (b >= 0x80 || parser->rune_remaining_bytes) decode_vt_utf8(b, parser);
+		else if (b < 0x20)                              execute_vt_control(b, parser);
+		else if (b != 0x7f)                             write_terminal_grid(&b, 0, 1, parser->grid);
+		break;
+
+	case VT_STATE_ESCAPE:
+		if (b < 0x20) execute_vt_control(b, parser);
+		else if (b == '[') enter_vt_state(VT_STATE_CSI_ENTRY, parser);
+		else if (b == ']') enter_vt_state(VT_STATE_OSC_STRING, parser);
+		else if (b == 'P' || b == 'X' || b == '^' || b == '_') enter_vt_state(VT_STATE_STRING, parser);
+		else if (b >= 0x20 && b <= 0x2f)
+		{
+			parser->intermediate = b;
+			parser->state = VT_STATE_ESCAPE_INTERMEDIATE;
+		}
+		else
+		{
+			if (b != 0x7f) dispatch_vt_escape(b, parser);
+			enter_vt_state(VT_STATE_GROUND, parser);
+		}
+		break;
+
+	case VT_STATE_ESCAPE_INTERMEDIATE:
+		if (b < 0x20) execute_vt_control(b, parser);
+		else if (b >= 0x30 && b <= 0x7e)
+		{
+			/* character set designations and the like are not emulated */
+			enter_vt_state(VT_STATE_GROUND, parser);
+		}
+		break;
+
+	case VT_STATE_CSI_ENTRY:
+		if (b >= 0x3c && b <= 0x3f)
+		{
+			parser->private_marker = b;
+			parser->state = VT_STATE_CSI_PARAMETER;
+			break;
+		}
+		/* fallthrough */
+	case VT_STATE_CSI_PARAMETER:
+		if (b < 0x20) execute_vt_control(b, parser);
+		else if (b >= '0' && b <= '9')
+		{
+			if (!parser->parameters_count) parser->parameters_count = 1;
+			uint *parameter = &parser->parameters[parser->parameters_count - 1];
+			if (*parameter < 100000) *parameter = *parameter * 10 + (b - '0');
+			parser->state = VT_STATE_CSI_PARAMETER;
+		}
+		else if (b == ';' || b == ':')
+		{
+			if (!parser->parameters_count) parser->parameters_count = 1;
+			if (parser->parameters_count == VT_PARAMETERS_CAPACITY)
+			{
+				parser->state = VT_STATE_CSI_IGNORE;
+				break;
+			}
+			parser->parameters[parser->parameters_count++] = 0;
+			parser->state = VT_STATE_CSI_PARAMETER;
+		}
+		else if (b >= 0x20 && b <= 0x2f)
+		{
+			parser->intermediate = b;
+			parser->state = VT_STATE_CSI_INTERMEDIATE;
+		}
+		else if (b >= 0x40 && b <= 0x7e)
+		{
+			dispatch_vt_control_sequence(b, parser);
+			enter_vt_state(VT_STATE_GROUND, parser);
+		}
+		else if (b != 0x7f) parser->state = VT_STATE_CSI_IGNORE;
+		break;
+
+	case VT_STATE_CSI_INTERMEDIATE:
+		if (b < 0x20) execute_vt_control(b, parser);
+		else if (b >= 0x40 && b <= 0x7e)
+		{
+			dispatch_vt_control_sequence(b, parser);
+			enter_vt_state(VT_STATE_GROUND, parser);
+		}
+		else if (b >= 0x30 && b <= 0x3f) parser->state = VT_STATE_CSI_IGNORE;
+		break;
+
+	case VT_STATE_CSI_IGNORE:
+		if (b < 0x20) execute_vt_control(b, parser);
+		else if (b >= 0x40 && b <= 0x7e) enter_vt_state(VT_STATE_GROUND, parser);
+		break;
+
+	case VT_STATE_OSC_STRING:
+	case VT_STATE_STRING:
+		/* window titles and the like are not used; strings end with BEL or ST */
+		if (b == 0x07 && parser->state == VT_STATE_OSC_STRING) enter_vt_state(VT_STATE_GROUND, parser);
+		else if (parser->string_escaped && b == '\\')          enter_vt_state(VT_STATE_GROUND, parser);
+		else parser->string_escaped = b == 0x1b;
+		break;
+	}
+}
+
+void parse_vt(const byte *data, uint size, vt_parser *parser)
+{
+	uint i = 0;
+	while (i < size)
+	{
+		if (parser->state == VT_STATE_GROUND && !parser->rune_remaining_bytes)
+		{
+			uint run_size = scan_vt_ground(data + i, size - i);
+			if (run_size)
+			{
+				write_terminal_grid(data + i, 0, run_size, parser->grid);
+				i += run_size;
+				if (i == size) break;
+			}
+		}
+		parse_vt_byte(data[i++], parser);
+	}
+}
+
+#define VT_BENCHMARK_COLUMNS          120
+#define VT_BENCHMARK_ROWS             40
+#define VT_BENCHMARK_CHUNK_SIZE       (64 << 10)
+#define VT_BENCHMARK_MINIMUM          (256 << 20)  /* bytes parsed by each parser at least */
+#define VT_BENCHMARK_COMMAND_CAPACITY 4096         /* that a terminal takes in a line */
+
+/* the parser without the ground state's scan, to compare with */
+static void parse_vt_bytewise(const byte *data, uint size, vt_parser *parser)
+{
+	for (uint i = 0; i < size; ++i) parse_vt_byte(data[i], parser);
+}
+
+/* parses a file, such as a build log, in the chunks that the terminal would
+   read, with and without the ground state's scan, and checks that both make
+   the same grid */
+void benchmark_vt(const char *path)
+{
+	handle      file = open_file(path);
+	uintl       size = get_size_of_file(file);
+	const byte *data = map_file(size, file);
+	uint rounds_count = size ? (uint)((VT_BENCHMARK_MINIMUM + size - 1) / size) : 1;
+
+	void (*parsers[])(const byte *data, uint size, vt_parser *parser) = { parse_vt, parse_vt_bytewise };
+	float64       times[countof(parsers)];
+	terminal_grid grids[countof(parsers)];
+	for (uint i = 0; i < countof(parsers); ++i)
+	{
+		initialize_terminal_grid(VT_BENCHMARK_COLUMNS, VT_BENCHMARK_ROWS, &grids[i]);
+		vt_parser parser = { .grid = &grids[i] };
+
+		uintl beginning_time = get_time();
+		for (uint round = 0; round < rounds_count; ++round)
+		{
+			for (uintl offset = 0; offset < size; offset += VT_BENCHMARK_CHUNK_SIZE)
+			{
+				uint chunk_size = size - offset < VT_BENCHMARK_CHUNK_SIZE ? size - offset : VT_BENCHMARK_CHUNK_SIZE;
+				parsers[i](data + offset, chunk_size, &parser);
+			}
+		}
+		times[i] = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+	}
+
+	terminal_grid *scanned = &grids[0];
+	terminal_grid *stepped = &grids[1];
+	assert(scanned->cursor_column == stepped->cursor_column && scanned->cursor_row == stepped->cursor_row);
+	for (uint row = 0; row < VT_BENCHMARK_ROWS; ++row)
+	{
+		assert(!compare(get_terminal_grid_row(row, scanned), get_terminal_grid_row(row, stepped), VT_BENCHMARK_COLUMNS * sizeof(terminal_cell)));
+	}
+
+	float64 megabytes = (float64)size * rounds_count / (1 << 20);
+	report_comment(
+		"parsed %.1f MB: %.1f MB/s scanning the ground state, %.1f MB/s byte by byte (%.2fx)\n",
+		megabytes, megabytes / times[0], megabytes / times[1], times[1] / times[0]);
+
+	for (uint i = 0; i < countof(parsers); ++i) terminate_terminal_grid(&grids[i]);
+	unmap_file(data, size);
+	close_file(file);
+}
+
+/* has a shell `cat` a file on a pseudoterminal, and parses what it writes
+   as the terminal would, with a scrollback */
+void benchmark_pseudoterminal(const char *path)
+{
+	/* as quoted, in the worst case */
+	if (strlen(path) * 4 + 16 > VT_BENCHMARK_COMMAND_CAPACITY)
+	{
+		report_failure("the path is too long\n");
+		return;
+	}
+
+	terminal_grid grid;
+	scrollback    scrollback;
+	initialize_terminal_grid(VT_BENCHMARK_COLUMNS, VT_BENCHMARK_ROWS, &grid);
+	initialize_scrollback(SCROLLBACK_DEFAULT_MEMORY_CAPACITY, &scrollback);
+	grid.scrollback = &scrollback;
+	reflow_scrollback(VT_BENCHMARK_COLUMNS, &scrollback);
+	vt_parser parser = { .grid = &grid };
+
+	pseudoterminal pseudoterminal;
+	open_pseudoterminal("/bin/sh", VT_BENCHMARK_COLUMNS, VT_BENCHMARK_ROWS, &pseudoterminal);
+
+	/* `exec`, so that the session ends with `cat`. the path is quoted for the
+	   shell: a quote in it closes the quoting, is escaped, and opens it again. */
+	static const char beginning[] = "exec cat '";
+	static const char ending[]    = "'\n";
+	char command[VT_BENCHMARK_COMMAND_CAPACITY];
+	uint command_size = sizeof(beginning) - 1;
+	copy(command, beginning, command_size);
+	for (const char *character = path; *character; ++character)
+	{
+		if (*character == '\'')
+		{
+			copy(command + command_size, "'\\''", 4);
+			command_size += 4;
+		}
+		else command[command_size++] = *character;
+	}
+	copy(command + command_size, ending, sizeof(ending) - 1);
+	command_size += sizeof(ending) - 1;
+	write_to_pseudoterminal(command, command_size, &pseudoterminal);
+
+	ring *ring           = &pseudoterminal.output_ring;
+	uintl beginning_time = get_time();
+	uintl parsing_time   = 0;
+	uintl parsed_size    = 0;
+	for (;;)
+	{
+		/* the reader exits after its last write, so that write is seen below */
+		bit exited = atomic_load(&pseudoterminal.exited);
+
+		uint        size;
+		const byte *region = begin_ring_read(&size, ring);
+		if (size)
+		{
+			uintl parsing_beginning_time = get_time();
+			parse_vt(region, size, &parser);
+			end_ring_read(size, ring);
+			update_scrollback(&scrollback);
+			parsing_time += get_time() - parsing_beginning_time;
+			parsed_size  += size;
+		}
+		else if (exited) break;
+		else             wait_for_events(WAIT_FOREVER);
+	}
+	float64 elapsed_time = (float64)(get_time() - beginning_time) / TIME_SECONDS_FACTOR;
+
+	close_pseudoterminal(&pseudoterminal);
+	terminate_terminal_grid(&grid);
+	terminate_scrollback(&scrollback);
+
+	float64 megabytes = (float64)parsed_size / (1 << 20);
+	report_comment(
+		"read and parsed %.1f MB of output in %.3f s (%.1f MB/s); parsing took %.3f s of it\n",
+		megabytes, elapsed_time, megabytes / elapsed_time, (float64)parsing_time / TIME_SECONDS_FACTOR);
+}
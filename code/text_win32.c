@@ -1,8 +1,10 @@
 #define WM_USER_ALREADYEXISTS (WM_USER + 1)
 
 static LRESULT CALLBACK win32_process_window_message(HWND window, UINT message, WPARAM wparam, LPARAM lparam);
+static int win32_pump_window_messages(void *parameter);
 
 static void win32_initialize_vulkan(void);
+static void win32_watch_handle(handle handle);
 
 struct win32
 {
@@ -11,8 +13,17 @@ struct win32
 
 	uintl performance_frequency;
 
-	HWND window;
-	MSG  window_message;
+	HWND        window;
+	thrd_t      window_thread;
+	atomic_bool window_created;
+
+	HANDLE waker;  /* signaled by other threads to wake the main thread */
+	HANDLE watched[MAXIMUM_WAIT_OBJECTS];  /* the waker, then what else wakes it */
+	uint   watched_count;
+
+	uintl plugin_write_time;  /* of the library that is loaded */
+
+	WCHAR high_surrogate;  /* of a rune that is typed in two messages */
 } win32;
 
 inline uintl get_time(void)
@@ -22,7 +33,7 @@ inline uintl get_time(void)
 	return counter.QuadPart / win32.performance_frequency * 1e9;
 }
 
-inline void *allocate(uint size)
+inline void *allocate_pages(uint size)
 {
 	void *memory = VirtualAlloc(0, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
 	if (!memory)
@@ -37,12 +48,19 @@ failed:
 	abort();
 }
 
-inline void deallocate(void *memory, uint size)
+inline void deallocate_pages(void *memory, uint size)
 {
 	(void)size;
 	VirtualFree(memory, 0, MEM_RELEASE);
 }
 
+uint get_processors_count(void)
+{
+	SYSTEM_INFO system_info;
+	GetSystemInfo(&system_info);
+	return system_info.dwNumberOfProcessors;
+}
+
 inline handle open_file(const char *path)
 {
 	handle handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
@@ -93,9 +111,317 @@ inline void close_file(handle handle)
 	CloseHandle(handle);
 }
 
-inline void get_window_frame_rect(rect *rect)
+inline const byte *map_file(uintl size, handle handle)
+{
+	if (!size) return 0;
+
+	/* the view keeps the mapping for as long as it is mapped */
+	HANDLE mapping = CreateFileMappingA(handle, 0, PAGE_READONLY, 0, 0, 0);
+	if (!mapping)
+	{
+		goto failed;
+	}
+	const byte *memory = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+	CloseHandle(mapping);
+	if (!memory)
+	{
+		goto failed;
+	}
+
+	return memory;
+
+failed:
+	fprintf(stderr, "%s: Win32's last error: %li\n", __FUNCTION__, GetLastError());
+	abort();
+}
+
+inline void unmap_file(const byte *memory, uintl size)
+{
+	(void)size;
+	if (memory) UnmapViewOfFile(memory);
+}
+
+/* closes the pseudoconsole once, which ends its output: the console host keeps
+   the pipe open after the program exits, until then. it is taken under the
+   lock, so that resizing never uses a closed one, and closed outside of it,
+   as closing may wait for the reader to drain the output. */
+static void win32_close_pseudoconsole(pseudoterminal *pseudoterminal)
+{
+	mtx_lock(&pseudoterminal->closer_lock);
+	HPCON console = pseudoterminal->closer;
+	pseudoterminal->closer = 0;
+	mtx_unlock(&pseudoterminal->closer_lock);
+	if (console) ClosePseudoConsole(console);
+}
+
+static void CALLBACK win32_notice_pseudoterminal_exit(void *parameter, BOOLEAN timed_out)
+{
+	(void)timed_out;
+	win32_close_pseudoconsole(parameter);
+}
+
+static int win32_read_pseudoterminal_output(void *parameter)
+{
+	pseudoterminal *pseudoterminal = parameter;
+	byte            discarded[4096];
+	for (;;)
+	{
+		uint  size;
+		byte *region = begin_ring_write(&size, &pseudoterminal->output_ring);
+
+		/* once closing, the output is only drained, for the console host to let go of the pipe */
+		if (atomic_load_explicit(&pseudoterminal->closing, memory_order_relaxed))
+		{
+			region = discarded;
+			size   = sizeof(discarded);
+		}
+		else if (!size)
+		{
+			/* the editor is behind; the program blocks on its writes meanwhile */
+			thrd_sleep(&(struct timespec){ .tv_nsec = 100000 }, 0);
+			continue;
+		}
+
+		/* the pipe breaks once the pseudoconsole is closed */
+		DWORD read_size;
+		if (!ReadFile(pseudoterminal->output, region, size, &read_size, 0) || !read_size) break;
+		if (region == discarded) continue;
+
+		end_ring_write(read_size, &pseudoterminal->output_ring);
+		atomic_fetch_add_explicit(&pseudoterminal->bytes_read_count, read_size, memory_order_relaxed);
+		wake_main_thread();
+	}
+	atomic_store(&pseudoterminal->exited, 1);
+	wake_main_thread();
+	return 0;
+}
+
+void open_pseudoterminal(const char *program, uint columns, uint rows, pseudoterminal *pseudoterminal)
+{
+	zero(pseudoterminal, sizeof(*pseudoterminal));
+	initialize_ring(PSEUDOTERMINAL_OUTPUT_CAPACITY, ALLOCATION_TAG_TERMINAL, &pseudoterminal->output_ring);
+	assert(mtx_init(&pseudoterminal->closer_lock, mtx_plain) == thrd_success);
+
+	/* the console host takes its own copies of its ends of the pipes */
+	HANDLE input_read   = 0;
+	HANDLE output_write = 0;
+	if (!CreatePipe(&input_read, &pseudoterminal->input, 0, 0) || !CreatePipe(&pseudoterminal->output, &output_write, 0, 0))
+	{
+		report_caution("could not create the pipes of a pseudoconsole: Win32's last error: %li\n", GetLastError());
+		if (input_read) CloseHandle(input_read);
+		goto failed;
+	}
+	HPCON   console;
+	HRESULT result = CreatePseudoConsole((COORD){ (SHORT)columns, (SHORT)rows }, input_read, output_write, 0, &console);
+	CloseHandle(input_read);
+	CloseHandle(output_write);
+	if (FAILED(result))
+	{
+		report_caution("could not create a pseudoconsole: %li\n", result);
+		goto failed;
+	}
+	pseudoterminal->closer = console;
+
+	STARTUPINFOEXA startup_information = { .StartupInfo.cb = sizeof(startup_information) };
+	SIZE_T         attributes_size     = 0;
+	InitializeProcThreadAttributeList(0, 1, 0, &attributes_size);
+	startup_information.lpAttributeList = allocate(attributes_size, ALLOCATION_TAG_TERMINAL);
+	bit attached =
+		InitializeProcThreadAttributeList(startup_information.lpAttributeList, 1, 0, &attributes_size) &&
+		UpdateProcThreadAttribute(startup_information.lpAttributeList, 0, PROC_THREAD_ATTRIBUTE_PSEUDOCONSOLE, console, sizeof(console), 0, 0);
+
+	/* the command line is written to by `CreateProcess` */
+	char command_line[MAX_PATH];
+	snprintf(command_line, sizeof(command_line), "%s", program);
+	PROCESS_INFORMATION process_information;
+	bit created = attached && CreateProcessA(0, command_line, 0, 0, FALSE, EXTENDED_STARTUPINFO_PRESENT, 0, 0, &startup_information.StartupInfo, &process_information);
+	if (!created) report_caution("could not run %s: Win32's last error: %li\n", program, GetLastError());
+	if (attached) DeleteProcThreadAttributeList(startup_information.lpAttributeList);
+	deallocate(startup_information.lpAttributeList, attributes_size, ALLOCATION_TAG_TERMINAL);
+	if (!created) goto failed;
+
+	CloseHandle(process_information.hThread);
+	pseudoterminal->process      = process_information.hProcess;
+	pseudoterminal->opening_time = get_time();
+	assert(thrd_create(&pseudoterminal->reader, win32_read_pseudoterminal_output, pseudoterminal) == thrd_success);
+	assert(RegisterWaitForSingleObject(&pseudoterminal->exit_wait, pseudoterminal->process, win32_notice_pseudoterminal_exit, pseudoterminal, INFINITE, WT_EXECUTEONLYONCE));
+	return;
+
+failed:
+	/* a pseudoterminal that could not be opened has exited, and is closed as one */
+	if (pseudoterminal->closer) ClosePseudoConsole(pseudoterminal->closer);
+	if (pseudoterminal->input)  CloseHandle(pseudoterminal->input);
+	if (pseudoterminal->output) CloseHandle(pseudoterminal->output);
+	pseudoterminal->closer = pseudoterminal->input = pseudoterminal->output = 0;
+	atomic_store(&pseudoterminal->exited, 1);
+}
+
+void close_pseudoterminal(pseudoterminal *pseudoterminal)
+{
+	if (pseudoterminal->process)
+	{
+		/* closing the pseudoconsole ends the programs attached to it, and its
+		   output, which the reader drains meanwhile */
+		atomic_store(&pseudoterminal->closing, 1);
+		UnregisterWaitEx(pseudoterminal->exit_wait, INVALID_HANDLE_VALUE);
+		win32_close_pseudoconsole(pseudoterminal);
+		if (WaitForSingleObject(pseudoterminal->process, (DWORD)(PSEUDOTERMINAL_HANGUP_TIMEOUT / 1000000)) != WAIT_OBJECT_0)
+		{
+			report_caution("%lu did not exit with its pseudoconsole, so it is killed\n", GetProcessId(pseudoterminal->process));
+			TerminateProcess(pseudoterminal->process, 1);
+			WaitForSingleObject(pseudoterminal->process, INFINITE);
+		}
+		thrd_join(pseudoterminal->reader, 0);
+		CloseHandle(pseudoterminal->process);
+		CloseHandle(pseudoterminal->input);
+		CloseHandle(pseudoterminal->output);
+
+		float64 elapsed_time = (float64)(get_time() - pseudoterminal->opening_time) / TIME_SECONDS_FACTOR;
+		float64 megabytes    = (float64)atomic_load(&pseudoterminal->bytes_read_count) / (1 << 20);
+		report_verbose("pseudoterminal read %.1f MB in %.1f s (%.1f MB/s)\n", megabytes, elapsed_time, megabytes / elapsed_time);
+	}
+	mtx_destroy(&pseudoterminal->closer_lock);
+	terminate_ring(&pseudoterminal->output_ring);
+}
+
+uint write_to_pseudoterminal(const void *data, uint size, pseudoterminal *pseudoterminal)
+{
+	uint written_size = 0;
+	while (pseudoterminal->input && written_size < size)
+	{
+		DWORD result;
+		if (!WriteFile(pseudoterminal->input, (const byte *)data + written_size, size - written_size, &result, 0) || !result) break;
+		written_size += result;
+	}
+	return written_size;
+}
+
+void resize_pseudoterminal(uint columns, uint rows, pseudoterminal *pseudoterminal)
+{
+	mtx_lock(&pseudoterminal->closer_lock);
+	if (pseudoterminal->closer) ResizePseudoConsole(pseudoterminal->closer, (COORD){ (SHORT)columns, (SHORT)rows });
+	mtx_unlock(&pseudoterminal->closer_lock);
+}
+
+/* loads a copy of the plugin's library, so that the linker can rewrite the
+   library while the copy runs */
+static bit win32_open_plugin_library(plugin *plugin)
+{
+	char copy_path[MAX_PATH];
+	snprintf(copy_path, sizeof(copy_path), "%s.%u", plugin->path, plugin->version + 1);
+
+	/* the linker may still be writing it; the next change tries again */
+	if (!CopyFileA(plugin->path, copy_path, FALSE)) return 0;
+
+	HMODULE library = LoadLibraryA(copy_path);
+	if (!library)
+	{
+		report_caution("could not load %s: Win32's last error: %li\n", plugin->path, GetLastError());
+		DeleteFileA(copy_path);
+		return 0;
+	}
+	plugin_initialize_function *initialize = (plugin_initialize_function *)GetProcAddress(library, "initialize");
+	plugin_tick_function       *tick       = (plugin_tick_function *)GetProcAddress(library, "tick");
+	plugin_terminate_function  *terminate  = (plugin_terminate_function *)GetProcAddress(library, "terminate");
+	if (!initialize || !tick || !terminate)
+	{
+		report_caution("%s does not export initialize, tick and terminate\n", plugin->path);
+		FreeLibrary(library);
+		DeleteFileA(copy_path);
+		return 0;
+	}
+
+	/* the new copy is good, so let go of the old one */
+	if (plugin->library)
+	{
+		flush_reports();
+		FreeLibrary(plugin->library);
+		snprintf(copy_path, sizeof(copy_path), "%s.%u", plugin->path, plugin->version);
+		DeleteFileA(copy_path);
+	}
+	plugin->library    = library;
+	plugin->initialize = initialize;
+	plugin->tick       = tick;
+	plugin->terminate  = terminate;
+	plugin->version   += 1;
+	return 1;
+}
+
+/* the time of the library's last write, or 0 if it is not there */
+static uintl win32_get_plugin_write_time(plugin *plugin)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExA(plugin->path, GetFileExInfoStandard, &attributes)) return 0;
+	return (uintl)attributes.ftLastWriteTime.dwHighDateTime << 32 | attributes.ftLastWriteTime.dwLowDateTime;
+}
+
+void load_plugin(const char *path, plugin *plugin)
+{
+	zero(plugin, sizeof(*plugin));
+	plugin->path   = path;
+	plugin->memory = allocate(PLUGIN_MEMORY_CAPACITY, ALLOCATION_TAG_PLUGIN);
+
+	/* watch the directory rather than the file, which the linker may replace */
+	char directory[MAX_PATH];
+	snprintf(directory, sizeof(directory), "%s", path);
+	char *separator = strrchr(directory, '\\');
+	char *slash     = strrchr(directory, '/');
+	if (slash > separator) separator = slash;
+	if (separator) *separator = 0;
+	else directory[0] = '.', directory[1] = 0;
+	plugin->watcher = FindFirstChangeNotificationA(directory, FALSE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE);
+	assert(plugin->watcher != INVALID_HANDLE_VALUE);
+	win32_watch_handle(plugin->watcher);
+
+	/* without its library the host runs on, and loads it once it is built */
+	win32.plugin_write_time = win32_get_plugin_write_time(plugin);
+	if (!win32_open_plugin_library(plugin))
+	{
+		report_caution("could not load %s; it is loaded once it is built\n", path);
+		return;
+	}
+	plugin->initialize(&global.interface, plugin->memory, 0);
+}
+
+void unload_plugin(plugin *plugin)
+{
+	if (plugin->library)
+	{
+		plugin->terminate();
+		flush_reports();
+		FreeLibrary(plugin->library);
+		char copy_path[MAX_PATH];
+		snprintf(copy_path, sizeof(copy_path), "%s.%u", plugin->path, plugin->version);
+		DeleteFileA(copy_path);
+	}
+	FindCloseChangeNotification(plugin->watcher);
+	deallocate(plugin->memory, PLUGIN_MEMORY_CAPACITY, ALLOCATION_TAG_PLUGIN);
+}
+
+/* swaps in the plugin's library if it was rewritten since the last frame; its
+   memory stays as it is */
+void update_plugin(plugin *plugin)
+{
+	if (WaitForSingleObject(plugin->watcher, 0) != WAIT_OBJECT_0) return;
+	FindNextChangeNotification(plugin->watcher);
+
+	/* the directory changed, but maybe not the library */
+	uintl write_time = win32_get_plugin_write_time(plugin);
+	if (!write_time || write_time == win32.plugin_write_time) return;
+
+	bit reloaded = plugin->library != 0;
+	if (win32_open_plugin_library(plugin))
+	{
+		win32.plugin_write_time = write_time;
+		report_comment("%s %s\n", reloaded ? "reloaded" : "loaded", plugin->path);
+		plugin->initialize(&global.interface, plugin->memory, reloaded);
+	}
+}
+
+inline bit get_window_frame_rect(rect *rect)
 {
 	GetClientRect(win32.window, (RECT *)rect);
+	return 1;
 }
 
 static void initialize(void)
@@ -109,6 +435,23 @@ static void initialize(void)
 	win32.instance = GetModuleHandle(0);
 	GetStartupInfoW(&win32.startup_info);
 
+	win32.waker = CreateEventW(0, FALSE, FALSE, 0);
+	assert(win32.waker);
+	win32_watch_handle(win32.waker);
+
+	/* the window's messages are pumped on a thread of their own, so that a
+	   slow frame does not hold input back */
+	assert(thrd_create(&win32.window_thread, win32_pump_window_messages, 0) == thrd_success);
+	thrd_detach(win32.window_thread);
+	while (!atomic_load(&win32.window_created)) thrd_yield();
+
+	win32_initialize_vulkan();
+}
+
+/* creates the window, then hands everything that it receives to the main
+   thread through `global.input_queue`, stamped with the time */
+static int win32_pump_window_messages(void *parameter)
+{
 	/* create the window */
 	{
 		WNDCLASSEXW window_class =
@@ -149,19 +492,95 @@ static void initialize(void)
 		assert(win32.window);
 		ShowWindow(win32.window, SW_NORMAL);
 	}
+	atomic_store(&win32.window_created, 1);
 
-	win32_initialize_vulkan();
+	MSG window_message;
+	while (GetMessageW(&window_message, 0, 0, 0) > 0)
+	{
+		TranslateMessage(&window_message);
+		DispatchMessageW(&window_message);
+	}
+	return 0;
+}
+
+/* the main thread drains the queue every frame, so it is never full for long */
+static void win32_push_input_event(input_event event)
+{
+	event.time = get_time();
+	while (!push_input_event(&event, &global.input_queue)) thrd_yield();
+	wake_main_thread();
+}
+
+/* makes a signaled `handle` wake the main thread */
+static void win32_watch_handle(handle handle)
+{
+	assert(win32.watched_count < countof(win32.watched));
+	win32.watched[win32.watched_count++] = handle;
 }
 
-static void get_window_messages(void)
+void wait_for_events(uintl timeout)
 {
-	while (PeekMessage(&win32.window_message, 0, 0, 0, PM_REMOVE))
+	/* round up, so that the timeout is not spent spinning on zero waits */
+	DWORD milliseconds = timeout == WAIT_FOREVER ? INFINITE : (DWORD)((timeout + 999999) / 1000000);
+	WaitForMultipleObjects(win32.watched_count, win32.watched, FALSE, milliseconds);
+}
+
+/* can be called from any thread; the event resets as the main thread wakes */
+void wake_main_thread(void)
+{
+	SetEvent(win32.waker);
+}
+
+static key_code win32_translate_key_code(WPARAM virtual_key)
+{
+	if (virtual_key >= 'A' && virtual_key <= 'Z') return KEY_CODE_A + (virtual_key - 'A');
+	if (virtual_key >= '0' && virtual_key <= '9') return KEY_CODE_0 + (virtual_key - '0');
+	if (virtual_key >= VK_F1 && virtual_key <= VK_F12) return KEY_CODE_F1 + (virtual_key - VK_F1);
+	switch (virtual_key)
 	{
-		TranslateMessage(&win32.window_message);
-		DispatchMessage(&win32.window_message);
+	case VK_ESCAPE:     return KEY_CODE_ESCAPE;
+	case VK_RETURN:     return KEY_CODE_ENTER;
+	case VK_TAB:        return KEY_CODE_TAB;
+	case VK_BACK:       return KEY_CODE_BACKSPACE;
+	case VK_SPACE:      return KEY_CODE_SPACE;
+	case VK_INSERT:     return KEY_CODE_INSERT;
+	case VK_DELETE:     return KEY_CODE_DELETE;
+	case VK_LEFT:       return KEY_CODE_LEFT;
+	case VK_RIGHT:      return KEY_CODE_RIGHT;
+	case VK_UP:         return KEY_CODE_UP;
+	case VK_DOWN:       return KEY_CODE_DOWN;
+	case VK_HOME:       return KEY_CODE_HOME;
+	case VK_END:        return KEY_CODE_END;
+	case VK_PRIOR:      return KEY_CODE_PAGE_UP;
+	case VK_NEXT:       return KEY_CODE_PAGE_DOWN;
+	case VK_OEM_3:      return KEY_CODE_BACK_TICK;
+	case VK_OEM_MINUS:  return KEY_CODE_MINUS;
+	case VK_OEM_PLUS:   return KEY_CODE_EQUALS;
+	case VK_OEM_4:      return KEY_CODE_LEFT_BRACKET;
+	case VK_OEM_6:      return KEY_CODE_RIGHT_BRACKET;
+	case VK_OEM_5:      return KEY_CODE_BACKSLASH;
+	case VK_OEM_1:      return KEY_CODE_SEMICOLON;
+	case VK_OEM_7:      return KEY_CODE_APOSTROPHE;
+	case VK_OEM_COMMA:  return KEY_CODE_COMMA;
+	case VK_OEM_PERIOD: return KEY_CODE_PERIOD;
+	case VK_OEM_2:      return KEY_CODE_SLASH;
+	default:            return KEY_CODE_NONE;
 	}
 }
 
+static void win32_dispatch_key(WPARAM virtual_key, bit pressed)
+{
+	key key = { .code = win32_translate_key_code(virtual_key) };
+	if (key.code == KEY_CODE_NONE) return;
+
+	if (pressed)                         key.modifiers |= KEY_MODIFIER_PRESSED;
+	if (GetKeyState(VK_CONTROL) & 0x8000) key.modifiers |= KEY_MODIFIER_CTRL;
+	if (GetKeyState(VK_SHIFT) & 0x8000)   key.modifiers |= KEY_MODIFIER_SHIFT;
+	if (GetKeyState(VK_MENU) & 0x8000)    key.modifiers |= KEY_MODIFIER_ALT;
+	if ((GetKeyState(VK_LWIN) | GetKeyState(VK_RWIN)) & 0x8000) key.modifiers |= KEY_MODIFIER_SUPER;
+	win32_push_input_event((input_event){ .tag = INPUT_EVENT_TAG_KEY, .key = key });
+}
+
 LRESULT CALLBACK win32_process_window_message(HWND window, UINT message, WPARAM wparam, LPARAM lparam)
 {
 	LRESULT result = 0;
@@ -175,7 +594,7 @@ LRESULT CALLBACK win32_process_window_message(HWND window, UINT message, WPARAM
 		break;
 
 	case WM_DESTROY:
-		global.terminability = 1;
+		win32_push_input_event((input_event){ .tag = INPUT_EVENT_TAG_CLOSE });
 		PostQuitMessage(0);
 		break;
 
@@ -187,13 +606,41 @@ LRESULT CALLBACK win32_process_window_message(HWND window, UINT message, WPARAM
 			EndPaint(window, &paint_struct);
 		}
 
+		/* the main thread draws, and follows the window's size as it does */
+		wake_main_thread();
+		break;
+
+	case WM_CHAR:
+		{
+			WCHAR unit = (WCHAR)wparam;
+			if (unit >= 0xd800 && unit < 0xdc00) win32.high_surrogate = unit;
+			else
+			{
+				utf32 rune = unit;
+				if (unit >= 0xdc00 && unit < 0xe000) rune = win32.high_surrogate ? 0x10000 + ((win32.high_surrogate - 0xd800) << 10) + (unit - 0xdc00) : 0xfffd;
+				win32.high_surrogate = 0;
+				win32_push_input_event((input_event){ .tag = INPUT_EVENT_TAG_TEXT, .rune = rune });
+			}
+		}
+		break;
+
+	case WM_KEYUP:
+	case WM_SYSKEYUP:
+		win32_dispatch_key(wparam, 0);
+		result = DefWindowProc(window, message, wparam, lparam);
+		break;
+
+	case WM_SYSKEYDOWN:
+		win32_dispatch_key(wparam, 1);
+		result = DefWindowProc(window, message, wparam, lparam);
 		break;
 
 	case WM_KEYDOWN:
+		win32_dispatch_key(wparam, 1);
 		switch (wparam)
 		{
 		case VK_ESCAPE:
-			global.terminability = 1;
+			win32_push_input_event((input_event){ .tag = INPUT_EVENT_TAG_CLOSE });
 			PostQuitMessage(0);
 			break;
 		}
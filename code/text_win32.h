@@ -8,4 +8,6 @@
 
 typedef HANDLE handle;
 
+#define PLUGIN_DEFAULT_PATH "build\\text_terminal.dll"
+
 #define VK_USE_PLATFORM_WIN32_KHR 1
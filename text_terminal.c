@@ -1,29 +1,88 @@
 #include "text_interface.h"
 
-#define EXPORT __declspec(dllexport)
-
 typedef enum
 {
 	CUSTOM_MESSAGE_TAG_OPEN_TERMINAL,
+	CUSTOM_MESSAGE_TAG_SCROLL_TERMINAL_UP,
+	CUSTOM_MESSAGE_TAG_SCROLL_TERMINAL_DOWN,
+	CUSTOM_MESSAGE_TAG_TOGGLE_MEMORY_OVERLAY,
 	CUSTOM_MESSAGE_TAGS_COUNT,
 } custom_message_tag;
 
 const char *custom_messsage_tag_representations[] =
 {
 	/* string representations of custom messages */
+	"open_terminal",
+	"scroll_terminal_up",
+	"scroll_terminal_down",
+	"toggle_memory_overlay",
 };
 
-EXPORT void initialize(context *context);
-EXPORT void tick(float32 elapse);
-EXPORT void terminate(void);
+/* how long the output is parsed for in a frame, normally and while flooded */
+#define TERMINAL_PARSING_BUDGET       (TIME_SECONDS_FACTOR / 500)
+#define TERMINAL_FLOOD_PARSING_BUDGET (TIME_SECONDS_FACTOR / 125)
+#define TERMINAL_PARSING_CHUNK_SIZE   (64 << 10)
+
+/* how often the grid is rendered into lines at most: once per refresh of the
+   display, and a few times a second while flooded */
+#define TERMINAL_REFRESH_INTERVAL       (1.f / 60)
+#define TERMINAL_FLOOD_REFRESH_INTERVAL (1.f / 8)
+
+#define TERMINAL_LINE_CAPACITY 1024
 
-interface *interface;
+#define TERMINAL_INPUT_ENCODING_CAPACITY 8  /* of what a typed event is sent as, at most */
 
-void initialize(interface *input_interface)
+/* all that the terminal keeps lives in the memory that the host gives it */
+typedef struct
 {
-	interface = input_interface;
+	bit            openable;
+	bit            opened;
+	char           program_name[256];
+	pseudoterminal pseudoterminal;
+	terminal_grid  grid;
+	scrollback     scrollback;
+	uintl          scroll;  /* the rows scrolled back */
+	vt_parser      parser;
+	uint           height;  /* of the panel, with its bar */
+	uint           bar_height;
+	font          *font;
+
+	/* the output is parsed as it comes but rendered at the display's pace: a
+	   program that writes faster than it can be parsed floods the terminal,
+	   which then parses for longer and renders less often */
+	char   *lines;
+	uint    lines_count;
+	bit     dirty;
+	bit     flooded;
+	float32 refresh_elapse;
+	uintl   parsed_bytes_count;
+	uintl   rendered_frames_count;
+	uintl   skipped_frames_count;
+
+	/* shows what every subsystem of the host holds */
+	bit memory_overlay;
+} terminal_state;
+
+interface      *host;
+terminal_state *terminal;
+
+void initialize(interface *input_interface, void *memory, bit reloaded)
+{
+	host      = input_interface;
+	terminal  = memory;
+	static_assert(sizeof(*terminal) <= PLUGIN_MEMORY_CAPACITY, "the terminal outgrew the plugin's memory");
+
+	if (!reloaded)
+	{
+		terminal->height     = 480;
+		terminal->bar_height = 24;
+	}
 
-	/* custom messages */
+	/* the output is made with the host's font */
+	terminal->font = &default_font;
+
+	/* custom messages, which are pushed again on every load, since their names
+	   were in the old copy of the plugin */
 	{
 		for (uint i = 0; i < CUSTOM_MESSAGE_TAGS_COUNT; ++i)
 		{
@@ -42,69 +101,148 @@ void initialize(interface *input_interface)
 				.key     = { KEY_MODIFIER_PRESSED | KEY_MODIFIER_CTRL, KEY_CODE_BACK_TICK },
 				.message = CUSTOM_MESSAGE_TAG_OPEN_TERMINAL,
 			});
+		push_mapping(
+			&(mapping){
+				.key     = { KEY_MODIFIER_PRESSED | KEY_MODIFIER_SHIFT, KEY_CODE_PAGE_UP },
+				.message = CUSTOM_MESSAGE_TAG_SCROLL_TERMINAL_UP,
+			});
+		push_mapping(
+			&(mapping){
+				.key     = { KEY_MODIFIER_PRESSED | KEY_MODIFIER_SHIFT, KEY_CODE_PAGE_DOWN },
+				.message = CUSTOM_MESSAGE_TAG_SCROLL_TERMINAL_DOWN,
+			});
+		push_mapping(
+			&(mapping){
+				.key     = { KEY_MODIFIER_PRESSED, KEY_CODE_F12 },
+				.message = CUSTOM_MESSAGE_TAG_TOGGLE_MEMORY_OVERLAY,
+			});
 	}
 }
 
-bit         terminal_openable = 0;
-bit         terminal_opened   = 0;
-const char *terminal_program_name;
-uint        terminal_height       = 480;
-uint        terminal_bar_height   = 24;
-uint        terminal_input_height = 24;
-font       *terminal_font;
-const char *terminal_output;
-uint        terminal_output_size;
-const char *terminal_input;
-uint        terminal_input_size;
-
 void open_terminal();
 void close_terminal();
+void get_terminal_size(uint *columns, uint *rows);
+void read_terminal_output(void);
+void write_terminal_input(void);
+void render_terminal_lines(void);
 
 void tick(float32 elapse)
 {
-	for (uint i = 0; i < interface->events_count; ++i)
+	for (uint i = 0; i < host->events_count; ++i)
 	{
-		const message *message = &interface->messages[i];
+		const message *message = &host->messages[i];
 		if (!message->is_custom) continue;
 
 		switch (message->tag)
 		{
 		case CUSTOM_MESSAGE_TAG_OPEN_TERMINAL:
-			terminal_openable ^= 1;
+			terminal->openable ^= 1;
+			break;
+		case CUSTOM_MESSAGE_TAG_SCROLL_TERMINAL_UP:
+			terminal->scroll += terminal->grid.rows / 2;
+			terminal->dirty   = 1;
+			break;
+		case CUSTOM_MESSAGE_TAG_SCROLL_TERMINAL_DOWN:
+			terminal->scroll = terminal->scroll > terminal->grid.rows / 2 ? terminal->scroll - terminal->grid.rows / 2 : 0;
+			terminal->dirty  = 1;
+			break;
+		case CUSTOM_MESSAGE_TAG_TOGGLE_MEMORY_OVERLAY:
+			terminal->memory_overlay ^= 1;
 			break;
 		default: unreachable();
 		}
 	}
 
-	terminal_openable && terminal_opened ? close_terminal() : open_terminal();
+	if (terminal->openable) terminal->opened ? close_terminal() : open_terminal();
 
-	if (terminal_opened)
+	if (terminal->opened)
 	{
+		/* the panel may have been resized; a change of width also reflows the
+		   scrollback */
+		uint columns, rows;
+		get_terminal_size(&columns, &rows);
+		if (columns != terminal->grid.columns || rows != terminal->grid.rows)
+		{
+			deallocate(terminal->lines, terminal->grid.rows * TERMINAL_LINE_CAPACITY, ALLOCATION_TAG_TERMINAL);
+			resize_terminal_grid(columns, rows, &terminal->grid);
+			resize_pseudoterminal(columns, rows, &terminal->pseudoterminal);
+			terminal->lines = allocate(rows * TERMINAL_LINE_CAPACITY, ALLOCATION_TAG_TERMINAL);
+			terminal->dirty = 1;
+		}
+
+		write_terminal_input();
+		read_terminal_output();
+
+		/* render at most once per refresh; the frames in between only count */
+		terminal->refresh_elapse += elapse;
+		if (terminal->dirty)
+		{
+			float32 refresh_interval = terminal->flooded ? TERMINAL_FLOOD_REFRESH_INTERVAL : TERMINAL_REFRESH_INTERVAL;
+			if (terminal->refresh_elapse >= refresh_interval)
+			{
+				render_terminal_lines();
+				terminal->dirty                  = 0;
+				terminal->refresh_elapse         = 0;
+				terminal->rendered_frames_count += 1;
+			}
+			else terminal->skipped_frames_count += 1;
+		}
+
+		/* what was left unparsed or unrendered needs another frame, soon or
+		   right away; otherwise the output wakes the host when it comes */
+		if (terminal->flooded) host->wait = 0;
+		else if (terminal->dirty)
+		{
+			uintl refresh_wait = (TERMINAL_REFRESH_INTERVAL - terminal->refresh_elapse) * TIME_SECONDS_FACTOR;
+			if (refresh_wait < host->wait) host->wait = refresh_wait;
+		}
+
 		ui_begin();
-			/* ensure the terminal appears from the base of the window */
-			ui_set_orientiation(ORIENTATION_VERTICAL);
+			/* ensure the terminal appears from the base of the window, under
+			   whatever room is left */
+			ui_set_orientation(ORIENTATION_VERTICAL);
+			ui_begin_box();
+				ui_set_expanding(1, 1);
+			ui_end_box();
 
 			/* build the terminal */
 			ui_begin_box();
-				ui_set_height(terminal_height);
+				ui_set_orientation(ORIENTATION_VERTICAL);
+				ui_set_expanding(1, 0);
+				ui_set_height(terminal->height);
 
 				/* build the terminal bar */
-				ui_begin_bar();
-					ui_set_height(terminal_bar_height);
-					ui_text("TERMINAL:%s", terminal_program_name);
-				ui_end_bar();
-
-				ui_set_font(terminal_font);
+				ui_begin_box();
+					ui_set_expanding(1, 0);
+					ui_set_height(terminal->bar_height);
+					ui_text("TERMINAL:%s", terminal->program_name);
+					ui_text("%llu bytes parsed, %llu frames rendered, %llu skipped%s", terminal->parsed_bytes_count, terminal->rendered_frames_count, terminal->skipped_frames_count, terminal->flooded ? " (flooded)" : "");
+				ui_end_box();
 
-				/* build the terminal output */
-				ui_text(terminal_output);
+				ui_set_font(terminal->font);
 
-				/* build the terminal input */
-				ui_begin_text_input();
-					ui_set_height(terminal_input_height * terminal_font->glyph_height);
+				/* build the terminal output from the last rendering */
+				for (uint i = 0; i < terminal->lines_count; ++i) ui_text("%s", terminal->lines + i * TERMINAL_LINE_CAPACITY);
+			ui_end_box();
+		ui_end();
+	}
 
-					ui_text_input(terminal_input, &terminal_input_size);
-				ui_end_text_input();
+	if (terminal->memory_overlay)
+	{
+		ui_begin();
+			ui_begin_box();
+				ui_set_orientation(ORIENTATION_VERTICAL);
+				for (uint i = 0; i < ALLOCATION_TAGS_COUNT; ++i)
+				{
+					const allocation_statistics *statistics = &global.allocations[i];
+					ui_text(
+						"%-10s %8llu KiB live in %5llu, %8llu KiB at peak, %8.1f KiB/s",
+						allocation_tag_representations[i],
+						atomic_load(&statistics->live_size) >> 10,
+						atomic_load(&statistics->live_count),
+						atomic_load(&statistics->peak_size) >> 10,
+						statistics->allocation_rate / 1024);
+				}
 			ui_end_box();
 		ui_end();
 	}
@@ -112,17 +250,186 @@ void tick(float32 elapse)
 
 void open_terminal(void)
 {
-	terminal_opened   = 1;
-	terminal_openable = 0;
+	terminal->opened   = 1;
+	terminal->openable = 0;
+
+#if defined(ON_WIN32)
+	const char *program_name = getenv("COMSPEC");
+	if (!program_name) program_name = "cmd.exe";
+#else
+	const char *program_name = getenv("SHELL");
+	if (!program_name) program_name = "/bin/sh";
+#endif
+	snprintf(terminal->program_name, sizeof(terminal->program_name), "%s", program_name);
+
+	uint columns, rows;
+	get_terminal_size(&columns, &rows);
+	initialize_terminal_grid(columns, rows, &terminal->grid);
+	initialize_scrollback(SCROLLBACK_DEFAULT_MEMORY_CAPACITY, &terminal->scrollback);
+	terminal->grid.scrollback = &terminal->scrollback;
+	reflow_scrollback(columns, &terminal->scrollback);
+	terminal->scroll                = 0;
+	terminal->parser                = (vt_parser){ .grid = &terminal->grid };
+	terminal->lines                 = allocate(rows * TERMINAL_LINE_CAPACITY, ALLOCATION_TAG_TERMINAL);
+	terminal->lines_count           = 0;
+	terminal->dirty                 = 1;
+	terminal->flooded               = 0;
+	terminal->refresh_elapse        = TERMINAL_REFRESH_INTERVAL;
+	terminal->parsed_bytes_count    = 0;
+	terminal->rendered_frames_count = 0;
+	terminal->skipped_frames_count  = 0;
+	open_pseudoterminal(terminal->program_name, columns, rows, &terminal->pseudoterminal);
+}
+
+/* the grid fills the panel under its bar, which spans the frame, with as many
+   whole glyphs as fit */
+void get_terminal_size(uint *columns, uint *rows)
+{
+	uint output_height = terminal->height > terminal->bar_height ? terminal->height - terminal->bar_height : 0;
+	*columns = host->frame_width / terminal->font->glyph_width;
+	*rows    = output_height / terminal->font->glyph_height;
+	if (!*columns) *columns = 1;
+	if (!*rows)    *rows    = 1;
 }
 
 void close_terminal(void)
 {
-	terminal_opened   = 0;
-	terminal_openable = 0;
+	terminal->opened   = 0;
+	terminal->openable = 0;
+
+	close_pseudoterminal(&terminal->pseudoterminal);
+	terminate_terminal_grid(&terminal->grid);
+	terminate_scrollback(&terminal->scrollback);
+	deallocate(terminal->lines, terminal->grid.rows * TERMINAL_LINE_CAPACITY, ALLOCATION_TAG_TERMINAL);
 }
 
-void terminate(void)
+/* parses what the reader thread has gathered since the last frame, in chunks,
+   until the budget runs out; never waits for the program */
+void read_terminal_output(void)
+{
+	ring *ring           = &terminal->pseudoterminal.output_ring;
+	uintl budget         = terminal->flooded ? TERMINAL_FLOOD_PARSING_BUDGET : TERMINAL_PARSING_BUDGET;
+	uintl beginning_time = get_time();
+
+	terminal->flooded = 0;
+	for (;;)
+	{
+		uint size;
+		const byte *region = begin_ring_read(&size, ring);
+		if (!size) break;
+		if (size > TERMINAL_PARSING_CHUNK_SIZE) size = TERMINAL_PARSING_CHUNK_SIZE;
+
+		parse_vt(region, size, &terminal->parser);
+		end_ring_read(size, ring);
+		terminal->parsed_bytes_count += size;
+		terminal->dirty               = 1;
+
+		if (get_time() - beginning_time >= budget)
+		{
+			/* the rest waits for the next frame */
+			begin_ring_read(&size, ring);
+			terminal->flooded = size != 0;
+			break;
+		}
+	}
+	update_scrollback(&terminal->scrollback);
+}
+
+/* what a terminal sends for the keys that type no text */
+const char *get_terminal_key_sequence(key_code code)
 {
+	switch (code)
+	{
+	case KEY_CODE_UP:        return "\x1b[A";
+	case KEY_CODE_DOWN:      return "\x1b[B";
+	case KEY_CODE_RIGHT:     return "\x1b[C";
+	case KEY_CODE_LEFT:      return "\x1b[D";
+	case KEY_CODE_HOME:      return "\x1b[H";
+	case KEY_CODE_END:       return "\x1b[F";
+	case KEY_CODE_INSERT:    return "\x1b[2~";
+	case KEY_CODE_DELETE:    return "\x1b[3~";
+	case KEY_CODE_PAGE_UP:   return "\x1b[5~";
+	case KEY_CODE_PAGE_DOWN: return "\x1b[6~";
+	case KEY_CODE_F1:        return "\x1bOP";
+	case KEY_CODE_F2:        return "\x1bOQ";
+	case KEY_CODE_F3:        return "\x1bOR";
+	case KEY_CODE_F4:        return "\x1bOS";
+	case KEY_CODE_F5:        return "\x1b[15~";
+	case KEY_CODE_F6:        return "\x1b[17~";
+	case KEY_CODE_F7:        return "\x1b[18~";
+	case KEY_CODE_F8:        return "\x1b[19~";
+	case KEY_CODE_F9:        return "\x1b[20~";
+	case KEY_CODE_F10:       return "\x1b[21~";
+	case KEY_CODE_F11:       return "\x1b[23~";
+	case KEY_CODE_F12:       return "\x1b[24~";
+	default:                 return 0;
+	}
+}
 
+/* sends what was typed during the frame to the program, and scrolls back
+   down to it */
+void write_terminal_input(void)
+{
+	char input[INTERFACE_EVENTS_CAPACITY * TERMINAL_INPUT_ENCODING_CAPACITY];
+	uint size = 0;
+	for (uint i = 0; i < host->inputs_count; ++i)
+	{
+		const input_event *event = &host->inputs[i];
+		if (event->tag == INPUT_EVENT_TAG_TEXT)
+		{
+			/* backspace erases with DEL, as terminals send it */
+			size += encode_utf8(event->rune == '\b' ? 0x7f : event->rune, input + size);
+			continue;
+		}
+
+		const char *sequence = get_terminal_key_sequence(event->key.code);
+		if (!sequence) continue;
+		uint sequence_size = strlen(sequence);
+		copy(input + size, sequence, sequence_size);
+		size += sequence_size;
+	}
+	if (!size) return;
+
+	write_to_pseudoterminal(input, size, &terminal->pseudoterminal);
+	if (terminal->scroll)
+	{
+		terminal->scroll = 0;
+		terminal->dirty  = 1;
+	}
+}
+
+/* converts the rows in view, `terminal->scroll` rows back, into lines of text */
+void render_terminal_lines(void)
+{
+	uintl line;
+	uint  row;
+	terminal->scroll = seek_scrollback_row(terminal->scroll, &line, &row, &terminal->scrollback);
+
+	uintl end_line = terminal->scrollback.first_line + terminal->scrollback.lines_count;
+	uint  grid_row = 0;
+	for (uint i = 0; i < terminal->grid.rows; ++i)
+	{
+		char *line_text = terminal->lines + i * TERMINAL_LINE_CAPACITY;
+		if (line < end_line)
+		{
+			/* a row of a line that wraps at the grid's width */
+			const terminal_cell *cells;
+			uint size  = get_scrollback_line(line, &cells, &terminal->scrollback);
+			uint start = row * terminal->grid.columns;
+			uint count = size - start < terminal->grid.columns ? size - start : terminal->grid.columns;
+			get_terminal_cells_text(cells + start, count, line_text, TERMINAL_LINE_CAPACITY);
+			if (++row == count_scrollback_rows(size, terminal->grid.columns))
+			{
+				line += 1;
+				row   = 0;
+			}
+		}
+		else get_terminal_grid_row_text(grid_row++, line_text, TERMINAL_LINE_CAPACITY, &terminal->grid);
+	}
+	terminal->lines_count = terminal->grid.rows;
+}
+
+void terminate(void)
+{
+	if (terminal->opened) close_terminal();
 }